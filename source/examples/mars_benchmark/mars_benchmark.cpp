@@ -0,0 +1,880 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/batch_smoother.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/measurement_archive.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/ipc_ingest.h>
+#include <mars/sensors/gps/gps_conversion.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pressure/pressure_conversion.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/shm_state.h>
+#include <mars/shm_state_publisher.h>
+#include <mars/state_history.h>
+#include <mars/type_definitions/core_type.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Benchmarks of filter configurations on synthetic data. Each scenario runs the same measurements through the
+// configurations that are compared and prints the processing time.
+//
+// Scenarios:
+//   cross_cov  Lazy and incremental core-sensor cross-covariance propagation for different update rates and numbers
+//              of position sensors with a 200 Hz IMU
+//   propagation  Matrix exponential and closed-form quaternion integration kernel of CoreState::PropagateState, time
+//                and CPU cycles (x86 only) per propagation step
+//   gps_enu    Scalar and batch WGS84 to ENU conversion of global and local coordinates, time per fix and the maximum
+//              difference to the scalar conversion
+//   pressure_height  Exact and fast gas height conversion within +-20 % of the reference pressure, time per sample
+//                    and the maximum difference to the exact conversion
+//   archive    Measurement archives of a 200 Hz IMU stream with increasing duration, time to open the archive and to
+//              read a 1 s and a 300 s window from its middle
+//   state_history  Filter estimates at past times from checkpoints and replay for different checkpoint intervals, time
+//                  of a single query, of 1000 sorted queries, and the expected time of a rerun up to a random time
+//   batch_smoother  Offline RTS smoothing of a complete recording with an increasing number of threads, time of the
+//                   backward pass and of writing the smoothed states with covariance to a csv and a binary file
+//   ipc_ingest  Measurement ingestion through a Unix domain socket from a load generator process compared to direct
+//               processing, throughput and the latency from sending a measurement to its state in shared memory
+//
+// Usage: mars_benchmark [--duration SECONDS] [SCENARIO ...]
+
+struct BenchmarkResult
+{
+  double t_total_{ 0 };   ///< Processing time of all measurements [s]
+  double t_update_{ 0 };  ///< Processing time of the update sensor measurements [s]
+  int num_updates_{ 0 };
+  Eigen::Vector3d p_wi_{ Eigen::Vector3d::Zero() };  ///< Final position estimate
+};
+
+BenchmarkResult RunCrossCov(const mars::SyntheticDataGenerator& generator, const bool& incremental)
+{
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr };
+  for (int k = 1; k < generator.get_num_sensors(); k++)
+  {
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position" + std::to_string(k), core_states_sptr);
+    position_sensor_sptr->const_ref_to_nav_ = true;
+    position_sensor_sptr->incremental_cross_cov_ = incremental;
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.02 * 0.02);
+
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    sensors.push_back(position_sensor_sptr);
+  }
+
+  // The buffer holds the sensor states of the lowest update rate
+  mars::CoreLogic core_logic(core_states_sptr);
+  core_logic.buffer_.set_max_buffer_size(2000);
+  const std::vector<mars::SyntheticMeasurement> stream = generator.get_arrival_stream();
+
+  BenchmarkResult result;
+  const auto t_start = std::chrono::steady_clock::now();
+
+  for (const auto& k : stream)
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+
+    if (k.sensor_idx_ == 0)
+    {
+      core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+      if (!core_logic.core_is_initialized_)
+      {
+        const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+        core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+      }
+    }
+    else
+    {
+      const auto t_update_start = std::chrono::steady_clock::now();
+      core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+      result.t_update_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - t_update_start).count();
+      result.num_updates_++;
+    }
+  }
+
+  result.t_total_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+  mars::BufferEntryType latest_state;
+  if (core_logic.buffer_.get_latest_state(&latest_state))
+  {
+    result.p_wi_ = static_cast<mars::CoreType*>(latest_state.data_.core_.get())->state_.p_wi_;
+  }
+
+  return result;
+}
+
+void BenchmarkCrossCov(const double& duration)
+{
+  std::cout << "Cross-covariance propagation, IMU 200 Hz, " << duration << " s" << std::endl;
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << std::setw(8) << "sensors" << std::setw(10) << "rate[Hz]" << std::setw(16) << "lazy upd[us]"
+            << std::setw(16) << "incr upd[us]" << std::setw(14) << "lazy tot[s]" << std::setw(14) << "incr tot[s]"
+            << std::setw(14) << "diff p[m]" << std::endl;
+
+  for (const int& num_sensors : { 1, 3 })
+  {
+    for (const double& rate : { 2.0, 10.0, 50.0, 200.0 })
+    {
+      mars::SyntheticTrajectoryOptions options;
+      options.duration_ = duration;
+      options.seed_ = 1;
+      mars::SyntheticDataGenerator generator(options);
+
+      mars::SyntheticSensorOptions imu_options;
+      imu_options.type_ = mars::SyntheticSensorType::imu;
+      imu_options.rate_ = 200;
+      generator.AddSensor(imu_options);
+
+      for (int k = 0; k < num_sensors; k++)
+      {
+        mars::SyntheticSensorOptions position_options;
+        position_options.type_ = mars::SyntheticSensorType::position;
+        position_options.rate_ = rate;
+        position_options.noise_std_ = 0.02;
+        position_options.timestamp_jitter_ = 0.2 / rate;
+        generator.AddSensor(position_options);
+      }
+
+      const BenchmarkResult lazy = RunCrossCov(generator, false);
+      const BenchmarkResult incremental = RunCrossCov(generator, true);
+
+      std::cout << std::fixed << std::setprecision(3);
+      std::cout << std::setw(8) << num_sensors << std::setw(10) << rate << std::setw(16)
+                << 1e6 * lazy.t_update_ / lazy.num_updates_ << std::setw(16)
+                << 1e6 * incremental.t_update_ / incremental.num_updates_ << std::setw(14) << lazy.t_total_
+                << std::setw(14) << incremental.t_total_ << std::setw(14) << std::scientific
+                << std::setprecision(1) << (lazy.p_wi_ - incremental.p_wi_).norm() << std::endl;
+    }
+  }
+}
+
+uint64_t CycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+void BenchmarkPropagation()
+{
+  constexpr int num_steps = 1000000;
+
+  // Pregenerated IMU measurements, such that only the kernel is measured
+  std::vector<mars::IMUMeasurementType> measurements;
+  measurements.reserve(1000);
+  for (int k = 0; k < 1000; k++)
+  {
+    measurements.emplace_back(Eigen::Vector3d(0, 0, 9.81) + Eigen::Vector3d::Random(), Eigen::Vector3d::Random());
+  }
+
+  std::cout << "State propagation, " << num_steps << " steps" << std::endl;
+  std::cout << std::setw(14) << "kernel" << std::setw(14) << "time[ns]" << std::setw(14) << "cycles" << std::endl;
+
+  for (const bool& closed_form : { false, true })
+  {
+    mars::CoreState core_state;
+    core_state.closed_form_quat_integration_ = closed_form;
+
+    mars::CoreStateType state;
+    Eigen::Matrix3d R_wi(state.q_wi_.toRotationMatrix());
+    const auto t_start = std::chrono::steady_clock::now();
+    const uint64_t cycles_start = CycleCounter();
+
+    for (int k = 0; k < num_steps; k++)
+    {
+      state = core_state.PropagateState(state, R_wi, measurements[k % measurements.size()], 0.005, &R_wi);
+    }
+
+    const uint64_t cycles = CycleCounter() - cycles_start;
+    const double t_total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(14) << (closed_form ? "closed_form" : "matexp") << std::setw(14) << 1e9 * t_total / num_steps
+              << std::setw(14) << static_cast<double>(cycles) / num_steps << "   (p_wi " << state.p_wi_.transpose()
+              << ")" << std::endl;
+  }
+}
+
+void BenchmarkGpsEnu()
+{
+  constexpr int num_fixes = 1000000;
+  const mars::GpsCoordinates reference(46.614798, 14.2628073, 450);
+  mars::GpsConversion gps_conversion(reference);
+
+  std::cout << "WGS84 to ENU conversion, " << num_fixes << " fixes" << std::endl;
+  std::cout << std::setw(14) << "coordinates" << std::setw(14) << "scalar[ns]" << std::setw(14) << "batch[ns]"
+            << std::setw(14) << "diff[m]" << std::endl;
+
+  for (const bool& local : { false, true })
+  {
+    const Eigen::ArrayXd latitude = local ? (reference.latitude_ + 0.1 * Eigen::ArrayXd::Random(num_fixes)).eval() :
+                                            (90 * Eigen::ArrayXd::Random(num_fixes)).eval();
+    const Eigen::ArrayXd longitude = local ? (reference.longitude_ + 0.1 * Eigen::ArrayXd::Random(num_fixes)).eval() :
+                                             (180 * Eigen::ArrayXd::Random(num_fixes)).eval();
+    const Eigen::ArrayXd altitude = reference.altitude_ + 100 * Eigen::ArrayXd::Random(num_fixes);
+
+    Eigen::Matrix3Xd enu_scalar(3, num_fixes);
+    const auto t_scalar_start = std::chrono::steady_clock::now();
+    for (int k = 0; k < num_fixes; k++)
+    {
+      enu_scalar.col(k) = gps_conversion.get_enu(mars::GpsCoordinates(latitude(k), longitude(k), altitude(k)));
+    }
+    const double t_scalar = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_scalar_start).count();
+
+    Eigen::Matrix3Xd enu_batch;
+    const auto t_batch_start = std::chrono::steady_clock::now();
+    gps_conversion.get_enu_batch(latitude, longitude, altitude, &enu_batch);
+    const double t_batch = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_batch_start).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(14) << (local ? "local" : "global") << std::setw(14) << 1e9 * t_scalar / num_fixes
+              << std::setw(14) << 1e9 * t_batch / num_fixes << std::setw(14) << std::scientific << std::setprecision(1)
+              << (enu_batch - enu_scalar).colwise().norm().maxCoeff() << std::endl;
+  }
+}
+
+void BenchmarkPressureHeight()
+{
+  constexpr int num_samples = 1000000;
+  const mars::Pressure reference(101325, 293.15, mars::Pressure::Type::GAS);
+
+  const Eigen::ArrayXd pressure = reference.data_ * (1 + 0.2 * Eigen::ArrayXd::Random(num_samples));
+  const Eigen::ArrayXd temperature = 300 + 20 * Eigen::ArrayXd::Random(num_samples);
+
+  mars::PressureConversion exact(reference);
+  Eigen::ArrayXd height_exact(num_samples);
+  const auto t_exact_start = std::chrono::steady_clock::now();
+  for (int k = 0; k < num_samples; k++)
+  {
+    height_exact(k) = exact.get_height(mars::Pressure(pressure(k), temperature(k), mars::Pressure::Type::GAS))(0);
+  }
+  const double t_exact = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_exact_start).count();
+
+  std::cout << "Gas height conversion, " << num_samples << " samples, exact " << std::fixed << std::setprecision(1)
+            << 1e9 * t_exact / num_samples << " ns" << std::endl;
+  std::cout << std::setw(14) << "max_error[m]" << std::setw(8) << "terms" << std::setw(14) << "batch[ns]"
+            << std::setw(14) << "diff[m]" << std::endl;
+
+  for (const double& max_error : { 1e-2, 1e-3, 1e-6 })
+  {
+    mars::PressureConversion fast(reference);
+    const int terms = fast.set_fast_height(max_error, 0.2);
+
+    Eigen::ArrayXd height_fast;
+    const auto t_fast_start = std::chrono::steady_clock::now();
+    fast.get_height_batch(pressure, temperature, mars::Pressure::Type::GAS, &height_fast);
+    const double t_fast = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_fast_start).count();
+
+    std::cout << std::scientific << std::setprecision(0) << std::setw(14) << max_error << std::setw(8) << terms
+              << std::fixed << std::setprecision(1) << std::setw(14) << 1e9 * t_fast / num_samples << std::setw(14)
+              << std::scientific << (height_fast - height_exact).abs().maxCoeff() << std::endl;
+  }
+}
+
+void BenchmarkArchive()
+{
+  const std::string archive_path = "mars_benchmark_archive.bin";
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+
+  std::cout << "Measurement archive, 200 Hz IMU" << std::endl;
+  std::cout << std::setw(12) << "duration[s]" << std::setw(12) << "records" << std::setw(12) << "size[MB]"
+            << std::setw(12) << "open[ms]" << std::setw(12) << "1s[ms]" << std::setw(12) << "300s[ms]" << std::endl;
+
+  for (const int& duration : { 600, 1800, 7200 })
+  {
+    const int num_records = 200 * duration;
+    {
+      mars::MeasurementArchiveWriter writer(archive_path);
+      const int stream_id = writer.AddStream("IMU", mars::JournalPayloadType::imu);
+      for (int k = 0; k < num_records; k++)
+      {
+        const double t = k * 0.005;
+        writer.Append(stream_id, t,
+                      std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81),
+                                                                 Eigen::Vector3d(std::sin(t), std::cos(t), 0)));
+      }
+    }
+
+    const auto t_open_start = std::chrono::steady_clock::now();
+    mars::MeasurementArchiveReader reader(archive_path);
+    const double t_open = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_open_start).count();
+
+    std::vector<mars::BufferEntryType> data;
+    const double t_mid = 0.5 * duration;
+
+    const auto t_short_start = std::chrono::steady_clock::now();
+    reader.Read("IMU", t_mid, t_mid + 1, imu_sensor_sptr, &data);
+    const double t_short = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_short_start).count();
+
+    const auto t_long_start = std::chrono::steady_clock::now();
+    reader.Read("IMU", t_mid, t_mid + 300, imu_sensor_sptr, &data);
+    const double t_long = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_long_start).count();
+
+    std::ifstream file(archive_path, std::ios::binary | std::ios::ate);
+    const double size = static_cast<double>(file.tellg()) / (1 << 20);
+
+    std::cout << std::fixed << std::setprecision(3) << std::setw(12) << duration << std::setw(12) << num_records
+              << std::setw(12) << std::setprecision(1) << size << std::setprecision(3) << std::setw(12)
+              << 1e3 * t_open << std::setw(12) << 1e3 * t_short << std::setw(12) << 1e3 * t_long << std::endl;
+  }
+
+  std::remove(archive_path.c_str());
+}
+
+void BenchmarkStateHistory(const double& duration)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = duration;
+  options.seed_ = 1;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 10;
+  position_options.noise_std_ = 0.02;
+
+  std::shared_ptr<mars::SweepDataset> dataset = std::make_shared<mars::SweepDataset>();
+  dataset->AddSensorMeasurements(generator.get_sensor_measurements(generator.AddSensor(imu_options)));
+  dataset->AddSensorMeasurements(generator.get_sensor_measurements(generator.AddSensor(position_options)));
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> time_dist(0, duration);
+  std::vector<mars::Time> times(1000);
+  for (auto& k : times)
+  {
+    k = time_dist(rng);
+  }
+
+  struct Result
+  {
+    double interval_;
+    int num_checkpoints_;
+    double t_run_;
+    double t_query_;
+    double t_batch_;
+  };
+  std::vector<Result> results;
+
+  // All filters are created before the table is printed
+  for (const double& interval : { 1.0, 5.0, 20.0 })
+  {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->const_ref_to_nav_ = true;
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.02 * 0.02);
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    mars::SweepRunSetup setup;
+    setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    setup.sensors_ = { imu_sensor_sptr, position_sensor_sptr };
+    setup.init_from_ground_truth_ = false;
+    setup.p_wi_init_ = generator.get_ground_truth(0).p_wi_;
+    setup.q_wi_init_ = generator.get_ground_truth(0).q_wi_;
+
+    mars::StateHistory history(dataset, setup);
+    history.checkpoint_interval_ = interval;
+
+    Result result;
+    result.interval_ = interval;
+
+    const auto t_run_start = std::chrono::steady_clock::now();
+    history.Run();
+    result.t_run_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_run_start).count();
+    result.num_checkpoints_ = history.get_num_checkpoints();
+
+    // Single queries in random order restore a checkpoint each
+    mars::BufferEntryType state;
+    const auto t_query_start = std::chrono::steady_clock::now();
+    for (int k = 0; k < 100; k++)
+    {
+      history.get_state(times[k], &state);
+    }
+    result.t_query_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_query_start).count() / 100;
+
+    std::vector<mars::BufferEntryType> states;
+    const auto t_batch_start = std::chrono::steady_clock::now();
+    history.get_states(times, &states);
+    result.t_batch_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_batch_start).count();
+
+    results.push_back(result);
+  }
+
+  std::cout << std::defaultfloat << "State history, IMU 200 Hz, position 10 Hz, " << duration << " s" << std::endl;
+  std::cout << std::setw(14) << "interval[s]" << std::setw(14) << "checkpoints" << std::setw(12) << "run[s]"
+            << std::setw(14) << "query[ms]" << std::setw(16) << "1000 sorted[s]" << std::setw(14) << "rerun[ms]"
+            << std::endl;
+
+  for (const auto& k : results)
+  {
+    // A rerun up to a uniformly distributed time processes half of the measurements on average
+    std::cout << std::fixed << std::setprecision(3) << std::setw(14) << k.interval_ << std::setw(14)
+              << k.num_checkpoints_ << std::setw(12) << k.t_run_ << std::setw(14) << 1e3 * k.t_query_ << std::setw(16)
+              << k.t_batch_ << std::setw(14) << 1e3 * 0.5 * k.t_run_ << std::endl;
+  }
+}
+
+void BenchmarkBatchSmoother(const double& duration)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = duration;
+  options.seed_ = 1;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 10;
+  position_options.noise_std_ = 0.02;
+  generator.AddSensor(position_options);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+      std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+  position_sensor_sptr->const_ref_to_nav_ = true;
+  position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.02 * 0.02);
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+  position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, position_sensor_sptr };
+
+  // Forward pass, the filter records the steps
+  std::shared_ptr<mars::BatchSmoother> smoother = std::make_shared<mars::BatchSmoother>();
+  mars::CoreLogic core_logic(core_states_sptr);
+  core_logic.smoother_ = smoother;
+
+  const auto t_forward_start = std::chrono::steady_clock::now();
+  for (const auto& k : generator.get_arrival_stream())
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+    core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+    if (!core_logic.core_is_initialized_)
+    {
+      const mars::CoreStateType ground_truth = generator.get_ground_truth(k.timestamp_.get_seconds());
+      core_logic.Initialize(ground_truth.p_wi_, ground_truth.q_wi_);
+    }
+  }
+  const double t_forward = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_forward_start).count();
+
+  struct Result
+  {
+    int num_threads_;
+    double t_smooth_;
+    double t_write_csv_;
+    double t_write_binary_;
+  };
+  std::vector<Result> results;
+
+  const std::string csv_path("mars_benchmark_smoothed.csv");
+  const std::string binary_path("mars_benchmark_smoothed.bin");
+  const int max_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+  {
+    Result result;
+    result.num_threads_ = num_threads;
+
+    std::vector<mars::BufferEntryType> entries;
+    const auto t_smooth_start = std::chrono::steady_clock::now();
+    smoother->Smooth(&entries, num_threads);
+    result.t_smooth_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_smooth_start).count();
+
+    const auto t_write_csv_start = std::chrono::steady_clock::now();
+    mars::BatchSmoother::WriteCsvFile(csv_path, entries, true, num_threads);
+    result.t_write_csv_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_write_csv_start).count();
+
+    const auto t_write_binary_start = std::chrono::steady_clock::now();
+    mars::BatchSmoother::WriteBinaryFile(binary_path, entries);
+    result.t_write_binary_ =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - t_write_binary_start).count();
+
+    results.push_back(result);
+  }
+  std::remove(csv_path.c_str());
+  std::remove(binary_path.c_str());
+
+  std::cout << std::defaultfloat << "Batch smoother, IMU 200 Hz, position 10 Hz, " << duration << " s, "
+            << smoother->get_num_nodes() << " steps, forward pass " << t_forward << " s" << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(14) << "smooth[s]" << std::setw(14) << "csv[s]" << std::setw(14)
+            << "binary[s]" << std::endl;
+
+  for (const auto& k : results)
+  {
+    std::cout << std::fixed << std::setprecision(3) << std::setw(10) << k.num_threads_ << std::setw(14) << k.t_smooth_
+              << std::setw(14) << k.t_write_csv_ << std::setw(14) << k.t_write_binary_ << std::endl;
+  }
+}
+
+// Filter with an IMU and a position sensor that publishes its state to shared memory
+std::shared_ptr<mars::CoreLogic> CreateIngestFilter(const std::string& shm_name,
+                                                    std::vector<std::shared_ptr<mars::SensorAbsClass>>* sensors)
+{
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+      std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+  position_sensor_sptr->const_ref_to_nav_ = true;
+  position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.02 * 0.02);
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+  position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+  core_logic->state_publisher_ = std::make_shared<mars::ShmStatePublisher>(shm_name);
+  core_logic->state_publisher_period_ = 0;
+  core_logic->state_publisher_->AddSensor(position_sensor_sptr);
+
+  *sensors = { imu_sensor_sptr, position_sensor_sptr };
+  return core_logic;
+}
+
+// Load generator of the ipc_ingest scenario, runs in a child process. Sends the encoded recording at once, waits for
+// the start signal of the server and then sends single IMU measurements and waits for the published state of each.
+// Writes the mean, p50, p99 and max latency [us] to the result pipe.
+int RunIngestClient(const std::string& socket_path, const std::string& shm_name, const mars::IngestEncoder& recording,
+                    const double& t_last, const int& start_fd, const int& result_fd)
+{
+  mars::IngestClient client;
+  mars::ShmStateReader reader;
+  if (!client.Connect(socket_path) || !reader.Open(shm_name))
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Throughput, the data is written in blocks of the socket buffer size
+  const std::vector<char>& data = recording.get_data();
+  const size_t block_size = 1 << 16;
+  for (size_t k = 0; k < data.size(); k += block_size)
+  {
+    if (!client.Send(data.data() + k, std::min(block_size, data.size() - k)))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  char start;
+  if (read(start_fd, &start, 1) != 1)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Latency, from sending a measurement to the state of the measurement in shared memory
+  const int num_samples = 2000;
+  std::vector<double> latencies;
+  const std::shared_ptr<mars::IMUMeasurementType> imu_meas =
+      std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero());
+
+  // The sensor record is sent with the first measurement and replaces the id of the recording
+  mars::IngestEncoder encoder;
+  const int imu_id = encoder.AddSensor("IMU", mars::JournalPayloadType::imu);
+
+  for (int k = 0; k < num_samples; k++)
+  {
+    encoder.AddMeasurement(imu_id, t_last + 0.005 * (k + 1), imu_meas);
+
+    const uint64_t sequence = reader.get_latest_sequence();
+    const auto t_start = std::chrono::steady_clock::now();
+    if (!client.Send(encoder))
+    {
+      return EXIT_FAILURE;
+    }
+    encoder.Clear();
+
+    while (reader.get_latest_sequence() == sequence)
+    {
+    }
+    latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_start).count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+  for (const auto& k : latencies)
+  {
+    sum += k;
+  }
+
+  const double result[4] = { sum / num_samples, latencies[num_samples / 2], latencies[num_samples * 99 / 100],
+                             latencies.back() };
+  return write(result_fd, result, sizeof(result)) == sizeof(result) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void BenchmarkIpcIngest(const double& duration)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = duration;
+  options.seed_ = 1;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 10;
+  position_options.noise_std_ = 0.02;
+  generator.AddSensor(position_options);
+
+  const std::string socket_path = "mars_benchmark_" + std::to_string(getpid()) + ".sock";
+  const std::string shm_name = "/mars_benchmark_" + std::to_string(getpid());
+
+  // Recording with the initialization after the first IMU measurement
+  mars::IngestEncoder recording;
+  const std::vector<int> sensor_ids = { recording.AddSensor("IMU", mars::JournalPayloadType::imu),
+                                        recording.AddSensor("Position", mars::JournalPayloadType::position) };
+  int num_measurements = 0;
+  double t_last = 0;
+  for (const auto& k : generator.get_arrival_stream())
+  {
+    recording.AddMeasurement(sensor_ids[k.sensor_idx_], k.timestamp_, k.data_);
+    num_measurements++;
+    t_last = k.timestamp_.get_seconds();
+
+    if (num_measurements == 1)
+    {
+      const mars::CoreStateType ground_truth = generator.get_ground_truth(t_last);
+      recording.AddInitialize(ground_truth.p_wi_, ground_truth.q_wi_);
+    }
+  }
+
+  // Direct processing of the same calls as reference
+  double t_direct = 0;
+  {
+    std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors;
+    std::shared_ptr<mars::CoreLogic> core_logic = CreateIngestFilter(shm_name, &sensors);
+    mars::IngestDecoder decoder;
+    mars::JournalRecord record;
+    std::vector<mars::JournalRecord> records;
+    size_t offset = 0;
+    while (decoder.Decode(recording.get_data().data(), recording.get_data().size(), &offset, &record) ==
+           mars::IngestDecodeResult::record)
+    {
+      records.push_back(record);
+    }
+
+    const auto t_start = std::chrono::steady_clock::now();
+    for (const auto& k : records)
+    {
+      if (k.type_ == mars::JournalRecordType::measurement)
+      {
+        mars::BufferDataType data;
+        data.set_sensor_data(k.payload_);
+        core_logic->ProcessMeasurement(sensors[k.sensor_id_], k.timestamp_, data);
+      }
+      else if (k.type_ == mars::JournalRecordType::initialize)
+      {
+        core_logic->Initialize(k.p_wi_, k.q_wi_);
+      }
+    }
+    t_direct = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+  }
+
+  std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors;
+  std::shared_ptr<mars::CoreLogic> core_logic = CreateIngestFilter(shm_name, &sensors);
+  mars::IngestServer server(core_logic, socket_path);
+  int start_pipe[2];
+  int result_pipe[2];
+  if (!server.is_open() || pipe(start_pipe) != 0 || pipe(result_pipe) != 0)
+  {
+    std::cout << "Error: Could not set up the ingestion server" << std::endl;
+    return;
+  }
+  server.AddSensor(sensors[0], mars::JournalPayloadType::imu);
+  server.AddSensor(sensors[1], mars::JournalPayloadType::position);
+
+  std::cout.flush();
+  const auto t_start = std::chrono::steady_clock::now();
+  const pid_t pid = fork();
+  if (pid == 0)
+  {
+    _exit(RunIngestClient(socket_path, shm_name, recording, t_last, start_pipe[0], result_pipe[1]));
+  }
+
+  while (pid > 0 && server.num_measurements_ < static_cast<uint64_t>(num_measurements) && server.Poll(100) >= 0)
+  {
+  }
+  const double t_ipc = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+  // Latency phase, served until the client exits
+  int status = 0;
+  if (pid > 0 && write(start_pipe[1], "s", 1) == 1)
+  {
+    while (waitpid(pid, &status, WNOHANG) == 0)
+    {
+      server.Poll(1);
+    }
+  }
+
+  double latency[4] = { 0, 0, 0, 0 };
+  const bool has_latency = pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS &&
+                           read(result_pipe[0], latency, sizeof(latency)) == sizeof(latency);
+
+  for (const int& fd : { start_pipe[0], start_pipe[1], result_pipe[0], result_pipe[1] })
+  {
+    close(fd);
+  }
+
+  const double size = static_cast<double>(recording.get_data().size()) / (1 << 20);
+  std::cout << std::defaultfloat << "IPC ingestion, IMU 200 Hz, position 10 Hz, " << duration << " s, "
+            << num_measurements << " measurements, " << std::setprecision(3) << size << " MB" << std::endl;
+  std::cout << std::setw(10) << "input" << std::setw(12) << "time[s]" << std::setw(14) << "meas/s" << std::setw(12)
+            << "MB/s" << std::endl;
+  const std::vector<std::pair<std::string, double>> rows = { { "direct", t_direct }, { "socket", t_ipc } };
+  for (const auto& k : rows)
+  {
+    std::cout << std::fixed << std::setprecision(3) << std::setw(10) << k.first << std::setw(12) << k.second
+              << std::setw(14) << std::setprecision(0) << num_measurements / k.second << std::setw(12)
+              << std::setprecision(1) << size / k.second << std::endl;
+  }
+
+  if (has_latency)
+  {
+    std::cout << std::fixed << std::setprecision(1) << "Latency socket to shared memory state [us]: mean "
+              << latency[0] << " p50 " << latency[1] << " p99 " << latency[2] << " max " << latency[3] << std::endl;
+  }
+  else
+  {
+    std::cout << "Error: The load generator failed" << std::endl;
+  }
+}
+
+void print_usage()
+{
+  std::cout << "Usage: mars_benchmark [--duration SECONDS] [SCENARIO ...]" << std::endl;
+  std::cout << "  --duration  Duration of the synthetic datasets, default 30 s" << std::endl;
+  std::cout << "  SCENARIO    cross_cov, propagation, gps_enu, pressure_height, archive, state_history, batch_smoother,"
+            << std::endl;
+  std::cout << "              ipc_ingest" << std::endl;
+  std::cout << "              All scenarios are run by default" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  double duration = 30;
+  std::vector<std::string> scenarios;
+
+  for (int k = 1; k < argc; k++)
+  {
+    if (!std::strcmp(argv[k], "--duration") && k + 1 < argc)
+    {
+      duration = std::stod(argv[++k]);
+    }
+    else if (argv[k][0] != '-')
+    {
+      scenarios.push_back(argv[k]);
+    }
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (scenarios.empty())
+  {
+    scenarios = { "cross_cov", "propagation",   "gps_enu",        "pressure_height",
+                  "archive",   "state_history", "batch_smoother", "ipc_ingest" };
+  }
+
+  for (const auto& k : scenarios)
+  {
+    if (k == "cross_cov")
+    {
+      BenchmarkCrossCov(duration);
+    }
+    else if (k == "propagation")
+    {
+      BenchmarkPropagation();
+    }
+    else if (k == "gps_enu")
+    {
+      BenchmarkGpsEnu();
+    }
+    else if (k == "pressure_height")
+    {
+      BenchmarkPressureHeight();
+    }
+    else if (k == "archive")
+    {
+      BenchmarkArchive();
+    }
+    else if (k == "state_history")
+    {
+      BenchmarkStateHistory(duration);
+    }
+    else if (k == "batch_smoother")
+    {
+      BenchmarkBatchSmoother(duration);
+    }
+    else if (k == "ipc_ingest")
+    {
+      BenchmarkIpcIngest(duration);
+    }
+    else
+    {
+      std::cout << "Error: Unknown scenario " << k << std::endl;
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -11,16 +11,475 @@
 // FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 // DEALINGS IN THE SOFTWARE.
 
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/read_imu_data.h>
+#include <mars/data_utils/read_pose_data.h>
+#include <mars/data_utils/read_position_data.h>
+#include <mars/data_utils/read_sim_data.h>
+#include <mars/m_perf.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <sys/resource.h>
+#include <yaml-cpp/yaml.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <string>
+#include <vector>
 
+// Batch processing of datasets with an IMU and a set of pose and position sensors. Every dataset directory is
+// processed with a new filter instance at maximum speed, the core states can be written to a CSV file per dataset.
+// At the end the throughput, the timing of each stage and the peak memory usage are printed.
+//
+// Config (YAML):
+//   imu_file_name / traj_file_name   IMU data in the ReadImuData or the ReadSimData format
+//   imu_n_w, imu_n_bw, imu_n_a, imu_n_ba
+//   init_p_wi: [x, y, z], init_q_wi: [w, x, y, z]   Used if the IMU data has no ground truth
+//   sensors:
+//     - type: pose | position
+//       name: Pose
+//       file_name: pose.csv
+//       meas_std: [...]          Measurement noise STD, 6 values for pose and 3 for position
+//       cal_p_ip: [x, y, z]      Initial calibration
+//       cal_q_ip: [w, x, y, z]
+//       cal_std: [...]           Initial calibration STD
+//   pose_file_name               Shorthand for a pose sensor with the settings of the THL example
+//   interm_prop_threshold: 0     Updates closer [s] to the latest state skip the intermediate propagation
+//   closed_form_quat_integration: false   Closed-form quaternion integration kernel for the propagation
+//
+// Usage: mars_cmd [--config FILE] [--output DIR] [DATASET_DIR ...]
+
+struct BatchSensor
+{
+  std::string file_name_;
+  std::string type_;
+  std::shared_ptr<mars::SensorAbsClass> sensor_;
+};
+
+struct BatchFilter
+{
+  std::shared_ptr<mars::CoreLogic> core_logic_;
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_;
+  std::vector<BatchSensor> sensors_;
+};
+
+bool read_yaml_vec(std::vector<double>* value, const std::string& parameter, const YAML::Node& config,
+                   const size_t& size)
+{
+  if (!config[parameter])
+  {
+    return false;
+  }
+
+  *value = config[parameter].as<std::vector<double>>();
+  if (value->size() != size)
+  {
+    std::cout << "Error: " << parameter << " requires " << size << " values" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return true;
+}
+
+Eigen::VectorXd read_yaml_vec_or(const std::string& parameter, const YAML::Node& config,
+                                 const Eigen::VectorXd& default_value)
+{
+  std::vector<double> value;
+  if (!read_yaml_vec(&value, parameter, config, default_value.size()))
+  {
+    return default_value;
+  }
+  return Eigen::Map<Eigen::VectorXd>(value.data(), value.size());
+}
+
+bool CreateSensor(const YAML::Node& node, const std::shared_ptr<mars::CoreState>& core_states, BatchSensor* sensor)
+{
+  sensor->type_ = node["type"].as<std::string>();
+  sensor->file_name_ = node["file_name"].as<std::string>();
+  const std::string name = node["name"] ? node["name"].as<std::string>() : sensor->type_;
+
+  const double deg = M_PI / 180;
+
+  if (sensor->type_ == "pose")
+  {
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor = std::make_shared<mars::PoseSensorClass>(name, core_states);
+    pose_sensor->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> meas_std;
+    meas_std << 0.02, 0.02, 0.02, 2 * deg, 2 * deg, 2 * deg;
+    meas_std = read_yaml_vec_or("meas_std", node, meas_std);
+    pose_sensor->R_ = meas_std.cwiseProduct(meas_std);
+
+    Eigen::Matrix<double, 6, 1> cal_std;
+    cal_std << 0.1, 0.1, 0.1, 10 * deg, 10 * deg, 10 * deg;
+    cal_std = read_yaml_vec_or("cal_std", node, cal_std);
+    const Eigen::Vector4d q_ip = read_yaml_vec_or("cal_q_ip", node, Eigen::Vector4d(1, 0, 0, 0));
+
+    mars::PoseSensorData pose_init_cal;
+    pose_init_cal.state_.p_ip_ = read_yaml_vec_or("cal_p_ip", node, Eigen::Vector3d::Zero());
+    pose_init_cal.state_.q_ip_ = Eigen::Quaterniond(q_ip(0), q_ip(1), q_ip(2), q_ip(3)).normalized();
+    pose_init_cal.sensor_cov_ = cal_std.cwiseProduct(cal_std).asDiagonal();
+    pose_sensor->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    sensor->sensor_ = pose_sensor;
+  }
+  else if (sensor->type_ == "position")
+  {
+    std::shared_ptr<mars::PositionSensorClass> position_sensor =
+        std::make_shared<mars::PositionSensorClass>(name, core_states);
+    position_sensor->const_ref_to_nav_ = true;
+
+    const Eigen::Vector3d meas_std = read_yaml_vec_or("meas_std", node, Eigen::Vector3d::Constant(0.02));
+    position_sensor->R_ = meas_std.cwiseProduct(meas_std);
+
+    const Eigen::Vector3d cal_std = read_yaml_vec_or("cal_std", node, Eigen::Vector3d::Constant(0.1));
+
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.state_.p_ip_ = read_yaml_vec_or("cal_p_ip", node, Eigen::Vector3d::Zero());
+    position_init_cal.sensor_cov_ = cal_std.cwiseProduct(cal_std).asDiagonal();
+    position_sensor->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    sensor->sensor_ = position_sensor;
+  }
+  else
+  {
+    std::cout << "Error: Sensor type " << sensor->type_ << " is not supported by mars_cmd" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool CreateFilter(const YAML::Node& config, BatchFilter* filter)
+{
+  filter->imu_sensor_ = std::make_shared<mars::ImuSensorClass>("IMU");
+
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(filter->imu_sensor_);
+  core_states_sptr->set_noise_std(read_yaml_vec_or("imu_n_w", config, Eigen::Vector3d::Constant(0.013)),
+                                  read_yaml_vec_or("imu_n_bw", config, Eigen::Vector3d::Constant(0.0013)),
+                                  read_yaml_vec_or("imu_n_a", config, Eigen::Vector3d::Constant(0.083)),
+                                  read_yaml_vec_or("imu_n_ba", config, Eigen::Vector3d::Constant(0.0083)));
+
+  if (config["closed_form_quat_integration"])
+  {
+    core_states_sptr->closed_form_quat_integration_ = config["closed_form_quat_integration"].as<bool>();
+  }
+
+  if (config["pose_file_name"])
+  {
+    YAML::Node pose_node;
+    pose_node["type"] = "pose";
+    pose_node["name"] = "Pose";
+    pose_node["file_name"] = config["pose_file_name"].as<std::string>();
+
+    BatchSensor sensor;
+    if (!CreateSensor(pose_node, core_states_sptr, &sensor))
+    {
+      return false;
+    }
+    filter->sensors_.push_back(sensor);
+  }
+
+  for (const auto& node : config["sensors"])
+  {
+    BatchSensor sensor;
+    if (!CreateSensor(node, core_states_sptr, &sensor))
+    {
+      return false;
+    }
+    filter->sensors_.push_back(sensor);
+  }
+
+  filter->core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+
+  if (config["interm_prop_threshold"])
+  {
+    filter->core_logic_->interm_prop_threshold_ = config["interm_prop_threshold"].as<double>();
+  }
+
+  return true;
+}
+
+struct SensorTiming
+{
+  size_t num_measurements_{ 0 };
+  double t_process_{ 0 };  ///< [s]
+};
+
+struct DatasetResult
+{
+  size_t num_measurements_{ 0 };
+  double t_load_{ 0 };                                ///< [s]
+  double t_process_{ 0 };                             ///< [s]
+  std::map<std::string, SensorTiming> sensor_timing_;  ///< ProcessMeasurement time per sensor name
+};
 
-int main(int /*argc*/, char** /*argv[]*/)
+bool ProcessDataset(const YAML::Node& config, const std::string& data_path, const std::string& output_file,
+                    mars::MPerf* perf, DatasetResult* result)
 {
-  // Print library info
-  // mars::Vector3_t v;
+  BatchFilter filter;
+  if (!CreateFilter(config, &filter))
+  {
+    return false;
+  }
+
+  const auto t_load_start = std::chrono::steady_clock::now();
+  perf->StartEntity("Load");
+
+  // IMU entries are inserted first such that the stable sort keeps them ahead of updates with the same timestamp
+  std::vector<mars::BufferEntryType> measurement_data;
+  if (config["traj_file_name"])
+  {
+    mars::ReadSimData(&measurement_data, filter.imu_sensor_, data_path + config["traj_file_name"].as<std::string>());
+  }
+  else if (config["imu_file_name"])
+  {
+    mars::ReadImuData(&measurement_data, filter.imu_sensor_, data_path + config["imu_file_name"].as<std::string>());
+  }
+  else
+  {
+    std::cout << "Error: No IMU data (imu_file_name or traj_file_name) configured" << std::endl;
+    return false;
+  }
+
+  for (const auto& k : filter.sensors_)
+  {
+    std::vector<mars::BufferEntryType> sensor_data;
+    if (k.type_ == "pose")
+    {
+      mars::ReadPoseData(&sensor_data, k.sensor_, data_path + k.file_name_);
+    }
+    else
+    {
+      mars::ReadPositionData(&sensor_data, k.sensor_, data_path + k.file_name_);
+    }
+    measurement_data.insert(measurement_data.end(), sensor_data.begin(), sensor_data.end());
+  }
+
+  std::stable_sort(measurement_data.begin(), measurement_data.end(),
+                   [](const mars::BufferEntryType& a, const mars::BufferEntryType& b) {
+                     return a.timestamp_ < b.timestamp_;
+                   });
+
+  perf->StopEntity("Load");
+  result->t_load_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_load_start).count();
+
+  // Results are collected in a string and written in large blocks
+  constexpr size_t output_block_size = 1 << 20;
+  std::ofstream ofile_core;
+  std::string output_buffer;
+  if (!output_file.empty())
+  {
+    ofile_core.open(output_file, std::ios::out);
+    if (!ofile_core.is_open())
+    {
+      std::cout << "Error: Could not open " << output_file << std::endl;
+      return false;
+    }
+    output_buffer = mars::CoreStateType::get_csv_state_header_string() + "\n";
+    output_buffer.reserve(output_block_size + 1024);
+  }
+
+  const Eigen::Vector3d p_wi_init = read_yaml_vec_or("init_p_wi", config, Eigen::Vector3d::Zero());
+  const Eigen::Vector4d q_wi_init = read_yaml_vec_or("init_q_wi", config, Eigen::Vector4d(1, 0, 0, 0));
+
+  // The processing time is accumulated per sensor, a profiler entity per measurement would cost more than an IMU step
+  std::map<const mars::SensorAbsClass*, SensorTiming*> sensor_timing = {
+    { filter.imu_sensor_.get(), &result->sensor_timing_[filter.imu_sensor_->name_] }
+  };
+  for (const auto& k : filter.sensors_)
+  {
+    sensor_timing[k.sensor_.get()] = &result->sensor_timing_[k.sensor_->name_];
+  }
+
+  mars::CoreLogic& core_logic = *filter.core_logic_;
+  const auto t_process_start = std::chrono::steady_clock::now();
+
+  for (const auto& k : measurement_data)
+  {
+    SensorTiming& timing = *sensor_timing[k.sensor_.get()];
+    const auto t_measurement_start = std::chrono::steady_clock::now();
+    core_logic.ProcessMeasurement(k.sensor_, k.timestamp_, k.data_);
+    timing.t_process_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - t_measurement_start).count();
+    timing.num_measurements_++;
+
+    if (!core_logic.core_is_initialized_)
+    {
+      if (k.sensor_ == filter.imu_sensor_)
+      {
+        // Initialize with the ground truth of the ReadSimData format if available
+        if (k.data_.core_ != nullptr)
+        {
+          const mars::CoreStateType& ground_truth = *static_cast<mars::CoreStateType*>(k.data_.core_.get());
+          core_logic.Initialize(ground_truth.p_wi_, ground_truth.q_wi_);
+        }
+        else
+        {
+          core_logic.Initialize(p_wi_init,
+                                Eigen::Quaterniond(q_wi_init(0), q_wi_init(1), q_wi_init(2), q_wi_init(3)));
+        }
+      }
+      continue;
+    }
+
+    if (ofile_core.is_open() && k.sensor_ == filter.imu_sensor_)
+    {
+      mars::BufferEntryType latest_result;
+      core_logic.buffer_.get_latest_state(&latest_result);
+      output_buffer += static_cast<mars::CoreType*>(latest_result.data_.core_.get())
+                           ->state_.to_csv_string(latest_result.timestamp_.get_seconds());
+      output_buffer += '\n';
+
+      if (output_buffer.size() > output_block_size)
+      {
+        perf->StartEntity("Output");
+        ofile_core.write(output_buffer.data(), output_buffer.size());
+        output_buffer.clear();
+        perf->StopEntity("Output");
+      }
+    }
+  }
+
+  if (ofile_core.is_open())
+  {
+    perf->StartEntity("Output");
+    ofile_core.write(output_buffer.data(), output_buffer.size());
+    ofile_core.close();
+    perf->StopEntity("Output");
+  }
+
+  result->t_process_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_process_start).count();
+  result->num_measurements_ = measurement_data.size();
+
+  std::cout << "Intermediate propagations skipped: " << core_logic.num_skipped_interm_prop_
+            << " reused: " << core_logic.num_reused_interm_prop_ << std::endl;
+
+  mars::BufferEntryType latest_result;
+  if (core_logic.buffer_.get_latest_state(&latest_result))
+  {
+    std::cout << "Last State:" << std::endl;
+    std::cout << static_cast<mars::CoreType*>(latest_result.data_.core_.get())->state_ << std::endl;
+  }
+
+  return true;
+}
+
+void print_usage()
+{
+  std::cout << "Usage: mars_cmd [--config FILE] [--output DIR] [DATASET_DIR ...]" << std::endl;
+  std::cout << "  --config  YAML configuration, default is parameter.yaml of the first dataset" << std::endl;
+  std::cout << "  --output  Directory for the core state CSV files, no output is written by default" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string config_file;
+  std::string output_dir;
+  std::vector<std::string> data_paths;
+
+  for (int k = 1; k < argc; k++)
+  {
+    const bool has_value = k + 1 < argc;
+
+    if (!std::strcmp(argv[k], "--config") && has_value)
+    {
+      config_file = argv[++k];
+    }
+    else if (!std::strcmp(argv[k], "--output") && has_value)
+    {
+      output_dir = std::string(argv[++k]) + "/";
+    }
+    else if (argv[k][0] != '-')
+    {
+      data_paths.push_back(std::string(argv[k]) + "/");
+    }
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (data_paths.empty())
+  {
+    data_paths.emplace_back(MARS_CMD_DEFAULT_DATA_PATH);
+  }
+
+  if (config_file.empty())
+  {
+    config_file = data_paths.front() + "parameter.yaml";
+  }
 
-  // Calculate and print fibonacci number
   std::cout << "MaRS library" << std::endl;
+  std::cout << "Config: " << config_file << std::endl;
+  YAML::Node config = YAML::LoadFile(config_file);
+
+  DatasetResult total;
+  {
+    // The profiler prints the stage timing once it goes out of scope
+    mars::MPerf perf("mars_cmd");
+
+    for (size_t k = 0; k < data_paths.size(); k++)
+    {
+      std::cout << "Dataset: " << data_paths[k] << std::endl;
+
+      const std::string output_file =
+          output_dir.empty() ? std::string() : output_dir + "mars_core_state_" + std::to_string(k) + ".csv";
+
+      DatasetResult result;
+      if (!ProcessDataset(config, data_paths[k], output_file, &perf, &result))
+      {
+        return EXIT_FAILURE;
+      }
+
+      std::cout << "Measurements: " << result.num_measurements_ << " load [s]: " << result.t_load_
+                << " process [s]: " << result.t_process_
+                << " throughput [meas/s]: " << result.num_measurements_ / result.t_process_ << std::endl;
+
+      total.num_measurements_ += result.num_measurements_;
+      total.t_load_ += result.t_load_;
+      total.t_process_ += result.t_process_;
+      for (const auto& timing : result.sensor_timing_)
+      {
+        total.sensor_timing_[timing.first].num_measurements_ += timing.second.num_measurements_;
+        total.sensor_timing_[timing.first].t_process_ += timing.second.t_process_;
+      }
+    }
+
+    std::cout << std::endl << "Datasets: " << data_paths.size() << std::endl;
+    std::cout << "Measurements: " << total.num_measurements_ << std::endl;
+    std::cout << "Load time [s]: " << total.t_load_ << std::endl;
+    std::cout << "Process time [s]: " << total.t_process_ << std::endl;
+    std::cout << "Throughput [meas/s]: " << total.num_measurements_ / total.t_process_ << std::endl;
+    for (const auto& timing : total.sensor_timing_)
+    {
+      std::cout << "Process " << timing.first << ": measurements: " << timing.second.num_measurements_
+                << " time [s]: " << timing.second.t_process_ << " mean [us]: "
+                << 1e6 * timing.second.t_process_ / std::max<size_t>(1, timing.second.num_measurements_) << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  // Peak resident set size, reported in kilobytes on Linux and in bytes on macOS
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+  {
+#ifdef __APPLE__
+    const double max_rss_mb = usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    const double max_rss_mb = usage.ru_maxrss / 1024.0;
+#endif
+    std::cout << "Peak memory (max RSS) [MB]: " << max_rss_mb << std::endl;
+  }
 
-  return 0;
+  return EXIT_SUCCESS;
 }
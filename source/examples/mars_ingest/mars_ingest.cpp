@@ -0,0 +1,169 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/ipc_ingest.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/shm_state_publisher.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Measurement ingestion daemon. The daemon hosts a filter with an IMU ("IMU"), a pose ("Pose") and a position
+// ("Position") sensor and accepts measurements of local driver processes on a Unix domain socket. The sensors have to
+// be registered with the imu, pose and position payload type. Drivers encode their measurements with the mars::IngestEncoder and send them with the mars::IngestClient, one of the drivers sends
+// the initialization of the filter. The latest state is published to shared memory after each update and at the
+// publish period after propagation steps, it can be read with the header-only mars::ShmStateReader.
+//
+// Usage: mars_ingest [--socket PATH] [--shm NAME] [--stats SECONDS] [--publish-period SECONDS]
+
+namespace
+{
+volatile std::sig_atomic_t g_stop = 0;
+
+void HandleSignal(int /*signal*/)
+{
+  g_stop = 1;
+}
+}  // namespace
+
+void print_usage()
+{
+  std::cout << "Usage: mars_ingest [--socket PATH] [--shm NAME] [--stats SECONDS] [--publish-period SECONDS]"
+            << std::endl;
+  std::cout << "  --socket  Path of the Unix domain socket, default /tmp/mars_ingest.sock" << std::endl;
+  std::cout << "  --shm     Name of the shared memory of the state output, default /mars_state" << std::endl;
+  std::cout << "  --stats   Interval of the statistics output, default 10 s, 0 disables the output" << std::endl;
+  std::cout << "  --publish-period  Min. time between two published propagation steps, default 0 publishes every "
+               "step, a negative value publishes updates only"
+            << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string socket_path("/tmp/mars_ingest.sock");
+  std::string shm_name("/mars_state");
+  double stats_interval = 10;
+  double publish_period = 0;
+
+  for (int k = 1; k < argc; k++)
+  {
+    const bool has_value = k + 1 < argc;
+
+    if (!std::strcmp(argv[k], "--socket") && has_value)
+    {
+      socket_path = argv[++k];
+    }
+    else if (!std::strcmp(argv[k], "--shm") && has_value)
+    {
+      shm_name = argv[++k];
+    }
+    else if (!std::strcmp(argv[k], "--stats") && has_value)
+    {
+      stats_interval = std::stod(argv[++k]);
+    }
+    else if (!std::strcmp(argv[k], "--publish-period") && has_value)
+    {
+      publish_period = std::stod(argv[++k]);
+    }
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Filter setup
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+      std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+  pose_sensor_sptr->const_ref_to_nav_ = true;
+  Eigen::Matrix<double, 6, 1> pose_meas_std;
+  pose_meas_std << 0.02, 0.02, 0.02, 2 * (M_PI / 180), 2 * (M_PI / 180), 2 * (M_PI / 180);
+  pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+  mars::PoseSensorData pose_init_cal;
+  Eigen::Matrix<double, 6, 1> pose_cal_std;
+  pose_cal_std << 0.1, 0.1, 0.1, (10 * M_PI / 180), (10 * M_PI / 180), (10 * M_PI / 180);
+  pose_init_cal.sensor_cov_ = pose_cal_std.cwiseProduct(pose_cal_std).asDiagonal();
+  pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+  std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+      std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+  position_sensor_sptr->const_ref_to_nav_ = true;
+  position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+  position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+
+  // State output
+  core_logic->state_publisher_ = std::make_shared<mars::ShmStatePublisher>(shm_name);
+  if (!core_logic->state_publisher_->is_open())
+  {
+    return EXIT_FAILURE;
+  }
+  core_logic->state_publisher_period_ = publish_period;
+  core_logic->state_publisher_->AddSensor(pose_sensor_sptr);
+  core_logic->state_publisher_->AddSensor(position_sensor_sptr);
+
+  // Measurement input
+  mars::IngestServer server(core_logic, socket_path);
+  if (!server.is_open())
+  {
+    return EXIT_FAILURE;
+  }
+  server.AddSensor(imu_sensor_sptr, mars::JournalPayloadType::imu);
+  server.AddSensor(pose_sensor_sptr, mars::JournalPayloadType::pose);
+  server.AddSensor(position_sensor_sptr, mars::JournalPayloadType::position);
+
+  std::signal(SIGINT, HandleSignal);
+  std::signal(SIGTERM, HandleSignal);
+
+  std::cout << "Listening on " << socket_path << ", publishing to " << shm_name << std::endl;
+
+  auto print_stats = [&server]() {
+    std::cout << "Connections " << server.get_num_clients() << " open / " << server.num_connections_
+              << " total, measurements " << server.num_measurements_ << ", dropped " << server.num_dropped_
+              << ", stream errors " << server.num_stream_errors_ << ", received " << server.num_bytes_ << " bytes"
+              << std::endl;
+  };
+
+  auto t_last_stats = std::chrono::steady_clock::now();
+
+  while (!g_stop)
+  {
+    if (server.Poll(100) < 0)
+    {
+      std::cout << "Error: Polling the connections failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (stats_interval > 0 && std::chrono::duration<double>(now - t_last_stats).count() >= stats_interval)
+    {
+      print_stats();
+      t_last_stats = now;
+    }
+  }
+
+  print_stats();
+  return EXIT_SUCCESS;
+}
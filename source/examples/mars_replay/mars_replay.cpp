@@ -0,0 +1,588 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/read_pose_data.h>
+#include <mars/data_utils/read_sim_data.h>
+#include <mars/journal.h>
+#include <mars/sensors/attitude/attitude_sensor_class.h>
+#include <mars/sensors/bodyvel/bodyvel_sensor_class.h>
+#include <mars/sensors/gps/gps_sensor_class.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_sensor_class.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/mag/mag_sensor_class.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/sensors/pressure/pressure_sensor_class.h>
+#include <mars/sensors/vision/vision_sensor_class.h>
+#include <mars/sweep_runner.h>
+#include <mars/type_definitions/core_type.h>
+#include <yaml-cpp/yaml.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Records and replays the input journal of a filter. The filter configuration is read from the parameter.yaml of the
+// dataset directory, the default is the unpacked test data of the mars-test target.
+//
+// Recording runs the IMU and pose data of the dataset through a filter with an enabled journal. Replaying builds a
+// new filter from the sensor records of the journal, each sensor is created for the recorded payload type and
+// configured by the sensors entry with the same name. The measurements of a recorded ProcessMeasurements call are
+// replayed with one ProcessMeasurements call and the recorded stacked update setting. The replay reports the latency of each call per sensor and
+// prints the final state. The final state is printed in hexadecimal floating point notation, the output of the
+// recording and the replay are identical. The replay fails if a record cannot be replayed.
+//
+// Config (YAML):
+//   traj_file_name, pose_file_name   Data of the recording
+//   imu_n_w, imu_n_bw, imu_n_a, imu_n_ba
+//   sensors:                         Optional, sensors without an entry use the defaults
+//     - name: Pose                   Name of the sensor in the journal
+//       meas_std: [...]              Measurement noise STD, rotations in [rad]
+//       cal_std: [...]               Initial calibration STD, one value per calibration error state
+//       cal_<state>: [...]           Initial calibration, named after the sensor state, e.g. cal_p_ip: [x, y, z] or
+//                                    cal_q_ip: [w, x, y, z]. Defaults are zero and identity.
+//       const_ref_to_nav: true
+//
+// Usage: mars_replay --record JOURNAL [--data PATH]
+//        mars_replay JOURNAL [--data PATH]
+
+struct FilterSetup
+{
+  std::shared_ptr<mars::CoreState> core_states_;
+  std::shared_ptr<mars::CoreLogic> core_logic_;
+};
+
+Eigen::VectorXd ReadVector(const YAML::Node& node, const std::string& parameter, const Eigen::VectorXd& default_value)
+{
+  if (!node[parameter])
+  {
+    return default_value;
+  }
+
+  std::vector<double> value = node[parameter].as<std::vector<double>>();
+  if (value.size() != static_cast<size_t>(default_value.size()))
+  {
+    std::cout << "Error: " << parameter << " requires " << default_value.size() << " values" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return Eigen::Map<Eigen::VectorXd>(value.data(), value.size());
+}
+
+Eigen::Quaterniond ReadQuaternion(const YAML::Node& node, const std::string& parameter)
+{
+  const Eigen::Vector4d q = ReadVector(node, parameter, Eigen::Vector4d(1, 0, 0, 0));
+  return Eigen::Quaterniond(q(0), q(1), q(2), q(3)).normalized();
+}
+
+// STD of size translations followed by size rotations [rad]
+Eigen::VectorXd StdVector(const int& size, const double& translation_std, const double& rotation_std)
+{
+  Eigen::VectorXd result(2 * size);
+  result << Eigen::VectorXd::Constant(size, translation_std), Eigen::VectorXd::Constant(size, rotation_std);
+  return result;
+}
+
+///
+/// \brief FindSensorConfig Returns the entry of the sensors list with the given name, an empty node if there is none
+///
+YAML::Node FindSensorConfig(const YAML::Node& config, const std::string& name)
+{
+  for (const auto& node : config["sensors"])
+  {
+    if (node["name"] && node["name"].as<std::string>() == name)
+    {
+      return node;
+    }
+  }
+  return YAML::Node();
+}
+
+///
+/// \brief CreateSensor Creates an update sensor for the measurement type of a journal payload
+/// \return Sensor, nullptr if the payload type has no update sensor
+///
+std::shared_ptr<mars::UpdateSensorAbsClass> CreateSensor(const mars::JournalPayloadType& payload_type,
+                                                         const std::string& name, const YAML::Node& node,
+                                                         const std::shared_ptr<mars::CoreState>& core_states)
+{
+  const double deg = M_PI / 180;
+
+  std::shared_ptr<mars::UpdateSensorAbsClass> sensor;
+  std::shared_ptr<void> calibration;
+  Eigen::MatrixXd* calibration_cov = nullptr;
+  Eigen::VectorXd meas_std;
+  Eigen::VectorXd cal_std;
+
+  switch (payload_type)
+  {
+    case mars::JournalPayloadType::pose:
+    {
+      auto data = std::make_shared<mars::PoseSensorData>();
+      data->state_.p_ip_ = ReadVector(node, "cal_p_ip", data->state_.p_ip_);
+      data->state_.q_ip_ = ReadQuaternion(node, "cal_q_ip");
+      sensor = std::make_shared<mars::PoseSensorClass>(name, core_states);
+      meas_std = StdVector(3, 0.02, 2 * deg);
+      cal_std = StdVector(3, 0.1, 10 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::position:
+    {
+      auto data = std::make_shared<mars::PositionSensorData>();
+      data->state_.p_ip_ = ReadVector(node, "cal_p_ip", data->state_.p_ip_);
+      sensor = std::make_shared<mars::PositionSensorClass>(name, core_states);
+      meas_std = Eigen::Vector3d::Constant(0.02);
+      cal_std = Eigen::Vector3d::Constant(0.1);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::vision:
+    {
+      auto data = std::make_shared<mars::VisionSensorData>();
+      data->state_.p_vw_ = ReadVector(node, "cal_p_vw", data->state_.p_vw_);
+      data->state_.q_vw_ = ReadQuaternion(node, "cal_q_vw");
+      data->state_.p_ic_ = ReadVector(node, "cal_p_ic", data->state_.p_ic_);
+      data->state_.q_ic_ = ReadQuaternion(node, "cal_q_ic");
+      data->state_.lambda_ = ReadVector(node, "cal_lambda", Eigen::VectorXd::Constant(1, data->state_.lambda_))(0);
+      sensor = std::make_shared<mars::VisionSensorClass>(name, core_states);
+      meas_std = StdVector(3, 0.02, 2 * deg);
+      cal_std.resize(13);
+      cal_std << StdVector(3, 0.1, 10 * deg), StdVector(3, 0.1, 10 * deg), 0.1;
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::gps:
+    {
+      auto data = std::make_shared<mars::GpsSensorData>();
+      data->state_.p_ig_ = ReadVector(node, "cal_p_ig", data->state_.p_ig_);
+      data->state_.p_gw_w_ = ReadVector(node, "cal_p_gw_w", data->state_.p_gw_w_);
+      data->state_.q_gw_w_ = ReadQuaternion(node, "cal_q_gw_w");
+      sensor = std::make_shared<mars::GpsSensorClass>(name, core_states);
+      meas_std = Eigen::Vector3d::Constant(0.5);
+      cal_std.resize(9);
+      cal_std << Eigen::Vector3d::Constant(0.1), StdVector(3, 1.0, 5 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::gps_w_vel:
+    {
+      auto data = std::make_shared<mars::GpsVelSensorData>();
+      data->state_.p_ig_ = ReadVector(node, "cal_p_ig", data->state_.p_ig_);
+      data->state_.p_gw_w_ = ReadVector(node, "cal_p_gw_w", data->state_.p_gw_w_);
+      data->state_.q_gw_w_ = ReadQuaternion(node, "cal_q_gw_w");
+      sensor = std::make_shared<mars::GpsVelSensorClass>(name, core_states);
+      meas_std = StdVector(3, 0.5, 0.1);
+      cal_std.resize(9);
+      cal_std << Eigen::Vector3d::Constant(0.1), StdVector(3, 1.0, 5 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::mag:
+    {
+      auto data = std::make_shared<mars::MagSensorData>();
+      data->state_.mag_ = ReadVector(node, "cal_mag", data->state_.mag_);
+      data->state_.q_im_ = ReadQuaternion(node, "cal_q_im");
+      sensor = std::make_shared<mars::MagSensorClass>(name, core_states);
+      meas_std = Eigen::Vector3d::Constant(0.1);
+      cal_std = StdVector(3, 0.3, 10 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::pressure:
+    {
+      auto data = std::make_shared<mars::PressureSensorData>();
+      data->state_.p_ip_ = ReadVector(node, "cal_p_ip", data->state_.p_ip_);
+      data->state_.bias_p_ = ReadVector(node, "cal_bias_p", Eigen::VectorXd::Constant(1, data->state_.bias_p_))(0);
+      sensor = std::make_shared<mars::PressureSensorClass>(name, core_states);
+      meas_std = Eigen::VectorXd::Constant(1, 0.5);
+      cal_std = Eigen::Vector4d::Constant(0.1);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::bodyvel:
+    {
+      auto data = std::make_shared<mars::BodyvelSensorData>();
+      data->state_.p_ib_ = ReadVector(node, "cal_p_ib", data->state_.p_ib_);
+      data->state_.q_ib_ = ReadQuaternion(node, "cal_q_ib");
+      sensor = std::make_shared<mars::BodyvelSensorClass>(name, core_states);
+      meas_std = Eigen::Vector3d::Constant(0.05);
+      cal_std = StdVector(3, 0.1, 10 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    case mars::JournalPayloadType::attitude:
+    {
+      auto data = std::make_shared<mars::AttitudeSensorData>();
+      data->state_.q_aw_ = ReadQuaternion(node, "cal_q_aw");
+      data->state_.q_ib_ = ReadQuaternion(node, "cal_q_ib");
+      sensor = std::make_shared<mars::AttitudeSensorClass>(name, core_states);
+      meas_std = Eigen::Vector3d::Constant(2 * deg);
+      cal_std = StdVector(3, 10 * deg, 10 * deg);
+      calibration_cov = &data->sensor_cov_;
+      calibration = data;
+      break;
+    }
+    default:
+      return nullptr;
+  }
+
+  sensor->const_ref_to_nav_ = node["const_ref_to_nav"] ? node["const_ref_to_nav"].as<bool>() : true;
+
+  meas_std = ReadVector(node, "meas_std", meas_std);
+  sensor->R_ = meas_std.cwiseProduct(meas_std);
+
+  cal_std = ReadVector(node, "cal_std", cal_std);
+  *calibration_cov = cal_std.cwiseProduct(cal_std).asDiagonal();
+  sensor->set_initial_calib(calibration);
+
+  return sensor;
+}
+
+FilterSetup CreateFilter(const YAML::Node& config)
+{
+  FilterSetup setup;
+
+  setup.core_states_ = std::make_shared<mars::CoreState>();
+  setup.core_states_->set_noise_std(Eigen::Vector3d(config["imu_n_w"].as<std::vector<double>>().data()),
+                                    Eigen::Vector3d(config["imu_n_bw"].as<std::vector<double>>().data()),
+                                    Eigen::Vector3d(config["imu_n_a"].as<std::vector<double>>().data()),
+                                    Eigen::Vector3d(config["imu_n_ba"].as<std::vector<double>>().data()));
+
+  setup.core_logic_ = std::make_shared<mars::CoreLogic>(setup.core_states_);
+
+  return setup;
+}
+
+void PrintFinalState(const mars::CoreLogic& core_logic)
+{
+  mars::BufferEntryType latest_state;
+  if (!core_logic.buffer_.get_latest_state(&latest_state))
+  {
+    std::cout << "No state in buffer" << std::endl;
+    return;
+  }
+
+  const mars::CoreType& core = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+
+  std::cout << std::hexfloat;
+  std::cout << "Final state t=" << latest_state.timestamp_.get_seconds() << std::endl;
+  std::cout << "  p_wi: " << core.state_.p_wi_.transpose() << std::endl;
+  std::cout << "  v_wi: " << core.state_.v_wi_.transpose() << std::endl;
+  std::cout << "  q_wi: " << core.state_.q_wi_.coeffs().transpose() << std::endl;
+  std::cout << "  trace(P): " << core.cov_.trace() << std::endl;
+  std::cout << std::defaultfloat;
+}
+
+int Record(const std::string& journal_path, const std::string& data_path, const YAML::Node& config)
+{
+  // The dataset sorts the measurements of both sensors by time, IMU measurements first for equal timestamps
+  mars::SweepDataset dataset;
+  {
+    std::vector<mars::BufferEntryType> measurement_data_imu;
+    mars::ReadSimData(&measurement_data_imu, nullptr, data_path + config["traj_file_name"].as<std::string>());
+
+    std::vector<mars::BufferEntryType> measurement_data_pose;
+    mars::ReadPoseData(&measurement_data_pose, nullptr, data_path + config["pose_file_name"].as<std::string>());
+
+    dataset.AddSensorMeasurements(measurement_data_imu);
+    dataset.AddSensorMeasurements(measurement_data_pose);
+    dataset.AddGroundTruth(measurement_data_imu);
+  }
+
+  FilterSetup setup = CreateFilter(config);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor = std::make_shared<mars::ImuSensorClass>("IMU");
+  setup.core_states_->set_propagation_sensor(imu_sensor);
+  std::shared_ptr<mars::SensorAbsClass> pose_sensor =
+      CreateSensor(mars::JournalPayloadType::pose, "Pose", FindSensorConfig(config, "Pose"), setup.core_states_);
+
+  std::shared_ptr<mars::JournalWriter> journal = std::make_shared<mars::JournalWriter>(journal_path);
+  if (!journal->IsOpen())
+  {
+    return EXIT_FAILURE;
+  }
+
+  journal->RegisterSensor(imu_sensor, mars::JournalPayloadType::imu);
+  journal->RegisterSensor(pose_sensor, mars::JournalPayloadType::pose);
+  setup.core_logic_->journal_ = journal;
+
+  const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor, pose_sensor };
+
+  const auto t_start = std::chrono::steady_clock::now();
+
+  for (const auto& k : dataset.get_measurements())
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+    setup.core_logic_->ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+    if (!setup.core_logic_->core_is_initialized_ && k.sensor_idx_ == 0)
+    {
+      mars::CoreStateType ground_truth;
+      dataset.get_ground_truth(k.timestamp_, &ground_truth);
+      setup.core_logic_->Initialize(ground_truth.p_wi_, ground_truth.q_wi_);
+    }
+  }
+
+  journal->Flush();
+
+  const double t_total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+  std::cout << "Recorded " << dataset.get_measurements().size() << " measurements in " << t_total << " s" << std::endl;
+
+  PrintFinalState(*setup.core_logic_);
+  return EXIT_SUCCESS;
+}
+
+int Replay(const std::string& journal_path, const YAML::Node& config)
+{
+  mars::JournalReader reader(journal_path);
+  if (!reader.IsOpen())
+  {
+    return EXIT_FAILURE;
+  }
+
+  FilterSetup setup = CreateFilter(config);
+
+  // The sensors are created from the sensor records, the journal sensor id is the index
+  std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors;
+  std::vector<std::vector<double>> latencies;
+  std::vector<double> init_latencies;
+  std::vector<double> call_latencies;
+
+  // Measurements of the current ProcessMeasurements call and the number of its records that are not read yet
+  std::vector<mars::BufferEntryType> call_measurements;
+  int num_pending_call_records = 0;
+
+  mars::JournalRecord record;
+  int num_failed = 0;
+
+  while (reader.ReadNext(&record))
+  {
+    switch (record.type_)
+    {
+      case mars::JournalRecordType::sensor:
+      {
+        std::shared_ptr<mars::SensorAbsClass> sensor;
+        if (record.payload_type_ == mars::JournalPayloadType::imu)
+        {
+          if (setup.core_states_->propagation_sensor_ != nullptr)
+          {
+            std::cout << "Error: Sensor " << record.sensor_name_ << " is a second propagation sensor" << std::endl;
+            num_failed++;
+            break;
+          }
+
+          sensor = std::make_shared<mars::ImuSensorClass>(record.sensor_name_);
+          setup.core_states_->set_propagation_sensor(sensor);
+        }
+        else
+        {
+          sensor = CreateSensor(record.payload_type_, record.sensor_name_,
+                                FindSensorConfig(config, record.sensor_name_), setup.core_states_);
+        }
+
+        if (sensor == nullptr)
+        {
+          std::cout << "Error: Sensor " << record.sensor_name_ << " has payload type "
+                    << static_cast<int>(record.payload_type_) << " which can not be replayed" << std::endl;
+          num_failed++;
+        }
+
+        sensors.resize(std::max<size_t>(sensors.size(), record.sensor_id_ + 1));
+        latencies.resize(sensors.size());
+        sensors[record.sensor_id_] = sensor;
+        break;
+      }
+      case mars::JournalRecordType::measurements:
+      {
+        if (num_pending_call_records > 0)
+        {
+          num_failed += num_pending_call_records;
+        }
+
+        setup.core_logic_->stacked_update_ = record.stacked_update_;
+        setup.core_logic_->stacked_update_epsilon_ = record.stacked_update_epsilon_;
+        call_measurements.clear();
+        num_pending_call_records = record.num_measurements_;
+        break;
+      }
+      case mars::JournalRecordType::measurement:
+      {
+        const bool is_call_record = num_pending_call_records > 0;
+        num_pending_call_records -= is_call_record;
+
+        if (record.sensor_id_ < 0 || record.sensor_id_ >= static_cast<int>(sensors.size()) ||
+            sensors[record.sensor_id_] == nullptr || record.payload_ == nullptr ||
+            setup.core_states_->propagation_sensor_ == nullptr)
+        {
+          num_failed++;
+        }
+        else
+        {
+          mars::BufferDataType data;
+          data.set_sensor_data(record.payload_);
+
+          if (is_call_record)
+          {
+            call_measurements.emplace_back(record.timestamp_, data, sensors[record.sensor_id_],
+                                           mars::BufferMetadataType::measurement);
+          }
+          else
+          {
+            const auto t_start = std::chrono::steady_clock::now();
+            setup.core_logic_->ProcessMeasurement(sensors[record.sensor_id_], record.timestamp_, data);
+            latencies[record.sensor_id_].push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_start).count());
+          }
+        }
+
+        if (is_call_record && num_pending_call_records == 0 && !call_measurements.empty())
+        {
+          const auto t_start = std::chrono::steady_clock::now();
+          setup.core_logic_->ProcessMeasurements(call_measurements);
+          call_latencies.push_back(
+              std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_start).count());
+        }
+        break;
+      }
+      case mars::JournalRecordType::initialize:
+      {
+        if (setup.core_states_->propagation_sensor_ == nullptr)
+        {
+          num_failed++;
+          break;
+        }
+
+        const auto t_start = std::chrono::steady_clock::now();
+        setup.core_logic_->Initialize(record.p_wi_, record.q_wi_);
+        init_latencies.push_back(
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_start).count());
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  if (num_pending_call_records > 0)
+  {
+    std::cout << "Error: The journal ends within a ProcessMeasurements call" << std::endl;
+    num_failed += num_pending_call_records;
+  }
+
+  if (reader.IsCorrupted())
+  {
+    std::cout << "Error: The journal is truncated or corrupted" << std::endl;
+    num_failed++;
+  }
+
+  auto print_latency = [](const std::string& name, std::vector<double> values) {
+    if (values.empty())
+    {
+      return;
+    }
+
+    std::sort(values.begin(), values.end());
+    double sum = 0;
+    for (const auto& k : values)
+    {
+      sum += k;
+    }
+
+    auto percentile = [&values](const double& p) { return values[static_cast<size_t>(p * (values.size() - 1))]; };
+
+    std::cout << name << ": calls " << values.size() << " mean " << sum / values.size() << " p50 " << percentile(0.5)
+              << " p90 " << percentile(0.9) << " p99 " << percentile(0.99) << " max " << values.back() << std::endl;
+  };
+
+  std::cout << "Latency per call [us]" << std::endl;
+  for (size_t k = 0; k < sensors.size(); k++)
+  {
+    if (sensors[k] != nullptr)
+    {
+      print_latency(sensors[k]->name_, latencies[k]);
+    }
+  }
+  print_latency("ProcessMeasurements", call_latencies);
+  print_latency("Initialize", init_latencies);
+
+  PrintFinalState(*setup.core_logic_);
+
+  if (num_failed > 0)
+  {
+    std::cout << "Error: " << num_failed << " records could not be replayed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void print_usage()
+{
+  std::cout << "Usage: mars_replay --record JOURNAL [--data PATH]" << std::endl;
+  std::cout << "       mars_replay JOURNAL [--data PATH]" << std::endl;
+  std::cout << "  --record  Run the dataset and record the journal" << std::endl;
+  std::cout << "  --data    Dataset directory containing parameter.yaml" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  bool record = false;
+  std::string journal_path;
+  std::string data_path(MARS_REPLAY_DEFAULT_DATA_PATH);
+
+  for (int k = 1; k < argc; k++)
+  {
+    const bool has_value = k + 1 < argc;
+
+    if (!std::strcmp(argv[k], "--record") && has_value)
+    {
+      record = true;
+      journal_path = argv[++k];
+    }
+    else if (!std::strcmp(argv[k], "--data") && has_value)
+    {
+      data_path = std::string(argv[++k]) + "/";
+    }
+    else if (argv[k][0] != '-' && journal_path.empty())
+    {
+      journal_path = argv[k];
+    }
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (journal_path.empty())
+  {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  YAML::Node config = YAML::LoadFile(data_path + "parameter.yaml");
+
+  return record ? Record(journal_path, data_path, config) : Replay(journal_path, config);
+}
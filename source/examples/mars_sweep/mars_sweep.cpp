@@ -0,0 +1,156 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/read_pose_data.h>
+#include <mars/data_utils/read_sim_data.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sweep_runner.h>
+#include <yaml-cpp/yaml.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Sweep of the IMU noise and the pose measurement noise on an IMU and pose dataset. The dataset is parsed once and
+// shared by all runs. Each run scales the noise values of the dataset configuration by a factor between 0.25 and 4.
+// The default dataset is the unpacked test data of the mars-test and mars-e2e-test targets.
+//
+// Usage: mars_sweep [--runs N] [--threads T] [--delay D] [--data PATH]
+
+void print_usage()
+{
+  std::cout << "Usage: mars_sweep [--runs N] [--threads T] [--delay D] [--data PATH]" << std::endl;
+  std::cout << "  --runs     Number of filter instances (default 16)" << std::endl;
+  std::cout << "  --threads  Number of worker threads, 0 for all hardware threads (default 0)" << std::endl;
+  std::cout << "  --delay    Injected pose sensor delay in seconds (default 0)" << std::endl;
+  std::cout << "  --data     Dataset directory containing parameter.yaml" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  int num_runs = 16;
+  int num_threads = 0;
+  double pose_delay = 0;
+  std::string data_path(MARS_SWEEP_DEFAULT_DATA_PATH);
+
+  for (int k = 1; k < argc; k++)
+  {
+    const bool has_value = k + 1 < argc;
+
+    if (!std::strcmp(argv[k], "--runs") && has_value)
+    {
+      num_runs = std::stoi(argv[++k]);
+    }
+    else if (!std::strcmp(argv[k], "--threads") && has_value)
+    {
+      num_threads = std::stoi(argv[++k]);
+    }
+    else if (!std::strcmp(argv[k], "--delay") && has_value)
+    {
+      pose_delay = std::stod(argv[++k]);
+    }
+    else if (!std::strcmp(argv[k], "--data") && has_value)
+    {
+      data_path = std::string(argv[++k]) + "/";
+    }
+    else
+    {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  YAML::Node config = YAML::LoadFile(data_path + "parameter.yaml");
+
+  const std::string traj_file_name = config["traj_file_name"].as<std::string>();
+  const std::string pose_file_name = config["pose_file_name"].as<std::string>();
+
+  const Eigen::Vector3d imu_n_w(config["imu_n_w"].as<std::vector<double>>().data());
+  const Eigen::Vector3d imu_n_bw(config["imu_n_bw"].as<std::vector<double>>().data());
+  const Eigen::Vector3d imu_n_a(config["imu_n_a"].as<std::vector<double>>().data());
+  const Eigen::Vector3d imu_n_ba(config["imu_n_ba"].as<std::vector<double>>().data());
+
+  // Parse the dataset once, all runs share the measurement payloads
+  std::shared_ptr<mars::SweepDataset> dataset = std::make_shared<mars::SweepDataset>();
+  {
+    std::vector<mars::BufferEntryType> measurement_data_imu;
+    mars::ReadSimData(&measurement_data_imu, nullptr, data_path + traj_file_name);
+
+    std::vector<mars::BufferEntryType> measurement_data_pose;
+    mars::ReadPoseData(&measurement_data_pose, nullptr, data_path + pose_file_name);
+
+    dataset->AddSensorMeasurements(measurement_data_imu);
+    dataset->AddSensorMeasurements(measurement_data_pose);
+    dataset->AddGroundTruth(measurement_data_imu);
+  }
+
+  std::cout << "Dataset: " << dataset->get_measurements().size() << " measurements" << std::endl;
+
+  auto setup = [&](const int& run_id) {
+    // Log spaced noise scale in [0.25, 4]
+    const double scale = num_runs > 1 ? std::pow(16.0, double(run_id) / double(num_runs - 1)) * 0.25 : 1.0;
+
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+    core_states_sptr->set_noise_std(scale * imu_n_w, scale * imu_n_bw, scale * imu_n_a, scale * imu_n_ba);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 2 * (M_PI / 180), 2 * (M_PI / 180), 2 * (M_PI / 180);
+    pose_meas_std *= scale;
+    pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> std;
+    std << 0.1, 0.1, 0.1, (10 * M_PI / 180), (10 * M_PI / 180), (10 * M_PI / 180);
+    pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+    pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    mars::SweepRunSetup run_setup;
+    run_setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    run_setup.sensors_ = { imu_sensor_sptr, pose_sensor_sptr };
+    run_setup.sensor_delays_ = { 0.0, pose_delay };
+
+    return run_setup;
+  };
+
+  mars::SweepRunner runner(dataset, num_threads);
+  std::cout << "Running " << num_runs << " filter instances on " << runner.get_num_threads() << " threads"
+            << std::endl;
+
+  const auto t_start = std::chrono::steady_clock::now();
+  std::vector<mars::SweepRunResult> results = runner.Run(num_runs, setup);
+  const double t_total = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+  mars::SweepRunner::PrintResults(results);
+
+  double t_cpu = 0;
+  for (const auto& k : results)
+  {
+    t_cpu += k.runtime_;
+  }
+
+  std::cout << "Wall time [s]: " << t_total << " Summed run time [s]: " << t_cpu
+            << " Speedup: " << (t_total > 0 ? t_cpu / t_total : 0) << std::endl;
+  std::cout << "Throughput [measurements/s]: "
+            << (t_total > 0 ? double(num_runs) * double(dataset->get_measurements().size()) / t_total : 0)
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef BACKGROUND_REWORK_CORE_LOGIC_H
+#define BACKGROUND_REWORK_CORE_LOGIC_H
+
+#include <mars/core_logic.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_data_type.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <Eigen/Dense>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace mars
+{
+///
+/// \brief The BackgroundReworkCoreLogic class moves the buffer rework of late measurements off the real-time path
+///
+/// An out of order measurement that is older than background_rework_threshold_ is processed by a clone of the
+/// CoreLogic in a worker thread. Meanwhile, in order measurements of the propagation sensor are propagated by the live
+/// CoreLogic and thus keep the state output going. All measurements that arrive during the rework are passed to the
+/// clone, once the clone processed all of them it replaces the live CoreLogic. The swap is performed by the next call
+/// of this class, the result is identical to processing all measurements sequentially with the CoreLogic.
+///
+/// Until the swap, the live CoreLogic does not contain the late measurement and the updates that arrived during the
+/// rework, only the propagation.
+///
+/// \note The live CoreLogic keeps its journal, smoother and state publisher. Measurements that are passed to the clone
+/// are recorded to the journal of the live CoreLogic in the order of arrival. The smoother does not receive the steps of
+/// the live CoreLogic during the rework. The clone records its smoother calls instead, the swap rewinds the smoother to
+/// the latest step before the rework and adds the steps of the clone.
+///
+/// \note The CoreLogic must not be used directly while a rework is active, see WaitForRework.
+///
+class BackgroundReworkCoreLogic
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  double background_rework_threshold_{ 0.1 };  ///< Out of order measurements older [s] than the latest buffer entry
+                                               ///< are reworked in the background, others are reworked directly
+
+  ///
+  /// \brief BackgroundReworkCoreLogic
+  /// \param core_logic Live filter, holds the result of each rework after the swap
+  ///
+  BackgroundReworkCoreLogic(std::shared_ptr<CoreLogic> core_logic);
+  BackgroundReworkCoreLogic(const BackgroundReworkCoreLogic&) = delete;
+  BackgroundReworkCoreLogic& operator=(const BackgroundReworkCoreLogic&) = delete;
+
+  ///
+  /// \brief ~BackgroundReworkCoreLogic Finishes an active rework and swaps the result in
+  ///
+  ~BackgroundReworkCoreLogic();
+
+  ///
+  /// \brief ProcessMeasurement Processes the measurement, see CoreLogic::ProcessMeasurement
+  /// \return True if the measurement was processed by the live CoreLogic or passed to the rework, false otherwise
+  ///
+  bool ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                          const BufferDataType& data);
+
+  ///
+  /// \brief Initialize Finishes an active rework and initializes the live CoreLogic, see CoreLogic::Initialize
+  ///
+  int Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init);
+
+  ///
+  /// \brief WaitForRework Blocks until an active rework is finished and swaps the result in
+  ///
+  void WaitForRework();
+
+  ///
+  /// \brief is_rework_active
+  /// \return True if the result of a rework was not swapped in yet, false otherwise
+  ///
+  bool is_rework_active() const;
+
+  ///
+  /// \brief get_num_background_reworks
+  /// \return Number of reworks that were performed in the background
+  ///
+  int get_num_background_reworks() const;
+
+  ///
+  /// \brief get_num_deferred_measurements
+  /// \return Number of measurements that arrived during a rework and were not processed by the live CoreLogic
+  ///
+  int get_num_deferred_measurements() const;
+
+private:
+  ///
+  /// \brief StartRework Clones the live CoreLogic and processes the measurement with the clone in the worker thread
+  ///
+  void StartRework(const BufferEntryType& measurement);
+
+  ///
+  /// \brief WorkerLoop Processes the late measurement and all pending measurements with the clone
+  ///
+  void WorkerLoop();
+
+  ///
+  /// \brief SwapIn Replaces the live CoreLogic with the clone, the worker thread must be finished
+  ///
+  void SwapIn();
+
+  class SmootherRecorder;
+
+  std::shared_ptr<CoreLogic> core_logic_;
+  std::unique_ptr<CoreLogic> shadow_;                    ///< Clone that performs the rework
+  BufferEntryType rework_entry_;                         ///< Out of order measurement of the active rework
+  std::shared_ptr<SmootherInterface> smoother_;          ///< Smoother of the live CoreLogic during the rework
+  std::shared_ptr<SmootherRecorder> smoother_recorder_;  ///< Smoother of the clone, records the steps of the rework
+  bool rework_active_{ false };
+  int num_background_reworks_{ 0 };
+  int num_deferred_measurements_{ 0 };
+
+  // Worker thread
+  std::thread worker_;
+  std::mutex mutex_;
+  std::deque<BufferEntryType> pending_;  ///< Measurements that arrived during the rework, in the order of arrival
+  bool rework_done_{ false };            ///< The clone processed all pending measurements
+};
+}  // namespace mars
+
+#endif  // BACKGROUND_REWORK_CORE_LOGIC_H
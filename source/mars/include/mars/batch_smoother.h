@@ -0,0 +1,166 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef BATCH_SMOOTHER_H
+#define BATCH_SMOOTHER_H
+
+#include <mars/smoother_interface.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The BatchSmoother class provides Rauch-Tung-Striebel smoothed core states of a complete recording
+///
+/// The forward pass is the filter itself, the CoreLogic passes each step to AddStep. The smoother stores one compact
+/// node per output state: the filtered state and the affine map of the backward recursion that leads from the
+/// correction and covariance of the next node to the ones of this node,
+///
+///   e_k = A_k e_k+1 + b_k,   P_k = A_k P_k+1 A_k^T + S_k.
+///
+/// These maps are associative under composition. Steps between two output nodes (output_interval_) are composed
+/// into the map of the node during the forward pass and are not stored. Smooth splits the nodes into one segment per
+/// thread, composes the segment maps in parallel, passes the boundary values from the latest to the first segment and
+/// finally runs the backward recursion of all segments in parallel.
+///
+/// \note Only the core state is smoothed, the cross-covariance with the sensor states is not considered.
+///
+/// Out of order measurements rewind the smoother to the latest step before the rework, the CoreLogic adds the reworked
+/// steps again. A checkpoint of the chain is kept for each of the latest max_rewind_steps_ steps.
+///
+/// \note A reset of the CoreLogic (new initialization) ends the current chain of steps. Each chain is smoothed on its
+/// own, the states of a chain that was reset are not corrected by later steps.
+///
+class BatchSmoother : public SmootherInterface
+{
+public:
+  double output_interval_{ 0 };  ///< Min. time [s] between two smoothed states, 0 outputs all filter steps
+  int max_rewind_steps_{ 300 };   ///< Max. number of latest steps that Rewind can return to
+
+  void AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry);
+
+  ///
+  /// \brief Reset Ends the current chain, the next step starts a new chain
+  ///
+  void Reset();
+
+  ///
+  /// \brief Rewind Removes the steps after the step with the given posterior core data and continues its chain
+  ///
+  /// If the step is not one of the latest max_rewind_steps_ steps of the current chain, the chain ends as with Reset.
+  ///
+  void Rewind(const std::shared_ptr<void>& core_data);
+
+  ///
+  /// \brief Smooth Smooths all steps that were added, ends the current chain
+  /// \param smoothed_entries Output parameter for the smoothed core states in time order, the core data of the entries
+  /// holds the smoothed state and covariance
+  /// \param num_threads Number of threads, 0 uses the number of hardware threads
+  /// \return Number of smoothed entries
+  ///
+  int Smooth(std::vector<BufferEntryType>* smoothed_entries, const int& num_threads = 0);
+
+  ///
+  /// \brief WriteCsvFile Writes the core states and the upper triangle of their covariance to a csv file
+  ///
+  /// The lines are formatted in parallel and written in blocks.
+  ///
+  /// \param file_path
+  /// \param entries Entries with core data
+  /// \param write_cov Write the covariance after the state
+  /// \param num_threads Number of threads, 0 uses the number of hardware threads
+  /// \return True if the file was written, false otherwise
+  ///
+  static bool WriteCsvFile(const std::string& file_path, const std::vector<BufferEntryType>& entries,
+                           const bool& write_cov = true, const int& num_threads = 0);
+
+  ///
+  /// \brief WriteBinaryFile Writes the columns of WriteCsvFile with covariance as raw doubles in native byte order
+  ///
+  /// Each entry is one record of 23 state and 120 covariance values without a file header, e.g. numpy.fromfile(path)
+  /// reshaped to (-1, 143).
+  ///
+  /// \param file_path
+  /// \param entries Entries with core data
+  /// \return True if the file was written, false otherwise
+  ///
+  static bool WriteBinaryFile(const std::string& file_path, const std::vector<BufferEntryType>& entries);
+
+  ///
+  /// \brief get_num_nodes
+  /// \return Number of stored nodes, the number of entries of the next Smooth call
+  ///
+  int get_num_nodes() const;
+
+private:
+  ///
+  /// \brief The Element struct is the affine map e = A e_next + b, P = A P_next A^T + S
+  ///
+  struct Element
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    CoreStateMatrix A_{ CoreStateMatrix::Identity() };
+    CoreStateVector b_{ CoreStateVector::Zero() };
+    CoreStateMatrix S_{ CoreStateMatrix::Zero() };
+  };
+
+  struct Node
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Time timestamp_;
+    std::shared_ptr<SensorAbsClass> sensor_{ nullptr };
+    CoreStateType state_;  ///< Filtered state
+    Element element_;      ///< Map from the next node, set once the next node was added or the chain ended
+  };
+
+  ///
+  /// \brief The Checkpoint struct holds the state of the chain after a step
+  ///
+  struct Checkpoint
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    std::shared_ptr<void> posterior_{ nullptr };  ///< Posterior of the step
+    size_t num_nodes_{ 0 };
+    Element open_element_;
+  };
+
+  ///
+  /// \brief Combine Composition of two maps, the result applies second first
+  ///
+  static Element Combine(const Element& first, const Element& second);
+
+  ///
+  /// \brief AddNode Adds a node for the posterior of a step, the map of the new node starts with the identity
+  ///
+  void AddNode(const BufferEntryType& posterior_entry);
+
+  ///
+  /// \brief FinishChain Completes the map of the latest node with the filtered covariance of the latest step
+  ///
+  void FinishChain();
+
+  std::vector<Node, Eigen::aligned_allocator<Node>> nodes_;
+  bool chain_open_{ false };                         ///< The map of the latest node is not complete
+  Element open_element_;                             ///< Map from the latest step to the latest node
+  std::shared_ptr<void> last_posterior_{ nullptr };  ///< Posterior of the latest added step
+  std::deque<Checkpoint, Eigen::aligned_allocator<Checkpoint>> checkpoints_;  ///< Latest steps of the current chain
+};
+}  // namespace mars
+
+#endif  // BATCH_SMOOTHER_H
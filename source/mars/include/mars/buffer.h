@@ -19,8 +19,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <deque>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -32,9 +34,17 @@ namespace mars
 /// \attention Erasing elements that are not located at the end or beginning of the buffer will
 /// invalidate the deque iterator
 ///
+/// The entries are stored in chunks of up to kChunkSize entries. Copies of a buffer share the chunk index and the
+/// chunks copy-on-write. Copying a buffer is O(1), the first modifying operation on either copy copies the chunk index,
+/// and each modification copies the chunk it modifies if the chunk is still shared. Diverging copies therefore only
+/// copy the chunks at which they were modified, entries that are appended to a full chunk start a new chunk. The
+/// payloads of the entries are never copied, they are treated as immutable once they were added to a buffer.
+///
 class Buffer
 {
 public:
+  static constexpr int kChunkSize = 64;  ///< Number of entries after which appended entries start a new chunk
+
   ///
   /// \brief Buffer default constructor
   /// max buffer size is set to 400 by default
@@ -70,6 +80,12 @@ public:
   ///
   void ResetBufferData();
 
+  ///
+  /// \brief IsShared
+  /// \return True if the chunk index is shared with a copy of this buffer, false otherwise
+  ///
+  bool IsShared() const;
+
   ///
   /// \brief IsEmpty
   /// \return True if the buffer is empty, false otherwise
@@ -210,6 +226,13 @@ public:
   ///
   bool DeleteStatesStartingAtIdx(const int& idx);
 
+  ///
+  /// \brief Deletes all entries before the given index
+  /// \param idx Index of the oldest entry that is kept
+  /// \return true if entries were deleted, false otherwise
+  ///
+  bool DeleteEntriesBeforeIdx(const int& idx);
+
   ///
   /// \brief Checks if all buffer entrys are correctly sorted by time
   /// \return true if sorted, false otherwise
@@ -244,11 +267,79 @@ public:
   ///
   int RemoveOverflowEntrys();
 
+  ///
+  /// \brief Detach Ensures that the chunk index is exclusively owned by this buffer before it is modified
+  ///
+  /// Called by all modifying operations. If the index is shared, the chunk references are copied, which is O(N /
+  /// kChunkSize) with the number of entries. The chunks remain shared until they are modified. A buffer that is
+  /// modified on another thread than its copies can detach on that thread ahead of time, the copies then own the
+  /// index and are modified without a copy of it.
+  ///
+  void Detach();
+
 private:
+  using Chunk = std::deque<BufferEntryType>;
+
+  ///
+  /// \brief Storage Chunk index of the buffer entries, shared copy-on-write between copies of the buffer
+  ///
+  /// The entries have consecutive positions, the first entry of chunk k has the position offsets_[k]. The positions
+  /// are relative, inserting or removing an entry moves the chunks before or after it, whichever are fewer.
+  ///
+  struct Storage
+  {
+    std::vector<std::shared_ptr<Chunk>> chunks_;  ///< Chunks in the order of the entries, chunks are never empty
+    std::vector<int64_t> offsets_;                ///< Position of the first entry of each chunk
+    int size_{ 0 };                               ///< Number of entries
+  };
+
+  ///
+  /// \brief FindChunk Returns the chunk that contains the entry at 'index', the last chunk if 'index' is the length
+  ///
+  size_t FindChunk(const int& index) const;
+
+  ///
+  /// \brief EntryAt Returns the entry at 'index', the index needs to be valid
+  ///
+  const BufferEntryType& EntryAt(const int& index) const;
+
+  ///
+  /// \brief FindLatest Returns the index of the latest entry for which 'predicate' is true, -1 if there is none
+  ///
+  template <typename Predicate>
+  int FindLatest(const Predicate& predicate) const;
+
+  ///
+  /// \brief FindOldest Returns the index of the oldest entry for which 'predicate' is true, -1 if there is none
+  ///
+  template <typename Predicate>
+  int FindOldest(const Predicate& predicate) const;
+
+  ///
+  /// \brief MutableChunk Returns the chunk at 'chunk' for modification, the chunk is copied if it is shared
+  /// \note The chunk index needs to be detached
+  ///
+  Chunk& MutableChunk(const size_t& chunk);
+
+  ///
+  /// \brief InsertEntry Inserts 'entry' before the entry at 'index', or appends it if 'index' is the length
+  ///
+  void InsertEntry(const int& index, const BufferEntryType& entry);
+
+  ///
+  /// \brief EraseEntry Removes the entry at 'index'
+  ///
+  void EraseEntry(const int& index);
+
+  ///
+  /// \brief EraseFront Removes the oldest 'count' entries
+  ///
+  void EraseFront(const int& count);
+
   ///
-  /// \brief deque container that holds the buffer entries
+  /// \brief chunk index that holds the buffer entries, shared copy-on-write between copies of the buffer
   ///
-  std::deque<BufferEntryType> data_;
+  std::shared_ptr<Storage> data_{ std::make_shared<Storage>() };
 
   ///
   /// \brief defines the max size at wich the oldest entry is removed
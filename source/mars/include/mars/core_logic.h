@@ -13,14 +13,22 @@
 
 #include <mars/buffer.h>
 #include <mars/core_state.h>
+#include <mars/cov_health.h>
 #include <mars/sensor_manager.h>
+#include <mars/time.h>
 #include <mars/type_definitions/core_state_type.h>
 #include <Eigen/Dense>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace mars
 {
+class JournalWriter;
+class ShmStatePublisher;
+class SmootherInterface;
+
 ///
 /// \brief The CoreLogic class represents the high-level logic for the operation of the filter
 ///
@@ -36,9 +44,24 @@ public:
   bool core_is_initialized_{ false };  /// core_is_initialized_ = true if the core state was initialized, false
                                        /// otherwise
   bool core_init_warn_once_{ false };
-  bool verbose_{ false };                /// Increased output of information
-  bool verbose_out_of_order_{ false };   /// Increased output of information for delayed measurements
-  bool discard_ooo_prop_meas_{ false };  /// Discard out of order propagation sensor measurements
+  bool verbose_{ false };                              /// Increased output of information
+  bool verbose_out_of_order_{ false };                 /// Increased output of information for delayed measurements
+  bool discard_ooo_prop_meas_{ false };                /// Discard out of order propagation sensor measurements
+  std::shared_ptr<JournalWriter> journal_{ nullptr };  /// Optional journal of all ProcessMeasurement and Initialize
+                                                       /// calls, disabled if nullptr
+  std::shared_ptr<SmootherInterface> smoother_{ nullptr };  /// Optional smoother that receives every filter step,
+                                                           /// disabled if nullptr
+  std::shared_ptr<ShmStatePublisher> state_publisher_{ nullptr };  /// Optional publisher of the latest state after
+                                                                  /// each update, disabled if nullptr
+  double state_publisher_period_{ -1 };  /// Min. time [s] between two published propagation steps, 0 publishes every
+                                         /// step and a negative value publishes updates only
+  bool stacked_update_{ false };        /// Fuse simultaneous measurements of ProcessMeasurements in one update
+  double stacked_update_epsilon_{ 0 };  /// Max. time difference [s] of measurements that are fused in one update
+  int num_stacked_updates_{ 0 };        /// Number of stacked updates that were performed
+  double interm_prop_threshold_{ 0 };   /// Updates closer [s] to the latest state skip the intermediate propagation
+  int num_skipped_interm_prop_{ 0 };    /// Number of intermediate propagations skipped due to the threshold
+  int num_reused_interm_prop_{ 0 };     /// Number of intermediate propagations reused from a previous update
+  CovHealthMonitor cov_health_;         /// Checks and anomaly counters of the prior core covariance of each update
 
   ///
   /// \brief CoreLogic
@@ -47,6 +70,25 @@ public:
   CoreLogic(std::shared_ptr<CoreState> core_states);
   CoreLogic() = default;
 
+  ///
+  /// \brief Clone Returns an independent copy of the filter
+  ///
+  /// The buffers of the clone share their entry chunks copy-on-write with the buffers of this instance. Cloning is O(1)
+  /// with respect to the buffer size, either instance only copies the chunks it modifies. Buffer payloads are
+  /// immutable and remain shared.
+  ///
+  /// \note The first modifying operation copies the chunk index of the buffer, O(N / Buffer::kChunkSize) with the
+  /// buffer size. Without further action this is the next measurement of whichever instance is processed first,
+  /// typically the source. A clone that is processed on a worker thread should call Buffer::Detach on that thread
+  /// first, such that the source is not delayed, see BackgroundReworkCoreLogic.
+  ///
+  /// \note The clone does not write to the journal and does not feed the smoother of this instance.
+  ///
+  /// \note The core states and the sensor instances are shared by reference. The sensor states that are stored in the
+  /// buffer diverge, the sensor configuration and calibration state held by the sensor instance do not.
+  ///
+  CoreLogic Clone() const;
+
   ///
   /// \brief Initialize the filter with information available in the prior init buffer
   ///
@@ -67,11 +109,53 @@ public:
   Eigen::MatrixXd PropagateSensorCrossCov(const Eigen::MatrixXd& sensor_cov, const CoreStateMatrix& core_cov,
                                           const CoreStateMatrix& state_transition);
 
+  ///
+  /// \brief CalcPriorSensorCov Returns the covariance of the core and the sensor state at the time of an update
+  ///
+  /// The core-sensor cross-covariance is read from the incrementally propagated block if the sensor has
+  /// incremental_cross_cov_ set and the block is available. Otherwise the stored cross-covariance is propagated with
+  /// the state transition between the sensor state and the core state.
+  ///
+  /// \param sensor Sensor handle
+  /// \param sensor_cov Full covariance of the latest sensor state
+  /// \param prior_sensor_idx Buffer index of the latest sensor state
+  /// \param prior_core_idx Buffer index of the core state closest to the update
+  /// \param core_cov Covariance of the core state at the time of the update
+  ///
+  Eigen::MatrixXd CalcPriorSensorCov(const std::shared_ptr<SensorAbsClass>& sensor, const Eigen::MatrixXd& sensor_cov,
+                                     const int& prior_sensor_idx, const int& prior_core_idx,
+                                     const CoreStateMatrix& core_cov);
+
   ///
   /// \brief PerformSensorUpdate Returns new state with corrected state and updated covariance
   ///
   bool PerformSensorUpdate(BufferEntryType* state_buffer_entry_return, std::shared_ptr<SensorAbsClass> sensor,
                            const Time& timestamp, std::shared_ptr<BufferDataType> data);
+  ///
+  /// \brief PerformStackedSensorUpdate Returns a corrected state entry for each measurement after a single update with
+  /// the stacked measurements of all sensors
+  ///
+  /// The update is performed at the latest timestamp of the measurements. The joint covariance contains the core
+  /// state and the states of all sensors, the cross-covariance between the individual sensors is zero.
+  ///
+  /// \param state_buffer_entries_return New state entries, one for each measurement
+  /// \param measurements Measurements of distinct, initialized sensors that support stacked updates
+  ///
+  bool PerformStackedSensorUpdate(std::vector<BufferEntryType>* state_buffer_entries_return,
+                                  const std::vector<BufferEntryType>& measurements);
+
+  ///
+  /// \brief PerformIntermediatePropagation Propagates the latest state to the timestamp of an update
+  ///
+  /// The propagation uses a zero-order hold of the latest IMU measurement. It is skipped if the timestamp is within
+  /// interm_prop_threshold_ of the latest state and the latest state is returned instead. The result is cached and
+  /// reused if further updates at the same timestamp see the same latest state, e.g. after a rejected update.
+  ///
+  /// \param timestamp Timestamp of the update, not older than the latest state
+  /// \return Core state entry at the timestamp
+  ///
+  BufferEntryType PerformIntermediatePropagation(const Time& timestamp);
+
   ///
   /// \brief PerformCoreStatePropagation Propagates the core state and returns the new state entry
   ///
@@ -124,6 +208,69 @@ public:
   /// \return True if the processing of the measurement was successful
   ///
   bool ProcessMeasurement(std::shared_ptr<SensorAbsClass> sensor, const Time& timestamp, const BufferDataType& data);
+
+  ///
+  /// \brief ProcessMeasurements Processes a set of measurements, e.g. all measurements of a driver tick
+  ///
+  /// The measurements of each sensor are passed to SensorInterface::PreprocessMeasurements first.
+  ///
+  /// If stacked_update_ is enabled, in order measurements of different update sensors whose timestamps are within
+  /// stacked_update_epsilon_ are fused in one stacked EKF update. This requires one intermediate propagation and one
+  /// covariance correction instead of one per measurement. All other measurements are passed to ProcessMeasurement.
+  /// If the stacked update of a group fails, e.g. a sensor provides no measurement model, the measurements of the
+  /// group are passed to ProcessMeasurement.
+  ///
+  /// \note Stacked measurements are stored individually in the buffer. A rework of the buffer after an out of order
+  /// measurement processes them sequentially. The journal records the call as a whole, such that the replay processes
+  /// the measurements with ProcessMeasurements and the same stacked update setting.
+  ///
+  /// \param measurements Measurement entries, the metadata is ignored
+  /// \return True if the processing of all measurements was successful
+  ///
+  bool ProcessMeasurements(const std::vector<BufferEntryType>& measurements);
+
+private:
+  ///
+  /// \brief ProcessMeasurementGroups Implements ProcessMeasurements without recording the call
+  ///
+  bool ProcessMeasurementGroups(const std::vector<BufferEntryType>& measurements);
+
+  ///
+  /// \brief SetSensorCrossCov Stores the core-sensor cross-covariance of a new sensor state for incremental propagation
+  ///
+  void SetSensorCrossCov(const BufferEntryType& sensor_state_entry);
+
+  ///
+  /// \brief PropagateIncrementalCrossCov Propagates the stored core-sensor cross-covariances by one core state step
+  ///
+  void PropagateIncrementalCrossCov(const BufferEntryType& core_state_entry);
+
+  ///
+  /// \brief PublishState Passes the latest state to the state publisher
+  ///
+  /// Updates are always published, propagation steps according to state_publisher_period_.
+  ///
+  /// \param timestamp Timestamp of the processed measurement
+  /// \param is_update False if the measurement was an in order propagation sensor measurement
+  ///
+  void PublishState(const Time& timestamp, const bool& is_update);
+
+  ///
+  /// \brief GetLatestSmootherStep Searches the latest entry before the index that was passed to the smoother
+  /// \return Core data of the entry, nullptr if there is none
+  ///
+  std::shared_ptr<void> GetLatestSmootherStep(const int& index) const;
+
+  std::shared_ptr<void> interm_prop_prior_core_{ nullptr };  /// Core data the cached propagation started from
+  BufferEntryType interm_prop_entry_;                        /// Cached result of the intermediate propagation
+  BufferEntryType update_prior_entry_;                       /// Prior core state of the latest sensor update
+  std::shared_ptr<void> propagated_core_{ nullptr };         /// Core data of the latest propagation result
+  Eigen::Matrix3d propagated_R_wi_;                          /// Rotation matrix of the orientation of propagated_core_
+  bool has_published_state_{ false };                        /// True if a propagation step was published
+  Time published_state_time_{ 0.0 };                         /// Timestamp of the latest published propagation step
+
+  /// Current core-sensor cross-covariance of the sensors with incremental_cross_cov_ set
+  std::map<std::shared_ptr<SensorAbsClass>, Eigen::MatrixXd> sensor_cross_cov_;
 };
 }  // namespace mars
 
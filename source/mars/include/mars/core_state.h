@@ -46,6 +46,9 @@ public:
   bool test_state_transition_{ false };  ///< If true, the class performs tests on the state-transition properties
   bool verbose_{ false };                ///< increased output of information
 
+  bool closed_form_quat_integration_{ false };  ///< If true, PropagateState uses IntegrateQuaternionClosedForm
+                                                ///< instead of the 4th order matrix exponential
+
   ///
   /// \brief CoreState Default constructor
   ///
@@ -122,6 +125,38 @@ public:
   ///   filter. arXiv preprint arXiv:1711.02508.
   CoreStateType PropagateState(const CoreStateType& prior_state, const IMUMeasurementType& measurement,
                                const double& dt);
+
+  ///
+  /// \brief PropagateState Performs the state propagation with the rotation matrix of the prior orientation
+  ///
+  /// Callers that propagate several steps pass the rotation matrix of the previous result as the prior rotation matrix
+  /// of the next step, each orientation is converted once.
+  ///
+  /// \param prior_state Prior state for the propagation
+  /// \param R_wi_prior Rotation matrix of the prior orientation
+  /// \param measurement System input
+  /// \param dt propagation timespan
+  /// \param R_wi Output parameter for the rotation matrix of the propagated orientation, can be R_wi_prior
+  /// \return Propagated core state
+  ///
+  CoreStateType PropagateState(const CoreStateType& prior_state, const Eigen::Matrix3d& R_wi_prior,
+                               const IMUMeasurementType& measurement, const double& dt, Eigen::Matrix3d* R_wi);
+  ///
+  /// \brief IntegrateQuaternionClosedForm First order quaternion integration with a closed-form exponential
+  ///
+  /// Equivalent to the integration of PropagateState without the truncation of the matrix exponential. With
+  /// Omega(w) q = q * [0, w], the exponential of the median turn rate is the rotation vector exponential and the
+  /// commutator term Omega(w) Omega(w_old) - Omega(w_old) Omega(w) reduces to q * [0, 2 * w_old x w].
+  ///
+  /// \param q_wi Prior orientation
+  /// \param w_old Bias corrected prior angular velocity
+  /// \param w Bias corrected current angular velocity
+  /// \param dt propagation timespan
+  /// \return Normalized orientation
+  ///
+  static Eigen::Quaterniond IntegrateQuaternionClosedForm(const Eigen::Quaterniond& q_wi, const Eigen::Vector3d& w_old,
+                                                          const Eigen::Vector3d& w, const double& dt);
+
   ///
   /// \brief PredictProcessCovariance Predicted core state covariance and generate the state transition matrix
   /// \param prior_core_state
@@ -133,6 +168,13 @@ public:
   CoreType PredictProcessCovariance(const CoreType& prior_core_state, const IMUMeasurementType& system_input,
                                     const double& dt);
 
+  ///
+  /// \brief PredictProcessCovariance Same as above with the rotation matrix of the prior orientation
+  /// \param R_wi Rotation matrix of the orientation of prior_core_state
+  ///
+  CoreType PredictProcessCovariance(const CoreType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                                    const IMUMeasurementType& system_input, const double& dt);
+
   // Static
   ///
   /// \brief GenerateFdTaylor Generates the state-transition matrix with cut-off Taylor series
@@ -161,6 +203,12 @@ public:
   ///
   static CoreStateMatrix GenerateFdSmallAngleApprox(const Eigen::Quaterniond& q_wi, const Eigen::Vector3d& a_est,
                                                     const Eigen::Vector3d& w_est, const double& dt);
+
+  ///
+  /// \brief GenerateFdSmallAngleApprox Same as above with the rotation matrix R_wi of the orientation
+  ///
+  static CoreStateMatrix GenerateFdSmallAngleApprox(const Eigen::Matrix3d& R_wi, const Eigen::Vector3d& a_est,
+                                                    const Eigen::Vector3d& w_est, const double& dt);
   static CoreStateMatrix CalcQSmallAngleApprox(const double& dt, const Eigen::Quaterniond& q_wi,
                                                const Eigen::Vector3d& a_m, const Eigen::Vector3d& n_a,
                                                const Eigen::Vector3d& b_a, const Eigen::Vector3d& n_ba,
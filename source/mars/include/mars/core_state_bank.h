@@ -0,0 +1,114 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef CORE_STATE_BANK_H
+#define CORE_STATE_BANK_H
+
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+
+namespace mars
+{
+///
+/// \brief The CoreStateBank class propagates the core states and covariances of many filters with the same IMU
+/// input in lockstep
+///
+/// The states, covariances and noise parameters are stored as structure of arrays. Each scalar element is a row and
+/// each filter is a column, such that the same operation of all filters operates on contiguous memory. Filters are
+/// processed in blocks of kLaneBlock lanes which map to the SIMD registers of the instruction set the library is
+/// compiled for (SSE2, AVX2, AVX-512 or NEON) and to scalar code otherwise.
+///
+/// The results are identical to CoreState::PropagateState and CoreState::PredictProcessCovariance within numerical
+/// precision. The process noise Q_d is evaluated per filter with CoreState::CalcQSmallAngleApprox.
+///
+/// \note Fixed biases (CoreState::set_fixed_acc_bias, CoreState::set_fixed_gyro_bias) are not supported.
+///
+class CoreStateBank
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int kLaneBlock = 16;  ///< Number of filters that are processed together
+
+  ///
+  /// \brief CoreStateBank
+  /// \param num_filters Number of filters in the bank
+  ///
+  CoreStateBank(const int& num_filters);
+
+  ///
+  /// \brief get_num_filters
+  /// \return Number of filters in the bank
+  ///
+  int get_num_filters() const;
+
+  ///
+  /// \brief set_noise_std Sets the IMU noise of a single filter, see CoreState::set_noise_std
+  ///
+  void set_noise_std(const int& idx, const Eigen::Vector3d& n_w, const Eigen::Vector3d& n_bw,
+                     const Eigen::Vector3d& n_a, const Eigen::Vector3d& n_ba);
+
+  ///
+  /// \brief set_core Sets the state and covariance of a single filter
+  ///
+  void set_core(const int& idx, const CoreType& core);
+
+  ///
+  /// \brief get_core Returns the state, covariance and latest state transition of a single filter
+  ///
+  CoreType get_core(const int& idx) const;
+
+  ///
+  /// \brief Propagate Propagates all filters with the same system input
+  /// \param measurement System input
+  /// \param dt Propagation timespan
+  ///
+  void Propagate(const IMUMeasurementType& measurement, const double& dt);
+
+private:
+  using Lanes = Eigen::Array<double, Eigen::Dynamic, 1, Eigen::ColMajor, kLaneBlock, 1>;
+  using BankArray = Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  // Row index of the state elements
+  static constexpr int kPwi = 0;
+  static constexpr int kVwi = 3;
+  static constexpr int kQwi = 6;  ///< Order w, x, y, z
+  static constexpr int kBw = 10;
+  static constexpr int kBa = 13;
+  static constexpr int kWm = 16;
+  static constexpr int kAm = 19;
+  static constexpr int kStateRows = 22;
+
+  // Row index of the noise elements
+  static constexpr int kNw = 0;
+  static constexpr int kNbw = 3;
+  static constexpr int kNa = 6;
+  static constexpr int kNba = 9;
+  static constexpr int kNoiseRows = 12;
+
+  static constexpr int kCovSize = CoreStateType::size_error_;
+
+  ///
+  /// \brief PropagateBlock Propagates the filters [start, start + num) of the bank
+  ///
+  void PropagateBlock(const int& start, const int& num, const IMUMeasurementType& measurement, const double& dt);
+
+  int num_filters_{ 0 };
+  BankArray state_;                        ///< State elements, kStateRows x num_filters_
+  BankArray cov_;                          ///< Row major flattened covariance, kCovSize^2 x num_filters_
+  BankArray transition_;                   ///< Row major flattened state transition, kCovSize^2 x num_filters_
+  BankArray noise_;                        ///< Noise STD, kNoiseRows x num_filters_
+  const Eigen::Vector3d g_{ 0, 0, 9.81 };  ///< Gravity, identical to CoreState::g_
+};
+}  // namespace mars
+
+#endif  // CORE_STATE_BANK_H
@@ -0,0 +1,80 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef COV_HEALTH_H
+#define COV_HEALTH_H
+
+#include <mars/type_definitions/core_state_type.h>
+
+namespace mars
+{
+///
+/// \brief The CovCheckLevel enum defines the checks of the CovHealthMonitor
+///
+enum class CovCheckLevel
+{
+  none,   ///< No checks
+  basic,  ///< Finite values, positive diagonal and a Cholesky factorization, full checks are sampled or on anomalies
+  full    ///< Basic and full checks for each covariance
+};
+
+///
+/// \brief The CovHealthMonitor class checks the core covariance of the filter and counts the anomalies
+///
+/// The basic check scans the covariance for non-finite values and non-positive variances and attempts a Cholesky
+/// factorization, all on the fixed-size core covariance. The full check additionally measures the asymmetry and the
+/// smallest eigenvalue of the symmetric part. With the basic level the full check runs after each anomaly and on every
+/// full_check_interval_-th check.
+///
+class CovHealthMonitor
+{
+public:
+  CovCheckLevel level_{ CovCheckLevel::basic };  ///< Checks that are performed
+  int full_check_interval_{ 100 };               ///< Every n-th basic check is a full check, 0 disables the sampling
+  double symmetry_tolerance_{ 1e-9 };            ///< Max. asymmetry relative to the largest variance
+  bool verbose_{ true };                         ///< Print a warning for each anomaly
+
+  int num_checks_{ 0 };                 ///< Number of checked covariances
+  int num_full_checks_{ 0 };            ///< Number of full checks
+  int num_not_finite_{ 0 };             ///< Covariances with NaN or infinite values
+  int num_non_positive_variance_{ 0 };  ///< Covariances with a diagonal entry <= 0
+  int num_not_positive_definite_{ 0 };  ///< Covariances without a Cholesky factorization
+  int num_not_symmetric_{ 0 };          ///< Covariances that exceed the symmetry tolerance, full check only
+  int num_negative_eigenvalue_{ 0 };    ///< Covariances with a negative eigenvalue, full check only
+  double min_eigenvalue_{ 0 };          ///< Smallest eigenvalue of the latest full check
+
+  ///
+  /// \brief Check Checks the covariance according to the level
+  /// \param cov Core covariance
+  /// \param description Name of the covariance for the warnings
+  /// \return True if no anomaly was found, false otherwise
+  ///
+  bool Check(const CoreStateMatrix& cov, const char* description);
+
+  ///
+  /// \brief get_num_anomalies
+  /// \return Number of checks that found an anomaly
+  ///
+  int get_num_anomalies() const;
+
+  ///
+  /// \brief ResetCounters Sets all counters to zero
+  ///
+  void ResetCounters();
+
+private:
+  bool CheckBasic(const CoreStateMatrix& cov, const char* description);
+  bool CheckFull(const CoreStateMatrix& cov, const char* description);
+
+  int num_anomalies_{ 0 };
+};
+}  // namespace mars
+
+#endif  // COV_HEALTH_H
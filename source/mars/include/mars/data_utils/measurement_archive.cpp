@@ -0,0 +1,419 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include "measurement_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace mars
+{
+namespace
+{
+const char kArchiveMagic[8] = "MARSARC";
+
+// Magic, version, padding and index offset
+constexpr size_t kHeaderSize = sizeof(kArchiveMagic) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+constexpr size_t kIndexOffsetPosition = sizeof(kArchiveMagic) + 2 * sizeof(uint32_t);
+
+template <typename T>
+bool ReadValue(const char* data, const size_t& size, size_t* offset, T* value)
+{
+  if (*offset + sizeof(T) > size)
+  {
+    return false;
+  }
+
+  std::memcpy(value, data + *offset, sizeof(T));
+  *offset += sizeof(T);
+  return true;
+}
+}  // namespace
+
+constexpr uint32_t MeasurementArchiveWriter::kVersion;
+
+MeasurementArchiveWriter::MeasurementArchiveWriter(const std::string& file_path, const uint32_t& chunk_size)
+  : file_(file_path, std::ios::binary | std::ios::trunc), chunk_size_(std::max<uint32_t>(chunk_size, 1))
+{
+  if (!file_.is_open())
+  {
+    std::cout << "Warning: MeasurementArchive: Could not open " << file_path << std::endl;
+    return;
+  }
+
+  std::vector<char> header;
+  header.insert(header.end(), kArchiveMagic, kArchiveMagic + sizeof(kArchiveMagic));
+  WriteValue(&header, kVersion);
+  WriteValue(&header, static_cast<uint32_t>(0));
+  WriteValue(&header, static_cast<uint64_t>(0));
+
+  file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+  file_size_ = header.size();
+}
+
+MeasurementArchiveWriter::~MeasurementArchiveWriter()
+{
+  Close();
+}
+
+bool MeasurementArchiveWriter::IsOpen() const
+{
+  return file_.is_open();
+}
+
+int MeasurementArchiveWriter::AddStream(const std::string& name, const JournalPayloadType& payload_type)
+{
+  if (!file_.is_open())
+  {
+    return -1;
+  }
+
+  for (const auto& k : streams_)
+  {
+    if (k.name_ == name)
+    {
+      std::cout << "Warning: MeasurementArchive: Stream " << name << " already exists" << std::endl;
+      return -1;
+    }
+  }
+
+  Stream stream;
+  stream.name_ = name;
+  stream.payload_type_ = payload_type;
+  streams_.push_back(stream);
+
+  return static_cast<int>(streams_.size()) - 1;
+}
+
+bool MeasurementArchiveWriter::Append(const int& stream_id, const Time& timestamp, const std::shared_ptr<void>& payload)
+{
+  if (!file_.is_open() || stream_id < 0 || stream_id >= static_cast<int>(streams_.size()))
+  {
+    return false;
+  }
+
+  Stream& stream = streams_[static_cast<size_t>(stream_id)];
+  const double t = timestamp.get_seconds();
+
+  if (stream.num_records_ > 0 && t < stream.t_last_)
+  {
+    std::cout << "Warning: MeasurementArchive: Measurement at t=" << t << " is older than the last measurement of "
+              << stream.name_ << ", the stream must be time sorted" << std::endl;
+    return false;
+  }
+
+  values_.clear();
+  if (!JournalWriter::EncodePayload(stream.payload_type_, payload, &values_))
+  {
+    return false;
+  }
+
+  WriteValue(&stream.chunk_, t);
+  WriteValue(&stream.chunk_, static_cast<uint32_t>(values_.size()));
+  const char* values = reinterpret_cast<const char*>(values_.data());
+  stream.chunk_.insert(stream.chunk_.end(), values, values + values_.size() * sizeof(double));
+
+  if (stream.pending_.count_ == 0)
+  {
+    stream.pending_.t_first_ = t;
+  }
+  stream.pending_.t_last_ = t;
+  stream.pending_.count_++;
+  stream.t_last_ = t;
+  stream.num_records_++;
+
+  if (stream.pending_.count_ == chunk_size_)
+  {
+    WriteChunk(&stream);
+  }
+
+  return true;
+}
+
+bool MeasurementArchiveWriter::Append(const int& stream_id, const std::vector<BufferEntryType>& entries)
+{
+  bool result = true;
+  for (const auto& k : entries)
+  {
+    result &= Append(stream_id, k.timestamp_, k.data_.sensor_);
+  }
+  return result;
+}
+
+void MeasurementArchiveWriter::WriteChunk(Stream* stream)
+{
+  if (stream->pending_.count_ == 0)
+  {
+    return;
+  }
+
+  stream->pending_.offset_ = file_size_;
+  stream->pending_.size_ = stream->chunk_.size();
+  file_.write(stream->chunk_.data(), static_cast<std::streamsize>(stream->chunk_.size()));
+  file_size_ += stream->chunk_.size();
+
+  stream->chunks_.push_back(stream->pending_);
+  stream->pending_ = MeasurementArchiveChunk();
+  stream->chunk_.clear();
+}
+
+void MeasurementArchiveWriter::Close()
+{
+  if (!file_.is_open())
+  {
+    return;
+  }
+
+  for (auto& k : streams_)
+  {
+    WriteChunk(&k);
+  }
+
+  const uint64_t index_offset = file_size_;
+
+  std::vector<char> index;
+  WriteValue(&index, static_cast<uint32_t>(streams_.size()));
+  for (const auto& k : streams_)
+  {
+    WriteValue(&index, static_cast<uint32_t>(k.name_.size()));
+    index.insert(index.end(), k.name_.begin(), k.name_.end());
+    WriteValue(&index, k.payload_type_);
+    WriteValue(&index, k.num_records_);
+    WriteValue(&index, static_cast<uint32_t>(k.chunks_.size()));
+
+    for (const auto& c : k.chunks_)
+    {
+      WriteValue(&index, c.t_first_);
+      WriteValue(&index, c.t_last_);
+      WriteValue(&index, c.offset_);
+      WriteValue(&index, c.size_);
+      WriteValue(&index, c.count_);
+    }
+  }
+
+  file_.write(index.data(), static_cast<std::streamsize>(index.size()));
+  file_.seekp(static_cast<std::streamoff>(kIndexOffsetPosition));
+  file_.write(reinterpret_cast<const char*>(&index_offset), sizeof(index_offset));
+  file_.close();
+}
+
+MeasurementArchiveReader::MeasurementArchiveReader(const std::string& file_path)
+{
+  const int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    std::cout << "Warning: MeasurementArchive: Could not open " << file_path << std::endl;
+    return;
+  }
+
+  struct stat info
+  {
+  };
+
+  if (fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      data_ = static_cast<const char*>(data);
+      size_ = static_cast<size_t>(info.st_size);
+    }
+  }
+  close(fd);
+
+  if (data_ == nullptr || !ReadIndex())
+  {
+    std::cout << "Warning: MeasurementArchive: " << file_path << " is not a valid archive" << std::endl;
+
+    if (data_ != nullptr)
+    {
+      munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    names_.clear();
+    streams_.clear();
+  }
+}
+
+MeasurementArchiveReader::~MeasurementArchiveReader()
+{
+  if (data_ != nullptr)
+  {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+bool MeasurementArchiveReader::IsOpen() const
+{
+  return data_ != nullptr;
+}
+
+bool MeasurementArchiveReader::ReadIndex()
+{
+  if (size_ < kHeaderSize || std::memcmp(data_, kArchiveMagic, sizeof(kArchiveMagic)) != 0)
+  {
+    return false;
+  }
+
+  size_t offset = sizeof(kArchiveMagic);
+  uint32_t version;
+  uint32_t padding;
+  uint64_t index_offset;
+  ReadValue(data_, size_, &offset, &version);
+  ReadValue(data_, size_, &offset, &padding);
+  ReadValue(data_, size_, &offset, &index_offset);
+
+  // An index offset of zero marks an archive that was not closed
+  if (version != MeasurementArchiveWriter::kVersion || index_offset < kHeaderSize || index_offset > size_)
+  {
+    return false;
+  }
+
+  offset = static_cast<size_t>(index_offset);
+  uint32_t num_streams;
+  if (!ReadValue(data_, size_, &offset, &num_streams))
+  {
+    return false;
+  }
+
+  for (uint32_t k = 0; k < num_streams; k++)
+  {
+    uint32_t name_length;
+    if (!ReadValue(data_, size_, &offset, &name_length) || offset + name_length > size_)
+    {
+      return false;
+    }
+    const std::string name(data_ + offset, name_length);
+    offset += name_length;
+
+    Stream stream;
+    uint32_t num_chunks;
+    if (!ReadValue(data_, size_, &offset, &stream.payload_type_) ||
+        !ReadValue(data_, size_, &offset, &stream.num_records_) || !ReadValue(data_, size_, &offset, &num_chunks))
+    {
+      return false;
+    }
+
+    stream.chunks_.resize(num_chunks);
+    for (auto& c : stream.chunks_)
+    {
+      if (!ReadValue(data_, size_, &offset, &c.t_first_) || !ReadValue(data_, size_, &offset, &c.t_last_) ||
+          !ReadValue(data_, size_, &offset, &c.offset_) || !ReadValue(data_, size_, &offset, &c.size_) ||
+          !ReadValue(data_, size_, &offset, &c.count_) || c.offset_ + c.size_ > index_offset)
+      {
+        return false;
+      }
+    }
+
+    names_.push_back(name);
+    streams_[name] = stream;
+  }
+
+  return true;
+}
+
+std::vector<std::string> MeasurementArchiveReader::get_stream_names() const
+{
+  return names_;
+}
+
+bool MeasurementArchiveReader::get_stream_info(const std::string& stream_name, JournalPayloadType* payload_type,
+                                               uint64_t* num_records, Time* t_first, Time* t_last) const
+{
+  auto it = streams_.find(stream_name);
+  if (it == streams_.end())
+  {
+    return false;
+  }
+
+  const Stream& stream = it->second;
+  *payload_type = stream.payload_type_;
+  *num_records = stream.num_records_;
+  *t_first = stream.chunks_.empty() ? Time(0) : Time(stream.chunks_.front().t_first_);
+  *t_last = stream.chunks_.empty() ? Time(0) : Time(stream.chunks_.back().t_last_);
+
+  return true;
+}
+
+bool MeasurementArchiveReader::Read(const std::string& stream_name, const Time& start, const Time& end,
+                                    const std::shared_ptr<SensorAbsClass>& sensor,
+                                    std::vector<BufferEntryType>* data_out, const double& time_offset) const
+{
+  data_out->clear();
+
+  auto it = streams_.find(stream_name);
+  if (it == streams_.end())
+  {
+    std::cout << "Warning: MeasurementArchive: Stream " << stream_name << " does not exist" << std::endl;
+    return false;
+  }
+
+  const Stream& stream = it->second;
+  const double t_start = start.get_seconds();
+  const double t_end = end.get_seconds();
+
+  // The chunks of a stream are time sorted, the first chunk of the window is the first that ends after its start
+  auto chunk = std::lower_bound(stream.chunks_.begin(), stream.chunks_.end(), t_start,
+                                [](const MeasurementArchiveChunk& c, const double& t) { return c.t_last_ < t; });
+
+  std::vector<double> values;
+  for (; chunk != stream.chunks_.end() && chunk->t_first_ <= t_end; chunk++)
+  {
+    const size_t chunk_end = static_cast<size_t>(chunk->offset_ + chunk->size_);
+    size_t offset = static_cast<size_t>(chunk->offset_);
+
+    for (uint32_t k = 0; k < chunk->count_; k++)
+    {
+      double t;
+      uint32_t num_values;
+      if (!ReadValue(data_, chunk_end, &offset, &t) || !ReadValue(data_, chunk_end, &offset, &num_values) ||
+          offset + num_values * sizeof(double) > chunk_end)
+      {
+        std::cout << "Warning: MeasurementArchive: Stream " << stream_name << " is corrupted" << std::endl;
+        return false;
+      }
+
+      if (t < t_start)
+      {
+        offset += num_values * sizeof(double);
+        continue;
+      }
+
+      if (t > t_end)
+      {
+        return true;
+      }
+
+      values.resize(num_values);
+      std::memcpy(values.data(), data_ + offset, num_values * sizeof(double));
+      offset += num_values * sizeof(double);
+
+      std::shared_ptr<void> payload = JournalReader::DecodePayload(stream.payload_type_, values);
+      if (payload == nullptr)
+      {
+        std::cout << "Warning: MeasurementArchive: Stream " << stream_name << " is corrupted" << std::endl;
+        return false;
+      }
+
+      BufferDataType data;
+      data.set_sensor_data(payload);
+      data_out->emplace_back(Time(t + time_offset), data, sensor, BufferMetadataType::measurement);
+    }
+  }
+
+  return true;
+}
+}  // namespace mars
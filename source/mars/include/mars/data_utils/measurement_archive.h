@@ -0,0 +1,183 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef MEASUREMENT_ARCHIVE_H
+#define MEASUREMENT_ARCHIVE_H
+
+#include <mars/journal.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The MeasurementArchiveChunk struct is the sparse time index entry of one chunk of a stream
+///
+struct MeasurementArchiveChunk
+{
+  double t_first_{ 0 };   ///< Timestamp of the first record in the chunk
+  double t_last_{ 0 };    ///< Timestamp of the last record in the chunk
+  uint64_t offset_{ 0 };  ///< Byte offset of the chunk in the file
+  uint64_t size_{ 0 };    ///< Size of the chunk in bytes
+  uint32_t count_{ 0 };   ///< Number of records in the chunk
+};
+
+///
+/// \brief The MeasurementArchiveWriter class writes measurements to an archive with a time-range index
+///
+/// Each sensor is a stream of time-sorted records. Records are collected per stream and written as chunks of
+/// chunk_size records, the index holds the time range and file offset of every chunk. Payloads use the journal codecs.
+///
+/// File layout: magic "MARSARC", version (uint32), padding (uint32), index offset (uint64), then the chunks. Each chunk
+/// is a sequence of records: double timestamp, uint32 number of values, double values. The index is written on Close:
+///   uint32 number of streams, for each stream: uint32 name length, name, int32 payload type, uint64 number of records,
+///   uint32 number of chunks, for each chunk: double t_first, double t_last, uint64 offset, uint64 size, uint32 count
+///
+class MeasurementArchiveWriter
+{
+public:
+  static constexpr uint32_t kVersion = 1;
+
+  ///
+  /// \brief MeasurementArchiveWriter Opens the archive file, an existing file is overwritten
+  /// \param file_path Path of the archive file
+  /// \param chunk_size Number of records per chunk, bounds the records that are decoded beyond a requested window
+  ///
+  MeasurementArchiveWriter(const std::string& file_path, const uint32_t& chunk_size = 256);
+  ~MeasurementArchiveWriter();
+
+  MeasurementArchiveWriter(const MeasurementArchiveWriter&) = delete;
+  MeasurementArchiveWriter& operator=(const MeasurementArchiveWriter&) = delete;
+
+  bool IsOpen() const;
+
+  ///
+  /// \brief AddStream Adds a stream for the measurements of one sensor
+  /// \return Id of the stream, -1 if the name is already used or the file is not open
+  ///
+  int AddStream(const std::string& name, const JournalPayloadType& payload_type);
+
+  ///
+  /// \brief Append Appends a measurement to a stream
+  /// \return True if the measurement was appended, false if it is older than the last one of the stream or its
+  /// payload type is not supported
+  ///
+  bool Append(const int& stream_id, const Time& timestamp, const std::shared_ptr<void>& payload);
+
+  ///
+  /// \brief Append Appends the measurements of buffer entries, e.g. the output of the read_*_data loaders
+  /// \return True if all entries were appended
+  ///
+  bool Append(const int& stream_id, const std::vector<BufferEntryType>& entries);
+
+  ///
+  /// \brief Close Writes the pending chunks and the index, no further measurements can be appended
+  ///
+  void Close();
+
+private:
+  struct Stream
+  {
+    std::string name_;
+    JournalPayloadType payload_type_;
+    uint64_t num_records_{ 0 };
+    double t_last_{ 0 };       ///< Timestamp of the last record, enforces the time order
+    std::vector<char> chunk_;  ///< Records of the pending chunk
+    MeasurementArchiveChunk pending_;
+    std::vector<MeasurementArchiveChunk> chunks_;
+  };
+
+  void WriteChunk(Stream* stream);
+
+  template <typename T>
+  static void WriteValue(std::vector<char>* buffer, const T& value)
+  {
+    const char* data = reinterpret_cast<const char*>(&value);
+    buffer->insert(buffer->end(), data, data + sizeof(T));
+  }
+
+  std::ofstream file_;
+  uint32_t chunk_size_;
+  uint64_t file_size_{ 0 };
+  std::vector<Stream> streams_;
+  std::vector<double> values_;  ///< Reused encoding buffer
+};
+
+///
+/// \brief The MeasurementArchiveReader class reads time windows of an archive that was written by the
+/// MeasurementArchiveWriter
+///
+/// The file is memory mapped and only the index is parsed on opening. A time window is found by a binary search over
+/// the chunk index, only the chunks that overlap the window are decoded. The cost of a query is therefore independent
+/// of the size of the archive.
+///
+class MeasurementArchiveReader
+{
+public:
+  ///
+  /// \brief MeasurementArchiveReader Maps the archive file and reads the index
+  ///
+  MeasurementArchiveReader(const std::string& file_path);
+  ~MeasurementArchiveReader();
+
+  MeasurementArchiveReader(const MeasurementArchiveReader&) = delete;
+  MeasurementArchiveReader& operator=(const MeasurementArchiveReader&) = delete;
+
+  bool IsOpen() const;
+
+  ///
+  /// \brief get_stream_names Names of all streams in the order they were added
+  ///
+  std::vector<std::string> get_stream_names() const;
+
+  ///
+  /// \brief get_stream_info Payload type, number of records and time range of a stream
+  /// \return False if the stream does not exist
+  ///
+  bool get_stream_info(const std::string& stream_name, JournalPayloadType* payload_type, uint64_t* num_records,
+                       Time* t_first, Time* t_last) const;
+
+  ///
+  /// \brief Read Decodes the measurements of a stream within [start, end]
+  ///
+  /// The output matches the read_*_data loaders: measurement entries of the given sensor, the time offset is added to
+  /// the timestamps after the window was selected.
+  ///
+  /// \return False if the stream does not exist or the archive is corrupted
+  ///
+  bool Read(const std::string& stream_name, const Time& start, const Time& end,
+            const std::shared_ptr<SensorAbsClass>& sensor, std::vector<BufferEntryType>* data_out,
+            const double& time_offset = 0) const;
+
+private:
+  struct Stream
+  {
+    JournalPayloadType payload_type_;
+    uint64_t num_records_;
+    std::vector<MeasurementArchiveChunk> chunks_;
+  };
+
+  bool ReadIndex();
+
+  const char* data_{ nullptr };  ///< Mapped file
+  size_t size_{ 0 };
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, Stream> streams_;
+};
+}  // namespace mars
+
+#endif  // MEASUREMENT_ARCHIVE_H
@@ -0,0 +1,44 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef READ_ARCHIVE_DATA_H
+#define READ_ARCHIVE_DATA_H
+
+#include <mars/data_utils/measurement_archive.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The ReadArchiveData class loads a time window of one stream of a measurement archive
+///
+/// Counterpart of the CSV loaders (ReadImuData, ReadPoseData, ...) for archives. The default window loads the full
+/// stream.
+///
+class ReadArchiveData
+{
+public:
+  ReadArchiveData(std::vector<BufferEntryType>* data_out, std::shared_ptr<SensorAbsClass> sensor,
+                  const std::string& file_path, const std::string& stream_name, const double& time_offset = 0,
+                  const Time& start = -std::numeric_limits<double>::infinity(),
+                  const Time& end = std::numeric_limits<double>::infinity())
+  {
+    MeasurementArchiveReader reader(file_path);
+    reader.Read(stream_name, start, end, sensor, data_out, time_offset);
+  }
+};
+}  // namespace mars
+
+#endif  // READ_ARCHIVE_DATA_H
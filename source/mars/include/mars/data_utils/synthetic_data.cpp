@@ -0,0 +1,441 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include "synthetic_data.h"
+
+#include <mars/general_functions/utils.h>
+#include <mars/journal.h>
+#include <mars/sensors/bodyvel/bodyvel_measurement_type.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_measurement_type.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/mag/mag_measurement_type.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/pressure/pressure_measurement_type.h>
+#include <mars/sensors/vision/vision_measurement_type.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace mars
+{
+SyntheticDataGenerator::SyntheticDataGenerator(const SyntheticTrajectoryOptions& options)
+  : options_(options), gps_conversion_(options.gps_reference_), generator_(options.seed_)
+{
+}
+
+int SyntheticDataGenerator::AddSensor(const SyntheticSensorOptions& options)
+{
+  if (options.rate_ <= 0)
+  {
+    std::cout << "Warning: SyntheticDataGenerator: Sensor rate needs to be positive, no measurements generated"
+              << std::endl;
+  }
+
+  const int sensor_idx = static_cast<int>(sensor_options_.size());
+  sensor_options_.push_back(options);
+  measurements_.emplace_back();
+  arrival_times_.emplace_back();
+
+  const int num_samples = options.rate_ > 0 ? static_cast<int>(std::floor(options_.duration_ * options.rate_)) + 1 : 0;
+  const double max_jitter = 0.45 / std::max(options.rate_, 1e-9);  // Keeps the sample times strictly increasing
+
+  std::uniform_real_distribution<double> dropout_dist(0, 1);
+
+  measurements_.back().reserve(num_samples);
+  arrival_times_.back().reserve(num_samples);
+
+  for (int k = 0; k < num_samples; k++)
+  {
+    double t = k / options.rate_;
+    if (options.timestamp_jitter_ > 0)
+    {
+      t += std::min(std::max(options.timestamp_jitter_ * normal_dist_(generator_), -max_jitter), max_jitter);
+      t = std::min(std::max(t, 0.0), options_.duration_);
+    }
+
+    if (options.dropout_ > 0 && dropout_dist(generator_) < options.dropout_)
+    {
+      continue;
+    }
+
+    double arrival = t + options.delay_;
+    if (options.delay_jitter_ > 0)
+    {
+      arrival += std::abs(options.delay_jitter_ * normal_dist_(generator_));
+    }
+
+    BufferDataType data;
+    data.set_sensor_data(GenerateMeasurement(options, t));
+
+    if (options.type_ == SyntheticSensorType::imu)
+    {
+      data.set_core_data(std::make_shared<CoreStateType>(get_ground_truth(t)));
+    }
+
+    measurements_.back().emplace_back(t, data, nullptr, BufferMetadataType::measurement);
+    arrival_times_.back().push_back(arrival);
+  }
+
+  return sensor_idx;
+}
+
+CoreStateType SyntheticDataGenerator::get_ground_truth(const double& t) const
+{
+  const double& r = options_.radius_;
+  const double& w = options_.angular_rate_;
+  const double& h_a = options_.height_amplitude_;
+  const double& t_a = options_.tilt_amplitude_;
+  const double& t_w = options_.tilt_rate_;
+
+  // Position, velocity and acceleration on the circle
+  const double s = std::sin(w * t);
+  const double c = std::cos(w * t);
+  const double s2 = std::sin(2 * w * t);
+  const double c2 = std::cos(2 * w * t);
+
+  const Eigen::Vector3d p_wi(r * c, r * s, options_.height_ + h_a * s2);
+  const Eigen::Vector3d v_wi(-r * w * s, r * w * c, 2 * w * h_a * c2);
+  const Eigen::Vector3d a_wi(-r * w * w * c, -r * w * w * s, -4 * w * w * h_a * s2);
+
+  // Attitude with the yaw-pitch-roll sequence R = Rz(yaw) * Ry(pitch) * Rx(roll)
+  const double yaw = w * t + M_PI / 2;
+  const double pitch = t_a * std::sin(t_w * t);
+  const double roll = t_a * std::cos(t_w * t);
+  const double d_yaw = w;
+  const double d_pitch = t_a * t_w * std::cos(t_w * t);
+  const double d_roll = -t_a * t_w * std::sin(t_w * t);
+
+  const Eigen::AngleAxisd R_yaw(yaw, Eigen::Vector3d::UnitZ());
+  const Eigen::AngleAxisd R_pitch(pitch, Eigen::Vector3d::UnitY());
+  const Eigen::AngleAxisd R_roll(roll, Eigen::Vector3d::UnitX());
+  const Eigen::Quaterniond q_wi = (R_yaw * R_pitch * R_roll).normalized();
+
+  // Angular velocity in the body frame
+  const Eigen::Vector3d w_i = R_roll.inverse() * (R_pitch.inverse() * Eigen::Vector3d(0, 0, d_yaw)) +
+                              R_roll.inverse() * Eigen::Vector3d(0, d_pitch, 0) + Eigen::Vector3d(d_roll, 0, 0);
+
+  const Eigen::Vector3d g(0, 0, 9.81);
+
+  CoreStateType state;
+  state.p_wi_ = p_wi;
+  state.v_wi_ = v_wi;
+  state.q_wi_ = q_wi;
+  state.b_w_ = options_.b_w_;
+  state.b_a_ = options_.b_a_;
+  state.w_m_ = w_i + options_.b_w_;
+  state.a_m_ = q_wi.toRotationMatrix().transpose() * (a_wi + g) + options_.b_a_;
+
+  return state;
+}
+
+const std::vector<BufferEntryType>& SyntheticDataGenerator::get_sensor_measurements(const int& sensor_idx) const
+{
+  return measurements_.at(sensor_idx);
+}
+
+std::vector<SyntheticMeasurement> SyntheticDataGenerator::get_arrival_stream() const
+{
+  std::vector<SyntheticMeasurement> stream;
+
+  for (size_t s = 0; s < measurements_.size(); s++)
+  {
+    for (size_t k = 0; k < measurements_[s].size(); k++)
+    {
+      SyntheticMeasurement entry;
+      entry.arrival_ = arrival_times_[s][k];
+      entry.timestamp_ = measurements_[s][k].timestamp_;
+      entry.sensor_idx_ = static_cast<int>(s);
+      entry.data_ = measurements_[s][k].data_.sensor_;
+      stream.push_back(entry);
+    }
+  }
+
+  // Stable sort, equal arrival times keep the order in which the sensors were added
+  std::stable_sort(stream.begin(), stream.end(), [](const SyntheticMeasurement& a, const SyntheticMeasurement& b) {
+    return a.arrival_ < b.arrival_;
+  });
+
+  return stream;
+}
+
+int SyntheticDataGenerator::get_num_sensors() const
+{
+  return static_cast<int>(sensor_options_.size());
+}
+
+bool SyntheticDataGenerator::WriteCsv(const int& sensor_idx, const std::string& file_path) const
+{
+  if (sensor_idx < 0 || sensor_idx >= get_num_sensors())
+  {
+    std::cout << "Warning: SyntheticDataGenerator: Invalid sensor index " << sensor_idx << std::endl;
+    return false;
+  }
+
+  std::ofstream file(file_path);
+  if (!file.is_open())
+  {
+    std::cout << "Warning: SyntheticDataGenerator: Could not open " << file_path << std::endl;
+    return false;
+  }
+
+  file << std::setprecision(17);
+
+  auto vec_to_csv = [](const Eigen::Vector3d& v) {
+    std::stringstream os;
+    os << std::setprecision(17) << ", " << v(0) << ", " << v(1) << ", " << v(2);
+    return os.str();
+  };
+  auto quat_to_csv = [](const Eigen::Quaterniond& q) {
+    std::stringstream os;
+    os << std::setprecision(17) << ", " << q.w() << ", " << q.x() << ", " << q.y() << ", " << q.z();
+    return os.str();
+  };
+
+  const SyntheticSensorType& type = sensor_options_[sensor_idx].type_;
+
+  switch (type)
+  {
+    case SyntheticSensorType::imu:
+      file << "t, a_x, a_y, a_z, w_x, w_y, w_z, p_x, p_y, p_z, v_x, v_y, v_z, q_w, q_x, q_y, q_z, ba_x, ba_y, ba_z, "
+              "bw_x, bw_y, bw_z\n";
+      break;
+    case SyntheticSensorType::pose:
+    case SyntheticSensorType::vision:
+      file << "t, p_x, p_y, p_z, q_w, q_x, q_y, q_z\n";
+      break;
+    case SyntheticSensorType::position:
+      file << "t, p_x, p_y, p_z\n";
+      break;
+    case SyntheticSensorType::gps:
+      file << "t, lat, long, alt\n";
+      break;
+    case SyntheticSensorType::gps_w_vel:
+      file << "t, lat, long, alt, v_x, v_y, v_z\n";
+      break;
+    case SyntheticSensorType::mag:
+      file << "t, cart_x, cart_y, cart_z\n";
+      break;
+    case SyntheticSensorType::pressure:
+      file << "t, p\n";
+      break;
+    case SyntheticSensorType::bodyvel:
+      file << "t, v_x, v_y, v_z\n";
+      break;
+    default:
+      return false;
+  }
+
+  for (const auto& k : measurements_[sensor_idx])
+  {
+    file << k.timestamp_.get_seconds();
+
+    switch (type)
+    {
+      case SyntheticSensorType::imu:
+      {
+        const auto& meas = *static_cast<IMUMeasurementType*>(k.data_.sensor_.get());
+        const auto& gt = *static_cast<CoreStateType*>(k.data_.core_.get());
+        file << vec_to_csv(meas.linear_acceleration_) << vec_to_csv(meas.angular_velocity_) << vec_to_csv(gt.p_wi_)
+             << vec_to_csv(gt.v_wi_) << quat_to_csv(gt.q_wi_) << vec_to_csv(gt.b_a_) << vec_to_csv(gt.b_w_);
+        break;
+      }
+      case SyntheticSensorType::pose:
+      {
+        const auto& meas = *static_cast<PoseMeasurementType*>(k.data_.sensor_.get());
+        file << vec_to_csv(meas.position_) << quat_to_csv(meas.orientation_);
+        break;
+      }
+      case SyntheticSensorType::vision:
+      {
+        const auto& meas = *static_cast<VisionMeasurementType*>(k.data_.sensor_.get());
+        file << vec_to_csv(meas.position_) << quat_to_csv(meas.orientation_);
+        break;
+      }
+      case SyntheticSensorType::position:
+        file << vec_to_csv(static_cast<PositionMeasurementType*>(k.data_.sensor_.get())->position_);
+        break;
+      case SyntheticSensorType::gps:
+      {
+        const GpsCoordinates& coordinates = static_cast<GpsMeasurementType*>(k.data_.sensor_.get())->coordinates_;
+        file << ", " << coordinates.latitude_ << ", " << coordinates.longitude_ << ", " << coordinates.altitude_;
+        break;
+      }
+      case SyntheticSensorType::gps_w_vel:
+      {
+        const auto& meas = *static_cast<GpsVelMeasurementType*>(k.data_.sensor_.get());
+        file << ", " << meas.coordinates_.latitude_ << ", " << meas.coordinates_.longitude_ << ", "
+             << meas.coordinates_.altitude_ << vec_to_csv(meas.velocity_);
+        break;
+      }
+      case SyntheticSensorType::mag:
+        file << vec_to_csv(static_cast<MagMeasurementType*>(k.data_.sensor_.get())->mag_vector_);
+        break;
+      case SyntheticSensorType::pressure:
+        file << ", " << static_cast<PressureMeasurementType*>(k.data_.sensor_.get())->pressure_.data_;
+        break;
+      case SyntheticSensorType::bodyvel:
+        file << vec_to_csv(static_cast<BodyvelMeasurementType*>(k.data_.sensor_.get())->velocity_);
+        break;
+      default:
+        break;
+    }
+
+    file << "\n";
+  }
+
+  return file.good();
+}
+
+bool SyntheticDataGenerator::WriteJournal(const std::string& file_path,
+                                          const std::vector<std::shared_ptr<SensorAbsClass>>& sensors) const
+{
+  if (static_cast<int>(sensors.size()) != get_num_sensors())
+  {
+    std::cout << "Warning: SyntheticDataGenerator: Number of sensor instances does not match the generator"
+              << std::endl;
+    return false;
+  }
+
+  JournalWriter journal(file_path);
+  if (!journal.IsOpen())
+  {
+    return false;
+  }
+
+  for (size_t k = 0; k < sensors.size(); k++)
+  {
+    JournalPayloadType payload_type = JournalPayloadType::unknown;
+
+    switch (sensor_options_[k].type_)
+    {
+      case SyntheticSensorType::imu:
+        payload_type = JournalPayloadType::imu;
+        break;
+      case SyntheticSensorType::pose:
+        payload_type = JournalPayloadType::pose;
+        break;
+      case SyntheticSensorType::position:
+        payload_type = JournalPayloadType::position;
+        break;
+      case SyntheticSensorType::vision:
+        payload_type = JournalPayloadType::vision;
+        break;
+      case SyntheticSensorType::gps:
+        payload_type = JournalPayloadType::gps;
+        break;
+      case SyntheticSensorType::gps_w_vel:
+        payload_type = JournalPayloadType::gps_w_vel;
+        break;
+      case SyntheticSensorType::mag:
+        payload_type = JournalPayloadType::mag;
+        break;
+      case SyntheticSensorType::pressure:
+        payload_type = JournalPayloadType::pressure;
+        break;
+      case SyntheticSensorType::bodyvel:
+        payload_type = JournalPayloadType::bodyvel;
+        break;
+      default:
+        break;
+    }
+
+    journal.RegisterSensor(sensors[k], payload_type);
+  }
+
+  for (const auto& k : get_arrival_stream())
+  {
+    BufferDataType data;
+    data.set_sensor_data(k.data_);
+    journal.RecordMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+  }
+
+  journal.Flush();
+  return true;
+}
+
+std::shared_ptr<void> SyntheticDataGenerator::GenerateMeasurement(const SyntheticSensorOptions& sensor,
+                                                                  const double& t)
+{
+  const CoreStateType state = get_ground_truth(t);
+  const Eigen::Matrix3d R_wi = state.q_wi_.toRotationMatrix();
+  const Eigen::Matrix3d R_ix = sensor.q_ix_.toRotationMatrix();
+  const Eigen::Vector3d w_i = state.w_m_ - state.b_w_;
+
+  const Eigen::Vector3d p_wx = state.p_wi_ + R_wi * sensor.p_ix_;
+  const Eigen::Quaterniond q_wx = state.q_wi_ * sensor.q_ix_;
+
+  switch (sensor.type_)
+  {
+    case SyntheticSensorType::imu:
+      return std::make_shared<IMUMeasurementType>(state.a_m_ + Noise(sensor.noise_std_),
+                                                  state.w_m_ + Noise(sensor.noise_std_secondary_));
+    case SyntheticSensorType::pose:
+      return std::make_shared<PoseMeasurementType>(
+          p_wx + Noise(sensor.noise_std_),
+          Utils::ApplySmallAngleQuatCorr(q_wx, Noise(sensor.noise_std_secondary_)));
+    case SyntheticSensorType::position:
+      return std::make_shared<PositionMeasurementType>(p_wx + Noise(sensor.noise_std_));
+    case SyntheticSensorType::vision:
+      return std::make_shared<VisionMeasurementType>(
+          p_wx + Noise(sensor.noise_std_),
+          Utils::ApplySmallAngleQuatCorr(q_wx, Noise(sensor.noise_std_secondary_)));
+    case SyntheticSensorType::gps:
+    {
+      const GpsCoordinates coordinates = gps_conversion_.get_wgs84(p_wx + Noise(sensor.noise_std_));
+      return std::make_shared<GpsMeasurementType>(coordinates.latitude_, coordinates.longitude_,
+                                                  coordinates.altitude_);
+    }
+    case SyntheticSensorType::gps_w_vel:
+    {
+      const GpsCoordinates coordinates = gps_conversion_.get_wgs84(p_wx + Noise(sensor.noise_std_));
+      const Eigen::Vector3d v_wx =
+          state.v_wi_ + R_wi * Utils::Skew(w_i) * sensor.p_ix_ + Noise(sensor.noise_std_secondary_);
+      return std::make_shared<GpsVelMeasurementType>(coordinates.latitude_, coordinates.longitude_,
+                                                     coordinates.altitude_, v_wx(0), v_wx(1), v_wx(2));
+    }
+    case SyntheticSensorType::mag:
+      return std::make_shared<MagMeasurementType>(R_ix.transpose() * R_wi.transpose() * options_.mag_w_ +
+                                                  Noise(sensor.noise_std_));
+    case SyntheticSensorType::pressure:
+    {
+      // Inverse of the barometric formula of the PressureConversion with the reference at sea level
+      const MediumPressureOptions medium;
+      const double pressure =
+          medium.P_sl * std::exp(-p_wx(2) / (medium.rOverMg * options_.temperature_K_)) +
+          sensor.noise_std_ * normal_dist_(generator_);
+      return std::make_shared<PressureMeasurementType>(pressure, options_.temperature_K_);
+    }
+    case SyntheticSensorType::bodyvel:
+      return std::make_shared<BodyvelMeasurementType>(
+          R_ix.transpose() * (R_wi.transpose() * state.v_wi_ + Utils::Skew(w_i) * sensor.p_ix_) +
+          Noise(sensor.noise_std_));
+    default:
+      return nullptr;
+  }
+}
+
+Eigen::Vector3d SyntheticDataGenerator::Noise(const double& std)
+{
+  if (std <= 0)
+  {
+    return Eigen::Vector3d::Zero();
+  }
+
+  const double n_x = normal_dist_(generator_);
+  const double n_y = normal_dist_(generator_);
+  const double n_z = normal_dist_(generator_);
+  return std * Eigen::Vector3d(n_x, n_y, n_z);
+}
+}  // namespace mars
@@ -0,0 +1,176 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SYNTHETIC_DATA_H
+#define SYNTHETIC_DATA_H
+
+#include <mars/sensors/gps/gps_conversion.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <Eigen/Dense>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The SyntheticSensorType enum defines the measurement types of the SyntheticDataGenerator
+///
+enum class SyntheticSensorType
+{
+  imu,        ///< IMUMeasurementType, the entries hold the ground truth as CoreStateType
+  pose,       ///< PoseMeasurementType
+  position,   ///< PositionMeasurementType
+  vision,     ///< VisionMeasurementType, the vision frame is aligned with the world frame and the scale is one
+  gps,        ///< GpsMeasurementType
+  gps_w_vel,  ///< GpsVelMeasurementType
+  mag,        ///< MagMeasurementType
+  pressure,   ///< PressureMeasurementType of type GAS
+  bodyvel     ///< BodyvelMeasurementType
+};
+
+///
+/// \brief The SyntheticSensorOptions struct describes a simulated sensor
+///
+/// The noise is additive white Gaussian noise with the given standard deviation on each axis:
+///   noise_std_:           imu [m/s^2], pose, position, vision, gps, gps_w_vel [m], mag [field unit],
+///                         pressure [Pa], bodyvel [m/s]
+///   noise_std_secondary_: imu [rad/s], pose, vision [rad], gps_w_vel [m/s]
+///
+struct SyntheticSensorOptions
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SyntheticSensorType type_{ SyntheticSensorType::pose };
+  double rate_{ 20 };                                          ///< Nominal measurement rate [Hz]
+  double noise_std_{ 0 };                                      ///< Noise of the primary measurement component
+  double noise_std_secondary_{ 0 };                            ///< Noise of the secondary measurement component
+  double delay_{ 0 };                                          ///< Latency between sampling and arrival [s]
+  double delay_jitter_{ 0 };                                   ///< Std. dev. of an additional positive latency [s]
+  double timestamp_jitter_{ 0 };                               ///< Std. dev. of the sample time around the grid [s]
+  double dropout_{ 0 };                                        ///< Probability that a measurement is lost
+  Eigen::Vector3d p_ix_{ Eigen::Vector3d::Zero() };            ///< Sensor position in the IMU frame
+  Eigen::Quaterniond q_ix_{ Eigen::Quaterniond::Identity() };  ///< Sensor orientation in the IMU frame
+};
+
+///
+/// \brief The SyntheticTrajectoryOptions struct describes the simulated trajectory and the environment
+///
+/// The IMU moves on a circle with a vertical oscillation, the heading follows the tangent of the circle and roll and
+/// pitch oscillate with the tilt amplitude.
+///
+struct SyntheticTrajectoryOptions
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  double duration_{ 60 };                                       ///< [s]
+  double radius_{ 2 };                                          ///< [m]
+  double angular_rate_{ 0.3 };                                  ///< Angular rate on the circle [rad/s]
+  double height_{ 1 };                                          ///< Mean height [m]
+  double height_amplitude_{ 0.2 };                              ///< [m]
+  double tilt_amplitude_{ 0.1 };                                ///< Roll and pitch amplitude [rad]
+  double tilt_rate_{ 0.8 };                                     ///< Roll and pitch frequency [rad/s]
+  Eigen::Vector3d b_w_{ Eigen::Vector3d::Zero() };              ///< Constant gyroscope bias [rad/s]
+  Eigen::Vector3d b_a_{ Eigen::Vector3d::Zero() };              ///< Constant accelerometer bias [m/s^2]
+  Eigen::Vector3d mag_w_{ 0.2, 0, -0.45 };                      ///< Magnetic field in the world frame
+  GpsCoordinates gps_reference_{ 46.614798, 14.2628073, 450 };  ///< Coordinates of the world frame origin
+  double temperature_K_{ 293.15 };                              ///< Air temperature for pressure measurements
+  unsigned int seed_{ 0 };                                      ///< Seed of the noise generator
+};
+
+///
+/// \brief The SyntheticMeasurement struct is a single generated measurement in arrival order
+///
+struct SyntheticMeasurement
+{
+  Time arrival_{ 0.0 };                    ///< Sample time plus the simulated latency
+  Time timestamp_{ 0.0 };                  ///< Sample time
+  int sensor_idx_{ -1 };                   ///< Index of the sensor within the generator
+  std::shared_ptr<void> data_{ nullptr };  ///< Measurement payload
+};
+
+///
+/// \brief The SyntheticDataGenerator class simulates an IMU and additional sensors on an analytic trajectory
+///
+/// Measurements are generated when a sensor is added. The entries of each sensor are sorted by their sample time and
+/// have the same format as the output of the read_*_data loaders, they can be passed to a SweepDataset directly.
+/// The merged stream in arrival order includes the simulated latencies and can be fed to a CoreLogic.
+///
+class SyntheticDataGenerator
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SyntheticDataGenerator(const SyntheticTrajectoryOptions& options = SyntheticTrajectoryOptions());
+
+  ///
+  /// \brief AddSensor Generates the measurements of a sensor for the whole trajectory
+  /// \return Index of the sensor
+  ///
+  int AddSensor(const SyntheticSensorOptions& options);
+
+  ///
+  /// \brief get_ground_truth Evaluates the trajectory, the IMU measurement fields w_m_ and a_m_ are noise free
+  /// \param t Time [s]
+  ///
+  CoreStateType get_ground_truth(const double& t) const;
+
+  ///
+  /// \brief get_sensor_measurements
+  /// \return Measurements of a sensor sorted by their sample time
+  ///
+  const std::vector<BufferEntryType>& get_sensor_measurements(const int& sensor_idx) const;
+
+  ///
+  /// \brief get_arrival_stream
+  /// \return Measurements of all sensors sorted by their arrival time
+  ///
+  std::vector<SyntheticMeasurement> get_arrival_stream() const;
+
+  int get_num_sensors() const;
+
+  ///
+  /// \brief WriteCsv Writes the measurements of a sensor in the format of the corresponding read_*_data loader
+  ///
+  /// IMU measurements are written in the ReadSimData format including the ground truth.
+  ///
+  /// \return True if the file was written, false otherwise
+  ///
+  bool WriteCsv(const int& sensor_idx, const std::string& file_path) const;
+
+  ///
+  /// \brief WriteJournal Writes all measurements in arrival order to a binary JournalWriter file
+  /// \param file_path Path of the journal file
+  /// \param sensors Sensor instance for each sensor index of the generator
+  /// \return True if the file was written, false otherwise
+  ///
+  bool WriteJournal(const std::string& file_path, const std::vector<std::shared_ptr<SensorAbsClass>>& sensors) const;
+
+private:
+  std::shared_ptr<void> GenerateMeasurement(const SyntheticSensorOptions& sensor, const double& t);
+
+  Eigen::Vector3d Noise(const double& std);
+
+  SyntheticTrajectoryOptions options_;
+  GpsConversion gps_conversion_;
+  std::mt19937 generator_;
+  std::normal_distribution<double> normal_dist_{ 0, 1 };
+
+  std::vector<SyntheticSensorOptions, Eigen::aligned_allocator<SyntheticSensorOptions>> sensor_options_;
+  std::vector<std::vector<BufferEntryType>> measurements_;  ///< Per sensor, sorted by sample time
+  std::vector<std::vector<double>> arrival_times_;          ///< Per sensor, arrival time of each measurement
+};
+}  // namespace mars
+
+#endif  // SYNTHETIC_DATA_H
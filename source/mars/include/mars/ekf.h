@@ -70,16 +70,30 @@ public:
   ///
   void PrintReport(const std::string& name);
 
+  ///
+  /// \brief get_last_X2
+  /// \return X2 value of the latest calculation
+  ///
+  double get_last_X2() const;
+
+  ///
+  /// \brief get_num_calculations
+  /// \return Number of X2 calculations, allows to detect if a new X2 value is available
+  ///
+  int get_num_calculations() const;
+
   boost::math::chi_squared dist_;  /// Chi2 distribution, generated based on the DoF
   int dof_{ 3 };                   /// Degrees of freedom for the setup
   double chi_value_{ 0.05 };       /// Chi value for the confidence intervall (0.05 represents 95% test)
   double ucv_;                     /// Upper critival value
   bool do_test_{ false };          /// Determine if the test is performed or not
+  bool calc_always_{ false };      /// Calculate the X2 value even if the test is disabled, e.g. to score hypotheses
   bool passed_{ false };           /// Shows if the test passed or not (true=passed)
 
 private:
-  Eigen::MatrixXd last_res_;  /// Last residual, for the report
-  double last_X2_;            /// Last X2 value, for the report
+  Eigen::MatrixXd last_res_;   /// Last residual, for the report
+  double last_X2_{ 0 };        /// Last X2 value, for the report
+  int num_calculations_{ 0 };  /// Number of X2 calculations
 };
 
 class Ekf
@@ -0,0 +1,191 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+#include <mars/core_logic.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_data_type.h>
+#include <Eigen/Dense>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief FilterSensorContextMap holds the states of the shared sensor instances for a single hypothesis
+///
+/// The states are created by SensorAbsClass::SaveState and restored by SensorAbsClass::RestoreState.
+///
+using FilterSensorContextMap = std::map<SensorAbsClass*, std::shared_ptr<void>>;
+
+///
+/// \brief The FilterHypothesis struct holds a single member of the FilterBank
+///
+struct FilterHypothesis
+{
+  int id_{ -1 };                            ///< Unique id of the hypothesis, persistent over pruning and merging
+  int parent_id_{ -1 };                     ///< Id of the hypothesis this hypothesis was branched from, -1 for the root
+  CoreLogic core_logic_;                    ///< Filter instance of the hypothesis
+  double log_likelihood_{ 0 };              ///< Accumulated innovation log-likelihood, -0.5 * sum(X2)
+  int num_scored_updates_{ 0 };             ///< Number of updates that contributed to the log-likelihood
+  FilterSensorContextMap sensor_contexts_;  ///< State of the shared sensor instances for this hypothesis
+};
+
+///
+/// \brief The FilterBank class maintains multiple filter hypotheses that are fed with the same measurements
+///
+/// Hypotheses are created by branching an existing hypothesis with CoreLogic::Clone. Branches share their buffer
+/// entries copy-on-write and all hypotheses reference the same measurement payloads, a measurement that is passed to
+/// the bank is stored once independent of the number of hypotheses.
+///
+/// Propagation sensor measurements are processed in parallel by a pool of worker threads. All other measurements are
+/// processed sequentially, since the sensor instances are shared between the hypotheses. After each update, the X2
+/// value of the sensor Chi2 instance is accumulated to the log-likelihood of the hypothesis. The bank enables
+/// Chi2::calc_always_ of the sensors it scores.
+///
+/// \note The hypotheses share the sensor instances. Hypotheses can differ in their buffer history, their core state
+/// and the sensor states, not in the sensor configuration. The part of a sensor instance that changes while
+/// measurements are processed (e.g. initialization, X2 test, calibration refinement and GPS or pressure reference) is
+/// kept per hypothesis with SensorAbsClass::SaveState and swapped into the sensor instances with
+/// SensorAbsClass::RestoreState for each sequential measurement. A branch
+/// inherits the contexts of its source, hypotheses without a context of a sensor start from the state of the sensor
+/// instance at its first measurement in the bank.
+///
+class FilterBank
+{
+public:
+  ///
+  /// \brief FilterBank
+  /// \param core_logic Root hypothesis, the bank operates on a clone of the given instance
+  /// \param max_hypotheses Maximum number of hypotheses, enforced by Prune
+  /// \param num_threads Number of threads for the propagation, 0 uses the number of hardware threads
+  ///
+  FilterBank(const CoreLogic& core_logic, const int& max_hypotheses = 8, const int& num_threads = 0);
+  ~FilterBank();
+
+  FilterBank(const FilterBank&) = delete;
+  FilterBank& operator=(const FilterBank&) = delete;
+
+  ///
+  /// \brief Branch Adds a copy of a hypothesis to the bank
+  /// \param idx Index of the hypothesis that is branched
+  /// \return Index of the new hypothesis, -1 if the index is invalid
+  ///
+  int Branch(const int& idx);
+
+  ///
+  /// \brief ProcessMeasurement Processes a measurement with all hypotheses
+  /// \return Number of hypotheses that processed the measurement successfully
+  ///
+  int ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                         const BufferDataType& data);
+
+  ///
+  /// \brief ProcessMeasurement Processes a measurement with a single hypothesis
+  ///
+  /// This is used to let hypotheses diverge, e.g. to process a measurement with a branch and to reject it with the
+  /// source of the branch.
+  ///
+  /// \return True if the processing was successful, false otherwise
+  ///
+  bool ProcessMeasurement(const int& idx, const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                          const BufferDataType& data);
+
+  ///
+  /// \brief Prune Removes unlikely hypotheses
+  ///
+  /// Hypotheses with a log-likelihood below the best log-likelihood minus max_log_likelihood_diff are removed. The
+  /// least likely hypotheses are removed afterwards until the number of hypotheses is at most max_hypotheses.
+  ///
+  /// \return Number of removed hypotheses
+  ///
+  int Prune(const double& max_log_likelihood_diff);
+
+  ///
+  /// \brief Merge Merges hypotheses with similar latest core states
+  ///
+  /// Of two similar hypotheses, the more likely hypothesis is kept and the likelihoods are summed.
+  ///
+  /// \param max_position_diff Max. distance of p_wi [m]
+  /// \param max_attitude_diff Max. angle between q_wi [rad]
+  /// \return Number of removed hypotheses
+  ///
+  int Merge(const double& max_position_diff, const double& max_attitude_diff);
+
+  ///
+  /// \brief get_best_hypothesis
+  /// \return Index of the hypothesis with the highest log-likelihood
+  ///
+  int get_best_hypothesis() const;
+
+  ///
+  /// \brief get_weights
+  /// \return Normalized probability of each hypothesis based on the log-likelihood
+  ///
+  std::vector<double> get_weights() const;
+
+  int get_num_hypotheses() const;
+  int get_num_threads() const;
+  const FilterHypothesis& get_hypothesis(const int& idx) const;
+
+private:
+  ///
+  /// \brief RunParallel Calls the function for each hypothesis index, distributed over the worker threads
+  ///
+  void RunParallel(const std::function<void(const int&)>& function);
+
+  ///
+  /// \brief ScoreUpdate Adds the X2 value of a sensor update to the log-likelihood of the hypothesis
+  ///
+  void ScoreUpdate(FilterHypothesis* hypothesis, const std::shared_ptr<SensorAbsClass>& sensor,
+                   const int& num_calculations_before);
+
+  ///
+  /// \brief RemoveHypothesis Removes a hypothesis, the last remaining hypothesis is never removed
+  ///
+  void RemoveHypothesis(const int& idx);
+
+  ///
+  /// \brief ProcessJob Processes hypothesis indices of the current job until all indices are taken
+  /// \param lock Lock of mutex_, locked when called and on return
+  ///
+  void ProcessJob(std::unique_lock<std::mutex>* lock);
+
+  void WorkerLoop();
+
+  std::vector<FilterHypothesis> hypotheses_;
+  FilterSensorContextMap initial_sensor_contexts_;  ///< Sensor states at the first measurement of each sensor
+  int max_hypotheses_{ 8 };
+  int next_id_{ 0 };
+
+  // Worker pool for the parallel propagation
+  int num_threads_{ 1 };
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(const int&)>* job_{ nullptr };  ///< Current job, valid while a job is active
+  int job_generation_{ 0 };                                 ///< Incremented for each job
+  int job_size_{ 0 };                                       ///< Number of hypotheses of the current job
+  int job_next_idx_{ 0 };                                   ///< Next hypothesis index of the current job
+  int job_num_pending_{ 0 };                                ///< Number of unfinished hypotheses of the current job
+  bool shutdown_{ false };
+};
+}  // namespace mars
+
+#endif  // FILTER_BANK_H
@@ -0,0 +1,95 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef FIXED_LAG_SMOOTHER_H
+#define FIXED_LAG_SMOOTHER_H
+
+#include <mars/smoother_interface.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The FixedLagSmoother class provides Rauch-Tung-Striebel smoothed core states that lag behind the filter
+///
+/// The CoreLogic passes each step of the filter to AddStep: every propagated core state and the prior and posterior
+/// core state of every sensor update. A step only references the core data of the buffer entries. The state
+/// transitions and the predicted covariances of the propagation are reused, the smoother recomputes neither.
+///
+/// Process runs the smoother on the steps that were added since its last call. It computes the RTS gain of each new
+/// step and smooths all steps that are at least lag_ seconds older than the latest step with one backward pass over the
+/// lag window. All operations are fixed-size core state kernels and the window is bounded by the lag, the cost per
+/// step is therefore bounded. AddStep and Process are synchronized such that Process can run on a second thread.
+///
+/// \note Only the core state is smoothed, the cross-covariance with the sensor states is not considered.
+///
+/// \note Out of order measurements and a new initialization change the past states of the filter. The CoreLogic
+/// resets the smoother in these cases and the steps within the lag window are not output.
+///
+class FixedLagSmoother : public SmootherInterface
+{
+public:
+  double lag_{ 0.5 };  ///< Lag [s] of the smoothed output behind the latest filter step
+
+  ///
+  /// \brief AddStep Adds a step of the filter, called by the CoreLogic
+  /// \param prior_entry Entry with the predicted core state of this step, the state transition of its core data leads
+  /// from the previous step to this step
+  /// \param posterior_entry Entry with the filtered core state of this step, identical to the prior entry for a
+  /// propagation step
+  ///
+  void AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry);
+
+  ///
+  /// \brief Reset Discards all steps, the next step starts a new window
+  ///
+  void Reset();
+
+  ///
+  /// \brief Process Smooths the steps that reached the lag
+  /// \param smoothed_entries Output parameter for the smoothed core states in time order, the core data of the entries
+  /// holds the smoothed state and covariance
+  /// \return Number of smoothed entries
+  ///
+  int Process(std::vector<BufferEntryType>* smoothed_entries);
+
+  ///
+  /// \brief get_window_size
+  /// \return Number of steps that were not output yet, only valid on the thread that calls Process
+  ///
+  int get_window_size() const;
+
+private:
+  struct Step
+  {
+    Time timestamp_;
+    std::shared_ptr<SensorAbsClass> sensor_{ nullptr };
+    std::shared_ptr<void> prior_{ nullptr };      ///< CoreType of the prediction from the previous step
+    std::shared_ptr<void> posterior_{ nullptr };  ///< CoreType of the filtered state
+    bool identity_transition_{ false };           ///< The prior is the posterior of the previous step
+    CoreStateMatrix gain_;                        ///< RTS gain from the next step, set once the next step was added
+  };
+
+  mutable std::mutex mutex_;
+  std::deque<Step> pending_;                         ///< Steps added since the last Process call
+  bool reset_pending_{ false };                      ///< Reset the window before the pending steps are processed
+  std::shared_ptr<void> last_posterior_{ nullptr };  ///< Posterior of the latest added step
+
+  std::deque<Step> window_;  ///< Steps that were not output yet, only accessed by Process
+};
+}  // namespace mars
+
+#endif  // FIXED_LAG_SMOOTHER_H
@@ -0,0 +1,254 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef IPC_INGEST_H
+#define IPC_INGEST_H
+
+#include <mars/core_logic.h>
+#include <mars/journal.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <Eigen/Dense>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Local ingestion of measurements over Unix domain stream sockets. The wire format is the record format of the
+// JournalWriter without the file header (see mars/journal.h): each connection registers its sensors with sensor
+// records and then sends measurement and initialize records. Sensor ids are local to a connection, the server maps
+// them to its sensors by name. The payload type of a sensor record has to match the payload type the sensor was added
+// with, otherwise the connection is closed.
+
+namespace mars
+{
+///
+/// \brief The IngestEncoder class encodes records for the IngestServer
+///
+class IngestEncoder
+{
+public:
+  ///
+  /// \brief AddSensor Encodes a sensor record
+  /// \param name Name of the sensor of the server
+  /// \param payload_type Type of the measurements of the sensor
+  /// \return Id of the sensor for AddMeasurement
+  ///
+  int AddSensor(const std::string& name, const JournalPayloadType& payload_type);
+
+  ///
+  /// \brief AddMeasurement Encodes a measurement record
+  /// \return False if the sensor is not registered or the payload type is not supported, true otherwise
+  ///
+  bool AddMeasurement(const int& sensor_id, const Time& timestamp, const std::shared_ptr<void>& payload);
+
+  ///
+  /// \brief AddInitialize Encodes a CoreLogic::Initialize call
+  ///
+  void AddInitialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init);
+
+  ///
+  /// \brief get_data
+  /// \return Encoded records since the last Clear
+  ///
+  const std::vector<char>& get_data() const;
+
+  ///
+  /// \brief Clear Removes the encoded records, the sensor ids stay valid
+  ///
+  void Clear();
+
+private:
+  template <typename T>
+  void Write(const T& value)
+  {
+    Write(&value, sizeof(T));
+  }
+  void Write(const void* data, const size_t& size);
+
+  std::vector<char> data_;
+  std::vector<JournalPayloadType> payload_types_;  ///< Payload type of each sensor id
+  std::vector<double> values_;                     ///< Reused encoding buffer
+};
+
+///
+/// \brief The IngestDecodeResult enum is the result of IngestDecoder::Decode
+///
+enum class IngestDecodeResult
+{
+  record,      ///< A record was decoded
+  incomplete,  ///< The data ends within the next record
+  error        ///< The data is not a valid record, the stream can not be continued
+};
+
+///
+/// \brief The IngestDecoder class decodes the records of a single stream
+///
+class IngestDecoder
+{
+public:
+  static constexpr uint32_t kMaxNameSize = 256;    ///< Max. length of a sensor name
+  static constexpr uint32_t kMaxNumValues = 1024;  ///< Max. number of payload values of a measurement
+  static constexpr uint32_t kMaxNumSensors = 256;  ///< Max. number of sensor ids of a stream
+
+  ///
+  /// \brief Decode Decodes the record at the offset
+  /// \param data Received data
+  /// \param size Size of the data
+  /// \param offset Position of the record, advanced to the next record if a record was decoded
+  /// \param record Output parameter
+  ///
+  IngestDecodeResult Decode(const char* data, const size_t& size, size_t* offset, JournalRecord* record);
+
+  ///
+  /// \brief get_max_record_size
+  /// \return Max. size of a valid record in bytes
+  ///
+  static size_t get_max_record_size();
+
+private:
+  std::unordered_map<int, JournalPayloadType> payload_types_;
+  std::vector<double> values_;  ///< Reused decoding buffer
+};
+
+///
+/// \brief The IngestServer class feeds the measurements of local driver processes to a CoreLogic
+///
+/// The server listens on a Unix domain socket and multiplexes all connections with poll in the calling thread. Each
+/// readable connection is drained with a single read of up to read_size bytes per Poll call, all complete records of
+/// the read are processed in order before the next connection is served. Results are published by the state publisher
+/// of the CoreLogic (CoreLogic::state_publisher_). The server and the CoreLogic must only be used by the polling
+/// thread.
+///
+class IngestServer
+{
+public:
+  ///
+  /// \brief IngestServer Creates the listening socket, an existing socket file is replaced
+  /// \param core_logic Filter that processes the measurements
+  /// \param socket_path Path of the Unix domain socket
+  /// \param read_size Max. number of bytes per read of a connection
+  ///
+  IngestServer(std::shared_ptr<CoreLogic> core_logic, std::string socket_path, const size_t& read_size = 1 << 16);
+  IngestServer(const IngestServer&) = delete;
+  IngestServer& operator=(const IngestServer&) = delete;
+
+  ///
+  /// \brief ~IngestServer Closes all connections and removes the socket file
+  ///
+  ~IngestServer();
+
+  bool is_open() const;
+
+  ///
+  /// \brief AddSensor Adds a sensor that can be addressed by its name
+  /// \param sensor Sensor that processes the measurements
+  /// \param payload_type Measurement type of the sensor class, connections that register the sensor with another
+  /// payload type are closed
+  ///
+  void AddSensor(const std::shared_ptr<SensorAbsClass>& sensor, const JournalPayloadType& payload_type);
+
+  ///
+  /// \brief Poll Accepts new connections and processes the received records
+  /// \param timeout_ms Max. time to wait for events, -1 waits until an event occurs
+  /// \return Number of processed measurements, -1 if poll failed
+  ///
+  int Poll(const int& timeout_ms);
+
+  ///
+  /// \brief get_num_clients
+  /// \return Number of open connections
+  ///
+  int get_num_clients() const;
+
+  uint64_t num_connections_{ 0 };      ///< Number of accepted connections
+  uint64_t num_measurements_{ 0 };     ///< Number of measurements passed to the CoreLogic
+  uint64_t num_initializations_{ 0 };  ///< Number of initialize records passed to the CoreLogic
+  uint64_t num_dropped_{ 0 };          ///< Measurements of unknown sensors or with unsupported payloads
+  uint64_t num_stream_errors_{ 0 };    ///< Connections that were closed due to invalid records or payload types
+  uint64_t num_bytes_{ 0 };            ///< Number of received bytes
+
+private:
+  struct SensorEntry
+  {
+    std::shared_ptr<SensorAbsClass> sensor_;
+    JournalPayloadType payload_type_;
+  };
+
+  struct Client
+  {
+    int fd_{ -1 };
+    std::vector<char> buffer_;  ///< Received data, the begin of the buffer is the begin of the next record
+    size_t size_{ 0 };          ///< Number of received bytes in the buffer
+    IngestDecoder decoder_;
+    std::vector<std::shared_ptr<SensorAbsClass>> sensors_;  ///< Sensor of each id of the connection
+  };
+
+  ///
+  /// \brief ReadClient Reads and processes the data of a connection
+  /// \return False if the connection was closed, true otherwise
+  ///
+  bool ReadClient(Client* client, int* num_processed);
+
+  ///
+  /// \brief ProcessRecord Processes a decoded record of a connection
+  /// \return False if the record can not be processed and the stream can not be continued, true otherwise
+  ///
+  bool ProcessRecord(Client* client, const JournalRecord& record, int* num_processed);
+  void CloseClient(Client* client);
+
+  std::shared_ptr<CoreLogic> core_logic_;
+  std::string socket_path_;
+  size_t read_size_;
+  int listen_fd_{ -1 };
+  std::map<std::string, SensorEntry> sensors_by_name_;
+  std::vector<std::unique_ptr<Client>> clients_;
+};
+
+///
+/// \brief The IngestClient class sends encoded records to an IngestServer
+///
+class IngestClient
+{
+public:
+  IngestClient() = default;
+  IngestClient(const IngestClient&) = delete;
+  IngestClient& operator=(const IngestClient&) = delete;
+  ~IngestClient();
+
+  ///
+  /// \brief Connect Connects to the server socket
+  /// \return True if the connection was established, false otherwise
+  ///
+  bool Connect(const std::string& socket_path);
+
+  ///
+  /// \brief Send Sends the data, blocks until all data was written to the socket
+  /// \return False if the connection is not open or was closed by the server, true otherwise
+  ///
+  bool Send(const char* data, const size_t& size);
+
+  ///
+  /// \brief Send Sends the records of the encoder
+  ///
+  bool Send(const IngestEncoder& encoder);
+
+  void Close();
+
+  bool is_connected() const;
+
+private:
+  int fd_{ -1 };
+};
+}  // namespace mars
+
+#endif  // IPC_INGEST_H
@@ -0,0 +1,227 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_data_type.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <Eigen/Dense>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The JournalRecordType enum defines the record types of the journal
+///
+enum class JournalRecordType : uint8_t
+{
+  sensor = 0,       ///< Registration of a sensor, maps the sensor id to the name and the payload type
+  measurement = 1,  ///< CoreLogic::ProcessMeasurement call
+  initialize = 2,   ///< CoreLogic::Initialize call
+  measurements = 3  ///< CoreLogic::ProcessMeasurements call, followed by the measurement records of the call
+};
+
+///
+/// \brief The JournalPayloadType enum defines the measurement types that can be encoded in the journal
+///
+enum class JournalPayloadType : int32_t
+{
+  unknown = -1,   ///< The payload is not recorded
+  imu = 0,        ///< IMUMeasurementType
+  pose = 1,       ///< PoseMeasurementType
+  position = 2,   ///< PositionMeasurementType
+  vision = 3,     ///< VisionMeasurementType
+  gps = 4,        ///< GpsMeasurementType
+  gps_w_vel = 5,  ///< GpsVelMeasurementType
+  mag = 6,        ///< MagMeasurementType
+  pressure = 7,   ///< PressureMeasurementType
+  bodyvel = 8,    ///< BodyvelMeasurementType
+  attitude = 9    ///< AttitudeMeasurementType
+};
+
+///
+/// \brief The JournalRecord struct holds a single decoded journal record
+///
+struct JournalRecord
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  JournalRecordType type_{ JournalRecordType::measurement };
+  int sensor_id_{ -1 };                                             ///< Sensor and measurement records
+  std::string sensor_name_;                                         ///< Sensor records
+  JournalPayloadType payload_type_{ JournalPayloadType::unknown };  ///< Sensor and measurement records
+  Time timestamp_;                                                  ///< Measurement records
+  std::shared_ptr<void> payload_{ nullptr };                        ///< Measurement records, decoded measurement
+  Eigen::Vector3d p_wi_{ Eigen::Vector3d::Zero() };                 ///< Initialize records
+  Eigen::Quaterniond q_wi_{ Eigen::Quaterniond::Identity() };       ///< Initialize records
+  int num_measurements_{ 0 };                                       ///< Measurements records
+  bool stacked_update_{ false };                                    ///< Measurements records, CoreLogic setting
+  double stacked_update_epsilon_{ 0 };                              ///< Measurements records, CoreLogic setting
+};
+
+///
+/// \brief The JournalWriter class records the input of a CoreLogic instance to a binary append-only log
+///
+/// Records are collected in an internal buffer and written to the file once the buffer is full. The payloads are
+/// stored as raw doubles, such that a replay of the journal reproduces the filter run bit-for-bit.
+///
+/// File layout: magic "MARSJNL" followed by the version (uint32), then a sequence of records. Each record starts with
+/// the JournalRecordType (uint8):
+///   sensor:      int32 sensor id, int32 payload type, uint32 name length, name
+///   measurement: int32 sensor id, double timestamp, uint32 number of values, double values
+///   initialize:  double p_wi [x y z], double q_wi [w x y z]
+///   measurements: uint32 number of measurements, uint8 stacked update, double stacked update epsilon, followed by the
+///                 measurement records of the call
+///
+/// Version 1 journals have no measurements records and are read unchanged.
+///
+class JournalWriter
+{
+public:
+  static constexpr uint32_t kVersion = 2;
+
+  ///
+  /// \brief JournalWriter Opens the journal file, an existing file is overwritten
+  /// \param file_path Path of the journal file
+  /// \param buffer_size Size of the write buffer in bytes
+  ///
+  JournalWriter(const std::string& file_path, const size_t& buffer_size = 1 << 16);
+  ~JournalWriter();
+
+  JournalWriter(const JournalWriter&) = delete;
+  JournalWriter& operator=(const JournalWriter&) = delete;
+
+  bool IsOpen() const;
+
+  ///
+  /// \brief RegisterSensor Registers a sensor and the type of its measurements
+  ///
+  /// Sensors that are not registered are registered automatically with the first measurement, their payloads are not
+  /// recorded.
+  ///
+  /// \return Id of the sensor in the journal
+  ///
+  int RegisterSensor(const std::shared_ptr<SensorAbsClass>& sensor, const JournalPayloadType& payload_type);
+
+  ///
+  /// \brief RecordMeasurement Records a CoreLogic::ProcessMeasurement call
+  ///
+  void RecordMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                         const BufferDataType& data);
+
+  ///
+  /// \brief RecordMeasurements Records a CoreLogic::ProcessMeasurements call
+  ///
+  /// The measurements are recorded as measurement records after the measurements record, such that the call is
+  /// replayed as a whole with the same stacked update setting.
+  ///
+  void RecordMeasurements(const std::vector<BufferEntryType>& measurements, const bool& stacked_update,
+                          const double& stacked_update_epsilon);
+
+  ///
+  /// \brief RecordInitialize Records a CoreLogic::Initialize call
+  ///
+  void RecordInitialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init);
+
+  ///
+  /// \brief Flush Writes the buffered records to the file
+  ///
+  void Flush();
+
+  ///
+  /// \brief EncodePayload Converts a measurement to a sequence of doubles
+  /// \return True if the payload type is supported, false otherwise
+  ///
+  static bool EncodePayload(const JournalPayloadType& payload_type, const std::shared_ptr<void>& payload,
+                            std::vector<double>* values);
+
+private:
+  struct SensorEntry
+  {
+    int id_;
+    JournalPayloadType payload_type_;
+  };
+
+  template <typename T>
+  void Write(const T& value)
+  {
+    Write(&value, sizeof(T));
+  }
+  void Write(const void* data, const size_t& size);
+
+  std::ofstream file_;
+  std::vector<char> buffer_;
+  size_t buffer_size_;
+  std::unordered_map<const SensorAbsClass*, SensorEntry> sensors_;
+  std::vector<double> values_;  ///< Reused encoding buffer
+};
+
+///
+/// \brief The JournalReader class reads the records of a journal that was written by the JournalWriter
+///
+class JournalReader
+{
+public:
+  ///
+  /// \brief JournalReader Opens the journal file and verifies the header
+  ///
+  JournalReader(const std::string& file_path);
+
+  bool IsOpen() const;
+
+  ///
+  /// \brief ReadNext Reads and decodes the next record
+  /// \return True if a record was read, false at the end of the file or if the file is corrupted
+  ///
+  bool ReadNext(JournalRecord* record);
+
+  ///
+  /// \brief IsCorrupted
+  /// \return True if the last ReadNext call failed within a record, i.e. the journal is truncated or corrupted
+  ///
+  bool IsCorrupted() const;
+
+  ///
+  /// \brief DecodePayload Converts a sequence of doubles to a measurement
+  /// \return Measurement, nullptr if the payload type is not supported or the values are invalid
+  ///
+  static std::shared_ptr<void> DecodePayload(const JournalPayloadType& payload_type,
+                                             const std::vector<double>& values);
+
+private:
+  template <typename T>
+  bool Read(T* value)
+  {
+    return Read(value, sizeof(T));
+  }
+  bool Read(void* data, const size_t& size);
+
+  ///
+  /// \brief ReadRecord Reads the remainder of a record whose type was read already
+  ///
+  bool ReadRecord(JournalRecord* record);
+
+  std::ifstream file_;
+  bool is_open_{ false };
+  bool is_corrupted_{ false };
+  std::unordered_map<int, JournalPayloadType> payload_types_;
+  std::vector<double> values_;  ///< Reused decoding buffer
+};
+}  // namespace mars
+
+#endif  // JOURNAL_H
@@ -0,0 +1,201 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef PIPELINED_CORE_LOGIC_H
+#define PIPELINED_CORE_LOGIC_H
+
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_data_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <Eigen/Dense>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace mars
+{
+///
+/// \brief The PipelinedCoreLogic class decouples the IMU-rate state output from the sensor updates of a CoreLogic
+///
+/// All measurements are queued to a worker thread that runs the CoreLogic, including the covariance propagation, the
+/// sensor updates and the rework of out of order measurements. The thread that calls ProcessMeasurement propagates
+/// the mean of the core state with each propagation sensor measurement and publishes it, independent of the progress
+/// of the worker.
+///
+/// Merge: after each batch of queued measurements the worker publishes the latest state of the CoreLogic buffer as
+/// anchor. The next propagation sensor measurement starts a merge of the anchor, which is propagated by at most
+/// max_merge_steps_ of the propagation sensor measurements after the anchor per call. Meanwhile the output state is
+/// propagated as before. Once the merge reached the latest measurement, it replaces the output state. A newer anchor
+/// replaces a running merge if it is not older than the progress of the merge. The cost of a call is therefore
+/// bounded, independent of how far the worker lags behind. Once the worker is idle the output state is the latest
+/// state of the CoreLogic.
+///
+/// If more than max_history_size_ propagation measurements are pending, the oldest measurements are dropped. Anchors
+/// before a dropped measurement are discarded with a warning, the output state continues with its own propagation
+/// until an anchor after the dropped measurements is published.
+///
+/// \note The CoreLogic must not be used while measurements are pending, see WaitUntilIdle. The settings of the
+/// CoreState must not change, both threads use CoreState::PropagateState.
+///
+class PipelinedCoreLogic
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ///
+  /// \brief StateCallback Receives each output state in the thread that calls ProcessMeasurement
+  ///
+  using StateCallback = std::function<void(const Time& timestamp, const CoreStateType& state)>;
+
+  ///
+  /// \brief PipelinedCoreLogic Starts the worker thread
+  /// \param core_logic Filter that is run by the worker thread
+  /// \param state_callback Optional receiver of the output states
+  ///
+  PipelinedCoreLogic(std::shared_ptr<CoreLogic> core_logic, StateCallback state_callback = nullptr);
+  PipelinedCoreLogic(const PipelinedCoreLogic&) = delete;
+  PipelinedCoreLogic& operator=(const PipelinedCoreLogic&) = delete;
+
+  ///
+  /// \brief ~PipelinedCoreLogic Processes the pending measurements and stops the worker thread
+  ///
+  ~PipelinedCoreLogic();
+
+  ///
+  /// \brief ProcessMeasurement Queues the measurement, measurements of the propagation sensor are propagated directly
+  /// \return True if a new output state was published, false otherwise
+  ///
+  bool ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                          const BufferDataType& data);
+
+  ///
+  /// \brief Initialize Queues a CoreLogic::Initialize call
+  ///
+  void Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init);
+
+  ///
+  /// \brief WaitUntilIdle Blocks until all queued measurements were processed by the CoreLogic
+  ///
+  void WaitUntilIdle();
+
+  ///
+  /// \brief get_latest_state Thread-safe access to the latest output state
+  /// \return False if no state was published yet, true otherwise
+  ///
+  bool get_latest_state(Time* timestamp, CoreStateType* state) const;
+
+  ///
+  /// \brief get_num_merges
+  /// \return Number of anchors that were merged into the output state
+  ///
+  int get_num_merges() const;
+
+  ///
+  /// \brief get_num_discarded_anchors
+  /// \return Number of anchors that were discarded because propagation measurements after them were dropped
+  ///
+  int get_num_discarded_anchors() const;
+
+  ///
+  /// \brief get_max_queue_size
+  /// \return Max. number of measurements that were pending for the worker
+  ///
+  int get_max_queue_size() const;
+
+  size_t max_history_size_{ 10000 };  ///< Max. number of propagation measurements kept for the merge
+  int max_merge_steps_{ 4 };          ///< Max. number of propagations of the merged anchor per call, at least 2
+
+private:
+  ///
+  /// \brief The Task struct is a queued CoreLogic call
+  ///
+  struct Task
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    bool initialize_{ false };  ///< CoreLogic::Initialize if true, CoreLogic::ProcessMeasurement otherwise
+    std::shared_ptr<SensorAbsClass> sensor_{ nullptr };
+    Time timestamp_;
+    BufferDataType data_;
+    Eigen::Vector3d p_wi_{ Eigen::Vector3d::Zero() };
+    Eigen::Quaterniond q_wi_{ Eigen::Quaterniond::Identity() };
+  };
+
+  struct PropagationSample
+  {
+    Time timestamp_;
+    std::shared_ptr<void> measurement_;  ///< IMUMeasurementType
+  };
+
+  void PushTask(const Task& task);
+  void WorkerLoop();
+
+  ///
+  /// \brief StartMerge Starts the merge of an anchor, unless measurements after the anchor were dropped
+  ///
+  void StartMerge(const Time& anchor_time, const CoreStateType& anchor_state);
+
+  ///
+  /// \brief ContinueMerge Propagates the merged anchor by at most max_merge_steps_ measurements
+  /// \return True if the merge reached the latest measurement and replaced the output state, false otherwise
+  ///
+  bool ContinueMerge();
+  void Publish();
+
+  std::shared_ptr<CoreLogic> core_logic_;
+  std::shared_ptr<CoreState> core_states_;
+  StateCallback state_callback_;
+
+  // Worker thread
+  std::thread worker_;
+  mutable std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<Task, Eigen::aligned_allocator<Task>> queue_;
+  bool busy_{ false };      ///< The worker processes a batch
+  bool shutdown_{ false };
+  int max_queue_size_{ 0 };
+  Time anchor_time_;
+  CoreStateType anchor_state_;
+  uint64_t anchor_version_{ 0 };  ///< Incremented for each anchor, 0 if no anchor was published
+
+  // Propagation thread
+  std::deque<PropagationSample> history_;  ///< Propagation measurements after the latest merged anchor
+  bool has_dropped_{ false };              ///< Measurements were dropped from the history
+  Time dropped_time_;                      ///< Latest measurement that was dropped from the history
+  uint64_t merged_version_{ 0 };           ///< Version of the latest merged anchor
+  bool merging_{ false };                  ///< An anchor is propagated to the latest measurement
+  size_t merge_idx_{ 0 };                  ///< Index of the next history measurement of the merge
+  Time merge_time_;
+  CoreStateType merge_state_;
+  Eigen::Matrix3d merge_R_wi_;             ///< Rotation matrix of the orientation of merge_state_
+  bool has_state_{ false };
+  Time state_time_;
+  CoreStateType state_;
+  Eigen::Matrix3d R_wi_;                   ///< Rotation matrix of the orientation of state_
+  int num_merges_{ 0 };
+  int num_discarded_anchors_{ 0 };
+
+  // Output
+  mutable std::mutex output_mutex_;
+  bool has_output_{ false };
+  Time output_time_;
+  CoreStateType output_state_;
+};
+}  // namespace mars
+
+#endif  // PIPELINED_CORE_LOGIC_H
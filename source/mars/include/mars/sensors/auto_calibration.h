@@ -0,0 +1,111 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef AUTO_CALIBRATION_H
+#define AUTO_CALIBRATION_H
+
+#include <mars/time.h>
+#include <Eigen/Dense>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The AutoCalibration class refines closed-form sensor calibrations over the first measurements
+///
+/// Sensors without a given calibration derive it in closed form from a measurement and the current core state. With a
+/// refinement duration, the sensor stays uninitialized for this duration and each measurement adds one closed-form
+/// estimate to a running mean. Every estimate is O(1), the refinement therefore never blocks the propagation path.
+/// Rotations are averaged by their sign-aligned quaternion coefficients which is accurate for small spreads.
+///
+class AutoCalibration
+{
+public:
+  double refine_duration_{ 0 };  ///< Duration [s] over which estimates are averaged, the first estimate is used if zero
+
+  ///
+  /// \brief Refine Adds a closed-form estimate and replaces it with the mean of all estimates in the window
+  ///
+  /// The window restarts after it was completed, such that a sensor that is initialized again is refined again.
+  ///
+  /// \param timestamp Time of the measurement the estimate was derived from
+  /// \param vectors Vector states of the estimate, replaced by their mean
+  /// \param rotations Rotation states of the estimate, replaced by their mean
+  /// \return True if the refinement window is complete and the sensor can be initialized
+  ///
+  bool Refine(const Time& timestamp, Eigen::VectorXd* vectors, std::vector<Eigen::Quaterniond>* rotations)
+  {
+    if (count_ == 0)
+    {
+      start_time_ = timestamp;
+      vector_sum_ = Eigen::VectorXd::Zero(vectors->size());
+      rotation_sum_.assign(rotations->size(), Eigen::Vector4d::Zero());
+      rotation_ref_ = *rotations;
+    }
+
+    count_++;
+    *vectors = (vector_sum_ += *vectors) / count_;
+
+    for (size_t k = 0; k < rotations->size(); k++)
+    {
+      // q and -q are the same rotation, all estimates are accumulated on the hemisphere of the first one
+      const Eigen::Vector4d coeffs = (*rotations)[k].coeffs();
+      rotation_sum_[k] += coeffs.dot(rotation_ref_[k].coeffs()) < 0 ? Eigen::Vector4d(-coeffs) : coeffs;
+      (*rotations)[k] = Eigen::Quaterniond(rotation_sum_[k].normalized());
+    }
+
+    if ((timestamp - start_time_).get_seconds() < refine_duration_)
+    {
+      return false;
+    }
+
+    count_ = 0;
+    return true;
+  }
+
+  ///
+  /// \brief get_count Number of estimates in the current refinement window
+  ///
+  int get_count() const
+  {
+    return count_;
+  }
+
+  ///
+  /// \brief PropagateCovariance First order covariance of a closed-form calibration x = f(core, n)
+  ///
+  /// The noise n holds the measurement and the assumed values of states that a single measurement does not determine.
+  ///
+  /// \param core_cov Covariance of the core state
+  /// \param J_core Jacobian of the calibration with respect to the core error state
+  /// \param noise_cov Covariance of the noise
+  /// \param J_noise Jacobian of the calibration with respect to the noise
+  /// \param sensor_cov Output, covariance of the calibration
+  /// \param cross_cov Output, cross-covariance of the core and the calibration
+  ///
+  static void PropagateCovariance(const Eigen::MatrixXd& core_cov, const Eigen::MatrixXd& J_core,
+                                  const Eigen::MatrixXd& noise_cov, const Eigen::MatrixXd& J_noise,
+                                  Eigen::MatrixXd* sensor_cov, Eigen::MatrixXd* cross_cov)
+  {
+    *cross_cov = core_cov * J_core.transpose();
+    const Eigen::MatrixXd cov = J_core * *cross_cov + J_noise * noise_cov * J_noise.transpose();
+    *sensor_cov = 0.5 * (cov + cov.transpose());
+  }
+
+private:
+  int count_{ 0 };                                ///< Number of estimates in the current window
+  Time start_time_;                               ///< Time of the first estimate in the current window
+  Eigen::VectorXd vector_sum_;                    ///< Sum of the vector states
+  std::vector<Eigen::Vector4d> rotation_sum_;     ///< Sum of the sign-aligned quaternion coefficients
+  std::vector<Eigen::Quaterniond> rotation_ref_;  ///< First rotation estimates, define the hemisphere of the sums
+};
+}  // namespace mars
+
+#endif  // AUTO_CALIBRATION_H
@@ -10,11 +10,93 @@
 
 #include "gps_conversion.h"
 #include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
 #include <iomanip>  // std::setprecision
 
 namespace mars
 {
+namespace
+{
+// WGS84 ellipsoid constants
+constexpr double kSemiMajorAxis = 6378137.0;
+constexpr double kEccentricitySq = 8.1819190842622e-2 * 8.1819190842622e-2;
+
+// Batches are converted in blocks that stay in the cache, the tail block is padded with the reference
+constexpr int kBlockSize = 64;
+using BlockArray = Eigen::Array<double, kBlockSize, 1>;
+
+///
+/// \brief Round Rounds to the nearest integer for |x| < 2^51 without SSE4.1 rounding instructions
+///
+BlockArray Round(const BlockArray& x)
+{
+  constexpr double shift = 6755399441055744.0;  // 1.5 * 2^52
+  const BlockArray shifted = x + shift;
+  return shifted - shift;
+}
+
+///
+/// \brief SinCos Vectorized sine and cosine of angles in [-2 pi, 2 pi]
+///
+/// The angles are reduced to [-pi/4, pi/4] by multiples k of pi/2 with a three part Cody-Waite reduction and evaluated
+/// with the minimax polynomials of the Cephes library. The error is within a few ulp of std::sin and std::cos.
+///
+void SinCos(const BlockArray& x, BlockArray* s, BlockArray* c)
+{
+  constexpr double dp1 = 2 * 7.85398125648498535156e-1;
+  constexpr double dp2 = 2 * 3.77489470793079817668e-8;
+  constexpr double dp3 = 2 * 2.69515142907905952645e-15;
+
+  const BlockArray k = Round(x * M_2_PI);
+  const BlockArray r = ((x - k * dp1) - k * dp2) - k * dp3;
+  const BlockArray r2 = r * r;
+
+  const BlockArray sin_r =
+      r + r * r2 *
+              (((((1.58962301576546568060e-10 * r2 - 2.50507477628578072866e-8) * r2 + 2.75573136213857245213e-6) * r2 -
+                 1.98412698295895385996e-4) *
+                    r2 +
+                8.33333333332211858878e-3) *
+                   r2 -
+               1.66666666666666307295e-1);
+  const BlockArray cos_r =
+      1 - 0.5 * r2 +
+      r2 * r2 *
+          (((((-1.13585365213876817300e-11 * r2 + 2.08757008419747316778e-9) * r2 - 2.75573141792967388112e-7) * r2 +
+             2.48015872888517045348e-5) *
+                r2 -
+            1.38888888888730564116e-3) *
+               r2 +
+           4.16666666666665929218e-2);
+
+  // Quadrant q = k mod 4 from its bits, sin(r + q pi/2) = [sin r, cos r, -sin r, -cos r]
+  const BlockArray quadrant = k - 4 * Round((k - 1.5) / 4);
+  const BlockArray half = Round((quadrant - 0.75) / 2);
+  const BlockArray odd = quadrant - 2 * half;
+  const BlockArray sign_s = 1 - 2 * half;
+  const BlockArray sign_c = 1 - 2 * (odd + half - 2 * odd * half);
+
+  *s = sign_s * ((1 - odd) * sin_r + odd * cos_r);
+  *c = sign_c * ((1 - odd) * cos_r + odd * sin_r);
+}
+
+///
+/// \brief SinCosOffset Sine and cosine of ref + dx for small offsets dx
+///
+/// The Taylor series of the offset are truncated after the terms that are below the double precision for |dx| <= 0.01.
+///
+void SinCosOffset(const double& s_ref, const double& c_ref, const BlockArray& dx, BlockArray* s, BlockArray* c)
+{
+  const BlockArray dx2 = dx * dx;
+  const BlockArray sin_dx = dx * (1 - dx2 / 6 * (1 - dx2 / 20 * (1 - dx2 / 42)));
+  const BlockArray cos_dx_m1 = -dx2 / 2 * (1 - dx2 / 12 * (1 - dx2 / 30 * (1 - dx2 / 56)));
+
+  *s = s_ref + (s_ref * cos_dx_m1 + c_ref * sin_dx);
+  *c = c_ref + (c_ref * cos_dx_m1 - s_ref * sin_dx);
+}
+}  // namespace
+
 std::ostream& operator<<(std::ostream& out, const GpsCoordinates& coordinates)
 {
   out << std::setprecision(4);
@@ -30,6 +112,11 @@ Eigen::Matrix<double, 3, 1> mars::GpsConversion::get_enu(mars::GpsCoordinates co
   return WGS84ToENU(coordinates);
 }
 
+GpsCoordinates mars::GpsConversion::get_wgs84(const Eigen::Matrix<double, 3, 1>& enu)
+{
+  return ECEFToWGS84(ENUToECEF(enu));
+}
+
 GpsConversion::GpsConversion(mars::GpsCoordinates coordinates)
 {
   ecef_ref_orientation_.setIdentity();
@@ -73,6 +160,58 @@ void GpsConversion::set_gps_reference(mars::GpsCoordinates coordinates)
 
   ecef_ref_orientation_ = R;
   ecef_ref_point_ = WGS84ToECEF(coordinates);
+  ref_sin_cos_ << s_lat, c_lat, s_long, c_long;
+}
+
+void GpsConversion::get_enu_batch(const Eigen::ArrayXd& latitude, const Eigen::ArrayXd& longitude,
+                                  const Eigen::ArrayXd& altitude, Eigen::Matrix3Xd* enu)
+{
+  const Eigen::Index num = latitude.size();
+  enu->resize(3, num);
+  if (num == 0)
+  {
+    return;
+  }
+
+  const bool local =
+      (latitude - reference_.latitude_).abs().maxCoeff() * (M_PI / 180) <= local_expansion_limit_ &&
+      (longitude - reference_.longitude_).abs().maxCoeff() * (M_PI / 180) <= local_expansion_limit_;
+  const Eigen::Matrix3d& R = ecef_ref_orientation_;
+
+  for (Eigen::Index start = 0; start < num; start += kBlockSize)
+  {
+    const Eigen::Index n = std::min<Eigen::Index>(kBlockSize, num - start);
+
+    BlockArray lat = BlockArray::Constant(reference_.latitude_);
+    BlockArray lon = BlockArray::Constant(reference_.longitude_);
+    BlockArray alt = BlockArray::Constant(reference_.altitude_);
+    lat.head(n) = latitude.segment(start, n);
+    lon.head(n) = longitude.segment(start, n);
+    alt.head(n) = altitude.segment(start, n);
+
+    BlockArray s_lat, c_lat, s_long, c_long;
+    if (local)
+    {
+      SinCosOffset(ref_sin_cos_(0), ref_sin_cos_(1), (lat - reference_.latitude_) * (M_PI / 180), &s_lat, &c_lat);
+      SinCosOffset(ref_sin_cos_(2), ref_sin_cos_(3), (lon - reference_.longitude_) * (M_PI / 180), &s_long, &c_long);
+    }
+    else
+    {
+      SinCos(lat * (M_PI / 180), &s_lat, &c_lat);
+      SinCos(lon * (M_PI / 180), &s_long, &c_long);
+    }
+
+    // WGS84ToECEF relative to the reference point
+    const BlockArray N = kSemiMajorAxis / (1 - kEccentricitySq * s_lat * s_lat).sqrt();
+    const BlockArray dx = (N + alt) * c_lat * c_long - ecef_ref_point_(0);
+    const BlockArray dy = (N + alt) * c_lat * s_long - ecef_ref_point_(1);
+    const BlockArray dz = (N * (1 - kEccentricitySq) + alt) * s_lat - ecef_ref_point_(2);
+
+    // ECEFToENU
+    enu->block(0, start, 1, n) = (R(0, 0) * dx + R(0, 1) * dy + R(0, 2) * dz).head(n).matrix().transpose();
+    enu->block(1, start, 1, n) = (R(1, 0) * dx + R(1, 1) * dy + R(1, 2) * dz).head(n).matrix().transpose();
+    enu->block(2, start, 1, n) = (R(2, 0) * dx + R(2, 1) * dy + R(2, 2) * dz).head(n).matrix().transpose();
+  }
 }
 
 double GpsConversion::deg2rad(const double& deg)
@@ -116,4 +255,42 @@ Eigen::Matrix<double, 3, 1> GpsConversion::WGS84ToECEF(const mars::GpsCoordinate
 
   return ecef;
 }
+
+Eigen::Matrix<double, 3, 1> GpsConversion::ENUToECEF(const Eigen::Matrix<double, 3, 1>& enu)
+{
+  Eigen::Matrix<double, 3, 1> ecef = ecef_ref_orientation_.transpose() * enu + ecef_ref_point_;
+  return ecef;
+}
+
+mars::GpsCoordinates GpsConversion::ECEFToWGS84(const Eigen::Matrix<double, 3, 1>& ecef)
+{
+  // WGS84 ellipsoid constants
+  constexpr double a = 6378137.0;             // semi-major axis
+  constexpr double ecc = 8.1819190842622e-2;  // eccentricity of this ellipsoid
+  constexpr double ecc_sq = ecc * ecc;
+
+  const double p = sqrt(ecef(0) * ecef(0) + ecef(1) * ecef(1));
+  const double rad_long = atan2(ecef(1), ecef(0));
+
+  // Fixed point iteration of the latitude, converges to sub-millimeter accuracy within a few iterations
+  double rad_lat = atan2(ecef(2), p * (1 - ecc_sq));
+  double h = 0;
+
+  for (int k = 0; k < 10; k++)
+  {
+    const double s_lat = sin(rad_lat);
+    const double N = a / sqrt(1 - ecc_sq * s_lat * s_lat);
+    h = p / cos(rad_lat) - N;
+
+    const double rad_lat_prev = rad_lat;
+    rad_lat = atan2(ecef(2), p * (1 - ecc_sq * N / (N + h)));
+
+    if (std::abs(rad_lat - rad_lat_prev) < 1e-14)
+    {
+      break;
+    }
+  }
+
+  return { rad_lat * 180 / M_PI, rad_long * 180 / M_PI, h };
+}
 }  // namespace mars
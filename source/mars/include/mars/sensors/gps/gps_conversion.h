@@ -29,6 +29,11 @@ struct GpsCoordinates
   double longitude_{ 0 };
   double altitude_{ 0 };
 
+  bool operator==(const GpsCoordinates& other) const
+  {
+    return latitude_ == other.latitude_ && longitude_ == other.longitude_ && altitude_ == other.altitude_;
+  }
+
   friend std::ostream& operator<<(std::ostream& out, const GpsCoordinates& coordinates);
 };
 
@@ -50,6 +55,29 @@ public:
   ///
   Eigen::Matrix<double, 3, 1> get_enu(mars::GpsCoordinates coordinates);
 
+  ///
+  /// \brief get_enu_batch Converts arrays of GPS coordinates to ENU positions
+  ///
+  /// The trigonometric functions are evaluated as polynomials on whole arrays such that Eigen vectorizes them. If all
+  /// coordinates are within local_expansion_limit_ of the reference, the sine and cosine are expanded around the
+  /// reference and no range reduction is needed. The difference to get_enu is below 1e-6 m for any coordinates on
+  /// earth and below 1e-8 m for local coordinates.
+  ///
+  /// \param latitude [deg]
+  /// \param longitude [deg]
+  /// \param altitude [m]
+  /// \param enu ENU local positions, one column per coordinate
+  ///
+  void get_enu_batch(const Eigen::ArrayXd& latitude, const Eigen::ArrayXd& longitude, const Eigen::ArrayXd& altitude,
+                     Eigen::Matrix3Xd* enu);
+
+  ///
+  /// \brief get_wgs84 inverse of get_enu
+  /// \param enu ENU local position
+  /// \return GPS coordinates
+  ///
+  mars::GpsCoordinates get_wgs84(const Eigen::Matrix<double, 3, 1>& enu);
+
   ///
   /// \brief get_gps_reference
   /// \return GPS reference coordinates
@@ -62,11 +90,14 @@ public:
   ///
   void set_gps_reference(mars::GpsCoordinates coordinates);
 
+  double local_expansion_limit_{ 0.01 };  ///< Maximum latitude and longitude offset of the batch fast path [rad]
+
 private:
   GpsCoordinates reference_;  ///< GPS reference coordinates
   Eigen::Matrix3d ecef_ref_orientation_;
   Eigen::Matrix<double, 3, 1> ecef_ref_point_;
   bool reference_is_set{ false };
+  Eigen::Vector4d ref_sin_cos_{ 0, 1, 0, 1 };  ///< sin(lat), cos(lat), sin(long), cos(long) of the reference
   ///
   /// \brief deg2rad
   /// \param deg
@@ -95,6 +126,20 @@ private:
   /// \return ENU local position
   ///
   Eigen::Matrix<double, 3, 1> WGS84ToENU(const mars::GpsCoordinates& coordinates);
+
+  ///
+  /// \brief ENUToECEF East-North-Up (ENU) to Earth-Centered-Earth-Fixed (ECEF)
+  /// \param enu ENU local position
+  /// \return ecef position
+  ///
+  Eigen::Matrix<double, 3, 1> ENUToECEF(const Eigen::Matrix<double, 3, 1>& enu);
+
+  ///
+  /// \brief ECEFToWGS84 Earth-Centered-Earth-Fixed (ECEF) to World Geodetic System 1984 model (WGS-84)
+  /// \param ecef ecef position
+  /// \return GPS coordinates
+  ///
+  mars::GpsCoordinates ECEFToWGS84(const Eigen::Matrix<double, 3, 1>& ecef);
 };
 }  // namespace mars
 #endif  // GPS_CONVERSION_H
@@ -20,10 +20,13 @@
 #include <mars/sensors/update_sensor_abs_class.h>
 #include <mars/time.h>
 #include <mars/type_definitions/buffer_data_type.h>
+#include <cmath>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mars
 {
@@ -38,6 +41,14 @@ public:
   bool using_external_gps_reference_;
   bool gps_reference_is_set_;
 
+  /// ENU positions of the latest preprocessed batch, keyed by measurement. The measurements themselves are shared
+  /// between filter instances and are not modified.
+  std::map<std::shared_ptr<void>, Eigen::Vector3d> batch_enu_;
+  GpsCoordinates batch_enu_reference_;  ///< GPS reference the positions in batch_enu_ were converted with
+
+  double auto_calib_p_ig_std_{ 0.1 };                ///< Std [m] of p_ig, assumed zero by the auto calibration
+  double auto_calib_r_gw_w_std_{ 5 * M_PI / 180 };  ///< Std [rad] of q_gw_w, assumed identity by the auto calibration
+
   GpsSensorClass(const std::string& name, std::shared_ptr<CoreState> core_states)
   {
     name_ = name;
@@ -94,6 +105,25 @@ public:
     }
   }
 
+  std::shared_ptr<void> SaveState() const
+  {
+    std::shared_ptr<GpsSensorState> state = std::make_shared<GpsSensorState>();
+    state->base_state_ = UpdateSensorAbsClass::SaveState();
+    state->gps_conversion_ = gps_conversion_;
+    state->using_external_gps_reference_ = using_external_gps_reference_;
+    state->gps_reference_is_set_ = gps_reference_is_set_;
+    return state;
+  }
+
+  void RestoreState(const std::shared_ptr<void>& state)
+  {
+    const GpsSensorState& gps_sensor_state = *static_cast<GpsSensorState*>(state.get());
+    UpdateSensorAbsClass::RestoreState(gps_sensor_state.base_state_);
+    gps_conversion_ = gps_sensor_state.gps_conversion_;
+    using_external_gps_reference_ = gps_sensor_state.using_external_gps_reference_;
+    gps_reference_is_set_ = gps_sensor_state.gps_reference_is_set_;
+  }
+
   BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> sensor_data,
                             std::shared_ptr<CoreType> latest_core_data)
   {
@@ -112,6 +142,7 @@ public:
 
     GpsSensorData sensor_state;
     std::string calibration_type;
+    bool calibration_complete = true;
 
     if (this->initial_calib_provided_)
     {
@@ -125,14 +156,18 @@ public:
     else
     {
       calibration_type = "Auto";
-      std::cout << "GPS calibration AUTO init not implemented yet" << std::endl;
-      exit(EXIT_FAILURE);
+      calibration_complete = CalcAutoCalibration(timestamp, measurement, *latest_core_data, &sensor_state);
     }
 
     // Bypass core state for the returned object
     BufferDataType result(std::make_shared<CoreType>(*latest_core_data.get()),
                           std::make_shared<GpsSensorData>(sensor_state));
 
+    if (!calibration_complete)
+    {
+      return result;
+    }
+
     is_initialized_ = true;
 
     std::cout << "Info: Initialized [" << name_ << "] with [" << calibration_type << "] Calibration at t=" << timestamp
@@ -145,16 +180,132 @@ public:
     return result;
   }
 
-  bool CalcUpdate(const Time& /*timestamp*/, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
-                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
-                  BufferDataType* new_state_data)
+  ///
+  /// \brief CalcAutoCalibration Closed-form calibration from a measurement and the core state
+  ///
+  /// The antenna is assumed at the IMU and the GPS frame aligned with the world frame (p_ig = 0, q_gw_w = I), which
+  /// gives p_gw_w = p_enu - p_wi. The assumed states enter the covariance with the auto_calib_*_std_ values.
+  ///
+  /// \return True if the refinement over auto_calib_.refine_duration_ is complete
+  ///
+  bool CalcAutoCalibration(const Time& timestamp, const GpsMeasurementType& measurement, const CoreType& core_data,
+                           GpsSensorData* sensor_data)
+  {
+    const CoreStateType& core_state = core_data.state_;
+    const Eigen::Vector3d P_wi = core_state.p_wi_;
+    const Eigen::Matrix3d R_wi = core_state.q_wi_.toRotationMatrix();
+    const Eigen::Vector3d p_enu = gps_conversion_.get_enu(measurement.coordinates_);
+
+    GpsSensorStateType& state = sensor_data->state_;
+    state.p_ig_.setZero();
+    state.q_gw_w_.setIdentity();
+
+    Eigen::VectorXd vectors = p_enu - state.q_gw_w_.toRotationMatrix() * (P_wi + R_wi * state.p_ig_);
+    std::vector<Eigen::Quaterniond> rotations;
+    const bool complete = auto_calib_.Refine(timestamp, &vectors, &rotations);
+
+    state.p_gw_w_ = vectors;
+
+    // Jacobians with respect to the core error state and the noise [p_meas p_ig r_gw_w]
+    const Eigen::Vector3d P_ig = state.p_ig_;
+    const Eigen::Matrix3d R_gw_w = state.q_gw_w_.toRotationMatrix();
+
+    Eigen::MatrixXd J_core = Eigen::MatrixXd::Zero(9, CoreStateType::size_error_);
+    J_core.block(3, 0, 3, 3) = -R_gw_w;
+    J_core.block(3, 6, 3, 3) = R_gw_w * R_wi * Utils::Skew(P_ig);
+
+    Eigen::MatrixXd J_noise = Eigen::MatrixXd::Zero(9, 9);
+    J_noise.block(0, 3, 3, 3).setIdentity();
+    J_noise.block(3, 0, 3, 3).setIdentity();
+    J_noise.block(3, 3, 3, 3) = -R_gw_w * R_wi;
+    J_noise.block(3, 6, 3, 3) = R_gw_w * Utils::Skew(P_wi + R_wi * P_ig);
+    J_noise.block(6, 6, 3, 3).setIdentity();
+
+    Eigen::VectorXd noise_var = Eigen::VectorXd::Zero(9);
+    if (R_.size() == 3)
+    {
+      noise_var.head(3) = R_;
+    }
+    noise_var.segment(3, 3).setConstant(auto_calib_p_ig_std_ * auto_calib_p_ig_std_);
+    noise_var.segment(6, 3).setConstant(auto_calib_r_gw_w_std_ * auto_calib_r_gw_w_std_);
+
+    AutoCalibration::PropagateCovariance(core_data.cov_, J_core, Eigen::MatrixXd(noise_var.asDiagonal()), J_noise,
+                                         &sensor_data->sensor_cov_, &sensor_data->core_sensor_cross_cov_);
+
+    return complete;
+  }
+
+  ///
+  /// \brief PreprocessMeasurements Converts the coordinates of a batch of measurements to ENU at once
+  ///
+  /// The conversion requires the GPS reference, batches before the initialization are converted in CalcUpdate. The
+  /// result replaces the previous batch in batch_enu_ and is used by CalcUpdate through get_enu.
+  ///
+  void PreprocessMeasurements(const std::vector<std::shared_ptr<void>>& measurements)
+  {
+    if (!gps_reference_is_set_ || measurements.empty())
+    {
+      return;
+    }
+
+    const Eigen::Index num = static_cast<Eigen::Index>(measurements.size());
+    Eigen::ArrayXd latitude(num), longitude(num), altitude(num);
+    for (Eigen::Index k = 0; k < num; k++)
+    {
+      const GpsMeasurementType* meas = static_cast<GpsMeasurementType*>(measurements[k].get());
+      latitude(k) = meas->coordinates_.latitude_;
+      longitude(k) = meas->coordinates_.longitude_;
+      altitude(k) = meas->coordinates_.altitude_;
+    }
+
+    Eigen::Matrix3Xd enu;
+    gps_conversion_.get_enu_batch(latitude, longitude, altitude, &enu);
+
+    batch_enu_.clear();
+    batch_enu_reference_ = gps_conversion_.get_gps_reference();
+    for (Eigen::Index k = 0; k < num; k++)
+    {
+      batch_enu_[measurements[k]] = enu.col(k);
+    }
+  }
+
+  ///
+  /// \brief get_enu ENU position of a measurement with the current GPS reference
+  ///
+  /// The position of the latest batch is used if the batch was converted with the current reference. The reference
+  /// changes e.g. with RestoreState, the batch is converted again in this case.
+  ///
+  Eigen::Vector3d get_enu(const std::shared_ptr<void>& measurement)
+  {
+    const GpsCoordinates reference = gps_conversion_.get_gps_reference();
+    if (reference == batch_enu_reference_)
+    {
+      const auto batch_enu = batch_enu_.find(measurement);
+      if (batch_enu != batch_enu_.end())
+      {
+        return batch_enu->second;
+      }
+    }
+
+    return gps_conversion_.get_enu(static_cast<GpsMeasurementType*>(measurement.get())->coordinates_);
+  }
+
+  bool SupportsStackedUpdate() const
+  {
+    return !chi2_.do_test_;
+  }
+
+  bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> measurement,
+                            const CoreStateType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                            std::shared_ptr<void> latest_sensor_data, Eigen::MatrixXd* H_out, Eigen::MatrixXd* R_out,
+                            Eigen::MatrixXd* res_out)
   {
     // Cast the sensor measurement and prior state information
     GpsMeasurementType* meas = static_cast<GpsMeasurementType*>(measurement.get());
     GpsSensorData* prior_sensor_data = static_cast<GpsSensorData*>(latest_sensor_data.get());
 
     // Decompose sensor measurement
-    Eigen::Vector3d p_meas = gps_conversion_.get_enu(meas->coordinates_);
+    const Eigen::Vector3d p_meas = get_enu(measurement);
 
     // Extract sensor state
     GpsSensorStateType prior_sensor_state(prior_sensor_data->state_);
@@ -172,16 +323,9 @@ public:
     }
     const Eigen::Matrix<double, 3, 3> R_meas = R_meas_dyn;
 
-    const int size_of_core_state = CoreStateType::size_error_;
-    const int size_of_sensor_state = prior_sensor_state.cov_size_;
-    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
-    const Eigen::MatrixXd P = prior_cov;
-    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
-
     // Calculate the measurement jacobian H
     // const Eigen::Matrix3d I_3 = Eigen::Matrix3d::Identity();
     const Eigen::Vector3d P_wi = prior_core_state.p_wi_;
-    const Eigen::Matrix3d R_wi = prior_core_state.q_wi_.toRotationMatrix();
     const Eigen::Vector3d P_ig = prior_sensor_state.p_ig_;
 
     const Eigen::Vector3d P_gw_w = prior_sensor_state.p_gw_w_;
@@ -210,6 +354,31 @@ public:
     const Eigen::Vector3d p_est = P_gw_w + R_gw_w * (P_wi + R_wi * P_ig);
     const Eigen::Vector3d res = p_meas - p_est;
 
+    *H_out = H;
+    *R_out = R_meas;
+    *res_out = res;
+
+    return true;
+  }
+
+  bool CalcUpdate(const Time& timestamp, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
+                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
+                  BufferDataType* new_state_data)
+  {
+    GpsSensorData* prior_sensor_data = static_cast<GpsSensorData*>(latest_sensor_data.get());
+
+    const int size_of_core_state = CoreStateType::size_error_;
+    const int size_of_sensor_state = prior_sensor_data->state_.cov_size_;
+    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
+    const Eigen::MatrixXd P = prior_cov;
+    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
+
+    Eigen::MatrixXd H;
+    Eigen::MatrixXd R_meas;
+    Eigen::MatrixXd res;
+    CalcMeasurementModel(timestamp, measurement, prior_core_state, prior_core_state.q_wi_.toRotationMatrix(),
+                         latest_sensor_data, &H, &R_meas, &res);
+
     // Perform EKF calculations
     mars::Ekf ekf(H, R_meas, res, P);
     const Eigen::MatrixXd correction = ekf.CalculateCorrection(&chi2_);
@@ -230,10 +399,6 @@ public:
     CoreStateVector core_correction = correction.block(0, 0, CoreStateType::size_error_, 1);
     CoreStateType corrected_core_state = CoreStateType::ApplyCorrection(prior_core_state, core_correction);
 
-    // Apply Sensor Correction
-    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
-    const GpsSensorStateType corrected_sensor_state = ApplyCorrection(prior_sensor_state, sensor_correction);
-
     // Return Results
     // CoreState data
     CoreType core_data;
@@ -241,9 +406,8 @@ public:
     core_data.state_ = corrected_core_state;
 
     // SensorState data
-    std::shared_ptr<GpsSensorData> sensor_data(std::make_shared<GpsSensorData>());
-    sensor_data->set_cov(P_updated);
-    sensor_data->state_ = corrected_sensor_state;
+    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
+    std::shared_ptr<void> sensor_data = CalcCorrectedSensorData(latest_sensor_data, sensor_correction, P_updated);
 
     BufferDataType state_entry(std::make_shared<CoreType>(core_data), sensor_data);
 
@@ -261,6 +425,17 @@ public:
     return true;
   }
 
+  std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> latest_sensor_data,
+                                                const Eigen::MatrixXd& correction, const Eigen::MatrixXd& cov)
+  {
+    GpsSensorData* prior_sensor_data = static_cast<GpsSensorData*>(latest_sensor_data.get());
+
+    std::shared_ptr<GpsSensorData> sensor_data(std::make_shared<GpsSensorData>());
+    sensor_data->set_cov(cov);
+    sensor_data->state_ = ApplyCorrection(prior_sensor_data->state_, correction);
+    return sensor_data;
+  }
+
   GpsSensorStateType ApplyCorrection(const GpsSensorStateType& prior_sensor_state, const Eigen::MatrixXd& correction)
   {
     // state + error state correction
@@ -273,6 +448,15 @@ public:
         Utils::ApplySmallAngleQuatCorr(prior_sensor_state.q_gw_w_, correction.block(6, 0, 3, 1));
     return corrected_sensor_state;
   }
+
+private:
+  struct GpsSensorState
+  {
+    std::shared_ptr<void> base_state_;
+    GpsConversion gps_conversion_;
+    bool using_external_gps_reference_;
+    bool gps_reference_is_set_;
+  };
 };
 }  // namespace mars
 
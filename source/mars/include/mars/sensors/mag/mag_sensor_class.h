@@ -26,6 +26,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mars
 {
@@ -39,9 +40,33 @@ private:
   Eigen::Vector3d mag_intr_offset_{ Eigen::Vector3d::Zero() };  ///< Intrinsic cal offset
   Eigen::Matrix3d mag_intr_transform_{ Eigen::Matrix3d::Identity() };  ///< Intrinsic cal distortion
 
+  ///
+  /// \brief CorrectMeasurement Applies the intrinsic calibration and normalization to a raw measurement
+  ///
+  Eigen::Vector3d CorrectMeasurement(const Eigen::Vector3d& mag_vector) const
+  {
+    Eigen::Vector3d mag_meas(mag_vector);
+
+    // Correct measurement with intrinsic calibration
+    if (apply_intrinsic_)
+    {
+      mag_meas = mag_intr_transform_ * (mag_meas - mag_intr_offset_);
+    }
+
+    // Perform normalization
+    if (normalize_)
+    {
+      mag_meas = mag_meas / mag_meas.norm();
+    }
+
+    return mag_meas;
+  }
+
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  double auto_calib_r_im_std_{ 10 * M_PI / 180 };  ///< Std [rad] of q_im, assumed identity by the auto calibration
+
   MagSensorClass(const std::string& name, std::shared_ptr<CoreState> core_states)
   {
     name_ = name;
@@ -77,13 +102,14 @@ public:
     initial_calib_provided_ = true;
   }
 
-  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> /*sensor_data*/,
+  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> sensor_data,
                             std::shared_ptr<CoreType> latest_core_data)
   {
-    // MagMeasurementType measurement = *static_cast<MagMeasurementType*>(sensor_data.get());
+    MagMeasurementType measurement = *static_cast<MagMeasurementType*>(sensor_data.get());
 
     MagSensorData sensor_state;
     std::string calibration_type;
+    bool calibration_complete = true;
 
     if (this->initial_calib_provided_)
     {
@@ -97,14 +123,18 @@ public:
     else
     {
       calibration_type = "Auto";
-      std::cout << "Magnetometer calibration AUTO init not implemented yet" << std::endl;
-      exit(EXIT_FAILURE);
+      calibration_complete = CalcAutoCalibration(timestamp, measurement, *latest_core_data, &sensor_state);
     }
 
     // Bypass core state for the returned object
     BufferDataType result(std::make_shared<CoreType>(*latest_core_data.get()),
                           std::make_shared<MagSensorData>(sensor_state));
 
+    if (!calibration_complete)
+    {
+      return result;
+    }
+
     // TODO (chb)
     // sensor_data.ref_to_nav = 0; //obj.calc_ref_to_nav(measurement, latest_core_state);
 
@@ -125,28 +155,68 @@ public:
     return result;
   }
 
-  bool CalcUpdate(const Time& /*timestamp*/, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
-                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
-                  BufferDataType* new_state_data)
+  ///
+  /// \brief CalcAutoCalibration Closed-form calibration from a measurement and the core state
+  ///
+  /// The magnetometer is assumed aligned with the IMU (q_im = I), which gives mag = R_wi R_im m. The assumed rotation
+  /// enters the covariance with auto_calib_r_im_std_.
+  ///
+  /// \return True if the refinement over auto_calib_.refine_duration_ is complete
+  ///
+  bool CalcAutoCalibration(const Time& timestamp, const MagMeasurementType& measurement, const CoreType& core_data,
+                           MagSensorData* sensor_data)
   {
-    // Cast the sensor measurement and prior state information
-    MagMeasurementType* meas = static_cast<MagMeasurementType*>(measurement.get());
-    MagSensorData* prior_sensor_data = static_cast<MagSensorData*>(latest_sensor_data.get());
+    const Eigen::Matrix3d R_wi = core_data.state_.q_wi_.toRotationMatrix();
+    const Eigen::Vector3d mag_meas = CorrectMeasurement(measurement.mag_vector_);
 
-    // Decompose sensor measurement
-    Eigen::Vector3d mag_meas(meas->mag_vector_);
+    MagSensorStateType& state = sensor_data->state_;
+    state.q_im_.setIdentity();
+    const Eigen::Matrix3d R_im = state.q_im_.toRotationMatrix();
 
-    // Correct measurement with intrinsic calibration
-    if (apply_intrinsic_)
-    {
-      mag_meas = mag_intr_transform_ * (mag_meas - mag_intr_offset_);
-    }
+    Eigen::VectorXd vectors = R_wi * R_im * mag_meas;
+    std::vector<Eigen::Quaterniond> rotations;
+    const bool complete = auto_calib_.Refine(timestamp, &vectors, &rotations);
 
-    // Perform normalization
-    if (normalize_)
+    state.mag_ = vectors;
+
+    // Jacobians with respect to the core error state and the noise [mag_meas r_im]
+    Eigen::MatrixXd J_core = Eigen::MatrixXd::Zero(6, CoreStateType::size_error_);
+    J_core.block(0, 6, 3, 3) = -R_wi * Utils::Skew(R_im * mag_meas);
+
+    Eigen::MatrixXd J_noise = Eigen::MatrixXd::Zero(6, 6);
+    J_noise.block(0, 0, 3, 3) = R_wi * R_im;
+    J_noise.block(0, 3, 3, 3) = -R_wi * R_im * Utils::Skew(mag_meas);
+    J_noise.block(3, 3, 3, 3).setIdentity();
+
+    Eigen::VectorXd noise_var = Eigen::VectorXd::Zero(6);
+    if (R_.size() == 3)
     {
-      mag_meas = mag_meas / mag_meas.norm();
+      noise_var.head(3) = R_;
     }
+    noise_var.tail(3).setConstant(auto_calib_r_im_std_ * auto_calib_r_im_std_);
+
+    AutoCalibration::PropagateCovariance(core_data.cov_, J_core, Eigen::MatrixXd(noise_var.asDiagonal()), J_noise,
+                                         &sensor_data->sensor_cov_, &sensor_data->core_sensor_cross_cov_);
+
+    return complete;
+  }
+
+  bool SupportsStackedUpdate() const
+  {
+    return !chi2_.do_test_;
+  }
+
+  bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> measurement,
+                            const CoreStateType& /*prior_core_state*/, const Eigen::Matrix3d& R_wi,
+                            std::shared_ptr<void> latest_sensor_data, Eigen::MatrixXd* H_out, Eigen::MatrixXd* R_out,
+                            Eigen::MatrixXd* res_out)
+  {
+    // Cast the sensor measurement and prior state information
+    MagMeasurementType* meas = static_cast<MagMeasurementType*>(measurement.get());
+    MagSensorData* prior_sensor_data = static_cast<MagSensorData*>(latest_sensor_data.get());
+
+    // Decompose sensor measurement
+    const Eigen::Vector3d mag_meas = CorrectMeasurement(meas->mag_vector_);
 
     // Extract sensor state
     MagSensorStateType prior_sensor_state(prior_sensor_data->state_);
@@ -164,15 +234,8 @@ public:
     }
     const Eigen::Matrix<double, 3, 3> R_meas = R_meas_dyn;
 
-    const int size_of_core_state = CoreStateType::size_error_;
-    const int size_of_sensor_state = prior_sensor_state.cov_size_;
-    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
-    const Eigen::MatrixXd P = prior_cov;
-    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
-
     // Calculate the measurement jacobian H
     // const Eigen::Matrix3d I_3 = Eigen::Matrix3d::Identity();
-    const Eigen::Matrix3d R_wi = prior_core_state.q_wi_.toRotationMatrix();
     const Eigen::Vector3d mag_w = prior_sensor_state.mag_;
     const Eigen::Matrix3d R_im = prior_sensor_state.q_im_.toRotationMatrix();
 
@@ -196,6 +259,31 @@ public:
     const Eigen::Vector3d mag_est = R_im.transpose() * R_wi.transpose() * mag_w;
     const Eigen::Vector3d res = mag_meas - mag_est;
 
+    *H_out = H;
+    *R_out = R_meas;
+    *res_out = res;
+
+    return true;
+  }
+
+  bool CalcUpdate(const Time& timestamp, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
+                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
+                  BufferDataType* new_state_data)
+  {
+    MagSensorData* prior_sensor_data = static_cast<MagSensorData*>(latest_sensor_data.get());
+
+    const int size_of_core_state = CoreStateType::size_error_;
+    const int size_of_sensor_state = prior_sensor_data->state_.cov_size_;
+    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
+    const Eigen::MatrixXd P = prior_cov;
+    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
+
+    Eigen::MatrixXd H;
+    Eigen::MatrixXd R_meas;
+    Eigen::MatrixXd res;
+    CalcMeasurementModel(timestamp, measurement, prior_core_state, prior_core_state.q_wi_.toRotationMatrix(),
+                         latest_sensor_data, &H, &R_meas, &res);
+
     // Perform EKF calculations
     mars::Ekf ekf(H, R_meas, res, P);
     const Eigen::MatrixXd correction = ekf.CalculateCorrection(&chi2_);
@@ -216,10 +304,6 @@ public:
     CoreStateVector core_correction = correction.block(0, 0, CoreStateType::size_error_, 1);
     CoreStateType corrected_core_state = CoreStateType::ApplyCorrection(prior_core_state, core_correction);
 
-    // Apply Sensor Correction
-    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
-    const MagSensorStateType corrected_sensor_state = ApplyCorrection(prior_sensor_state, sensor_correction);
-
     // Return Results
     // CoreState data
     CoreType core_data;
@@ -227,9 +311,8 @@ public:
     core_data.state_ = corrected_core_state;
 
     // SensorState data
-    std::shared_ptr<MagSensorData> sensor_data(std::make_shared<MagSensorData>());
-    sensor_data->set_cov(P_updated);
-    sensor_data->state_ = corrected_sensor_state;
+    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
+    std::shared_ptr<void> sensor_data = CalcCorrectedSensorData(latest_sensor_data, sensor_correction, P_updated);
 
     BufferDataType state_entry(std::make_shared<CoreType>(core_data), sensor_data);
 
@@ -247,6 +330,17 @@ public:
     return true;
   }
 
+  std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> latest_sensor_data,
+                                                const Eigen::MatrixXd& correction, const Eigen::MatrixXd& cov)
+  {
+    MagSensorData* prior_sensor_data = static_cast<MagSensorData*>(latest_sensor_data.get());
+
+    std::shared_ptr<MagSensorData> sensor_data(std::make_shared<MagSensorData>());
+    sensor_data->set_cov(cov);
+    sensor_data->state_ = ApplyCorrection(prior_sensor_data->state_, correction);
+    return sensor_data;
+  }
+
   MagSensorStateType ApplyCorrection(const MagSensorStateType& prior_sensor_state, const Eigen::MatrixXd& correction)
   {
     // state + error state correction
@@ -14,12 +14,14 @@ namespace mars
 {
 void MagnetometerInit::AddElement(const Eigen::Vector3d& mag_vector, const Eigen::Vector3d& imu_linear_acc_vector)
 {
-  rot_init_vec_.push_back(MagImuData(mag_vector, imu_linear_acc_vector));
+  mag_vec_sum_ += mag_vector;
+  imu_vec_sum_ += imu_linear_acc_vector;
+  num_elements_++;
 }
 
 int MagnetometerInit::get_size() const
 {
-  return static_cast<int>(rot_init_vec_.size());
+  return num_elements_;
 }
 
 void MagnetometerInit::set_done()
@@ -35,7 +37,9 @@ bool MagnetometerInit::IsDone() const
 void MagnetometerInit::Reset()
 {
   once_ = false;
-  rot_init_vec_.clear();
+  mag_vec_sum_.setZero();
+  imu_vec_sum_.setZero();
+  num_elements_ = 0;
 }
 
 Eigen::Vector3d MagnetometerInit::mag_var_ang_to_vec(const double& dec, const double& inc, const double& r)
@@ -54,14 +58,7 @@ Eigen::Vector3d MagnetometerInit::mag_var_ang_to_vec(const double& dec, const do
 
 MagnetometerInit::MagImuData MagnetometerInit::get_vec_mean() const
 {
-  Eigen::Vector3d mag_vec_sum(0, 0, 0);
-  Eigen::Vector3d imu_vec_sum(0, 0, 0);
-  for (const auto& k : rot_init_vec_)
-  {
-    mag_vec_sum += k.mag_vec_;
-    imu_vec_sum += k.imu_vec_;
-  }
-  return MagImuData(mag_vec_sum / get_size(), imu_vec_sum / get_size());
+  return MagImuData(mag_vec_sum_ / num_elements_, imu_vec_sum_ / num_elements_);
 }
 
 Eigen::Matrix3d MagnetometerInit::get_rot() const
@@ -12,7 +12,6 @@
 #define MAG_UTILS_H
 
 #include <Eigen/Dense>
-#include <vector>
 
 namespace mars
 {
@@ -22,7 +21,7 @@ public:
   MagnetometerInit() = default;
 
   ///
-  /// \brief AddElement Add magnetometer and imu measurement pairs to buffer
+  /// \brief AddElement Add magnetometer and imu measurement pairs to the running mean
   /// IMU and Magnetometer vectors nee to be expressed in the IMU reference frame
   /// \param mag_vector Magnetic vector expressed in the IMU frame
   /// \param imu_linear_acc_vector Linear acceleration vector, assuming static conditions
@@ -30,7 +29,7 @@ public:
   void AddElement(const Eigen::Vector3d& mag_vector, const Eigen::Vector3d& imu_linear_acc_vector);
 
   ///
-  /// \brief get_rot Get the rotation matrix for the vector pairs in the buffer
+  /// \brief get_rot Get the rotation matrix for the mean of the added vector pairs
   /// \return Rotation of the IMU sensor w.r.t. the world frame
   ///
   Eigen::Matrix3d get_rot() const;
@@ -42,8 +41,8 @@ public:
   Eigen::Quaterniond get_quat() const;
 
   ///
-  /// \brief get_size Get the current size of the buffer
-  /// \return Size of the buffer
+  /// \brief get_size Get the number of added vector pairs
+  /// \return Number of vector pairs
   ///
   int get_size() const;
 
@@ -61,7 +60,7 @@ public:
   ///
   /// \brief Reset Reset the initialization module
   ///
-  /// Reset 'isDone' and clear the buffer
+  /// Reset 'isDone' and clear the running mean
   ///
   void Reset();
 
@@ -103,16 +102,26 @@ public:
   };
 
   ///
-  /// \brief get_vec_mean Get the mean of the Mag and IMU vectors in the measurement buffer
+  /// \brief get_vec_mean Get the mean of the added Mag and IMU vectors
   /// \return Return the mean as 'MagImuData' type
   ///
   MagImuData get_vec_mean() const;
 
 private:
   ///
-  /// \brief rot_init_vec_ Measurement buffer
+  /// \brief mag_vec_sum_ Sum of the added magnetometer vectors
   ///
-  std::vector<MagImuData> rot_init_vec_;
+  Eigen::Vector3d mag_vec_sum_{ Eigen::Vector3d::Zero() };
+
+  ///
+  /// \brief imu_vec_sum_ Sum of the added IMU linear acceleration vectors
+  ///
+  Eigen::Vector3d imu_vec_sum_{ Eigen::Vector3d::Zero() };
+
+  ///
+  /// \brief num_elements_ Number of added vector pairs
+  ///
+  int num_elements_{ 0 };
 
   ///
   /// \brief once_ Indicate if the intialization was done
@@ -26,6 +26,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mars
 {
@@ -63,19 +64,28 @@ public:
     return data.get_full_cov();
   }
 
+  Eigen::VectorXd get_state_vector(const std::shared_ptr<void>& sensor_data)
+  {
+    const PoseSensorStateType& state = static_cast<PoseSensorData*>(sensor_data.get())->state_;
+    Eigen::VectorXd state_vector(7);
+    state_vector << state.p_ip_, state.q_ip_.w(), state.q_ip_.vec();
+    return state_vector;
+  }
+
   void set_initial_calib(std::shared_ptr<void> calibration)
   {
     initial_calib_ = calibration;
     initial_calib_provided_ = true;
   }
 
-  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> /*sensor_data*/,
+  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> sensor_data,
                             std::shared_ptr<CoreType> latest_core_data)
   {
-    // PoseMeasurementType measurement = *static_cast<PoseMeasurementType*>(sensor_data.get());
+    PoseMeasurementType measurement = *static_cast<PoseMeasurementType*>(sensor_data.get());
 
     PoseSensorData sensor_state;
     std::string calibration_type;
+    bool calibration_complete = true;
 
     if (this->initial_calib_provided_)
     {
@@ -89,14 +99,18 @@ public:
     else
     {
       calibration_type = "Auto";
-      std::cout << "Pose calibration AUTO init not implemented yet" << std::endl;
-      exit(EXIT_FAILURE);
+      calibration_complete = CalcAutoCalibration(timestamp, measurement, *latest_core_data, &sensor_state);
     }
 
     // Bypass core state for the returned object
     BufferDataType result(std::make_shared<CoreType>(*latest_core_data.get()),
                           std::make_shared<PoseSensorData>(sensor_state));
 
+    if (!calibration_complete)
+    {
+      return result;
+    }
+
     is_initialized_ = true;
 
     std::cout << "Info: Initialized [" << name_ << "] with [" << calibration_type << "] Calibration at t=" << timestamp
@@ -114,9 +128,55 @@ public:
     return result;
   }
 
-  bool CalcUpdate(const Time& /*timestamp*/, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
-                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
-                  BufferDataType* new_state_data)
+  ///
+  /// \brief CalcAutoCalibration Closed-form calibration from a measurement and the core state
+  ///
+  /// p_ip = R_wi^T (p_wp - p_wi) and q_ip = q_wi^-1 q_wp. The covariance is the first order propagation of the core
+  /// covariance and the measurement noise R_, the cross-covariance to the core is set accordingly.
+  ///
+  /// \return True if the refinement over auto_calib_.refine_duration_ is complete
+  ///
+  bool CalcAutoCalibration(const Time& timestamp, const PoseMeasurementType& measurement, const CoreType& core_data,
+                           PoseSensorData* sensor_data)
+  {
+    const CoreStateType& core_state = core_data.state_;
+    const Eigen::Matrix3d R_wi = core_state.q_wi_.toRotationMatrix();
+
+    Eigen::VectorXd vectors = R_wi.transpose() * (measurement.position_ - core_state.p_wi_);
+    std::vector<Eigen::Quaterniond> rotations{ core_state.q_wi_.conjugate() * measurement.orientation_ };
+    const bool complete = auto_calib_.Refine(timestamp, &vectors, &rotations);
+
+    sensor_data->state_.p_ip_ = vectors;
+    sensor_data->state_.q_ip_ = rotations[0];
+
+    // Jacobians with respect to the core error state and the measurement noise
+    const Eigen::Matrix3d R_ip = sensor_data->state_.q_ip_.toRotationMatrix();
+
+    Eigen::MatrixXd J_core = Eigen::MatrixXd::Zero(6, CoreStateType::size_error_);
+    J_core.block(0, 0, 3, 3) = -R_wi.transpose();
+    J_core.block(0, 6, 3, 3) = Utils::Skew(sensor_data->state_.p_ip_);
+    J_core.block(3, 6, 3, 3) = -R_ip.transpose();
+
+    Eigen::MatrixXd J_meas = Eigen::MatrixXd::Identity(6, 6);
+    J_meas.block(0, 0, 3, 3) = R_wi.transpose();
+
+    const Eigen::MatrixXd R_meas = R_.size() == 6 ? Eigen::MatrixXd(R_.asDiagonal()) : Eigen::MatrixXd::Zero(6, 6);
+
+    AutoCalibration::PropagateCovariance(core_data.cov_, J_core, R_meas, J_meas, &sensor_data->sensor_cov_,
+                                         &sensor_data->core_sensor_cross_cov_);
+
+    return complete;
+  }
+
+  bool SupportsStackedUpdate() const
+  {
+    return !chi2_.do_test_;
+  }
+
+  bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> measurement,
+                            const CoreStateType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                            std::shared_ptr<void> latest_sensor_data, Eigen::MatrixXd* H_out, Eigen::MatrixXd* R_out,
+                            Eigen::MatrixXd* res_out)
   {
     // Cast the sensor measurement and prior state information
     PoseMeasurementType* meas = static_cast<PoseMeasurementType*>(measurement.get());
@@ -142,16 +202,9 @@ public:
     }
     const Eigen::Matrix<double, 6, 6> R_meas = R_meas_dyn;
 
-    const int size_of_core_state = CoreStateType::size_error_;
-    const int size_of_sensor_state = prior_sensor_state.cov_size_;
-    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
-    const Eigen::MatrixXd P = prior_cov;
-    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
-
     // Calculate the measurement jacobian H
     const Eigen::Matrix3d I_3 = Eigen::Matrix3d::Identity();
     const Eigen::Vector3d P_wi = prior_core_state.p_wi_;
-    const Eigen::Matrix3d R_wi = prior_core_state.q_wi_.toRotationMatrix();
     const Eigen::Vector3d P_ip = prior_sensor_state.p_ip_;
     const Eigen::Matrix3d R_ip = prior_sensor_state.q_ip_.toRotationMatrix();
 
@@ -202,6 +255,31 @@ public:
     Eigen::MatrixXd res(res_p.rows() + res_r.rows(), 1);
     res << res_p, res_r;
 
+    *H_out = H;
+    *R_out = R_meas;
+    *res_out = res;
+
+    return true;
+  }
+
+  bool CalcUpdate(const Time& timestamp, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
+                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
+                  BufferDataType* new_state_data)
+  {
+    PoseSensorData* prior_sensor_data = static_cast<PoseSensorData*>(latest_sensor_data.get());
+
+    const int size_of_core_state = CoreStateType::size_error_;
+    const int size_of_sensor_state = prior_sensor_data->state_.cov_size_;
+    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
+    const Eigen::MatrixXd P = prior_cov;
+    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
+
+    Eigen::MatrixXd H;
+    Eigen::MatrixXd R_meas;
+    Eigen::MatrixXd res;
+    CalcMeasurementModel(timestamp, measurement, prior_core_state, prior_core_state.q_wi_.toRotationMatrix(),
+                         latest_sensor_data, &H, &R_meas, &res);
+
     // Perform EKF calculations
     mars::Ekf ekf(H, R_meas, res, P);
     const Eigen::MatrixXd correction = ekf.CalculateCorrection(&chi2_);
@@ -222,10 +300,6 @@ public:
     CoreStateVector core_correction = correction.block(0, 0, CoreStateType::size_error_, 1);
     CoreStateType corrected_core_state = CoreStateType::ApplyCorrection(prior_core_state, core_correction);
 
-    // Apply Sensor Correction
-    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
-    const PoseSensorStateType corrected_sensor_state = ApplyCorrection(prior_sensor_state, sensor_correction);
-
     // Return Results
     // CoreState data
     CoreType core_data;
@@ -233,9 +307,8 @@ public:
     core_data.state_ = corrected_core_state;
 
     // SensorState data
-    std::shared_ptr<PoseSensorData> sensor_data(std::make_shared<PoseSensorData>());
-    sensor_data->set_cov(P_updated);
-    sensor_data->state_ = corrected_sensor_state;
+    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
+    std::shared_ptr<void> sensor_data = CalcCorrectedSensorData(latest_sensor_data, sensor_correction, P_updated);
 
     BufferDataType state_entry(std::make_shared<CoreType>(core_data), sensor_data);
 
@@ -253,6 +326,17 @@ public:
     return true;
   }
 
+  std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> latest_sensor_data,
+                                                const Eigen::MatrixXd& correction, const Eigen::MatrixXd& cov)
+  {
+    PoseSensorData* prior_sensor_data = static_cast<PoseSensorData*>(latest_sensor_data.get());
+
+    std::shared_ptr<PoseSensorData> sensor_data(std::make_shared<PoseSensorData>());
+    sensor_data->set_cov(cov);
+    sensor_data->state_ = ApplyCorrection(prior_sensor_data->state_, correction);
+    return sensor_data;
+  }
+
   PoseSensorStateType ApplyCorrection(const PoseSensorStateType& prior_sensor_state, const Eigen::MatrixXd& correction)
   {
     // state + error state correction
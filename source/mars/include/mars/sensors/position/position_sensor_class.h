@@ -60,6 +60,11 @@ public:
     return data.get_full_cov();
   }
 
+  Eigen::VectorXd get_state_vector(const std::shared_ptr<void>& sensor_data)
+  {
+    return static_cast<PositionSensorData*>(sensor_data.get())->state_.p_ip_;
+  }
+
   void set_initial_calib(std::shared_ptr<void> calibration)
   {
     initial_calib_ = calibration;
@@ -105,9 +110,15 @@ public:
     return result;
   }
 
-  bool CalcUpdate(const Time& /*timestamp*/, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
-                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
-                  BufferDataType* new_state_data)
+  bool SupportsStackedUpdate() const
+  {
+    return !chi2_.do_test_;
+  }
+
+  bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> measurement,
+                            const CoreStateType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                            std::shared_ptr<void> latest_sensor_data, Eigen::MatrixXd* H_out, Eigen::MatrixXd* R_out,
+                            Eigen::MatrixXd* res_out)
   {
     // Cast the sensor measurement and prior state information
     PositionMeasurementType* meas = static_cast<PositionMeasurementType*>(measurement.get());
@@ -132,16 +143,9 @@ public:
     }
     const Eigen::Matrix<double, 3, 3> R_meas = R_meas_dyn;
 
-    const int size_of_core_state = CoreStateType::size_error_;
-    const int size_of_sensor_state = prior_sensor_state.cov_size_;
-    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
-    const Eigen::MatrixXd P = prior_cov;
-    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
-
     // Calculate the measurement jacobian H
     const Eigen::Matrix3d I_3 = Eigen::Matrix3d::Identity();
     const Eigen::Vector3d P_wi = prior_core_state.p_wi_;
-    const Eigen::Matrix3d R_wi = prior_core_state.q_wi_.toRotationMatrix();
     const Eigen::Vector3d P_ip = prior_sensor_state.p_ip_;
 
     // Position
@@ -163,6 +167,31 @@ public:
     const Eigen::Vector3d p_est = P_wi + R_wi * P_ip;
     const Eigen::Vector3d res = p_meas - p_est;
 
+    *H_out = H;
+    *R_out = R_meas;
+    *res_out = res;
+
+    return true;
+  }
+
+  bool CalcUpdate(const Time& timestamp, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
+                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
+                  BufferDataType* new_state_data)
+  {
+    PositionSensorData* prior_sensor_data = static_cast<PositionSensorData*>(latest_sensor_data.get());
+
+    const int size_of_core_state = CoreStateType::size_error_;
+    const int size_of_sensor_state = prior_sensor_data->state_.cov_size_;
+    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
+    const Eigen::MatrixXd P = prior_cov;
+    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
+
+    Eigen::MatrixXd H;
+    Eigen::MatrixXd R_meas;
+    Eigen::MatrixXd res;
+    CalcMeasurementModel(timestamp, measurement, prior_core_state, prior_core_state.q_wi_.toRotationMatrix(),
+                         latest_sensor_data, &H, &R_meas, &res);
+
     // Perform EKF calculations
     mars::Ekf ekf(H, R_meas, res, P);
     const Eigen::MatrixXd correction = ekf.CalculateCorrection(&chi2_);
@@ -183,10 +212,6 @@ public:
     CoreStateVector core_correction = correction.block(0, 0, CoreStateType::size_error_, 1);
     CoreStateType corrected_core_state = CoreStateType::ApplyCorrection(prior_core_state, core_correction);
 
-    // Apply Sensor Correction
-    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
-    const PositionSensorStateType corrected_sensor_state = ApplyCorrection(prior_sensor_state, sensor_correction);
-
     // Return Results
     // CoreState data
     CoreType core_data;
@@ -194,9 +219,8 @@ public:
     core_data.state_ = corrected_core_state;
 
     // SensorState data
-    std::shared_ptr<PositionSensorData> sensor_data(std::make_shared<PositionSensorData>());
-    sensor_data->set_cov(P_updated);
-    sensor_data->state_ = corrected_sensor_state;
+    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
+    std::shared_ptr<void> sensor_data = CalcCorrectedSensorData(latest_sensor_data, sensor_correction, P_updated);
 
     BufferDataType state_entry(std::make_shared<CoreType>(core_data), sensor_data);
 
@@ -214,6 +238,17 @@ public:
     return true;
   }
 
+  std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> latest_sensor_data,
+                                                const Eigen::MatrixXd& correction, const Eigen::MatrixXd& cov)
+  {
+    PositionSensorData* prior_sensor_data = static_cast<PositionSensorData*>(latest_sensor_data.get());
+
+    std::shared_ptr<PositionSensorData> sensor_data(std::make_shared<PositionSensorData>());
+    sensor_data->set_cov(cov);
+    sensor_data->state_ = ApplyCorrection(prior_sensor_data->state_, correction);
+    return sensor_data;
+  }
+
   PositionSensorStateType ApplyCorrection(const PositionSensorStateType& prior_sensor_state,
                                           const Eigen::MatrixXd& correction)
   {
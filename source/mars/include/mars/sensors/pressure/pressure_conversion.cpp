@@ -9,6 +9,8 @@
 // You can contact the author at <martin.scheiber@aau.at>
 
 #include "pressure_conversion.h"
+#include <algorithm>
+#include <cmath>
 
 namespace mars
 {
@@ -53,10 +55,46 @@ void PressureConversion::set_pressure_reference(Pressure pressure)
   // set pressure reference
   reference_ = pressure;
   medium_options_.update_constants(reference_);
+  ln_P0Psl_ = std::log(reference_.data_) - medium_options_.ln_Psl;
   reference_is_set_ = true;
   medium_options_.PrintGasOptions();
 }
 
+int PressureConversion::set_fast_height(const double& max_error, const double& max_relative_offset)
+{
+  fast_height_terms_ = 0;
+  if (max_error <= 0)
+  {
+    return 0;
+  }
+
+  fast_height_max_offset_ = std::min(std::max(max_relative_offset, 0.0), 0.5);
+  for (int k = 0; k < kFastHeightMaxTerms; k++)
+  {
+    fast_height_coeffs_[k] = 1.0 / (2 * k + 1);
+  }
+
+  // The remainder of the atanh series after n terms is bounded by 2 u^(2n+1) / ((2n+1) (1 - u^2)), the largest |u|
+  // is reached at the lower pressure bound
+  const double u_max = fast_height_max_offset_ / (2 - fast_height_max_offset_);
+  const double height_per_ln = medium_options_.rOverMg * kFastHeightMaxTemperatureK;
+
+  for (int n = 1; n <= kFastHeightMaxTerms; n++)
+  {
+    const double remainder = 2 * std::pow(u_max, 2 * n + 1) / ((2 * n + 1) * (1 - u_max * u_max));
+    if (height_per_ln * remainder <= max_error)
+    {
+      fast_height_terms_ = n;
+      return n;
+    }
+  }
+
+  std::cout << "Warning: [PressureConversion] Fast height error bound can not be reached, using "
+            << kFastHeightMaxTerms << " terms" << std::endl;
+  fast_height_terms_ = kFastHeightMaxTerms;
+  return fast_height_terms_;
+}
+
 PressureConversion::Matrix1d PressureConversion::get_height(Pressure pressure)
 {
   switch (pressure.type_)
@@ -80,7 +118,54 @@ double PressureConversion::get_height_liquid(const Pressure& pressure)
 
 double PressureConversion::get_height_gas(const Pressure& pressure)
 {
+  return get_height_gas(pressure.data_, pressure.temperature_K_);
+}
+
+double PressureConversion::get_height_gas(const double& pressure, const double& temperature_K) const
+{
+  const double p_0 = reference_.data_;
+
+  if (fast_height_terms_ > 0 && std::abs(pressure - p_0) <= fast_height_max_offset_ * p_0)
+  {
+    // ln(p / p_0) = 2 atanh(u) = 2 (u + u^3 / 3 + u^5 / 5 + ...)
+    const double u = (pressure - p_0) / (pressure + p_0);
+    const double u2 = u * u;
+
+    double series = fast_height_coeffs_[fast_height_terms_ - 1];
+    for (int k = fast_height_terms_ - 2; k >= 0; k--)
+    {
+      series = series * u2 + fast_height_coeffs_[k];
+    }
+
+    return medium_options_.rOverMg * (medium_options_.ln_P0PslT - (ln_P0Psl_ + 2 * u * series) * temperature_K);
+  }
+
   return medium_options_.rOverMg *
-         (medium_options_.ln_P0PslT - (std::log(pressure.data_) - medium_options_.ln_Psl) * pressure.temperature_K_);
+         (medium_options_.ln_P0PslT - (std::log(pressure) - medium_options_.ln_Psl) * temperature_K);
+}
+
+void PressureConversion::get_height_batch(const Eigen::ArrayXd& pressure, const Eigen::ArrayXd& temperature_K,
+                                          const Pressure::Type& type, Eigen::ArrayXd* height)
+{
+  switch (type)
+  {
+    case mars::Pressure::Type::LIQUID:
+      *height = medium_options_.OneOverGRho * pressure;
+      break;
+    case mars::Pressure::Type::GAS:
+      height->resize(pressure.size());
+      for (Eigen::Index k = 0; k < pressure.size(); k++)
+      {
+        (*height)(k) = get_height_gas(pressure(k), temperature_K(k));
+      }
+      break;
+    case mars::Pressure::Type::HEIGHT:
+      *height = pressure;
+      break;
+    default:
+      std::cout << "Error: [PressureConversion] Cannot return height (unknown type)" << std::endl;
+      *height = Eigen::ArrayXd::Constant(pressure.size(), -1);
+      break;
+  }
 }
 }  // namespace mars
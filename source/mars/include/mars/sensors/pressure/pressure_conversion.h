@@ -12,6 +12,7 @@
 #define PRESSURECONVERSION_H
 
 #include <Eigen/Dense>
+#include <array>
 #include <iostream>
 
 namespace mars
@@ -80,16 +81,16 @@ struct MediumPressureOptions
     set_constants();
   }
 
-  // general constants
-  const double g{ 9.80665 };  //!< gravity constant [m/s^2]
+  // general constants, not const such that the options and the PressureConversion are assignable
+  double g{ 9.80665 };  //!< gravity constant [m/s^2]
 
   // gas constants
-  const double P_sl{ 101325 };  //!< (gas) pressure at sealevel [Pascal]
-  const double M{ 0.0289644 };  //!< (gas) [Kg*mol]
-  const double r{ 8.31432 };    //!< (gas) [Nm/mol*K]
+  double P_sl{ 101325 };  //!< (gas) pressure at sealevel [Pascal]
+  double M{ 0.0289644 };  //!< (gas) [Kg*mol]
+  double r{ 8.31432 };    //!< (gas) [Nm/mol*K]
 
   // liquid constants
-  const double rho{ 997 };  //!< (liquid) density of the medium [kg/m^2]
+  double rho{ 997 };  //!< (liquid) density of the medium [kg/m^2]
 
   // gas variables
   double rOverMg;
@@ -133,21 +134,55 @@ class PressureConversion
 public:
   typedef Eigen::Matrix<double, 1, 1> Matrix1d;
 
+  static constexpr double kFastHeightMaxTemperatureK = 350;  ///< Temperature bound of the fast height error [K]
+  static constexpr int kFastHeightMaxTerms = 12;             ///< Maximum number of series terms of the fast height
+
   PressureConversion() = default;
   PressureConversion(Pressure pressure) : PressureConversion(pressure, MediumPressureOptions()){};
   PressureConversion(Pressure pressure, MediumPressureOptions gas_options);
 
   void set_pressure_reference(Pressure pressure);
 
+  ///
+  /// \brief set_fast_height Enables the polynomial approximation of the gas height conversion
+  ///
+  /// The logarithm is expanded around the reference pressure p_0 as ln(p) = ln(p_0) + 2 atanh(u) with
+  /// u = (p - p_0) / (p + p_0). The odd series of atanh is truncated after the smallest number of terms that keeps the
+  /// height error below max_error for pressures within max_relative_offset of p_0 and temperatures up to
+  /// kFastHeightMaxTemperatureK. Pressures outside of this range are converted with the exact formula.
+  ///
+  /// \param max_error Maximum height error [m], zero or negative disables the approximation
+  /// \param max_relative_offset Operating range |p - p_0| / p_0, limited to [0, 0.5]
+  /// \return Number of series terms, zero if the approximation is disabled
+  ///
+  int set_fast_height(const double& max_error, const double& max_relative_offset = 0.2);
+
   Matrix1d get_height(Pressure pressure);
 
+  ///
+  /// \brief get_height_batch Converts arrays of pressure measurements of the same type to heights
+  /// \param pressure Pressure [Pa], or height [m] for Pressure::Type::HEIGHT
+  /// \param temperature_K Temperature [K], only used for Pressure::Type::GAS
+  /// \param type Type of all measurements
+  /// \param height Height [m] of each measurement
+  ///
+  void get_height_batch(const Eigen::ArrayXd& pressure, const Eigen::ArrayXd& temperature_K, const Pressure::Type& type,
+                        Eigen::ArrayXd* height);
+
 private:
   Pressure reference_;
   MediumPressureOptions medium_options_;
   bool reference_is_set_{ false };
 
+  int fast_height_terms_{ 0 };          ///< Number of atanh series terms, zero if disabled
+  double fast_height_max_offset_{ 0 };  ///< Maximum relative pressure offset of the approximation
+  double ln_P0Psl_{ 0 };                ///< ln(p_0) - ln(P_sl)
+
+  std::array<double, kFastHeightMaxTerms> fast_height_coeffs_{};  ///< Series coefficients 1 / (2k + 1)
+
   double get_height_liquid(const Pressure& pressure);
   double get_height_gas(const Pressure& pressure);
+  double get_height_gas(const double& pressure, const double& temperature_K) const;
 };
 
 }  // namespace mars
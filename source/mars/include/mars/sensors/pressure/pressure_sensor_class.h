@@ -93,6 +93,23 @@ public:
     }
   }
 
+  std::shared_ptr<void> SaveState() const
+  {
+    std::shared_ptr<PressureSensorState> state = std::make_shared<PressureSensorState>();
+    state->base_state_ = UpdateSensorAbsClass::SaveState();
+    state->pressure_conversion_ = pressure_conversion_;
+    state->pressure_reference_is_set_ = pressure_reference_is_set_;
+    return state;
+  }
+
+  void RestoreState(const std::shared_ptr<void>& state)
+  {
+    const PressureSensorState& pressure_sensor_state = *static_cast<PressureSensorState*>(state.get());
+    UpdateSensorAbsClass::RestoreState(pressure_sensor_state.base_state_);
+    pressure_conversion_ = pressure_sensor_state.pressure_conversion_;
+    pressure_reference_is_set_ = pressure_sensor_state.pressure_reference_is_set_;
+  }
+
   BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> sensor_data,
                             std::shared_ptr<CoreType> latest_core_data)
   {
@@ -272,6 +289,14 @@ public:
 
     return corrected_sensor_state;
   }
+
+private:
+  struct PressureSensorState
+  {
+    std::shared_ptr<void> base_state_;
+    PressureConversion pressure_conversion_;
+    bool pressure_reference_is_set_;
+  };
 };
 }  // namespace mars
 
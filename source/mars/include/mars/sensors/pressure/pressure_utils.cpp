@@ -9,6 +9,8 @@
 // You can contact the author at <martin.scheiber@aau.at>
 
 #include "mars/sensors/pressure/pressure_utils.h"
+#include <cmath>
+#include <iostream>
 
 // new stuff
 
@@ -19,11 +21,49 @@ mars::PressureInit::PressureInit(const double& init_duration) : init_duration_(i
 void mars::PressureInit::Reset()
 {
   b_is_initialized_ = false;
+  has_measurement_ = false;
+  bins_.fill(Bin());
 }
 
-mars::Pressure mars::PressureInit::get_press_mean(const std::shared_ptr<mars::SensorAbsClass>& sensor_handle,
-                                                  const mars::Buffer& buffer, const mars::Pressure& cur_meas,
-                                                  const mars::Time& cur_time)
+int64_t mars::PressureInit::get_bin_index(const mars::Time& time) const
+{
+  return static_cast<int64_t>(std::floor(time.get_seconds() * kNumBins / init_duration_));
+}
+
+void mars::PressureInit::AddMeasurement(const mars::Pressure& meas, const mars::Time& time)
+{
+  if (!has_measurement_ || time < first_time_)
+  {
+    first_time_ = time;
+    has_measurement_ = true;
+  }
+
+  if (init_duration_ <= 0.0)
+  {
+    return;
+  }
+
+  const int64_t index = get_bin_index(time);
+  Bin& bin = bins_[static_cast<size_t>(((index % (kNumBins + 1)) + (kNumBins + 1)) % (kNumBins + 1))];
+
+  if (bin.index_ > index)
+  {
+    // Older than the window of a later measurement
+    return;
+  }
+
+  if (bin.index_ < index)
+  {
+    bin = Bin();
+    bin.index_ = index;
+  }
+
+  bin.data_sum_ += meas.data_;
+  bin.temperature_sum_ += meas.temperature_K_;
+  bin.count_++;
+}
+
+mars::Pressure mars::PressureInit::get_press_mean(const mars::Pressure& cur_meas, const mars::Time& cur_time)
 {
   if (b_verbose_)
   {
@@ -38,37 +78,35 @@ mars::Pressure mars::PressureInit::get_press_mean(const std::shared_ptr<mars::Se
     return cur_meas;
   }
 
-  // get ordered values from buffer
-  std::vector<const mars::BufferEntryType*> pressure_entries;
-  buffer.get_sensor_handle_measurements(sensor_handle, &pressure_entries);
+  if (init_duration_ == 0.0)
+  {
+    b_is_initialized_ = true;
+    return cur_meas;
+  }
+
+  AddMeasurement(cur_meas, cur_time);
 
   // check if enough measurements where recorded
-  if (pressure_entries.empty() || (cur_time - pressure_entries.at(0)->timestamp_).get_seconds() < init_duration_)
+  if ((cur_time - first_time_).get_seconds() < init_duration_)
   {
     if (b_verbose_)
     {
-      std::cout << "[PressureInit]: could not init sensor (empty? " << pressure_entries.empty() << ")" << std::endl;
+      std::cout << "[PressureInit]: could not init sensor, window not filled" << std::endl;
     }
     return cur_meas;
   }
 
-  // calcualte average pressure/height
-  Pressure avg_pressure = cur_meas;
-  uint cnt_meas = 1;
-  for (std::vector<const mars::BufferEntryType*>::reverse_iterator it = pressure_entries.rbegin();
-       it != pressure_entries.rend(); ++it)
+  // calcualte average pressure/height of the bins within the window
+  const int64_t cur_index = get_bin_index(cur_time);
+  Pressure avg_pressure(0, 0, cur_meas.type_);
+  int cnt_meas = 0;
+  for (const auto& k : bins_)
   {
-    if ((cur_time - (*it)->timestamp_).get_seconds() <= init_duration_)
-    {
-      const PressureMeasurementType meas = *static_cast<PressureMeasurementType*>((*it)->data_.sensor_.get());
-
-      avg_pressure += meas.pressure_;
-      cnt_meas++;
-    }
-    else
+    if (k.index_ >= cur_index - kNumBins && k.index_ <= cur_index)
     {
-      // in this case all other entries will not fullfill requirement of buffer so break early
-      break;
+      avg_pressure.data_ += k.data_sum_;
+      avg_pressure.temperature_K_ += k.temperature_sum_;
+      cnt_meas += k.count_;
     }
   }
 
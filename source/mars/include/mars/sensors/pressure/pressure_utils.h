@@ -11,28 +11,71 @@
 #ifndef PRESSURE_UTILS_H
 #define PRESSURE_UTILS_H
 
-#include <mars/buffer.h>
 #include <mars/sensors/pressure/pressure_conversion.h>
-#include <mars/sensors/pressure/pressure_measurement_type.h>
-#include <mars/sensors/sensor_abs_class.h>
+#include <mars/time.h>
+#include <array>
+#include <cstdint>
 
 namespace mars
 {
+///
+/// \brief The PressureInit class averages the pressure measurements of the initialization window
+///
+/// Measurements are accumulated on arrival in kNumBins time bins of init_duration / kNumBins each. The mean covers
+/// the bins that overlap the window [cur_time - init_duration, cur_time], measurements up to one bin width older than
+/// the init duration are therefore included. Adding a measurement and computing the mean is independent of the
+/// measurement rate and the init duration.
+///
 class PressureInit
 {
 private:
+  static constexpr int kNumBins = 16;
+
+  ///
+  /// \brief The Bin struct holds the sums of the measurements within one bin of the window
+  ///
+  struct Bin
+  {
+    int64_t index_{ -1 };  ///< Time index of the bin, time / bin width
+    double data_sum_{ 0 };
+    double temperature_sum_{ 0 };
+    int count_{ 0 };
+  };
+
   double init_duration_{ 1.0 };
   bool b_is_initialized_{ false };
   bool b_verbose_{ false };
 
+  std::array<Bin, kNumBins + 1> bins_;  ///< Ring of the bins of the window and the current bin
+  Time first_time_{ 0.0 };              ///< Timestamp of the first measurement
+  bool has_measurement_{ false };
+
+  int64_t get_bin_index(const Time& time) const;
+
 public:
   PressureInit() = default;
   PressureInit(const double& init_duration);
 
   void Reset();
 
-  Pressure get_press_mean(const std::shared_ptr<SensorAbsClass>& sensor_handle, const Buffer& buffer,
-                          const Pressure& cur_meas, const Time& cur_time);
+  ///
+  /// \brief AddMeasurement Adds a measurement to the window accumulator
+  ///
+  /// Measurements older than the window of the latest measurement are ignored.
+  ///
+  void AddMeasurement(const Pressure& meas, const Time& time);
+
+  ///
+  /// \brief get_press_mean Adds the current measurement and returns the mean of the window
+  ///
+  /// The initialization is done once the measurements cover the init duration. Until then the current measurement is
+  /// returned.
+  ///
+  /// \param cur_meas Current measurement
+  /// \param cur_time Timestamp of the current measurement
+  /// \return Mean pressure of the window, or cur_meas if the initialization is not done
+  ///
+  Pressure get_press_mean(const Pressure& cur_meas, const Time& cur_time);
 
   bool IsDone();
 };  // class PressureInit
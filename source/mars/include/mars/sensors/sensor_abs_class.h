@@ -12,6 +12,7 @@
 #define SENSORABSCLASS_H
 
 #include <mars/sensors/sensor_interface.h>
+#include <memory>
 #include <string>
 
 namespace mars
@@ -20,9 +21,32 @@ class SensorAbsClass : public SensorInterface
 {
 public:
   int id_{ -1 };
-  std::string name_;              ///< Name of the individual sensor instance
-  bool is_initialized_{ false };  ///< True if the sensor has been initialized
+  std::string name_;                     ///< Name of the individual sensor instance
+  bool is_initialized_{ false };         ///< True if the sensor has been initialized
+  bool incremental_cross_cov_{ false };  ///< The CoreLogic keeps the core-sensor cross-covariance current at each
+                                         ///< propagation step instead of propagating it on the next update
   int type_{ -1 };  ///< Future feature, holds information such as position or orientation for highlevel decissions
+
+  ///
+  /// \brief SaveState Copies the members of the sensor instance that change while measurements are processed
+  ///
+  /// Used if a sensor instance is shared between filter instances, e.g. by the FilterBank or the StateHistory. Derived
+  /// classes with additional members of this kind extend the state of their base class.
+  ///
+  /// \return State that can be passed to RestoreState of the same sensor instance
+  ///
+  virtual std::shared_ptr<void> SaveState() const
+  {
+    return std::make_shared<bool>(is_initialized_);
+  }
+
+  ///
+  /// \brief RestoreState Sets the members of the sensor instance to a state returned by SaveState
+  ///
+  virtual void RestoreState(const std::shared_ptr<void>& state)
+  {
+    is_initialized_ = *static_cast<bool*>(state.get());
+  }
 };
 }  // namespace mars
 #endif  // SENSORABSCLASS_H
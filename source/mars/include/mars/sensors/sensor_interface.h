@@ -16,6 +16,7 @@
 #include <mars/type_definitions/core_type.h>
 #include <Eigen/Dense>
 #include <memory>
+#include <vector>
 
 namespace mars
 {
@@ -63,6 +64,70 @@ public:
   ///
   virtual Eigen::MatrixXd get_covariance(const std::shared_ptr<void>& sensor_data) = 0;
 
+  ///
+  /// \brief get_state_vector Resolves a void pointer to the state values of the corresponding sensor type
+  /// \param sensor_data
+  /// \return State values in the order of the csv export of the sensor state, empty if not provided by the sensor
+  ///
+  virtual Eigen::VectorXd get_state_vector(const std::shared_ptr<void>& /*sensor_data*/)
+  {
+    return Eigen::VectorXd();
+  }
+
+  ///
+  /// \brief PreprocessMeasurements Prepares a batch of measurements of this sensor before they are processed
+  ///
+  /// Sensors can use this to replace per measurement work in CalcUpdate with vectorized conversions of the batch.
+  ///
+  /// \param measurements Measurements of this sensor in the order of processing
+  ///
+  virtual void PreprocessMeasurements(const std::vector<std::shared_ptr<void>>& /*measurements*/)
+  {
+  }
+
+  ///
+  /// \brief SupportsStackedUpdate Determines if the sensor can be part of a stacked update of several sensors
+  /// \return True if CalcMeasurementModel and CalcCorrectedSensorData are implemented and can be used
+  ///
+  virtual bool SupportsStackedUpdate() const
+  {
+    return false;
+  }
+
+  ///
+  /// \brief CalcMeasurementModel Calculates the linearized measurement model of an individual sensor definition
+  /// \param timestamp current timestamp
+  /// \param measurement current sensor measurement
+  /// \param prior_core_state_data
+  /// \param R_wi Rotation matrix of the orientation of prior_core_state_data, shared by the sensors of a stacked update
+  /// \param latest_sensor_data
+  /// \param H Measurement jacobian with respect to the core and the sensor error state
+  /// \param R Measurement noise
+  /// \param res Residual
+  /// \return True if the model was calculated
+  ///
+  virtual bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> /*measurement*/,
+                                    const CoreStateType& /*prior_core_state_data*/, const Eigen::Matrix3d& /*R_wi*/,
+                                    std::shared_ptr<void> /*latest_sensor_data*/, Eigen::MatrixXd* /*H*/,
+                                    Eigen::MatrixXd* /*R*/, Eigen::MatrixXd* /*res*/)
+  {
+    return false;
+  }
+
+  ///
+  /// \brief CalcCorrectedSensorData Applies an error state correction to the sensor state
+  /// \param latest_sensor_data
+  /// \param correction Correction of the sensor error state
+  /// \param cov Updated covariance containing core, sensor and sensor cross covariance
+  /// \return Corrected sensor data, nullptr if not supported
+  ///
+  virtual std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> /*latest_sensor_data*/,
+                                                        const Eigen::MatrixXd& /*correction*/,
+                                                        const Eigen::MatrixXd& /*cov*/)
+  {
+    return nullptr;
+  }
+
 protected:
   // SensorInterface(); // construction for child classes only
 };
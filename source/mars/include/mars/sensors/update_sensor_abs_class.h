@@ -13,11 +13,13 @@
 
 #include <mars/core_state.h>
 #include <mars/ekf.h>
+#include <mars/sensors/auto_calibration.h>
 #include <mars/sensors/sensor_abs_class.h>
 #include <mars/sensors/sensor_interface.h>
 #include <mars/type_definitions/base_states.h>
 
 #include <Eigen/Dense>
+#include <memory>
 
 namespace mars
 {
@@ -40,9 +42,36 @@ public:
   bool const_ref_to_nav_{ true };         ///< True if the reference should not be estimated
   bool use_dynamic_meas_noise_{ false };  ///< True if dynamic noise values from measurements should be used
 
+  AutoCalibration auto_calib_;  ///< Closed-form calibration refinement, used if no initial calibration was provided
+
   Chi2 chi2_;
 
   std::shared_ptr<CoreState> core_states_;
+
+  std::shared_ptr<void> SaveState() const
+  {
+    std::shared_ptr<UpdateSensorState> state = std::make_shared<UpdateSensorState>();
+    state->base_state_ = SensorAbsClass::SaveState();
+    state->chi2_ = chi2_;
+    state->auto_calib_ = auto_calib_;
+    return state;
+  }
+
+  void RestoreState(const std::shared_ptr<void>& state)
+  {
+    const UpdateSensorState& update_state = *static_cast<UpdateSensorState*>(state.get());
+    SensorAbsClass::RestoreState(update_state.base_state_);
+    chi2_ = update_state.chi2_;
+    auto_calib_ = update_state.auto_calib_;
+  }
+
+private:
+  struct UpdateSensorState
+  {
+    std::shared_ptr<void> base_state_;
+    Chi2 chi2_;
+    AutoCalibration auto_calib_;
+  };
 };
 }  // namespace mars
 
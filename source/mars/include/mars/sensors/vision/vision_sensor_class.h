@@ -27,6 +27,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mars
 {
@@ -39,6 +40,10 @@ public:
 
   bool update_scale_{ true };
 
+  double auto_calib_p_ic_std_{ 0.1 };               ///< Std [m] of p_ic, assumed zero by the auto calibration
+  double auto_calib_r_ic_std_{ 10 * M_PI / 180 };  ///< Std [rad] of q_ic, assumed identity by the auto calibration
+  double auto_calib_lambda_std_{ 0.1 };            ///< Std of lambda, assumed one by the auto calibration
+
   VisionSensorClass(const std::string& name, std::shared_ptr<CoreState> core_states, bool update_scale = true)
   {
     name_ = name;
@@ -73,13 +78,14 @@ public:
     initial_calib_provided_ = true;
   }
 
-  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> /*sensor_data*/,
+  BufferDataType Initialize(const Time& timestamp, std::shared_ptr<void> sensor_data,
                             std::shared_ptr<CoreType> latest_core_data)
   {
-    // VisionMeasurementType measurement = *static_cast<VisionMeasurementType*>(sensor_data.get());
+    VisionMeasurementType measurement = *static_cast<VisionMeasurementType*>(sensor_data.get());
 
     VisionSensorData sensor_state;
     std::string calibration_type;
+    bool calibration_complete = true;
 
     if (this->initial_calib_provided_)
     {
@@ -93,36 +99,18 @@ public:
     else
     {
       calibration_type = "Auto";
-
-      //      Eigen::Vector3d p_wp(measurement.position_);
-      //      Eigen::Quaterniond q_wp(measurement.orientation_);
-
-      //      Eigen::Vector3d p_wi(latest_core_data->state_.p_wi_);
-      //      Eigen::Quaterniond q_wi(latest_core_data->state_.q_wi_);
-      //      Eigen::Matrix3d r_wi(q_wi.toRotationMatrix());
-
-      //      Eigen::Vector3d p_ip = r_wi.transpose() * (p_wp - p_wi);
-      //      Eigen::Quaterniond q_ip = q_wi.conjugate() * q_wp;
-
-      //      // Calibration, position / rotation imu-pose
-      //      sensor_state.state_.p_vw_ = p_ip;
-      //      sensor_state.state_.q_vw_ = q_ip;
-      //      sensor_state.state_.p_ic_ = p_ip;
-      //      sensor_state.state_.q_ic_ = q_ip;
-      //      sensor_state.state_.lambda_ = 1;
-
-      //      // The covariance should enclose the initialization with a 3 Sigma bound
-      //      Eigen::Matrix<double, 13, 1> std;
-      //      std << 1, 1, 1, (35 * M_PI / 180), (35 * M_PI / 180), (35 * M_PI / 180);
-      //      sensor_state.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
-      std::cout << "Vision calibration AUTO init not implemented yet" << std::endl;
-      exit(EXIT_FAILURE);
+      calibration_complete = CalcAutoCalibration(timestamp, measurement, *latest_core_data, &sensor_state);
     }
 
     // Bypass core state for the returned object
     BufferDataType result(std::make_shared<CoreType>(*latest_core_data.get()),
                           std::make_shared<VisionSensorData>(sensor_state));
 
+    if (!calibration_complete)
+    {
+      return result;
+    }
+
     is_initialized_ = true;
 
     std::cout << "Info: Initialized [" << name_ << "] with [" << calibration_type << "] Calibration at t=" << timestamp
@@ -145,9 +133,82 @@ public:
     return result;
   }
 
-  bool CalcUpdate(const Time& /*timestamp*/, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
-                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
-                  BufferDataType* new_state_data)
+  ///
+  /// \brief CalcAutoCalibration Closed-form calibration from a measurement and the core state
+  ///
+  /// A single measurement does not separate q_vw from q_ic and p_vw from p_ic. The camera is assumed at the IMU with a
+  /// unit scale (p_ic = 0, q_ic = I, lambda = 1), which gives q_vw = q_vc q_wi^-1 and p_vw = p_vc - R_vw p_wi. The
+  /// assumed states enter the covariance with the auto_calib_*_std_ values, the filter estimates them online.
+  ///
+  /// \return True if the refinement over auto_calib_.refine_duration_ is complete
+  ///
+  bool CalcAutoCalibration(const Time& timestamp, const VisionMeasurementType& measurement, const CoreType& core_data,
+                           VisionSensorData* sensor_data)
+  {
+    const CoreStateType& core_state = core_data.state_;
+    const Eigen::Vector3d P_wi = core_state.p_wi_;
+    const Eigen::Matrix3d R_wi = core_state.q_wi_.toRotationMatrix();
+
+    VisionSensorStateType& state = sensor_data->state_;
+    state.p_ic_.setZero();
+    state.q_ic_.setIdentity();
+    state.lambda_ = 1;
+
+    const Eigen::Quaterniond q_vw = measurement.orientation_ * state.q_ic_.conjugate() * core_state.q_wi_.conjugate();
+    Eigen::VectorXd vectors =
+        measurement.position_ / state.lambda_ - q_vw.toRotationMatrix() * (P_wi + R_wi * state.p_ic_);
+    std::vector<Eigen::Quaterniond> rotations{ q_vw };
+    const bool complete = auto_calib_.Refine(timestamp, &vectors, &rotations);
+
+    state.p_vw_ = vectors;
+    state.q_vw_ = rotations[0];
+
+    // Jacobians with respect to the core error state and the noise [p_meas r_meas p_ic r_ic lambda]
+    const Eigen::Vector3d P_ic = state.p_ic_;
+    const Eigen::Matrix3d R_ic = state.q_ic_.toRotationMatrix();
+    const Eigen::Matrix3d R_vw = state.q_vw_.toRotationMatrix();
+    const double L = state.lambda_;
+    const Eigen::Matrix3d S_vw = R_vw * Utils::Skew(P_wi + R_wi * P_ic);
+
+    Eigen::MatrixXd J_core = Eigen::MatrixXd::Zero(13, CoreStateType::size_error_);
+    J_core.block(0, 0, 3, 3) = -R_vw;
+    J_core.block(0, 6, 3, 3) = -S_vw * R_wi + R_vw * R_wi * Utils::Skew(P_ic);
+    J_core.block(3, 6, 3, 3) = -R_wi;
+
+    Eigen::MatrixXd J_noise = Eigen::MatrixXd::Zero(13, 13);
+    J_noise.block(0, 0, 3, 3) = Eigen::Matrix3d::Identity() / L;
+    J_noise.block(0, 3, 3, 3) = S_vw * R_wi * R_ic;
+    J_noise.block(0, 6, 3, 3) = -R_vw * R_wi;
+    J_noise.block(0, 9, 3, 3) = -S_vw * R_wi * R_ic;
+    J_noise.block(0, 12, 3, 1) = -measurement.position_ / (L * L);
+    J_noise.block(3, 3, 3, 3) = R_wi * R_ic;
+    J_noise.block(3, 9, 3, 3) = -R_wi * R_ic;
+    J_noise.block(6, 6, 7, 7).setIdentity();
+
+    Eigen::VectorXd noise_var = Eigen::VectorXd::Zero(13);
+    if (R_.size() == 6)
+    {
+      noise_var.head(6) = R_;
+    }
+    noise_var.segment(6, 3).setConstant(auto_calib_p_ic_std_ * auto_calib_p_ic_std_);
+    noise_var.segment(9, 3).setConstant(auto_calib_r_ic_std_ * auto_calib_r_ic_std_);
+    noise_var(12) = auto_calib_lambda_std_ * auto_calib_lambda_std_;
+
+    AutoCalibration::PropagateCovariance(core_data.cov_, J_core, Eigen::MatrixXd(noise_var.asDiagonal()), J_noise,
+                                         &sensor_data->sensor_cov_, &sensor_data->core_sensor_cross_cov_);
+
+    return complete;
+  }
+
+  bool SupportsStackedUpdate() const
+  {
+    return !chi2_.do_test_;
+  }
+
+  bool CalcMeasurementModel(const Time& /*timestamp*/, std::shared_ptr<void> measurement,
+                            const CoreStateType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                            std::shared_ptr<void> latest_sensor_data, Eigen::MatrixXd* H_out, Eigen::MatrixXd* R_out,
+                            Eigen::MatrixXd* res_out)
   {
     // Cast the sensor measurement and prior state information
     VisionMeasurementType* meas = static_cast<VisionMeasurementType*>(measurement.get());
@@ -173,16 +234,9 @@ public:
     }
     const Eigen::Matrix<double, 6, 6> R_meas = R_meas_dyn;
 
-    const int size_of_core_state = CoreStateType::size_error_;
-    const int size_of_sensor_state = prior_sensor_state.cov_size_;
-    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
-    const Eigen::MatrixXd P = prior_cov;
-    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
-
     // Calculate the measurement jacobian H
     const Eigen::Matrix3d I_3 = Eigen::Matrix3d::Identity();
     const Eigen::Vector3d P_wi = prior_core_state.p_wi_;
-    const Eigen::Matrix3d R_wi = prior_core_state.q_wi_.toRotationMatrix();
     const Eigen::Vector3d P_vw = prior_sensor_state.p_vw_;
     const Eigen::Matrix3d R_vw = prior_sensor_state.q_vw_.toRotationMatrix();
     const Eigen::Vector3d P_ic = prior_sensor_state.p_ic_;
@@ -254,6 +308,31 @@ public:
     Eigen::MatrixXd res(res_p.rows() + res_r.rows(), 1);
     res << res_p, res_r;
 
+    *H_out = H;
+    *R_out = R_meas;
+    *res_out = res;
+
+    return true;
+  }
+
+  bool CalcUpdate(const Time& timestamp, std::shared_ptr<void> measurement, const CoreStateType& prior_core_state,
+                  std::shared_ptr<void> latest_sensor_data, const Eigen::MatrixXd& prior_cov,
+                  BufferDataType* new_state_data)
+  {
+    VisionSensorData* prior_sensor_data = static_cast<VisionSensorData*>(latest_sensor_data.get());
+
+    const int size_of_core_state = CoreStateType::size_error_;
+    const int size_of_sensor_state = prior_sensor_data->state_.cov_size_;
+    const int size_of_full_error_state = size_of_core_state + size_of_sensor_state;
+    const Eigen::MatrixXd P = prior_cov;
+    assert(P.size() == size_of_full_error_state * size_of_full_error_state);
+
+    Eigen::MatrixXd H;
+    Eigen::MatrixXd R_meas;
+    Eigen::MatrixXd res;
+    CalcMeasurementModel(timestamp, measurement, prior_core_state, prior_core_state.q_wi_.toRotationMatrix(),
+                         latest_sensor_data, &H, &R_meas, &res);
+
     // Perform EKF calculations
     mars::Ekf ekf(H, R_meas, res, P);
     const Eigen::MatrixXd correction = ekf.CalculateCorrection(&chi2_);
@@ -274,10 +353,6 @@ public:
     CoreStateVector core_correction = correction.block(0, 0, CoreStateType::size_error_, 1);
     CoreStateType corrected_core_state = CoreStateType::ApplyCorrection(prior_core_state, core_correction);
 
-    // Apply Sensor Correction
-    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
-    const VisionSensorStateType corrected_sensor_state = ApplyCorrection(prior_sensor_state, sensor_correction);
-
     // Return Results
     // CoreState data
     CoreType core_data;
@@ -285,9 +360,8 @@ public:
     core_data.state_ = corrected_core_state;
 
     // SensorState data
-    std::shared_ptr<VisionSensorData> sensor_data(std::make_shared<VisionSensorData>());
-    sensor_data->set_cov(P_updated);
-    sensor_data->state_ = corrected_sensor_state;
+    const Eigen::MatrixXd sensor_correction = correction.block(size_of_core_state, 0, size_of_sensor_state, 1);
+    std::shared_ptr<void> sensor_data = CalcCorrectedSensorData(latest_sensor_data, sensor_correction, P_updated);
 
     BufferDataType state_entry(std::make_shared<CoreType>(core_data), sensor_data);
 
@@ -305,6 +379,17 @@ public:
     return true;
   }
 
+  std::shared_ptr<void> CalcCorrectedSensorData(std::shared_ptr<void> latest_sensor_data,
+                                                const Eigen::MatrixXd& correction, const Eigen::MatrixXd& cov)
+  {
+    VisionSensorData* prior_sensor_data = static_cast<VisionSensorData*>(latest_sensor_data.get());
+
+    std::shared_ptr<VisionSensorData> sensor_data(std::make_shared<VisionSensorData>());
+    sensor_data->set_cov(cov);
+    sensor_data->state_ = ApplyCorrection(prior_sensor_data->state_, correction);
+    return sensor_data;
+  }
+
   VisionSensorStateType ApplyCorrection(const VisionSensorStateType& prior_sensor_state,
                                         const Eigen::MatrixXd& correction)
   {
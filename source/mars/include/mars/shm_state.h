@@ -0,0 +1,262 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SHM_STATE_H
+#define SHM_STATE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Shared memory layout of the ShmStatePublisher and the header-only ShmStateReader. The reader does not depend on the
+// filter and only requires this file.
+
+namespace mars
+{
+///
+/// \brief The ShmCoreState struct holds a core state and its covariance in shared memory
+///
+struct ShmCoreState
+{
+  static constexpr int size_error_ = 15;
+
+  double timestamp_;
+  double p_wi_[3];
+  double v_wi_[3];
+  double q_wi_[4];  ///< w, x, y, z
+  double b_w_[3];
+  double b_a_[3];
+  double cov_[size_error_ * size_error_];  ///< Column major
+};
+
+///
+/// \brief The ShmSensorState struct holds the latest state of a sensor and its covariance in shared memory
+///
+struct ShmSensorState
+{
+  static constexpr int max_name_length_ = 32;
+  static constexpr int max_state_size_ = 16;
+  static constexpr int max_cov_size_ = 12;
+
+  char name_[max_name_length_];  ///< Null-terminated, truncated name of the sensor
+  double timestamp_;
+  int32_t valid_;       ///< 1 if the sensor has a state in the filter
+  int32_t state_size_;  ///< Number of values in state_, 0 if the sensor does not provide its state values
+  int32_t cov_size_;    ///< Size of the sensor error state, 0 if it exceeds max_cov_size_
+  int32_t reserved_;
+  double state_[max_state_size_];             ///< Values in the order of the csv export of the sensor state
+  double cov_[max_cov_size_ * max_cov_size_];  ///< Column major cov_size_ x cov_size_ sensor covariance
+};
+
+///
+/// \brief The ShmStateSample struct is the content of one ring slot
+///
+struct ShmStateSample
+{
+  static constexpr int max_sensors_ = 8;
+
+  uint64_t sequence_;  ///< Publication counter, starts at 1
+  ShmCoreState core_;
+  int32_t num_sensors_;
+  int32_t reserved_;
+  ShmSensorState sensors_[max_sensors_];
+};
+
+///
+/// \brief The ShmStateSlot struct is a seqlock protected ring slot
+///
+/// The lock is odd while the publisher writes the slot and 2 * sequence_ once the sample was written.
+///
+struct ShmStateSlot
+{
+  std::atomic<uint64_t> lock_;
+  ShmStateSample sample_;
+};
+
+///
+/// \brief The ShmStateHeader struct precedes the ring slots in the shared memory
+///
+struct ShmStateHeader
+{
+  static constexpr uint32_t magic_ = 0x4d415253;  // "MARS"
+  static constexpr uint32_t version_ = 1;
+
+  std::atomic<uint32_t> magic_number_;  ///< Set last by the publisher once the memory is initialized
+  uint32_t version_number_;
+  uint32_t num_slots_;
+  uint32_t slot_size_;
+  std::atomic<uint64_t> latest_sequence_;  ///< Sequence of the latest complete sample, 0 if none
+
+  static size_t get_memory_size(const uint32_t& num_slots)
+  {
+    return sizeof(ShmStateHeader) + num_slots * sizeof(ShmStateSlot);
+  }
+
+  ShmStateSlot* get_slots()
+  {
+    return reinterpret_cast<ShmStateSlot*>(reinterpret_cast<char*>(this) + sizeof(ShmStateHeader));
+  }
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared memory requires lock-free 64 bit atomics");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The shared memory requires lock-free 32 bit atomics");
+static_assert(sizeof(ShmStateHeader) % alignof(ShmStateSlot) == 0, "The slots must be aligned");
+
+///
+/// \brief The ShmStateReader class reads the samples of a ShmStatePublisher from the shared memory
+///
+/// Readers never block the publisher and do not need to be known to it. A read copies a slot and retries if the
+/// publisher overwrote the slot in the meantime.
+///
+class ShmStateReader
+{
+public:
+  ShmStateReader() = default;
+  ShmStateReader(const ShmStateReader&) = delete;
+  ShmStateReader& operator=(const ShmStateReader&) = delete;
+
+  ~ShmStateReader()
+  {
+    Close();
+  }
+
+  ///
+  /// \brief Open Maps the shared memory of a publisher
+  /// \param name Name of the shared memory, e.g. "/mars_state"
+  /// \return True if a publisher has initialized the memory, false otherwise
+  ///
+  bool Open(const std::string& name)
+  {
+    Close();
+
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ShmStateHeader))
+    {
+      close(fd);
+      return false;
+    }
+
+    void* memory = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+      return false;
+    }
+
+    memory_size_ = static_cast<size_t>(info.st_size);
+    header_ = static_cast<ShmStateHeader*>(memory);
+
+    if (header_->magic_number_.load(std::memory_order_acquire) != ShmStateHeader::magic_ ||
+        header_->version_number_ != ShmStateHeader::version_ || header_->slot_size_ != sizeof(ShmStateSlot) ||
+        ShmStateHeader::get_memory_size(header_->num_slots_) > memory_size_)
+    {
+      Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Close()
+  {
+    if (header_ != nullptr)
+    {
+      munmap(header_, memory_size_);
+      header_ = nullptr;
+      memory_size_ = 0;
+    }
+  }
+
+  bool is_open() const
+  {
+    return header_ != nullptr;
+  }
+
+  ///
+  /// \brief get_latest_sequence
+  /// \return Sequence of the latest published sample, 0 if none was published
+  ///
+  uint64_t get_latest_sequence() const
+  {
+    return header_ == nullptr ? 0 : header_->latest_sequence_.load(std::memory_order_acquire);
+  }
+
+  ///
+  /// \brief ReadLatest Copies the latest sample
+  /// \param sample Output parameter
+  /// \return True if a consistent sample was read, false if none was published
+  ///
+  bool ReadLatest(ShmStateSample* sample) const
+  {
+    for (int k = 0; k < max_retries_; k++)
+    {
+      const uint64_t sequence = get_latest_sequence();
+      if (sequence == 0)
+      {
+        return false;
+      }
+
+      // The latest slot can only be overwritten if the publisher wrapped around the ring during the copy
+      if (Read(sequence, sample))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  ///
+  /// \brief Read Copies the sample with the given sequence
+  /// \param sequence Sequence of the sample
+  /// \param sample Output parameter
+  /// \return True if the sample was read, false if it was overwritten or not published yet
+  ///
+  bool Read(const uint64_t& sequence, ShmStateSample* sample) const
+  {
+    if (header_ == nullptr || sequence == 0)
+    {
+      return false;
+    }
+
+    ShmStateSlot& slot = header_->get_slots()[(sequence - 1) % header_->num_slots_];
+    const uint64_t expected_lock = 2 * sequence;
+
+    if (slot.lock_.load(std::memory_order_acquire) != expected_lock)
+    {
+      return false;
+    }
+
+    std::memcpy(static_cast<void*>(sample), &slot.sample_, sizeof(ShmStateSample));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return slot.lock_.load(std::memory_order_relaxed) == expected_lock;
+  }
+
+private:
+  static constexpr int max_retries_ = 16;
+
+  ShmStateHeader* header_{ nullptr };
+  size_t memory_size_{ 0 };
+};
+}  // namespace mars
+
+#endif  // SHM_STATE_H
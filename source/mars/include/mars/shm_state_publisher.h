@@ -0,0 +1,84 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SHM_STATE_PUBLISHER_H
+#define SHM_STATE_PUBLISHER_H
+
+#include <mars/buffer.h>
+#include <mars/sensors/sensor_abs_class.h>
+#include <mars/shm_state.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The ShmStatePublisher class publishes the latest filter state to a POSIX shared memory ring
+///
+/// Each Publish call writes the latest core state, its covariance and the latest state of the registered sensors to the
+/// next slot of the ring. The slots are protected by a sequence lock, the publisher never waits for readers and any
+/// number of processes can read the samples with the header-only ShmStateReader of mars/shm_state.h. The publisher is
+/// not thread-safe, a single publisher per shared memory name is supported.
+///
+class ShmStatePublisher
+{
+public:
+  ///
+  /// \brief ShmStatePublisher Creates and maps the shared memory, an existing memory with the same name is replaced
+  /// \param name Name of the shared memory, starts with a slash, e.g. "/mars_state"
+  /// \param num_slots Number of ring slots, readers can access the latest num_slots samples
+  ///
+  ShmStatePublisher(std::string name, const int& num_slots = 16);
+  ShmStatePublisher(const ShmStatePublisher&) = delete;
+  ShmStatePublisher& operator=(const ShmStatePublisher&) = delete;
+
+  ///
+  /// \brief ~ShmStatePublisher Unmaps and removes the shared memory, mapped readers keep their mapping
+  ///
+  ~ShmStatePublisher();
+
+  ///
+  /// \brief is_open
+  /// \return True if the shared memory was created, false otherwise
+  ///
+  bool is_open() const;
+
+  ///
+  /// \brief AddSensor Registers a sensor whose latest state is published
+  /// \return False if ShmStateSample::max_sensors_ sensors are registered, true otherwise
+  ///
+  bool AddSensor(const std::shared_ptr<SensorAbsClass>& sensor);
+
+  ///
+  /// \brief Publish Writes the latest state of the buffer to the next slot, called by the CoreLogic
+  /// \return False if the shared memory is not open or the buffer has no state, true otherwise
+  ///
+  bool Publish(const Buffer& buffer);
+
+  ///
+  /// \brief get_num_published
+  /// \return Sequence of the latest published sample
+  ///
+  uint64_t get_num_published() const;
+
+private:
+  void FillSensorState(const Buffer& buffer, const std::shared_ptr<SensorAbsClass>& sensor,
+                       ShmSensorState* sensor_state) const;
+
+  std::string name_;
+  size_t memory_size_{ 0 };
+  ShmStateHeader* header_{ nullptr };
+  std::vector<std::shared_ptr<SensorAbsClass>> sensors_;
+  uint64_t sequence_{ 0 };  ///< Sequence of the latest published sample
+};
+}  // namespace mars
+
+#endif  // SHM_STATE_PUBLISHER_H
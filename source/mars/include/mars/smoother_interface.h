@@ -0,0 +1,56 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SMOOTHER_INTERFACE_H
+#define SMOOTHER_INTERFACE_H
+
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <memory>
+
+namespace mars
+{
+///
+/// \brief The SmootherInterface class receives the steps of the filter from the CoreLogic
+///
+class SmootherInterface
+{
+public:
+  virtual ~SmootherInterface() = default;
+
+  ///
+  /// \brief AddStep Adds a step of the filter, called by the CoreLogic
+  /// \param prior_entry Entry with the predicted core state of this step, the state transition of its core data leads
+  /// from the previous step to this step
+  /// \param posterior_entry Entry with the filtered core state of this step, identical to the prior entry for a
+  /// propagation step
+  ///
+  virtual void AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry) = 0;
+
+  ///
+  /// \brief Reset Called if the past states of the filter changed, the next step does not continue the previous steps
+  ///
+  virtual void Reset() = 0;
+
+  ///
+  /// \brief Rewind Called before the CoreLogic reworks its buffer, the reworked steps are added again afterwards
+  ///
+  /// Removes the steps after the step with the given posterior core data. Smoothers that cannot return to a previous
+  /// step are reset instead, which is the default.
+  ///
+  /// \param core_data Core data of the posterior entry of the latest step that remains valid, nullptr if none
+  ///
+  virtual void Rewind(const std::shared_ptr<void>& /*core_data*/)
+  {
+    Reset();
+  }
+};
+}  // namespace mars
+
+#endif  // SMOOTHER_INTERFACE_H
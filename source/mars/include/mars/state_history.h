@@ -0,0 +1,125 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef STATE_HISTORY_H
+#define STATE_HISTORY_H
+
+#include <mars/core_logic.h>
+#include <mars/sweep_runner.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <memory>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The StateHistory class provides the filter estimate at any past time of an offline run
+///
+/// Run processes the dataset once and stores a checkpoint of the filter every checkpoint_interval_ seconds. A query
+/// restores the latest checkpoint before the requested time and replays only the measurements in between. The
+/// checkpoints are clones of the CoreLogic whose buffer is trimmed to the entries that subsequent measurements refer
+/// to, i.e. everything starting at the oldest of the latest states of all sensors.
+///
+/// A query with a time after the previous query continues the previous replay if no later checkpoint is closer.
+/// Queries in increasing time order therefore replay each measurement at most once, see get_states.
+///
+/// Measurements are processed in the arrival order of SweepRunSetup::get_arrival_order, times of the queries and the
+/// checkpoints refer to the arrival time. With sensor delays, a checkpoint keeps all buffer entries that a delayed
+/// measurement which has not arrived yet can refer to.
+///
+/// \note The sensor instances are shared by the run and all replays, queries are not thread safe. The sensor states
+/// (SensorAbsClass::SaveState) are part of the checkpoints.
+///
+class StateHistory
+{
+public:
+  double checkpoint_interval_{ 1.0 };  ///< Time [s] between two checkpoints
+
+  ///
+  /// \brief StateHistory
+  /// \param dataset Shared read-only dataset
+  /// \param setup Filter setup, the CoreLogic of the setup performs the run
+  ///
+  StateHistory(std::shared_ptr<const SweepDataset> dataset, const SweepRunSetup& setup);
+
+  ///
+  /// \brief Run Processes all measurements of the dataset and records the checkpoints
+  /// \return True if the filter was initialized during the run
+  ///
+  bool Run();
+
+  ///
+  /// \brief get_state Returns the filter estimate at the given time
+  ///
+  /// The estimate is the latest state after all measurements that arrived up to and including the given time were
+  /// processed. This is the estimate the filter provided at this time during the run.
+  ///
+  /// \param timestamp Requested time
+  /// \param state_entry Output parameter for the state entry, its core data holds the core state and covariance
+  /// \return False if the filter was not initialized at the given time
+  ///
+  bool get_state(const Time& timestamp, BufferEntryType* state_entry);
+
+  ///
+  /// \brief get_states Returns the filter estimates for many times, the times are processed in sorted order
+  /// \param timestamps Requested times in any order
+  /// \param state_entries Output parameter for the state entry of each time. Entries of times before the
+  /// initialization have no core data.
+  /// \return Number of times for which a state was found
+  ///
+  int get_states(const std::vector<Time>& timestamps, std::vector<BufferEntryType>* state_entries);
+
+  int get_num_checkpoints() const;
+
+  ///
+  /// \brief get_num_replayed
+  /// \return Number of measurements that were processed by queries
+  ///
+  int get_num_replayed() const;
+
+private:
+  struct Checkpoint
+  {
+    size_t arrival_idx_{ 0 };  ///< Arrival index of the first measurement that is not included
+    Time timestamp_{ 0.0 };    ///< All measurements that arrived up to this time are included
+    CoreLogic core_logic_;     ///< Filter with a trimmed buffer
+    std::vector<std::shared_ptr<void>> sensor_states_;  ///< State of each sensor of the setup
+  };
+
+  ///
+  /// \brief ProcessMeasurement Processes a measurement of the dataset and initializes the filter with the first
+  /// propagation sensor measurement, equivalent to SweepRunner::RunSingle
+  ///
+  void ProcessMeasurement(CoreLogic* core_logic, const size_t& measurement_idx) const;
+
+  ///
+  /// \brief AddCheckpoint Stores a checkpoint of the filter of the run
+  /// \param arrival_idx Arrival index of the first measurement that is not included
+  /// \param timestamp Arrival time of the latest included measurement
+  /// \param earliest_pending Earliest timestamp of the measurements that are not included
+  ///
+  void AddCheckpoint(const size_t& arrival_idx, const Time& timestamp, const Time& earliest_pending);
+
+  std::shared_ptr<const SweepDataset> dataset_;
+  SweepRunSetup setup_;
+  std::vector<size_t> arrival_order_;    ///< Measurement indices in arrival order
+  std::vector<Time> arrival_time_;       ///< Arrival time of each entry of arrival_order_
+  std::vector<Checkpoint> checkpoints_;  ///< Checkpoints sorted by time, the first one precedes all measurements
+
+  CoreLogic replay_;         ///< Filter of the latest query
+  size_t replay_idx_{ 0 };   ///< Arrival index of the next measurement of the replay
+  Time replay_time_{ 0.0 };  ///< Time of the latest query
+  bool replay_valid_{ false };
+  int num_replayed_{ 0 };
+};
+}  // namespace mars
+
+#endif  // STATE_HISTORY_H
@@ -0,0 +1,191 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SWEEP_RUNNER_H
+#define SWEEP_RUNNER_H
+
+#include <mars/core_logic.h>
+#include <mars/time.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <mars/type_definitions/core_state_type.h>
+#include <Eigen/Dense>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The SweepMeasurement struct is a sensor agnostic entry of a SweepDataset
+///
+/// The sensor is referenced by an index instead of a sensor handle such that each run can bind its own sensor
+/// instances to the shared measurement payload.
+///
+struct SweepMeasurement
+{
+  Time timestamp_{ 0.0 };
+  int sensor_idx_{ -1 };                   ///< Index of the sensor within the dataset
+  std::shared_ptr<void> data_{ nullptr };  ///< Measurement payload, shared between all runs and never modified
+};
+
+///
+/// \brief The SweepDataset class holds a measurement set and its ground truth which is parsed once and shared
+/// read-only between all runs of a SweepRunner
+///
+class SweepDataset
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SweepDataset() = default;
+
+  ///
+  /// \brief AddSensorMeasurements Adds the output of one of the read_*_data loaders as a new sensor
+  /// \param entries Measurement entries, the sensor handle of the entries is ignored
+  /// \return Index of the sensor which is used to bind sensor instances in a SweepRunSetup
+  ///
+  int AddSensorMeasurements(const std::vector<BufferEntryType>& entries);
+
+  ///
+  /// \brief AddGroundTruth Adds the ground truth stored as CoreStateType in the core_ field of ReadSimData entries
+  /// \param sim_data Output of ReadSimData
+  ///
+  void AddGroundTruth(const std::vector<BufferEntryType>& sim_data);
+
+  ///
+  /// \brief get_ground_truth Returns the ground truth state that is closest to the given timestamp
+  /// \param timestamp Requested time
+  /// \param state Output parameter for the ground truth state
+  /// \param max_dt Maximum allowed time difference in seconds
+  /// \return true if a ground truth entry within max_dt was found, false otherwise
+  ///
+  bool get_ground_truth(const Time& timestamp, CoreStateType* state, const double& max_dt = 1e-6) const;
+
+  ///
+  /// \brief has_ground_truth
+  /// \return true if ground truth was added to the dataset
+  ///
+  bool has_ground_truth() const;
+
+  ///
+  /// \brief get_measurements
+  /// \return All measurements of the dataset sorted by time
+  ///
+  const std::vector<SweepMeasurement>& get_measurements() const;
+
+  ///
+  /// \brief get_num_sensors
+  /// \return Number of sensors that were added to the dataset
+  ///
+  int get_num_sensors() const;
+
+private:
+  std::vector<SweepMeasurement> measurements_;                      ///< Time sorted measurements of all sensors
+  std::vector<Time> ground_truth_time_;                             ///< Time sorted ground truth timestamps
+  std::vector<std::shared_ptr<CoreStateType>> ground_truth_state_;  ///< Ground truth states
+  int num_sensors_{ 0 };
+};
+
+///
+/// \brief The SweepRunSetup struct describes a single filter instance of a sweep
+///
+/// The sensors_ vector maps the sensor index of the SweepDataset to the sensor instance of this run. All objects
+/// must be created exclusively for this run since runs are executed concurrently.
+///
+struct SweepRunSetup
+{
+  std::shared_ptr<CoreLogic> core_logic_{ nullptr };
+  std::vector<std::shared_ptr<SensorAbsClass>> sensors_;  ///< Sensor instance for each dataset sensor index
+  std::vector<double> sensor_delays_;                     ///< Optional arrival delay [s] per sensor index
+  bool init_from_ground_truth_{ true };                   ///< Initialize with the ground truth pose if available
+  Eigen::Vector3d p_wi_init_{ Eigen::Vector3d::Zero() };
+  Eigen::Quaterniond q_wi_init_{ Eigen::Quaterniond::Identity() };
+
+  ///
+  /// \brief get_sensor_delay
+  /// \return Arrival delay [s] of the sensor index, 0 if no delay was set
+  ///
+  double get_sensor_delay(const int& sensor_idx) const;
+
+  ///
+  /// \brief get_arrival_order Returns the order in which the measurements of the dataset arrive at the filter
+  ///
+  /// Injected delays only change the order in which the measurements arrive, the timestamps remain unchanged.
+  /// Measurements with the same arrival time keep their dataset order.
+  ///
+  /// \param dataset Dataset of the run
+  /// \return Measurement indices sorted by timestamp plus sensor delay
+  ///
+  std::vector<size_t> get_arrival_order(const SweepDataset& dataset) const;
+};
+
+///
+/// \brief The SweepRunResult struct holds the error metrics of a single run with respect to the ground truth
+///
+/// The metrics are evaluated at every propagation sensor measurement after the filter was initialized.
+///
+struct SweepRunResult
+{
+  int run_id_{ -1 };
+  bool valid_{ false };        ///< True if the run was initialized and evaluated at least once
+  int num_measurements_{ 0 };  ///< Number of measurements handed to the filter
+  int num_evaluations_{ 0 };   ///< Number of states compared against the ground truth
+  double p_rmse_{ 0 };         ///< Position RMSE [m]
+  double v_rmse_{ 0 };         ///< Velocity RMSE [m/s]
+  double q_rmse_deg_{ 0 };     ///< Attitude RMSE [deg]
+  double p_final_error_{ 0 };  ///< Final position error norm [m]
+  double runtime_{ 0 };        ///< Wall time of the run [s]
+};
+
+///
+/// \brief The SweepRunner class runs many independent CoreLogic instances on a shared SweepDataset
+///
+/// Runs are distributed dynamically over a pool of worker threads. Each worker fetches the next run index from a
+/// shared counter, which balances runs with different execution times without any further synchronization.
+///
+class SweepRunner
+{
+public:
+  using SetupFunction = std::function<SweepRunSetup(const int& run_id)>;
+
+  ///
+  /// \brief SweepRunner
+  /// \param dataset Shared read-only dataset
+  /// \param num_threads Number of worker threads, 0 uses the number of hardware threads
+  ///
+  SweepRunner(std::shared_ptr<const SweepDataset> dataset, const int& num_threads = 0);
+
+  ///
+  /// \brief Run Executes all runs and returns the results ordered by run index
+  /// \param num_runs Number of runs
+  /// \param setup Function that generates the filter setup for a given run index. It is called from the worker
+  /// threads and must be thread safe.
+  ///
+  std::vector<SweepRunResult> Run(const int& num_runs, const SetupFunction& setup) const;
+
+  ///
+  /// \brief RunSingle Executes a single run on the calling thread
+  ///
+  static SweepRunResult RunSingle(const SweepDataset& dataset, const int& run_id, const SweepRunSetup& setup);
+
+  ///
+  /// \brief PrintResults Prints a table of the results
+  ///
+  static void PrintResults(const std::vector<SweepRunResult>& results);
+
+  int get_num_threads() const;
+
+private:
+  std::shared_ptr<const SweepDataset> dataset_;
+  int num_threads_{ 1 };
+};
+}  // namespace mars
+
+#endif  // SWEEP_RUNNER_H
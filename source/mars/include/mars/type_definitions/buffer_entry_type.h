@@ -15,7 +15,6 @@
 #include <mars/time.h>
 #include <mars/type_definitions/buffer_data_type.h>
 #include <iostream>
-#include <set>
 
 namespace BufferMetadataTypes
 {
@@ -60,19 +59,15 @@ public:
 
   ///
   /// \brief IsState
-  /// \return True if the metadata can be found in the metadata_state_filter_. False otherwise.
+  /// \return True if the metadata is core_state, sensor_state or init_state. False otherwise.
   ///
   bool IsState() const;
 
   ///
   /// \brief IsMeasurement
-  /// \return True if the metadata can be found in the metadata_measurement_filter_. False otherwise.
+  /// \return True if the metadata is measurement or measurement_ooo. False otherwise.
   ///
   bool IsMeasurement() const;
-
-private:
-  std::set<int> metadata_state_filter_;
-  std::set<int> metadata_measurement_filter_;
 };
 }  // namespace mars
 #endif  // BUFFERENTRYTYPE_H
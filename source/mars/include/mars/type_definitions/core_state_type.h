@@ -75,6 +75,27 @@ public:
     return corrected_state;
   }
 
+  ///
+  /// \brief CalcCorrection Inverse of ApplyCorrection, state = ApplyCorrection(state_prior, correction)
+  /// \param state
+  /// \param state_prior
+  /// \return Correction with the order of ApplyCorrection
+  ///
+  static Eigen::Matrix<double, CoreStateType::size_error_, 1> CalcCorrection(const CoreStateType& state,
+                                                                             const CoreStateType& state_prior)
+  {
+    Eigen::Quaterniond dq = state_prior.q_wi_.conjugate() * state.q_wi_;
+    if (dq.w() < 0)
+    {
+      dq.coeffs() *= -1;
+    }
+
+    Eigen::Matrix<double, CoreStateType::size_error_, 1> correction;
+    correction << state.p_wi_ - state_prior.p_wi_, state.v_wi_ - state_prior.v_wi_, 2 * dq.vec(),
+        state.b_w_ - state_prior.b_w_, state.b_a_ - state_prior.b_a_;
+    return correction;
+  }
+
   friend std::ostream& operator<<(std::ostream& out, const CoreStateType& data)
   {
     out.precision(10);
@@ -0,0 +1,269 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/background_rework_core_logic.h>
+#include <mars/journal.h>
+#include <mars/shm_state_publisher.h>
+#include <mars/smoother_interface.h>
+#include <utility>
+#include <vector>
+
+namespace mars
+{
+///
+/// \brief The SmootherRecorder class records the smoother calls of the clone for the smoother of the live CoreLogic
+///
+/// The recorded steps continue the latest step of the live smoother at the start of the rework, unless the clone
+/// rewinds or resets the smoother to an earlier state. Rewinds to a recorded step only drop recorded steps.
+///
+class BackgroundReworkCoreLogic::SmootherRecorder : public SmootherInterface
+{
+public:
+  void AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry)
+  {
+    steps_.emplace_back(prior_entry, posterior_entry);
+  }
+
+  void Reset()
+  {
+    steps_.clear();
+    reset_ = true;
+    rewind_ = false;
+  }
+
+  void Rewind(const std::shared_ptr<void>& core_data)
+  {
+    for (size_t k = steps_.size(); k > 0; k--)
+    {
+      if (core_data != nullptr && steps_[k - 1].second.data_.core_ == core_data)
+      {
+        steps_.resize(k);
+        return;
+      }
+    }
+
+    // The target precedes the recorded steps, a rewind after a reset continues the new chain that starts with the
+    // recorded steps
+    steps_.clear();
+    if (!reset_)
+    {
+      rewind_ = true;
+      rewind_core_data_ = core_data;
+    }
+  }
+
+  ///
+  /// \brief Apply Passes the recorded calls to the smoother
+  ///
+  void Apply(SmootherInterface* smoother) const
+  {
+    if (reset_)
+    {
+      smoother->Reset();
+    }
+    else if (rewind_)
+    {
+      smoother->Rewind(rewind_core_data_);
+    }
+
+    for (const auto& k : steps_)
+    {
+      smoother->AddStep(k.first, k.second);
+    }
+  }
+
+private:
+  std::vector<std::pair<BufferEntryType, BufferEntryType>> steps_;  ///< Prior and posterior entry of each step
+  bool reset_{ false };                                             ///< The smoother was reset
+  bool rewind_{ false };                               ///< The smoother was rewound to a step before the recorded steps
+  std::shared_ptr<void> rewind_core_data_{ nullptr };  ///< Target of the rewind
+};
+
+BackgroundReworkCoreLogic::BackgroundReworkCoreLogic(std::shared_ptr<CoreLogic> core_logic)
+  : core_logic_(std::move(core_logic))
+{
+}
+
+BackgroundReworkCoreLogic::~BackgroundReworkCoreLogic()
+{
+  WaitForRework();
+}
+
+bool BackgroundReworkCoreLogic::ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor,
+                                                   const Time& timestamp, const BufferDataType& data)
+{
+  const BufferEntryType measurement(timestamp, data, sensor, BufferMetadataType::measurement);
+
+  if (rework_active_)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (rework_done_)
+    {
+      lock.unlock();
+      SwapIn();
+    }
+    else
+    {
+      pending_.push_back(measurement);
+      lock.unlock();
+
+      // The live CoreLogic continues the propagation, everything else is only processed by the clone
+      BufferEntryType latest_entry;
+      core_logic_->buffer_.get_latest_entry(&latest_entry);
+
+      if (sensor == core_logic_->core_states_->propagation_sensor_ && timestamp >= latest_entry.timestamp_)
+      {
+        return core_logic_->ProcessMeasurement(sensor, timestamp, data);
+      }
+
+      if (core_logic_->journal_ != nullptr)
+      {
+        core_logic_->journal_->RecordMeasurement(sensor, timestamp, data);
+      }
+
+      num_deferred_measurements_++;
+      return true;
+    }
+  }
+
+  if (core_logic_->core_is_initialized_)
+  {
+    BufferEntryType latest_entry;
+    if (core_logic_->buffer_.get_latest_entry(&latest_entry) &&
+        (latest_entry.timestamp_ - timestamp).get_seconds() > background_rework_threshold_)
+    {
+      if (core_logic_->journal_ != nullptr)
+      {
+        core_logic_->journal_->RecordMeasurement(sensor, timestamp, data);
+      }
+
+      StartRework(measurement);
+      return true;
+    }
+  }
+
+  return core_logic_->ProcessMeasurement(sensor, timestamp, data);
+}
+
+int BackgroundReworkCoreLogic::Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init)
+{
+  WaitForRework();
+  return core_logic_->Initialize(p_wi_init, q_wi_init);
+}
+
+void BackgroundReworkCoreLogic::WaitForRework()
+{
+  if (rework_active_)
+  {
+    SwapIn();
+  }
+}
+
+bool BackgroundReworkCoreLogic::is_rework_active() const
+{
+  return rework_active_;
+}
+
+int BackgroundReworkCoreLogic::get_num_background_reworks() const
+{
+  return num_background_reworks_;
+}
+
+int BackgroundReworkCoreLogic::get_num_deferred_measurements() const
+{
+  return num_deferred_measurements_;
+}
+
+void BackgroundReworkCoreLogic::StartRework(const BufferEntryType& measurement)
+{
+  // The buffers of the clone share their entries copy-on-write, cloning does not copy the buffer
+  shadow_.reset(new CoreLogic(core_logic_->Clone()));
+  rework_entry_ = measurement;
+
+  // The steps of the live CoreLogic during the rework are replaced by the steps of the clone
+  smoother_ = core_logic_->smoother_;
+  core_logic_->smoother_ = nullptr;
+  if (smoother_ != nullptr)
+  {
+    smoother_recorder_ = std::make_shared<SmootherRecorder>();
+    shadow_->smoother_ = smoother_recorder_;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    rework_done_ = false;
+  }
+
+  rework_active_ = true;
+  num_background_reworks_++;
+  worker_ = std::thread(&BackgroundReworkCoreLogic::WorkerLoop, this);
+}
+
+void BackgroundReworkCoreLogic::WorkerLoop()
+{
+  // The clone copies the shared chunk index of the buffer on this thread, the live CoreLogic then owns its index and
+  // continues the propagation without a copy of it. It only copies if its next measurement is processed before this
+  // point.
+  shadow_->buffer_.Detach();
+
+  shadow_->ProcessMeasurement(rework_entry_.sensor_, rework_entry_.timestamp_, rework_entry_.data_);
+
+  std::deque<BufferEntryType> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!pending_.empty())
+  {
+    batch.swap(pending_);
+    lock.unlock();
+
+    for (const auto& k : batch)
+    {
+      shadow_->ProcessMeasurement(k.sensor_, k.timestamp_, k.data_);
+    }
+    batch.clear();
+
+    lock.lock();
+  }
+
+  // The clone caught up, further measurements are processed after the swap
+  rework_done_ = true;
+}
+
+void BackgroundReworkCoreLogic::SwapIn()
+{
+  // Returns once the clone caught up, no measurements are added in the meantime
+  worker_.join();
+
+  // The clone does not hold the hooks of the live CoreLogic
+  std::shared_ptr<JournalWriter> journal = core_logic_->journal_;
+  std::shared_ptr<ShmStatePublisher> state_publisher = core_logic_->state_publisher_;
+
+  *core_logic_ = std::move(*shadow_);
+  shadow_.reset();
+  rework_active_ = false;
+
+  core_logic_->journal_ = journal;
+  core_logic_->smoother_ = std::move(smoother_);
+  core_logic_->state_publisher_ = state_publisher;
+
+  // The smoother returns to the latest step before the rework and continues with the reworked steps
+  if (smoother_recorder_ != nullptr)
+  {
+    smoother_recorder_->Apply(core_logic_->smoother_.get());
+    smoother_recorder_.reset();
+  }
+
+  if (state_publisher != nullptr)
+  {
+    state_publisher->Publish(core_logic_->buffer_);
+  }
+}
+}  // namespace mars
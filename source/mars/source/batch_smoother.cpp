@@ -0,0 +1,362 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/batch_smoother.h>
+#include <mars/data_utils/write_csv.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace mars
+{
+namespace
+{
+const CoreType& CoreData(const std::shared_ptr<void>& core_data)
+{
+  return *static_cast<CoreType*>(core_data.get());
+}
+
+int ResolveNumThreads(const int& num_threads)
+{
+  if (num_threads > 0)
+  {
+    return num_threads;
+  }
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+///
+/// \brief RunParallel Runs task(0) to task(num_tasks - 1) with one thread per task, the calling thread runs task 0
+///
+void RunParallel(const int& num_tasks, const std::function<void(const int&)>& task)
+{
+  std::vector<std::thread> workers;
+  for (int k = 1; k < num_tasks; k++)
+  {
+    workers.emplace_back(task, k);
+  }
+
+  if (num_tasks > 0)
+  {
+    task(0);
+  }
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+///
+/// \brief SegmentBegin First index of a segment when num_items are split into num_segments contiguous segments
+///
+int SegmentBegin(const int& segment_idx, const int& num_items, const int& num_segments)
+{
+  return static_cast<int>(static_cast<long long>(segment_idx) * num_items / num_segments);
+}
+}  // namespace
+
+void BatchSmoother::AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry)
+{
+  const CoreType& posterior = CoreData(posterior_entry.data_.core_);
+
+  if (chain_open_)
+  {
+    // RTS step from this step to the previous step: e = C (e_next + d), P = C P_next C^T + P_f - C P_pred C^T with
+    // the gain C = P_f F^T P_pred^-1 and d = x_next (-) x_pred. Updates without intermediate propagation use the
+    // previous state as prior and have the identity as gain.
+    const CoreType& previous = CoreData(last_posterior_);
+    Element element;
+
+    if (prior_entry.data_.core_ == last_posterior_)
+    {
+      element.b_ = CoreStateType::CalcCorrection(posterior.state_, previous.state_);
+    }
+    else
+    {
+      const CoreType& prior = CoreData(prior_entry.data_.core_);
+      element.A_ = prior.cov_.llt().solve(prior.state_transition_ * previous.cov_).transpose();
+      element.b_ = element.A_ * CoreStateType::CalcCorrection(posterior.state_, prior.state_);
+      element.S_ = previous.cov_ - element.A_ * prior.cov_ * element.A_.transpose();
+    }
+
+    open_element_ = Combine(open_element_, element);
+
+    // Steps within the output interval are only part of the map of the latest node
+    if ((posterior_entry.timestamp_ - nodes_.back().timestamp_).get_seconds() >= output_interval_)
+    {
+      nodes_.back().element_ = open_element_;
+      AddNode(posterior_entry);
+    }
+  }
+  else
+  {
+    AddNode(posterior_entry);
+  }
+
+  last_posterior_ = posterior_entry.data_.core_;
+  chain_open_ = true;
+
+  Checkpoint checkpoint;
+  checkpoint.posterior_ = last_posterior_;
+  checkpoint.num_nodes_ = nodes_.size();
+  checkpoint.open_element_ = open_element_;
+  checkpoints_.push_back(checkpoint);
+
+  while (static_cast<int>(checkpoints_.size()) > max_rewind_steps_)
+  {
+    checkpoints_.pop_front();
+  }
+}
+
+void BatchSmoother::Reset()
+{
+  FinishChain();
+  checkpoints_.clear();
+}
+
+void BatchSmoother::Rewind(const std::shared_ptr<void>& core_data)
+{
+  while (!checkpoints_.empty() && (core_data == nullptr || checkpoints_.back().posterior_ != core_data))
+  {
+    checkpoints_.pop_back();
+  }
+
+  if (checkpoints_.empty())
+  {
+    std::cout << "Warning: BatchSmoother: Rewind step not found, the current chain ends" << std::endl;
+    FinishChain();
+    return;
+  }
+
+  // The map of the latest node is completed by the next node or the end of the chain
+  const Checkpoint& checkpoint = checkpoints_.back();
+  nodes_.resize(checkpoint.num_nodes_);
+  open_element_ = checkpoint.open_element_;
+  last_posterior_ = checkpoint.posterior_;
+  chain_open_ = true;
+}
+
+int BatchSmoother::Smooth(std::vector<BufferEntryType>* smoothed_entries, const int& num_threads)
+{
+  FinishChain();
+  smoothed_entries->clear();
+
+  const int num_nodes = static_cast<int>(nodes_.size());
+  if (num_nodes == 0)
+  {
+    return 0;
+  }
+
+  const int num_segments = std::min(ResolveNumThreads(num_threads), num_nodes);
+
+  // Map of each segment from the first node of the next segment, the map of the first segment is not required
+  std::vector<Element, Eigen::aligned_allocator<Element>> segment_elements(num_segments);
+  RunParallel(num_segments - 1, [&](const int& task_idx) {
+    const int segment_idx = task_idx + 1;
+    const int begin = SegmentBegin(segment_idx, num_nodes, num_segments);
+    const int end = SegmentBegin(segment_idx + 1, num_nodes, num_segments);
+
+    Element element = nodes_[begin].element_;
+    for (int k = begin + 1; k < end; k++)
+    {
+      element = Combine(element, nodes_[k].element_);
+    }
+    segment_elements[segment_idx] = element;
+  });
+
+  // Correction and covariance at the end of each segment, the map of the latest node does not depend on its input
+  std::vector<CoreStateVector, Eigen::aligned_allocator<CoreStateVector>> segment_corrections(
+      num_segments, CoreStateVector::Zero());
+  std::vector<CoreStateMatrix, Eigen::aligned_allocator<CoreStateMatrix>> segment_covs(num_segments,
+                                                                                      CoreStateMatrix::Zero());
+  for (int k = num_segments - 2; k >= 0; k--)
+  {
+    const Element& next = segment_elements[k + 1];
+    segment_corrections[k] = next.A_ * segment_corrections[k + 1] + next.b_;
+    segment_covs[k] = next.A_ * segment_covs[k + 1] * next.A_.transpose() + next.S_;
+  }
+
+  // Backward recursion of all segments
+  smoothed_entries->resize(num_nodes);
+  RunParallel(num_segments, [&](const int& segment_idx) {
+    const int begin = SegmentBegin(segment_idx, num_nodes, num_segments);
+    const int end = SegmentBegin(segment_idx + 1, num_nodes, num_segments);
+
+    CoreStateVector correction = segment_corrections[segment_idx];
+    CoreStateMatrix cov = segment_covs[segment_idx];
+
+    for (int k = end - 1; k >= begin; k--)
+    {
+      const Node& node = nodes_[k];
+      correction = node.element_.A_ * correction + node.element_.b_;
+      cov = node.element_.A_ * cov * node.element_.A_.transpose() + node.element_.S_;
+
+      std::shared_ptr<CoreType> smoothed = std::make_shared<CoreType>();
+      smoothed->state_ = CoreStateType::ApplyCorrection(node.state_, correction);
+      smoothed->cov_ = 0.5 * (cov + cov.transpose());
+
+      BufferDataType data;
+      data.set_core_data(smoothed);
+      (*smoothed_entries)[k] = BufferEntryType(node.timestamp_, data, node.sensor_, BufferMetadataType::core_state);
+    }
+  });
+
+  return num_nodes;
+}
+
+bool BatchSmoother::WriteCsvFile(const std::string& file_path, const std::vector<BufferEntryType>& entries,
+                                 const bool& write_cov, const int& num_threads)
+{
+  std::ofstream ofile(file_path, std::ios::out);
+  if (!ofile.is_open())
+  {
+    std::cout << "Warning: BatchSmoother: Could not open " << file_path << std::endl;
+    return false;
+  }
+
+  std::string header = CoreStateType::get_csv_state_header_string();
+  if (write_cov)
+  {
+    header += WriteCsv::get_cov_header_string(CoreStateType::size_error_);
+  }
+  header += '\n';
+  ofile.write(header.data(), header.size());
+
+  // Blocks of lines are formatted in parallel, each round writes one block per thread in order
+  constexpr int block_size = 1024;
+  const int num_entries = static_cast<int>(entries.size());
+  const int num_workers = ResolveNumThreads(num_threads);
+  std::vector<std::string> blocks(num_workers);
+
+  for (int round_begin = 0; round_begin < num_entries; round_begin += num_workers * block_size)
+  {
+    RunParallel(num_workers, [&](const int& worker_idx) {
+      std::string& block = blocks[worker_idx];
+      block.clear();
+
+      const int begin = std::min(num_entries, round_begin + worker_idx * block_size);
+      const int end = std::min(num_entries, begin + block_size);
+      for (int k = begin; k < end; k++)
+      {
+        const CoreType& core = CoreData(entries[k].data_.core_);
+        block += core.state_.to_csv_string(entries[k].timestamp_.get_seconds());
+        if (write_cov)
+        {
+          block += WriteCsv::cov_mat_to_csv(core.cov_);
+        }
+        block += '\n';
+      }
+    });
+
+    for (const auto& block : blocks)
+    {
+      ofile.write(block.data(), block.size());
+    }
+  }
+
+  return ofile.good();
+}
+
+bool BatchSmoother::WriteBinaryFile(const std::string& file_path, const std::vector<BufferEntryType>& entries)
+{
+  std::ofstream ofile(file_path, std::ios::out | std::ios::binary);
+  if (!ofile.is_open())
+  {
+    std::cout << "Warning: BatchSmoother: Could not open " << file_path << std::endl;
+    return false;
+  }
+
+  constexpr int num_state_values = 23;
+  constexpr int num_cov_values = CoreStateType::size_error_ * (CoreStateType::size_error_ + 1) / 2;
+  constexpr size_t num_values = num_state_values + num_cov_values;
+  constexpr size_t block_size = 4096;
+
+  std::vector<double> block;
+  block.reserve(block_size * num_values);
+
+  for (size_t k = 0; k < entries.size(); k++)
+  {
+    const CoreType& core = CoreData(entries[k].data_.core_);
+    const CoreStateType& state = core.state_;
+
+    block.push_back(entries[k].timestamp_.get_seconds());
+    block.insert(block.end(), state.w_m_.data(), state.w_m_.data() + 3);
+    block.insert(block.end(), state.a_m_.data(), state.a_m_.data() + 3);
+    block.insert(block.end(), state.p_wi_.data(), state.p_wi_.data() + 3);
+    block.insert(block.end(), state.v_wi_.data(), state.v_wi_.data() + 3);
+    block.push_back(state.q_wi_.w());
+    block.insert(block.end(), state.q_wi_.coeffs().data(), state.q_wi_.coeffs().data() + 3);
+    block.insert(block.end(), state.b_w_.data(), state.b_w_.data() + 3);
+    block.insert(block.end(), state.b_a_.data(), state.b_a_.data() + 3);
+
+    // Upper triangle row by row, the column of the symmetric covariance is contiguous
+    for (int row = 0; row < CoreStateType::size_error_; row++)
+    {
+      const double* column = core.cov_.data() + row * CoreStateType::size_error_;
+      block.insert(block.end(), column + row, column + CoreStateType::size_error_);
+    }
+
+    if (block.size() >= block_size * num_values || k + 1 == entries.size())
+    {
+      ofile.write(reinterpret_cast<const char*>(block.data()),
+                  static_cast<std::streamsize>(block.size() * sizeof(double)));
+      block.clear();
+    }
+  }
+
+  return ofile.good();
+}
+
+int BatchSmoother::get_num_nodes() const
+{
+  return static_cast<int>(nodes_.size());
+}
+
+BatchSmoother::Element BatchSmoother::Combine(const Element& first, const Element& second)
+{
+  Element combined;
+  combined.A_ = first.A_ * second.A_;
+  combined.b_ = first.A_ * second.b_ + first.b_;
+  combined.S_ = first.A_ * second.S_ * first.A_.transpose() + first.S_;
+  return combined;
+}
+
+void BatchSmoother::AddNode(const BufferEntryType& posterior_entry)
+{
+  nodes_.push_back(Node());
+  nodes_.back().timestamp_ = posterior_entry.timestamp_;
+  nodes_.back().sensor_ = posterior_entry.sensor_;
+  nodes_.back().state_ = CoreData(posterior_entry.data_.core_).state_;
+
+  open_element_ = Element();
+}
+
+void BatchSmoother::FinishChain()
+{
+  if (!chain_open_)
+  {
+    return;
+  }
+
+  // The latest step of a chain is not corrected by later steps, its smoothed covariance is the filtered one
+  Element last;
+  last.A_.setZero();
+  last.S_ = CoreData(last_posterior_).cov_;
+  nodes_.back().element_ = Combine(open_element_, last);
+
+  chain_open_ = false;
+  last_posterior_ = nullptr;
+}
+}  // namespace mars
@@ -11,6 +11,7 @@
 // and <martin.scheiber@ieee.org>
 
 #include <mars/buffer.h>
+#include <atomic>
 #include <utility>
 
 namespace mars
@@ -38,17 +39,251 @@ int Buffer::get_max_buffer_size() const
 
 void Buffer::ResetBufferData()
 {
-  data_.erase(data_.begin(), data_.end());
+  // Other buffers that share the entries keep their data
+  data_ = std::make_shared<Storage>();
+}
+
+bool Buffer::IsShared() const
+{
+  return data_.use_count() > 1;
+}
+
+void Buffer::Detach()
+{
+  if (data_.use_count() > 1)
+  {
+    // Copy the chunk index, the chunks remain shared until they are modified
+    data_ = std::make_shared<Storage>(*data_);
+  }
+  else
+  {
+    // Synchronizes with the release of the storage by a copy that was detached on another thread
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+}
+
+size_t Buffer::FindChunk(const int& index) const
+{
+  const std::vector<int64_t>& offsets = data_->offsets_;
+  const int64_t position = offsets.front() + index;
+
+  // Most accesses are close to the latest entry
+  if (position >= offsets.back())
+  {
+    return offsets.size() - 1;
+  }
+
+  const auto next_chunk = std::upper_bound(offsets.begin(), offsets.end(), position);
+  return static_cast<size_t>(std::max<std::ptrdiff_t>(next_chunk - offsets.begin() - 1, 0));
+}
+
+template <typename Predicate>
+int Buffer::FindLatest(const Predicate& predicate) const
+{
+  int index = data_->size_;
+
+  for (auto chunk = data_->chunks_.rbegin(); chunk != data_->chunks_.rend(); ++chunk)
+  {
+    for (auto k = (*chunk)->rbegin(); k != (*chunk)->rend(); ++k)
+    {
+      --index;
+      if (predicate(*k))
+      {
+        return index;
+      }
+    }
+  }
+
+  return -1;
+}
+
+template <typename Predicate>
+int Buffer::FindOldest(const Predicate& predicate) const
+{
+  int index = 0;
+
+  for (const auto& chunk : data_->chunks_)
+  {
+    for (const auto& k : *chunk)
+    {
+      if (predicate(k))
+      {
+        return index;
+      }
+      ++index;
+    }
+  }
+
+  return -1;
+}
+
+const BufferEntryType& Buffer::EntryAt(const int& index) const
+{
+  const size_t chunk = FindChunk(index);
+  return (*data_->chunks_[chunk])[data_->offsets_.front() + index - data_->offsets_[chunk]];
+}
+
+Buffer::Chunk& Buffer::MutableChunk(const size_t& chunk)
+{
+  std::shared_ptr<Chunk>& chunk_ptr = data_->chunks_[chunk];
+
+  if (chunk_ptr.use_count() > 1)
+  {
+    chunk_ptr = std::make_shared<Chunk>(*chunk_ptr);
+  }
+  else
+  {
+    // Synchronizes with the release of the chunk by a copy that was modified on another thread
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+
+  return *chunk_ptr;
+}
+
+void Buffer::InsertEntry(const int& index, const BufferEntryType& entry)
+{
+  Detach();
+  Storage& storage = *data_;
+
+  if (storage.chunks_.empty())
+  {
+    storage.chunks_.push_back(std::make_shared<Chunk>(1, entry));
+    storage.offsets_.push_back(0);
+    storage.size_ = 1;
+    return;
+  }
+
+  // Entries at the ends of the buffer start a new chunk if the chunk at the end is full
+  if (index == storage.size_ && static_cast<int>(storage.chunks_.back()->size()) >= kChunkSize)
+  {
+    storage.offsets_.push_back(storage.offsets_.back() + static_cast<int64_t>(storage.chunks_.back()->size()));
+    storage.chunks_.push_back(std::make_shared<Chunk>(1, entry));
+    storage.size_++;
+    return;
+  }
+
+  if (index == 0 && static_cast<int>(storage.chunks_.front()->size()) >= kChunkSize)
+  {
+    storage.offsets_.insert(storage.offsets_.begin(), storage.offsets_.front() - 1);
+    storage.chunks_.insert(storage.chunks_.begin(), std::make_shared<Chunk>(1, entry));
+    storage.size_++;
+    return;
+  }
+
+  const size_t chunk_idx = FindChunk(index);
+  const int64_t local_idx = storage.offsets_.front() + index - storage.offsets_[chunk_idx];
+  Chunk& chunk = MutableChunk(chunk_idx);
+  chunk.insert(chunk.begin() + local_idx, entry);
+  storage.size_++;
+
+  // Either the chunk and the chunks before it start one position earlier, or the chunks after it one position later
+  if (chunk_idx < storage.offsets_.size() - chunk_idx - 1)
+  {
+    for (size_t k = 0; k <= chunk_idx; k++)
+    {
+      storage.offsets_[k]--;
+    }
+  }
+  else
+  {
+    for (size_t k = chunk_idx + 1; k < storage.offsets_.size(); k++)
+    {
+      storage.offsets_[k]++;
+    }
+  }
+
+  // Chunks that grew by insertions are split, such that a modification does not copy more than two chunk sizes
+  if (static_cast<int>(chunk.size()) > 2 * kChunkSize)
+  {
+    std::shared_ptr<Chunk> upper_half = std::make_shared<Chunk>(chunk.begin() + kChunkSize, chunk.end());
+    chunk.erase(chunk.begin() + kChunkSize, chunk.end());
+    storage.offsets_.insert(storage.offsets_.begin() + chunk_idx + 1, storage.offsets_[chunk_idx] + kChunkSize);
+    storage.chunks_.insert(storage.chunks_.begin() + chunk_idx + 1, upper_half);
+  }
+}
+
+void Buffer::EraseEntry(const int& index)
+{
+  Detach();
+  Storage& storage = *data_;
+
+  const size_t chunk_idx = FindChunk(index);
+  const int64_t local_idx = storage.offsets_.front() + index - storage.offsets_[chunk_idx];
+  storage.size_--;
+
+  // Index of the first chunk after the removed entry
+  size_t next_chunk_idx = chunk_idx + 1;
+
+  if (storage.chunks_[chunk_idx]->size() == 1)
+  {
+    // Chunks are never empty
+    storage.chunks_.erase(storage.chunks_.begin() + chunk_idx);
+    storage.offsets_.erase(storage.offsets_.begin() + chunk_idx);
+    next_chunk_idx = chunk_idx;
+  }
+  else
+  {
+    Chunk& chunk = MutableChunk(chunk_idx);
+    chunk.erase(chunk.begin() + local_idx);
+  }
+
+  // Either the chunks before the removed entry start one position later, or the chunks after it one position earlier
+  if (next_chunk_idx < storage.offsets_.size() - next_chunk_idx)
+  {
+    for (size_t k = 0; k < next_chunk_idx; k++)
+    {
+      storage.offsets_[k]++;
+    }
+  }
+  else
+  {
+    for (size_t k = next_chunk_idx; k < storage.offsets_.size(); k++)
+    {
+      storage.offsets_[k]--;
+    }
+  }
+}
+
+void Buffer::EraseFront(const int& count)
+{
+  Detach();
+  Storage& storage = *data_;
+
+  // Whole chunks are released without a copy
+  size_t num_chunks = 0;
+  int remaining = count;
+  while (static_cast<int>(storage.chunks_[num_chunks]->size()) <= remaining)
+  {
+    remaining -= static_cast<int>(storage.chunks_[num_chunks]->size());
+    num_chunks++;
+
+    if (num_chunks == storage.chunks_.size())
+    {
+      break;
+    }
+  }
+
+  storage.chunks_.erase(storage.chunks_.begin(), storage.chunks_.begin() + num_chunks);
+  storage.offsets_.erase(storage.offsets_.begin(), storage.offsets_.begin() + num_chunks);
+  storage.size_ -= count - remaining;
+
+  if (remaining > 0)
+  {
+    Chunk& chunk = MutableChunk(0);
+    chunk.erase(chunk.begin(), chunk.begin() + remaining);
+    storage.offsets_.front() += remaining;
+    storage.size_ -= remaining;
+  }
 }
 
 bool Buffer::IsEmpty() const
 {
-  return data_.empty();
+  return data_->size_ == 0;
 }
 
 int Buffer::get_length() const
 {
-  return static_cast<int>(data_.size());
+  return data_->size_;
 }
 
 void Buffer::PrintBufferEntrys() const
@@ -56,9 +291,9 @@ void Buffer::PrintBufferEntrys() const
   std::cout << "Idx \t Sensor Name \t Timestamp \t Metadata " << std::endl;
 
   // iterate forwards
-  for (size_t k = 0; k < data_.size(); ++k)
+  for (int k = 0; k < get_length(); ++k)
   {
-    std::cout << k << " " << data_[k] << std::endl;
+    std::cout << k << " " << EntryAt(k) << std::endl;
   }
 }
 
@@ -69,7 +304,7 @@ bool Buffer::get_latest_entry(BufferEntryType* entry) const
     return false;
   }
 
-  *entry = data_.back();
+  *entry = data_->chunks_.back()->back();
   return true;
 }
 
@@ -81,16 +316,15 @@ bool Buffer::get_latest_state(BufferEntryType* entry) const
   }
 
   // iterate backwards
-  for (auto k = data_.rbegin(); k != data_.rend(); ++k)
+  const int index = FindLatest([](const BufferEntryType& k) { return k.IsState(); });
+
+  if (index < 0)
   {
-    if (k->IsState())
-    {
-      *entry = *k;
-      return true;
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_oldest_state(BufferEntryType* entry) const
@@ -101,16 +335,15 @@ bool Buffer::get_oldest_state(BufferEntryType* entry) const
   }
 
   // iterate forwards
-  for (const auto& k : data_)
+  const int index = FindOldest([](const BufferEntryType& k) { return k.IsState(); });
+
+  if (index < 0)
   {
-    if (k.IsState())
-    {
-      *entry = k;
-      return true;
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_oldest_core_state(BufferEntryType* entry) const
@@ -121,16 +354,16 @@ bool Buffer::get_oldest_core_state(BufferEntryType* entry) const
   }
 
   // iterate forwards (oldest to newest)
-  for (const auto& k : data_)
+  const int index =
+      FindOldest([](const BufferEntryType& k) { return k.metadata_ == mars::BufferMetadataType::core_state; });
+
+  if (index < 0)
   {
-    if (k.metadata_ == mars::BufferMetadataType::core_state)
-    {
-      *entry = k;
-      return true;
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_latest_init_state(BufferEntryType* entry) const
@@ -141,19 +374,16 @@ bool Buffer::get_latest_init_state(BufferEntryType* entry) const
   }
 
   // iterate backwards (newest to oldest)
-  for (auto k = data_.rbegin(); k != data_.rend(); ++k)
+  const int index = FindLatest(
+      [](const BufferEntryType& k) { return k.IsState() && k.metadata_ == BufferMetadataType::init_state; });
+
+  if (index < 0)
   {
-    if (k->IsState())
-    {
-      if (k->metadata_ == BufferMetadataType::init_state)
-      {
-        *entry = *k;
-        return true;
-      }
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_latest_sensor_handle_state(const std::shared_ptr<SensorAbsClass>& sensor_handle,
@@ -173,21 +403,16 @@ bool Buffer::get_latest_sensor_handle_state(const std::shared_ptr<SensorAbsClass
   }
 
   // iterate backwards
-  for (int k = data_.size() - 1; k >= 0; --k)
+  *index = FindLatest(
+      [&sensor_handle](const BufferEntryType& k) { return k.IsState() && k.sensor_.get() == sensor_handle.get(); });
+
+  if (*index < 0)
   {
-    if (data_[k].IsState())
-    {
-      if (data_[k].sensor_.get() == sensor_handle.get())
-      {
-        *entry = data_[k];
-        *index = k;
-        return true;
-      }
-    }
+    return false;
   }
 
-  *index = -1;
-  return false;
+  *entry = EntryAt(*index);
+  return true;
 }
 
 bool Buffer::get_oldest_sensor_handle_state(const std::shared_ptr<SensorAbsClass>& sensor_handle,
@@ -199,19 +424,16 @@ bool Buffer::get_oldest_sensor_handle_state(const std::shared_ptr<SensorAbsClass
   }
 
   // iterate forwards (oldest to newest)
-  for (const auto& k : data_)
+  const int index = FindOldest(
+      [&sensor_handle](const BufferEntryType& k) { return k.IsState() && k.sensor_.get() == sensor_handle.get(); });
+
+  if (index < 0)
   {
-    if (k.IsState())
-    {
-      if (k.sensor_.get() == sensor_handle.get())
-      {
-        *entry = k;
-        return true;
-      }
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_latest_sensor_handle_measurement(const std::shared_ptr<SensorAbsClass>& sensor_handle,
@@ -223,19 +445,17 @@ bool Buffer::get_latest_sensor_handle_measurement(const std::shared_ptr<SensorAb
   }
 
   // iterate backwards (newest to oldest)
-  for (auto k = data_.rbegin(); k != data_.rend(); ++k)
+  const int index = FindLatest([&sensor_handle](const BufferEntryType& k) {
+    return k.IsMeasurement() && k.sensor_.get() == sensor_handle.get();
+  });
+
+  if (index < 0)
   {
-    if (k->IsMeasurement())
-    {
-      if (k->sensor_.get() == sensor_handle.get())
-      {
-        *entry = *k;
-        return true;
-      }
-    }
+    return false;
   }
 
-  return false;
+  *entry = EntryAt(index);
+  return true;
 }
 
 bool Buffer::get_sensor_handle_measurements(const std::shared_ptr<SensorAbsClass>& sensor_handle,
@@ -250,13 +470,16 @@ bool Buffer::get_sensor_handle_measurements(const std::shared_ptr<SensorAbsClass
   entries->clear();
 
   // iterate forwards (oldest to newest)
-  for (const auto& k : data_)
+  for (const auto& chunk : data_->chunks_)
   {
-    if (k.IsMeasurement())
+    for (const auto& k : *chunk)
     {
-      if (k.sensor_.get() == sensor_handle.get())
+      if (k.IsMeasurement())
       {
-        entries->push_back(&k);
+        if (k.sensor_.get() == sensor_handle.get())
+        {
+          entries->push_back(&k);
+        }
       }
     }
   }
@@ -285,29 +508,34 @@ bool Buffer::get_closest_state(const Time& timestamp, BufferEntryType* entry, in
   bool found_state = false;
 
   // iterate backwards / start with latest entry
-  for (int k = data_.size() - 1; k >= 0; --k)
+  int k = get_length();
+  for (auto chunk = data_->chunks_.rbegin(); chunk != data_->chunks_.rend(); ++chunk)
   {
-    if (data_[k].IsState())
+    for (auto entry_it = (*chunk)->rbegin(); entry_it != (*chunk)->rend(); ++entry_it)
     {
-      found_state = true;
+      --k;
+      if (entry_it->IsState())
+      {
+        found_state = true;
 
-      Time current_distance = (timestamp - data_[k].timestamp_).abs();
+        Time current_distance = (timestamp - entry_it->timestamp_).abs();
 
-      if (current_distance < time_distance)
-      {
-        time_distance = current_distance;
-      }
-      else
-      {
-        continue;
+        if (current_distance < time_distance)
+        {
+          time_distance = current_distance;
+        }
+        else
+        {
+          continue;
+        }
+        previous_state_index = k;
       }
-      previous_state_index = k;
     }
   }
 
   if (found_state)
   {
-    *entry = data_[previous_state_index];
+    *entry = EntryAt(previous_state_index);
     *index = previous_state_index;
     return true;
   }
@@ -332,7 +560,7 @@ bool Buffer::get_entry_at_idx(const int& index, BufferEntryType* entry) const
 
   if (index < this->get_length())
   {
-    *entry = data_[index];
+    *entry = EntryAt(index);
     return true;
   }
 
@@ -377,9 +605,9 @@ bool Buffer::DeleteStatesStartingAtIdx(const int& idx)
   {
     for (int k = get_length() - 1; k >= idx; --k)
     {
-      if (data_[k].IsState())
+      if (EntryAt(k).IsState())
       {
-        *data_.erase(data_.begin() + k);
+        EraseEntry(k);
       }
     }
     return true;
@@ -388,6 +616,17 @@ bool Buffer::DeleteStatesStartingAtIdx(const int& idx)
   return false;
 }
 
+bool Buffer::DeleteEntriesBeforeIdx(const int& idx)
+{
+  if (idx <= 0 || idx > this->get_length())
+  {
+    return false;
+  }
+
+  EraseFront(idx);
+  return true;
+}
+
 bool Buffer::IsSorted() const
 {
   if (this->IsEmpty())
@@ -395,14 +634,22 @@ bool Buffer::IsSorted() const
     return false;
   }
 
-  return std::is_sorted(data_.begin(), data_.end());
+  for (int k = 1; k < get_length(); ++k)
+  {
+    if (EntryAt(k) < EntryAt(k - 1))
+    {
+      return false;
+    }
+  }
+
+  return true;
 }
 
 int Buffer::InsertDataAtTimestamp(const BufferEntryType& new_entry)
 {
   if (this->IsEmpty())
   {
-    data_.push_back(new_entry);
+    InsertEntry(0, new_entry);
     // entry is added at idx 0, buffer was empty
     return 0;
   }
@@ -411,9 +658,8 @@ int Buffer::InsertDataAtTimestamp(const BufferEntryType& new_entry)
   this->get_latest_entry(&latest_entry);
   if (latest_entry <= new_entry)
   {
-    data_.push_back(new_entry);
-    // get index based on iterator
-    return static_cast<int>(data_.end() - data_.begin()) - 1;
+    InsertEntry(get_length(), new_entry);
+    return get_length() - 1;
   }
 
   Time previous_time_distance(1e100);
@@ -422,20 +668,14 @@ int Buffer::InsertDataAtTimestamp(const BufferEntryType& new_entry)
   // iterate backwards and start with latest entry
   // find the first entry at which (state_entry_stamp - new_stamp) is >=0
   // the new entry is entered after this index (idx+1)
-  for (int k = data_.size() - 1; k >= 0; --k)
-  {
-    Time current_time_distance = timestamp - data_[k].timestamp_;
-
-    if (current_time_distance.get_seconds() >= 0)
-    {
-      data_.insert(data_.begin() + k + 1, new_entry);
-      return k + 1;  // return entry index
-    }
-  }
-
-  // If the buffer has only one element and the new entry is older then the existing entry
-  data_.push_front(new_entry);
-  return 0;  // push front adds element at index 0
+  const int k = FindLatest([&timestamp](const BufferEntryType& entry) {
+    Time current_time_distance = timestamp - entry.timestamp_;
+    return current_time_distance.get_seconds() >= 0;
+  });
+
+  // k is -1 if the new entry is older than all existing entries, push front adds the element at index 0
+  InsertEntry(k + 1, new_entry);
+  return k + 1;  // return entry index
 }
 
 bool Buffer::InsertDataAtIndex(const BufferEntryType& new_entry, const int& index)
@@ -443,11 +683,11 @@ bool Buffer::InsertDataAtIndex(const BufferEntryType& new_entry, const int& inde
   if (this->get_length() - 1 < index)
   {
     // required index is beyond buffersize, append at the end of the buffer
-    data_.push_back(new_entry);
+    InsertEntry(get_length(), new_entry);
     return true;
   }
 
-  data_.insert(data_.begin() + index, new_entry);
+  InsertEntry(index, new_entry);
   return true;
 }
 
@@ -458,24 +698,24 @@ int Buffer::RemoveOverflowEntrys()
     int delete_idx = 0;  // 0 is the oldest index
 
     // This only keeps sensor states, not measurements or core states
-    if (this->keep_last_sensor_handle_ && (data_[delete_idx].metadata_ == BufferMetadataType::sensor_state))
+    if (this->keep_last_sensor_handle_ && (EntryAt(delete_idx).metadata_ == BufferMetadataType::sensor_state))
     {
       for (int k = 0; k < this->get_length(); k++)
       {
-        if (CheckForLastSensorHandle(data_[delete_idx].sensor_))
+        if (CheckForLastSensorHandle(EntryAt(delete_idx).sensor_))
         {
           delete_idx++;
         }
         else
         {
-          *data_.erase(data_.begin() + delete_idx);
+          EraseEntry(delete_idx);
           return delete_idx;
         }
       }
     }
     else
     {
-      *data_.erase(data_.begin() + delete_idx);
+      EraseEntry(delete_idx);
       return delete_idx;
     }
   }
@@ -488,28 +728,31 @@ bool Buffer::CheckForLastSensorHandle(const std::shared_ptr<SensorAbsClass>& sen
   int num_found_handle = 0;
   int num_found_meas = 0;
 
-  for (const auto& k : data_)
+  for (const auto& chunk : data_->chunks_)
   {
-    if (k.sensor_ == sensor_handle)
+    for (const auto& k : *chunk)
     {
-      if (k.metadata_ == BufferMetadataType::measurement)
+      if (k.sensor_ == sensor_handle)
       {
-        num_found_meas++;
-
-        if (num_found_meas > 1)
+        if (k.metadata_ == BufferMetadataType::measurement)
         {
-          return true;
+          num_found_meas++;
+
+          if (num_found_meas > 1)
+          {
+            return true;
+          }
         }
-      }
-      else
-      {
-        if (k.metadata_ == BufferMetadataType::sensor_state)
+        else
         {
-          num_found_handle++;
-
-          if (num_found_handle > 1 || num_found_meas > 0)
+          if (k.metadata_ == BufferMetadataType::sensor_state)
           {
-            return false;
+            num_found_handle++;
+
+            if (num_found_handle > 1 || num_found_meas > 0)
+            {
+              return false;
+            }
           }
         }
       }
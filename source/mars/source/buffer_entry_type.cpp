@@ -19,11 +19,6 @@ BufferEntryType::BufferEntryType(const Time& timestamp, BufferDataType data, std
                                  const int& metadata)
   : timestamp_(timestamp), data_(std::move(data)), sensor_(move(sensor)), metadata_(metadata)
 {
-  metadata_state_filter_ = std::set<int>(
-      { BufferMetadataType::core_state, BufferMetadataType::sensor_state, BufferMetadataType::init_state });
-
-  metadata_measurement_filter_ =
-      std::set<int>({ BufferMetadataType::measurement, BufferMetadataType::measurement_ooo });
 }
 
 bool BufferEntryType::operator<(const BufferEntryType& rhs) const
@@ -57,11 +52,13 @@ std::ostream& operator<<(std::ostream& out, const BufferEntryType& entry)
 
 bool BufferEntryType::IsState() const
 {
-  return (metadata_state_filter_.find(metadata_) != metadata_state_filter_.end());
+  // The filters are not stored per entry, this keeps copies of entries cheap
+  return metadata_ == BufferMetadataType::core_state || metadata_ == BufferMetadataType::sensor_state ||
+         metadata_ == BufferMetadataType::init_state;
 }
 
 bool BufferEntryType::IsMeasurement() const
 {
-  return (metadata_measurement_filter_.find(metadata_) != metadata_measurement_filter_.end());
+  return metadata_ == BufferMetadataType::measurement || metadata_ == BufferMetadataType::measurement_ooo;
 }
 }  // namespace mars
@@ -10,9 +10,13 @@
 
 #include <mars/core_logic.h>
 #include <mars/general_functions/utils.h>
+#include <mars/journal.h>
 #include <mars/nearest_cov.h>
 #include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/shm_state_publisher.h>
+#include <mars/smoother_interface.h>
 #include <mars/type_definitions/core_type.h>
+#include <algorithm>
 
 namespace mars
 {
@@ -21,8 +25,23 @@ CoreLogic::CoreLogic(std::shared_ptr<CoreState> core_states) : core_states_(move
   std::cout << "Created: CoreLogic" << std::endl;
 }
 
+CoreLogic CoreLogic::Clone() const
+{
+  // The buffer copies share their entries copy-on-write
+  CoreLogic clone(*this);
+  clone.journal_ = nullptr;
+  clone.smoother_ = nullptr;
+  clone.state_publisher_ = nullptr;
+  return clone;
+}
+
 int CoreLogic::Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init)
 {
+  if (journal_ != nullptr)
+  {
+    journal_->RecordInitialize(p_wi_init, q_wi_init);
+  }
+
   if (buffer_prior_core_init_.IsEmpty())
   {
     std::cout << "CoreLogic: "
@@ -63,6 +82,13 @@ int CoreLogic::Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quatern
                                        latest_prop_sensor_buffer_entry.sensor_, mars::BufferMetadataType::init_state);
 
   buffer_.AddEntrySorted(new_core_state_entry);
+  sensor_cross_cov_.clear();
+
+  if (smoother_ != nullptr)
+  {
+    smoother_->Reset();
+    smoother_->AddStep(new_core_state_entry, new_core_state_entry);
+  }
 
   core_is_initialized_ = true;
   std::cout << "Info: Filter was initialized" << std::endl;
@@ -122,6 +148,82 @@ Eigen::MatrixXd CoreLogic::PropagateSensorCrossCov(const Eigen::MatrixXd& sensor
   return propagated_cov;
 }
 
+Eigen::MatrixXd CoreLogic::CalcPriorSensorCov(const std::shared_ptr<SensorAbsClass>& sensor,
+                                              const Eigen::MatrixXd& sensor_cov, const int& prior_sensor_idx,
+                                              const int& prior_core_idx, const CoreStateMatrix& core_cov)
+{
+  auto cross_cov = sensor_cross_cov_.find(sensor);
+
+  if (!sensor->incremental_cross_cov_ || cross_cov == sensor_cross_cov_.end())
+  {
+    // Generate state transition block between prior_sensor_idx and prior_core_idx
+    CoreStateMatrix state_transition = GenerateStateTransitionBlock(prior_sensor_idx, prior_core_idx);
+    return PropagateSensorCrossCov(sensor_cov, core_cov, state_transition);
+  }
+
+  const int core_cov_size = core_states_->state.size_error_;
+  const int sensor_cov_size = static_cast<int>(sensor_cov.rows()) - core_cov_size;
+
+  Eigen::MatrixXd prior_cov(sensor_cov);
+  prior_cov.block(0, 0, core_cov_size, core_cov_size) = core_cov;
+  prior_cov.block(0, core_cov_size, core_cov_size, sensor_cov_size) = cross_cov->second;
+  prior_cov.block(core_cov_size, 0, sensor_cov_size, core_cov_size) = cross_cov->second.transpose();
+
+  return prior_cov;
+}
+
+void CoreLogic::SetSensorCrossCov(const BufferEntryType& sensor_state_entry)
+{
+  if (!sensor_state_entry.sensor_->incremental_cross_cov_)
+  {
+    return;
+  }
+
+  const int core_cov_size = core_states_->state.size_error_;
+  const Eigen::MatrixXd sensor_cov = sensor_state_entry.sensor_->get_covariance(sensor_state_entry.data_.sensor_);
+  const int sensor_cov_size = static_cast<int>(sensor_cov.rows()) - core_cov_size;
+
+  sensor_cross_cov_[sensor_state_entry.sensor_] = sensor_cov.block(0, core_cov_size, core_cov_size, sensor_cov_size);
+}
+
+void CoreLogic::PropagateIncrementalCrossCov(const BufferEntryType& core_state_entry)
+{
+  if (sensor_cross_cov_.empty())
+  {
+    return;
+  }
+
+  const CoreStateMatrix& state_transition =
+      static_cast<CoreType*>(core_state_entry.data_.core_.get())->state_transition_;
+
+  for (auto& k : sensor_cross_cov_)
+  {
+    k.second = state_transition * k.second;
+  }
+}
+
+void CoreLogic::PublishState(const Time& timestamp, const bool& is_update)
+{
+  if (state_publisher_ == nullptr)
+  {
+    return;
+  }
+
+  if (!is_update)
+  {
+    if (state_publisher_period_ < 0 ||
+        (has_published_state_ && (timestamp - published_state_time_).get_seconds() < state_publisher_period_))
+    {
+      return;
+    }
+
+    has_published_state_ = true;
+    published_state_time_ = timestamp;
+  }
+
+  state_publisher_->Publish(buffer_);
+}
+
 bool CoreLogic::PerformSensorUpdate(BufferEntryType* state_buffer_entry_return, std::shared_ptr<SensorAbsClass> sensor,
                                     const Time& timestamp, std::shared_ptr<BufferDataType> sensor_data)
 {
@@ -147,6 +249,7 @@ bool CoreLogic::PerformSensorUpdate(BufferEntryType* state_buffer_entry_return,
     BufferDataType init_data =
         sensor->Initialize(timestamp, sensor_data->sensor_, std::make_shared<CoreType>(latest_core_data));
     *state_buffer_entry_return = BufferEntryType(timestamp, init_data, sensor, BufferMetadataType::init_state);
+    SetSensorCrossCov(*state_buffer_entry_return);
 
     return true;
   }
@@ -167,31 +270,19 @@ bool CoreLogic::PerformSensorUpdate(BufferEntryType* state_buffer_entry_return,
     return false;
   }
 
-  // Since the measurement was not out of order, get latest state is valid
-  mars::BufferEntryType latest_state_buffer_entry;
-  buffer_.get_latest_state(&latest_state_buffer_entry);
-
-  CoreType core_prev = *static_cast<CoreType*>(latest_state_buffer_entry.data_.core_.get());
-  IMUMeasurementType imu_meas_curr(core_prev.state_.a_m_, core_prev.state_.w_m_);
-  BufferDataType interm_prop;
-  interm_prop.set_sensor_data(std::make_shared<IMUMeasurementType>(imu_meas_curr));
-
-  mars::BufferEntryType new_core_state_entry;
-  new_core_state_entry = PerformCoreStatePropagation(latest_state_buffer_entry.sensor_, timestamp,
-                                                     std::make_shared<BufferDataType>(interm_prop),
-                                                     std::make_shared<BufferEntryType>(latest_state_buffer_entry));
+  // Since the measurement was not out of order, the latest state is valid
+  mars::BufferEntryType new_core_state_entry = PerformIntermediatePropagation(timestamp);
+  update_prior_entry_ = new_core_state_entry;
 
   // Extract prior information from buffer entry
   CoreType prior_core_data = *static_cast<CoreType*>(new_core_state_entry.data_.core_.get());
 
   Eigen::MatrixXd prior_sensor_covariance = sensor->get_covariance(prior_sensor_state_entry.data_.sensor_);
 
-  Utils::CheckCov(prior_core_data.cov_, "CoreLogic: Core cov prior");
+  cov_health_.Check(prior_core_data.cov_, "CoreLogic: Core cov prior");
 
-  // Generate state transition block between prior_sensor_idx and prior_core_idx
-  CoreStateMatrix state_transition = GenerateStateTransitionBlock(prior_sensor_idx, prior_core_idx);
-
-  Eigen::MatrixXd prior_cov = PropagateSensorCrossCov(prior_sensor_covariance, prior_core_data.cov_, state_transition);
+  Eigen::MatrixXd prior_cov =
+      CalcPriorSensorCov(sensor, prior_sensor_covariance, prior_sensor_idx, prior_core_idx, prior_core_data.cov_);
 
   NearestCov correct_cov(prior_cov);
   Eigen::MatrixXd corrected_cov = correct_cov.EigenCorrectionUsingCovariance(NearestCovMethod::abs);
@@ -212,6 +303,7 @@ bool CoreLogic::PerformSensorUpdate(BufferEntryType* state_buffer_entry_return,
     // Generate buffer entry and return the corrected states
     *state_buffer_entry_return =
         BufferEntryType(timestamp, corrected_state_data, sensor, BufferMetadataType::sensor_state);
+    SetSensorCrossCov(*state_buffer_entry_return);
 
     return true;
   }
@@ -221,6 +313,232 @@ bool CoreLogic::PerformSensorUpdate(BufferEntryType* state_buffer_entry_return,
   }
 }
 
+bool CoreLogic::PerformStackedSensorUpdate(std::vector<BufferEntryType>* state_buffer_entries_return,
+                                           const std::vector<BufferEntryType>& measurements)
+{
+  if (verbose_)
+  {
+    std::cout << "[CoreLogic]: Perform Stacked Sensor Update (" << measurements.size() << " measurements)" << std::endl;
+  }
+
+  // The update is performed at the latest timestamp of the group
+  Time timestamp = measurements.front().timestamp_;
+  for (const auto& k : measurements)
+  {
+    timestamp = std::max(timestamp, k.timestamp_);
+  }
+
+  BufferEntryType prior_core_state_entry;
+  int prior_core_idx;
+  if (!buffer_.get_closest_state(timestamp, &prior_core_state_entry, &prior_core_idx))
+  {
+    std::cout << "Warning: Could not perform Sensor update. No core state in buffer" << std::endl;
+    return false;
+  }
+
+  // Since the measurements are not out of order, the latest state is valid
+  mars::BufferEntryType new_core_state_entry = PerformIntermediatePropagation(timestamp);
+  update_prior_entry_ = new_core_state_entry;
+
+  CoreType prior_core_data = *static_cast<CoreType*>(new_core_state_entry.data_.core_.get());
+  cov_health_.Check(prior_core_data.cov_, "CoreLogic: Core cov prior");
+
+  const int size_of_core_state = CoreStateType::size_error_;
+  const int num_sensors = static_cast<int>(measurements.size());
+
+  // Propagated core-sensor covariance and sensor state of each sensor
+  std::vector<Eigen::MatrixXd> sensor_covs(measurements.size());
+  std::vector<std::shared_ptr<void>> prior_sensor_data(measurements.size());
+  std::vector<int> sensor_state_idx(measurements.size() + 1, size_of_core_state);
+
+  for (int k = 0; k < num_sensors; k++)
+  {
+    const std::shared_ptr<SensorAbsClass>& sensor = measurements[k].sensor_;
+
+    BufferEntryType prior_sensor_state_entry;
+    int prior_sensor_idx;
+    if (!buffer_.get_latest_sensor_handle_state(sensor, &prior_sensor_state_entry, &prior_sensor_idx))
+    {
+      std::cout << "Warning: Could not perform Sensor update. No corresponding prior sensor state in buffer"
+                << std::endl;
+      return false;
+    }
+
+    prior_sensor_data[k] = prior_sensor_state_entry.data_.sensor_;
+
+    Eigen::MatrixXd prior_sensor_covariance = sensor->get_covariance(prior_sensor_data[k]);
+    sensor_covs[k] =
+        CalcPriorSensorCov(sensor, prior_sensor_covariance, prior_sensor_idx, prior_core_idx, prior_core_data.cov_);
+
+    sensor_state_idx[k + 1] = sensor_state_idx[k] + static_cast<int>(sensor_covs[k].rows()) - size_of_core_state;
+  }
+
+  // Joint covariance of the core state and all sensor states, sensors are not correlated with each other
+  const int size_of_joint_state = sensor_state_idx.back();
+  Eigen::MatrixXd prior_cov(Eigen::MatrixXd::Zero(size_of_joint_state, size_of_joint_state));
+  prior_cov.block(0, 0, size_of_core_state, size_of_core_state) = prior_core_data.cov_;
+
+  for (int k = 0; k < num_sensors; k++)
+  {
+    const int idx = sensor_state_idx[k];
+    const int dim = sensor_state_idx[k + 1] - idx;
+
+    const Eigen::MatrixXd& sensor_cov = sensor_covs[k];
+
+    prior_cov.block(0, idx, size_of_core_state, dim) = sensor_cov.block(0, size_of_core_state, size_of_core_state, dim);
+    prior_cov.block(idx, 0, dim, size_of_core_state) = sensor_cov.block(size_of_core_state, 0, dim, size_of_core_state);
+    prior_cov.block(idx, idx, dim, dim) = sensor_cov.block(size_of_core_state, size_of_core_state, dim, dim);
+  }
+
+  NearestCov correct_cov(prior_cov);
+  Eigen::MatrixXd corrected_cov = correct_cov.EigenCorrectionUsingCovariance(NearestCovMethod::abs);
+
+  // Stack the measurement models
+  std::vector<Eigen::MatrixXd> H_list(measurements.size());
+  std::vector<Eigen::MatrixXd> R_list(measurements.size());
+  std::vector<Eigen::MatrixXd> res_list(measurements.size());
+  int size_of_measurements = 0;
+
+  // The sensors of the group share the rotation matrix of the prior orientation
+  const Eigen::Matrix3d R_wi = prior_core_data.state_.q_wi_.toRotationMatrix();
+
+  for (int k = 0; k < num_sensors; k++)
+  {
+    if (!measurements[k].sensor_->CalcMeasurementModel(timestamp, measurements[k].data_.sensor_,
+                                                       prior_core_data.state_, R_wi, prior_sensor_data[k], &H_list[k],
+                                                       &R_list[k], &res_list[k]))
+    {
+      std::cout << "Warning: Class: CoreLogic - " << measurements[k].sensor_->name_
+                << " does not provide a measurement model for stacked updates" << std::endl;
+      return false;
+    }
+
+    size_of_measurements += static_cast<int>(res_list[k].rows());
+  }
+
+  Eigen::MatrixXd H(Eigen::MatrixXd::Zero(size_of_measurements, size_of_joint_state));
+  Eigen::MatrixXd R(Eigen::MatrixXd::Zero(size_of_measurements, size_of_measurements));
+  Eigen::MatrixXd res(size_of_measurements, 1);
+
+  int meas_idx = 0;
+  for (int k = 0; k < num_sensors; k++)
+  {
+    const int rows = static_cast<int>(res_list[k].rows());
+    const int idx = sensor_state_idx[k];
+    const int dim = sensor_state_idx[k + 1] - idx;
+
+    H.block(meas_idx, 0, rows, size_of_core_state) = H_list[k].block(0, 0, rows, size_of_core_state);
+    H.block(meas_idx, idx, rows, dim) = H_list[k].block(0, size_of_core_state, rows, dim);
+
+    // Sensors provide either the diagonal or the full noise matrix
+    if (R_list[k].cols() == 1)
+    {
+      R.block(meas_idx, meas_idx, rows, rows) = R_list[k].asDiagonal();
+    }
+    else
+    {
+      R.block(meas_idx, meas_idx, rows, rows) = R_list[k];
+    }
+
+    res.block(meas_idx, 0, rows, 1) = res_list[k];
+    meas_idx += rows;
+  }
+
+  // Perform EKF calculations
+  mars::Ekf ekf(H, R, res, corrected_cov);
+  const Eigen::MatrixXd correction = ekf.CalculateCorrection();
+
+  Eigen::MatrixXd P_updated = ekf.CalculateCovUpdate();
+  P_updated = Utils::EnforceMatrixSymmetry(P_updated);
+
+  // Apply Core Correction, the corrected core state is shared by all entries
+  CoreStateVector core_correction = correction.block(0, 0, size_of_core_state, 1);
+
+  CoreType core_data;
+  core_data.cov_ = P_updated.block(0, 0, size_of_core_state, size_of_core_state);
+  core_data.state_ = CoreStateType::ApplyCorrection(prior_core_data.state_, core_correction);
+  std::shared_ptr<CoreType> core_data_sptr = std::make_shared<CoreType>(core_data);
+
+  // Apply Sensor Corrections with the core and the individual sensor covariance
+  state_buffer_entries_return->clear();
+
+  for (int k = 0; k < num_sensors; k++)
+  {
+    const int idx = sensor_state_idx[k];
+    const int dim = sensor_state_idx[k + 1] - idx;
+
+    Eigen::MatrixXd sensor_cov(size_of_core_state + dim, size_of_core_state + dim);
+    sensor_cov << P_updated.block(0, 0, size_of_core_state, size_of_core_state),
+        P_updated.block(0, idx, size_of_core_state, dim), P_updated.block(idx, 0, dim, size_of_core_state),
+        P_updated.block(idx, idx, dim, dim);
+
+    std::shared_ptr<void> sensor_data = measurements[k].sensor_->CalcCorrectedSensorData(
+        prior_sensor_data[k], correction.block(idx, 0, dim, 1), sensor_cov);
+
+    BufferDataType corrected_state_data(core_data_sptr, sensor_data);
+    state_buffer_entries_return->push_back(
+        BufferEntryType(timestamp, corrected_state_data, measurements[k].sensor_, BufferMetadataType::sensor_state));
+    SetSensorCrossCov(state_buffer_entries_return->back());
+  }
+
+  num_stacked_updates_++;
+
+  if (verbose_)
+  {
+    std::cout << "[CoreLogic]: Perform Stacked Sensor Update - DONE" << std::endl;
+  }
+
+  return true;
+}
+
+BufferEntryType CoreLogic::PerformIntermediatePropagation(const Time& timestamp)
+{
+  mars::BufferEntryType latest_state_buffer_entry;
+  buffer_.get_latest_state(&latest_state_buffer_entry);
+
+  if ((timestamp - latest_state_buffer_entry.timestamp_).abs().get_seconds() <= interm_prop_threshold_)
+  {
+    num_skipped_interm_prop_++;
+    return latest_state_buffer_entry;
+  }
+
+  if (interm_prop_prior_core_ == latest_state_buffer_entry.data_.core_ && interm_prop_entry_.timestamp_ == timestamp)
+  {
+    num_reused_interm_prop_++;
+    return interm_prop_entry_;
+  }
+
+  // Zero-order hold of the IMU measurement of the latest state
+  CoreType core_prev = *static_cast<CoreType*>(latest_state_buffer_entry.data_.core_.get());
+  IMUMeasurementType imu_meas_curr(core_prev.state_.a_m_, core_prev.state_.w_m_);
+  BufferDataType interm_prop;
+  interm_prop.set_sensor_data(std::make_shared<IMUMeasurementType>(imu_meas_curr));
+
+  interm_prop_entry_ = PerformCoreStatePropagation(latest_state_buffer_entry.sensor_, timestamp,
+                                                   std::make_shared<BufferDataType>(interm_prop),
+                                                   std::make_shared<BufferEntryType>(latest_state_buffer_entry));
+  interm_prop_prior_core_ = latest_state_buffer_entry.data_.core_;
+
+  return interm_prop_entry_;
+}
+
+std::shared_ptr<void> CoreLogic::GetLatestSmootherStep(const int& index) const
+{
+  // Propagated and updated core states are smoother steps, sensor initializations are not
+  for (int k = index - 1; k >= 0; k--)
+  {
+    BufferEntryType entry;
+    buffer_.get_entry_at_idx(k, &entry);
+
+    if (entry.metadata_ == BufferMetadataType::core_state || entry.metadata_ == BufferMetadataType::sensor_state)
+    {
+      return entry.data_.core_;
+    }
+  }
+
+  return nullptr;
+}
+
 BufferEntryType CoreLogic::PerformCoreStatePropagation(std::shared_ptr<SensorAbsClass> sensor, const Time& timestamp,
                                                        const std::shared_ptr<BufferDataType>& data_measurement,
                                                        const std::shared_ptr<BufferEntryType>& prior_state_entry)
@@ -242,13 +560,21 @@ BufferEntryType CoreLogic::PerformCoreStatePropagation(std::shared_ptr<SensorAbs
     std::cout << "Warning: dt for propagation is zero" << std::endl;
   }
 
+  // Consecutive propagation steps convert each orientation to a rotation matrix once, the propagation and the state
+  // transition share the prior rotation matrix
+  const bool is_consecutive = propagated_core_ != nullptr && prior_state_entry->data_.core_ == propagated_core_;
+  const Eigen::Matrix3d R_wi_prior =
+      is_consecutive ? propagated_R_wi_ : Eigen::Matrix3d(prior_core_data.state_.q_wi_.toRotationMatrix());
+
   CoreType propagated_core_state;
-  propagated_core_state = core_states_->PredictProcessCovariance(prior_core_data, meas_system_input, dt.get_seconds());
-  propagated_core_state.state_ =
-      core_states_->PropagateState(prior_core_data.state_, meas_system_input, dt.get_seconds());
+  propagated_core_state =
+      core_states_->PredictProcessCovariance(prior_core_data, R_wi_prior, meas_system_input, dt.get_seconds());
+  propagated_core_state.state_ = core_states_->PropagateState(prior_core_data.state_, R_wi_prior, meas_system_input,
+                                                              dt.get_seconds(), &propagated_R_wi_);
 
   BufferDataType buffer_data;
   buffer_data.set_core_data(std::make_shared<CoreType>(propagated_core_state));
+  propagated_core_ = buffer_data.core_;
 
   BufferEntryType new_core_state_entry(current_time, buffer_data, sensor, mars::BufferMetadataType::core_state);
 
@@ -271,6 +597,16 @@ bool CoreLogic::ReworkBufferStartingAtIndex(const int& index)
 
   buffer_.DeleteStatesStartingAtIdx(index);
 
+  // The smoother drops the steps of the deleted states, the reworked steps are added again
+  if (smoother_ != nullptr)
+  {
+    smoother_->Rewind(GetLatestSmootherStep(index));
+  }
+
+  // The incremental cross-covariances are valid for the latest state only, sensors without a new state during the
+  // rework use the cross-covariance of their state in the buffer
+  sensor_cross_cov_.clear();
+
   // The buffer grows by one index for each additional state,
   // index_offset corrects this
   int index_offset = 0;
@@ -314,6 +650,12 @@ bool CoreLogic::ReworkBufferStartingAtIndex(const int& index)
                                       std::make_shared<BufferEntryType>(latest_state_buffer_entry));
 
       buffer_.InsertDataAtIndex(new_core_state_entry, state_insertion_idx);
+      PropagateIncrementalCrossCov(new_core_state_entry);
+
+      if (smoother_ != nullptr)
+      {
+        smoother_->AddStep(new_core_state_entry, new_core_state_entry);
+      }
     }
     else
     {
@@ -326,6 +668,11 @@ bool CoreLogic::ReworkBufferStartingAtIndex(const int& index)
       }
 
       buffer_.InsertDataAtIndex(new_state_buffer_entry, state_insertion_idx);
+
+      if (smoother_ != nullptr && new_state_buffer_entry.metadata_ == BufferMetadataType::sensor_state)
+      {
+        smoother_->AddStep(update_prior_entry_, new_state_buffer_entry);
+      }
     }
 
     index_offset = index_offset + 1;
@@ -350,6 +697,11 @@ bool CoreLogic::ProcessMeasurement(std::shared_ptr<SensorAbsClass> sensor, const
     std::cout << "[CoreLogic]: Process Measurement (" << sensor->name_ << ")" << std::endl;
   }
 
+  if (journal_ != nullptr)
+  {
+    journal_->RecordMeasurement(sensor, timestamp, data);
+  }
+
   // Generate buffer entry element for the measurement
   mars::BufferEntryType new_measurement_buffer_entry(timestamp, data, sensor, mars::BufferMetadataType::measurement);
 
@@ -454,6 +806,7 @@ bool CoreLogic::ProcessMeasurement(std::shared_ptr<SensorAbsClass> sensor, const
 
     // Reworking the buffer starting at out of order buffer index
     ReworkBufferStartingAtIndex(out_of_order_buffer_idx);
+    PublishState(timestamp, true);
 
     if (verbose_)
     {
@@ -477,6 +830,12 @@ bool CoreLogic::ProcessMeasurement(std::shared_ptr<SensorAbsClass> sensor, const
                                                        std::make_shared<BufferEntryType>(latest_state_buffer_entry));
 
     buffer_.AddEntrySorted(new_core_state_entry);
+    PropagateIncrementalCrossCov(new_core_state_entry);
+
+    if (smoother_ != nullptr)
+    {
+      smoother_->AddStep(new_core_state_entry, new_core_state_entry);
+    }
   }
   else
   {
@@ -488,8 +847,151 @@ bool CoreLogic::ProcessMeasurement(std::shared_ptr<SensorAbsClass> sensor, const
     }
 
     buffer_.AddEntrySorted(new_state_buffer_entry);
+
+    // Sensor initializations do not change the core state
+    if (smoother_ != nullptr && new_state_buffer_entry.metadata_ == BufferMetadataType::sensor_state)
+    {
+      smoother_->AddStep(update_prior_entry_, new_state_buffer_entry);
+    }
   }
 
+  PublishState(timestamp, sensor != core_states_->propagation_sensor_);
+
   return true;
 }
+
+bool CoreLogic::ProcessMeasurements(const std::vector<BufferEntryType>& measurements)
+{
+  if (journal_ == nullptr)
+  {
+    return ProcessMeasurementGroups(measurements);
+  }
+
+  // The call is recorded as a whole, ProcessMeasurement does not record the measurements again
+  std::shared_ptr<JournalWriter> journal = std::move(journal_);
+  journal->RecordMeasurements(measurements, stacked_update_, stacked_update_epsilon_);
+
+  const bool successful = ProcessMeasurementGroups(measurements);
+  journal_ = std::move(journal);
+  return successful;
+}
+
+bool CoreLogic::ProcessMeasurementGroups(const std::vector<BufferEntryType>& measurements)
+{
+  // Sensors prepare the measurements of the batch at once
+  std::map<std::shared_ptr<SensorAbsClass>, std::vector<std::shared_ptr<void>>> sensor_measurements;
+  for (const auto& k : measurements)
+  {
+    sensor_measurements[k.sensor_].push_back(k.data_.sensor_);
+  }
+  for (const auto& k : sensor_measurements)
+  {
+    k.first->PreprocessMeasurements(k.second);
+  }
+
+  if (!stacked_update_)
+  {
+    bool successful = true;
+    for (const auto& k : measurements)
+    {
+      successful &= ProcessMeasurement(k.sensor_, k.timestamp_, k.data_);
+    }
+    return successful;
+  }
+
+  std::vector<BufferEntryType> sorted_measurements(measurements);
+  std::stable_sort(sorted_measurements.begin(), sorted_measurements.end(),
+                   [](const BufferEntryType& a, const BufferEntryType& b) { return a.timestamp_ < b.timestamp_; });
+
+  auto can_be_stacked = [this](const BufferEntryType& entry) {
+    return entry.sensor_ != core_states_->propagation_sensor_ && entry.sensor_->is_initialized_ &&
+           entry.sensor_->SupportsStackedUpdate();
+  };
+
+  bool successful = true;
+  size_t k = 0;
+
+  while (k < sorted_measurements.size())
+  {
+    // Collect measurements of distinct sensors within the time epsilon of the first measurement
+    std::vector<BufferEntryType> group = { sorted_measurements[k] };
+    size_t next = k + 1;
+
+    if (can_be_stacked(sorted_measurements[k]))
+    {
+      while (next < sorted_measurements.size() &&
+             (sorted_measurements[next].timestamp_ - sorted_measurements[k].timestamp_).get_seconds() <=
+                 stacked_update_epsilon_ &&
+             can_be_stacked(sorted_measurements[next]))
+      {
+        const bool sensor_in_group =
+            std::any_of(group.begin(), group.end(), [&sorted_measurements, &next](const BufferEntryType& entry) {
+              return entry.sensor_ == sorted_measurements[next].sensor_;
+            });
+
+        if (sensor_in_group)
+        {
+          break;
+        }
+
+        group.push_back(sorted_measurements[next]);
+        next++;
+      }
+    }
+
+    // Out of order groups are processed sequentially to use the buffer rework
+    bool in_order = false;
+    if (core_is_initialized_ && group.size() > 1)
+    {
+      mars::BufferEntryType latest_buffer_entry;
+      in_order = buffer_.get_latest_entry(&latest_buffer_entry) &&
+                 group.front().timestamp_ >= latest_buffer_entry.timestamp_;
+    }
+
+    if (!in_order)
+    {
+      for (const auto& m : group)
+      {
+        successful &= ProcessMeasurement(m.sensor_, m.timestamp_, m.data_);
+      }
+    }
+    else
+    {
+      std::vector<BufferEntryType> new_state_buffer_entries;
+      if (PerformStackedSensorUpdate(&new_state_buffer_entries, group))
+      {
+        // The measurements are stored once the update succeeded, otherwise they are processed sequentially
+        for (auto& m : group)
+        {
+          m.metadata_ = BufferMetadataType::measurement;
+          buffer_.AddEntrySorted(m);
+        }
+
+        for (const auto& m : new_state_buffer_entries)
+        {
+          buffer_.AddEntrySorted(m);
+        }
+
+        // The entries of a stacked update share the corrected core state
+        if (smoother_ != nullptr)
+        {
+          smoother_->AddStep(update_prior_entry_, new_state_buffer_entries.front());
+        }
+
+        PublishState(group.back().timestamp_, true);
+      }
+      else
+      {
+        for (const auto& m : group)
+        {
+          successful &= ProcessMeasurement(m.sensor_, m.timestamp_, m.data_);
+        }
+      }
+    }
+
+    k = next;
+  }
+
+  return successful;
+}
 }  // namespace mars
@@ -13,6 +13,7 @@
 #include <mars/time.h>
 #include <mars/type_definitions/core_state_type.h>
 
+#include <cmath>
 #include <utility>
 
 namespace mars
@@ -94,6 +95,13 @@ CoreStateMatrix CoreState::InitializeCovariance()
 
 CoreStateType CoreState::PropagateState(const CoreStateType& prior_state, const IMUMeasurementType& measurement,
                                         const double& dt)
+{
+  Eigen::Matrix3d R_wi;
+  return PropagateState(prior_state, prior_state.q_wi_.toRotationMatrix(), measurement, dt, &R_wi);
+}
+
+CoreStateType CoreState::PropagateState(const CoreStateType& prior_state, const Eigen::Matrix3d& R_wi_prior,
+                                        const IMUMeasurementType& measurement, const double& dt, Eigen::Matrix3d* R_wi)
 {
   CoreStateType current_state;
 
@@ -125,6 +133,25 @@ CoreStateType CoreState::PropagateState(const CoreStateType& prior_state, const
   // First order Quaternion integration
   const Eigen::Vector3d ew = current_state.w_m_ - current_state.b_w_;
   const Eigen::Vector3d ew_old = prior_state.w_m_ - prior_state.b_w_;
+
+  const Eigen::Vector3d ea = current_state.a_m_ - current_state.b_a_;
+  const Eigen::Vector3d ea_old = prior_state.a_m_ - prior_state.b_a_;
+
+  // R_wi may alias R_wi_prior, the prior term is evaluated before R_wi is overwritten
+  const Eigen::Vector3d a_old_w = R_wi_prior * ea_old;
+
+  if (closed_form_quat_integration_)
+  {
+    current_state.q_wi_ = IntegrateQuaternionClosedForm(prior_state.q_wi_, ew_old, ew, delta_t);
+    *R_wi = current_state.q_wi_.toRotationMatrix();
+
+    const Eigen::Vector3d dv = (*R_wi * ea + a_old_w) / 2;
+    current_state.v_wi_ = prior_state.v_wi_ + (dv - g_) * delta_t;
+    current_state.p_wi_ = prior_state.p_wi_ + ((current_state.v_wi_ + prior_state.v_wi_) / 2) * delta_t;
+
+    return current_state;
+  }
+
   const Eigen::Vector3d median_turn_rate = (ew_old + ew) / 2;
 
   // Quaternion right side multiplication matrix from angular turn rates
@@ -148,13 +175,10 @@ CoreStateType CoreState::PropagateState(const CoreStateType& prior_state, const
   current_state.q_wi_ = Eigen::Quaterniond(current_q_wi_coeffs.x(), current_q_wi_coeffs.y(), current_q_wi_coeffs.z(),
                                            current_q_wi_coeffs.w());
   current_state.q_wi_.normalize();
+  *R_wi = current_state.q_wi_.toRotationMatrix();
 
   // integrate linear acceleration
-  const Eigen::Vector3d ea = current_state.a_m_ - current_state.b_a_;
-  const Eigen::Vector3d ea_old = prior_state.a_m_ - prior_state.b_a_;
-
-  const Eigen::Vector3d dv =
-      (current_state.q_wi_.toRotationMatrix() * ea + prior_state.q_wi_.toRotationMatrix() * ea_old) / 2;
+  const Eigen::Vector3d dv = (*R_wi * ea + a_old_w) / 2;
   current_state.v_wi_ = prior_state.v_wi_ + (dv - g_) * delta_t;
 
   // integrate velocity
@@ -163,8 +187,44 @@ CoreStateType CoreState::PropagateState(const CoreStateType& prior_state, const
   return current_state;
 }
 
+Eigen::Quaterniond CoreState::IntegrateQuaternionClosedForm(const Eigen::Quaterniond& q_wi,
+                                                            const Eigen::Vector3d& w_old, const Eigen::Vector3d& w,
+                                                            const double& dt)
+{
+  // Rotation vector exponential of the median turn rate, exp([0, w_med * dt / 2])
+  const Eigen::Vector3d w_med = (w_old + w) / 2;
+  const double w_med_norm = w_med.norm();
+  const double half_angle = w_med_norm * dt / 2;
+
+  double sin_scale;
+  if (half_angle > 1e-4)
+  {
+    sin_scale = std::sin(half_angle) / w_med_norm;
+  }
+  else
+  {
+    // sin(x) / x Taylor series, the truncation error is below the double precision
+    sin_scale = (dt / 2) * (1 - half_angle * half_angle / 6);
+  }
+
+  // Commutator term of the first order integration
+  const Eigen::Vector3d u = sin_scale * w_med + (dt * dt / 24) * w_old.cross(w);
+  const Eigen::Quaterniond dq(std::cos(half_angle), u.x(), u.y(), u.z());
+
+  Eigen::Quaterniond q_new = q_wi * dq;
+  q_new.normalize();
+  return q_new;
+}
+
 CoreType CoreState::PredictProcessCovariance(const CoreType& prior_core_state, const IMUMeasurementType& system_input,
                                              const double& dt)
+{
+  return PredictProcessCovariance(prior_core_state, prior_core_state.state_.q_wi_.toRotationMatrix(), system_input,
+                                  dt);
+}
+
+CoreType CoreState::PredictProcessCovariance(const CoreType& prior_core_state, const Eigen::Matrix3d& R_wi,
+                                             const IMUMeasurementType& system_input, const double& dt)
 {
   const CoreStateMatrix P = prior_core_state.cov_;
   const Eigen::Quaterniond q_wi(prior_core_state.state_.q_wi_);
@@ -178,7 +238,7 @@ CoreType CoreState::PredictProcessCovariance(const CoreType& prior_core_state, c
   const Eigen::Vector3d a_est = a_m - b_a;
 
   // State-Transition and Process-Noise
-  CoreStateMatrix F_d = GenerateFdSmallAngleApprox(q_wi, a_est, w_est, dt);
+  CoreStateMatrix F_d = GenerateFdSmallAngleApprox(R_wi, a_est, w_est, dt);
   CoreStateMatrix Q_d =
       CalcQSmallAngleApprox(dt, q_wi, a_m, this->n_a_, b_a, this->n_ba_, w_m, this->n_w_, b_w, this->n_bw_);
 
@@ -196,8 +256,12 @@ CoreType CoreState::PredictProcessCovariance(const CoreType& prior_core_state, c
 CoreStateMatrix CoreState::GenerateFdSmallAngleApprox(const Eigen::Quaterniond& q_wi, const Eigen::Vector3d& a_est,
                                                       const Eigen::Vector3d& w_est, const double& dt)
 {
-  const Eigen::Matrix3d R = q_wi.toRotationMatrix();
+  return GenerateFdSmallAngleApprox(q_wi.toRotationMatrix(), a_est, w_est, dt);
+}
 
+CoreStateMatrix CoreState::GenerateFdSmallAngleApprox(const Eigen::Matrix3d& R, const Eigen::Vector3d& a_est,
+                                                      const Eigen::Vector3d& w_est, const double& dt)
+{
   const Eigen::Matrix3d I(Eigen::Matrix3d::Identity());
 
   // Prepare dt powers (dt_p2 = dt power 2)
@@ -0,0 +1,392 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/core_state.h>
+#include <mars/core_state_bank.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace mars
+{
+namespace
+{
+///
+/// \brief IsTransitionNonZero Returns true for the structurally non zero elements of
+/// CoreState::GenerateFdSmallAngleApprox
+///
+bool IsTransitionNonZero(const int& row, const int& col)
+{
+  if (row == col)
+  {
+    return true;
+  }
+  if (row < 3)
+  {
+    return col >= 6 || col == row + 3;
+  }
+  if (row < 6)
+  {
+    return col >= 6;
+  }
+  if (row < 9)
+  {
+    return col >= 6 && col < 12;
+  }
+  return false;
+}
+
+///
+/// \brief The TransitionPattern struct lists the non zero columns of each row of the state transition matrix
+///
+struct TransitionPattern
+{
+  std::array<std::array<int, CoreStateType::size_error_>, CoreStateType::size_error_> cols_;
+  std::array<int, CoreStateType::size_error_> num_;
+
+  TransitionPattern()
+  {
+    for (int r = 0; r < CoreStateType::size_error_; r++)
+    {
+      num_[r] = 0;
+      for (int c = 0; c < CoreStateType::size_error_; c++)
+      {
+        if (IsTransitionNonZero(r, c))
+        {
+          cols_[r][num_[r]++] = c;
+        }
+      }
+    }
+  }
+};
+}  // namespace
+
+constexpr int CoreStateBank::kLaneBlock;
+
+CoreStateBank::CoreStateBank(const int& num_filters) : num_filters_(std::max(num_filters, 0))
+{
+  state_ = BankArray::Zero(kStateRows, num_filters_);
+  cov_ = BankArray::Zero(kCovSize * kCovSize, num_filters_);
+  transition_ = BankArray::Zero(kCovSize * kCovSize, num_filters_);
+  noise_ = BankArray::Zero(kNoiseRows, num_filters_);
+
+  // Identity orientation and state transition
+  state_.row(kQwi).setOnes();
+  for (int k = 0; k < kCovSize; k++)
+  {
+    transition_.row(k * kCovSize + k).setOnes();
+  }
+}
+
+int CoreStateBank::get_num_filters() const
+{
+  return num_filters_;
+}
+
+void CoreStateBank::set_noise_std(const int& idx, const Eigen::Vector3d& n_w, const Eigen::Vector3d& n_bw,
+                                  const Eigen::Vector3d& n_a, const Eigen::Vector3d& n_ba)
+{
+  assert(idx >= 0 && idx < num_filters_);
+
+  noise_.col(idx).segment(kNw, 3) = n_w.array();
+  noise_.col(idx).segment(kNbw, 3) = n_bw.array();
+  noise_.col(idx).segment(kNa, 3) = n_a.array();
+  noise_.col(idx).segment(kNba, 3) = n_ba.array();
+}
+
+void CoreStateBank::set_core(const int& idx, const CoreType& core)
+{
+  assert(idx >= 0 && idx < num_filters_);
+
+  const CoreStateType& s = core.state_;
+  state_.col(idx).segment(kPwi, 3) = s.p_wi_.array();
+  state_.col(idx).segment(kVwi, 3) = s.v_wi_.array();
+  state_.col(idx).segment(kQwi, 4) = Eigen::Array4d(s.q_wi_.w(), s.q_wi_.x(), s.q_wi_.y(), s.q_wi_.z());
+  state_.col(idx).segment(kBw, 3) = s.b_w_.array();
+  state_.col(idx).segment(kBa, 3) = s.b_a_.array();
+  state_.col(idx).segment(kWm, 3) = s.w_m_.array();
+  state_.col(idx).segment(kAm, 3) = s.a_m_.array();
+
+  const Eigen::Matrix<double, kCovSize, kCovSize, Eigen::RowMajor> cov(core.cov_);
+  cov_.col(idx) = Eigen::Map<const Eigen::Array<double, kCovSize * kCovSize, 1>>(cov.data());
+}
+
+CoreType CoreStateBank::get_core(const int& idx) const
+{
+  assert(idx >= 0 && idx < num_filters_);
+
+  CoreType core;
+  core.state_.p_wi_ = state_.col(idx).segment(kPwi, 3).matrix();
+  core.state_.v_wi_ = state_.col(idx).segment(kVwi, 3).matrix();
+  core.state_.q_wi_ = Eigen::Quaterniond(state_(kQwi, idx), state_(kQwi + 1, idx), state_(kQwi + 2, idx),
+                                         state_(kQwi + 3, idx));
+  core.state_.b_w_ = state_.col(idx).segment(kBw, 3).matrix();
+  core.state_.b_a_ = state_.col(idx).segment(kBa, 3).matrix();
+  core.state_.w_m_ = state_.col(idx).segment(kWm, 3).matrix();
+  core.state_.a_m_ = state_.col(idx).segment(kAm, 3).matrix();
+
+  Eigen::Matrix<double, kCovSize * kCovSize, 1> flat;
+  flat = cov_.col(idx).matrix();
+  core.cov_ = Eigen::Map<const Eigen::Matrix<double, kCovSize, kCovSize, Eigen::RowMajor>>(flat.data());
+  flat = transition_.col(idx).matrix();
+  core.state_transition_ = Eigen::Map<const Eigen::Matrix<double, kCovSize, kCovSize, Eigen::RowMajor>>(flat.data());
+
+  return core;
+}
+
+void CoreStateBank::Propagate(const IMUMeasurementType& measurement, const double& dt)
+{
+  for (int start = 0; start < num_filters_; start += kLaneBlock)
+  {
+    PropagateBlock(start, std::min(kLaneBlock, num_filters_ - start), measurement, dt);
+  }
+}
+
+void CoreStateBank::PropagateBlock(const int& start, const int& num, const IMUMeasurementType& measurement,
+                                   const double& dt)
+{
+  using LaneMat3 = std::array<Lanes, 9>;  // Row major 3x3 matrix of lanes
+
+  static const TransitionPattern pattern;
+
+  auto load = [&](const BankArray& bank, const int& row) -> Lanes {
+    return bank.row(row).segment(start, num).transpose();
+  };
+  auto store = [&](BankArray* bank, const int& row, const Lanes& value) {
+    bank->row(row).segment(start, num) = value.transpose();
+  };
+
+  auto mul = [](const LaneMat3& a, const LaneMat3& b) {
+    LaneMat3 res;
+    for (int r = 0; r < 3; r++)
+    {
+      for (int c = 0; c < 3; c++)
+      {
+        res[3 * r + c] = a[3 * r] * b[c] + a[3 * r + 1] * b[3 + c] + a[3 * r + 2] * b[6 + c];
+      }
+    }
+    return res;
+  };
+
+  const Lanes zero(Lanes::Zero(num));
+  const Lanes one(Lanes::Ones(num));
+
+  // I * c0 + S * c1 + S2 * c2
+  auto poly = [&](const LaneMat3& s, const LaneMat3& s2, const double& c0, const double& c1, const double& c2) {
+    LaneMat3 res;
+    for (int k = 0; k < 9; k++)
+    {
+      res[k] = s[k] * c1 + s2[k] * c2;
+    }
+    res[0] += c0;
+    res[4] += c0;
+    res[8] += c0;
+    return res;
+  };
+
+  auto skew = [&](const Lanes* v) {
+    return LaneMat3{ { zero, -v[2], v[1], v[2], zero, -v[0], -v[1], v[0], zero } };
+  };
+
+  auto rotation = [&](const Lanes* q) {
+    const Lanes &w = q[0], &x = q[1], &y = q[2], &z = q[3];
+    return LaneMat3{ { one - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y),  //
+                       2 * (x * y + w * z), one - 2 * (x * x + z * z), 2 * (y * z - w * x),  //
+                       2 * (x * z - w * y), 2 * (y * z + w * x), one - 2 * (x * x + y * y) } };
+  };
+
+  // Prior state
+  Lanes p[3], v[3], q[4], b_w[3], b_a[3], w_m_old[3], a_m_old[3];
+  for (int k = 0; k < 3; k++)
+  {
+    p[k] = load(state_, kPwi + k);
+    v[k] = load(state_, kVwi + k);
+    b_w[k] = load(state_, kBw + k);
+    b_a[k] = load(state_, kBa + k);
+    w_m_old[k] = load(state_, kWm + k);
+    a_m_old[k] = load(state_, kAm + k);
+  }
+  for (int k = 0; k < 4; k++)
+  {
+    q[k] = load(state_, kQwi + k);
+  }
+
+  const Eigen::Vector3d& w_m = measurement.angular_velocity_;
+  const Eigen::Vector3d& a_m = measurement.linear_acceleration_;
+
+  Lanes w_est[3], a_est[3];
+  for (int k = 0; k < 3; k++)
+  {
+    w_est[k] = w_m(k) - b_w[k];
+    a_est[k] = a_m(k) - b_a[k];
+  }
+
+  // State transition, see CoreState::GenerateFdSmallAngleApprox
+  const double dt_p2 = dt * dt;
+  const double dt_p3 = dt_p2 * dt;
+  const double dt_p4 = dt_p2 * dt_p2;
+  const double dt_p5 = dt_p4 * dt;
+
+  const LaneMat3 R = rotation(q);
+  const LaneMat3 skew_w_est = skew(w_est);
+  const LaneMat3 skew_w_est_p2 = mul(skew_w_est, skew_w_est);
+  LaneMat3 R_skew_a = mul(R, skew(a_est));
+  for (auto& k : R_skew_a)
+  {
+    k = -k;
+  }
+
+  const LaneMat3 A = mul(R_skew_a, poly(skew_w_est, skew_w_est_p2, dt_p2 / 2, -dt_p3 / 6, dt_p4 / 24));
+  const LaneMat3 B = mul(R_skew_a, poly(skew_w_est, skew_w_est_p2, -dt_p3 / 6, dt_p4 / 24, -dt_p5 / 120));
+  const LaneMat3 C = mul(R_skew_a, poly(skew_w_est, skew_w_est_p2, dt, -dt_p2 / 2, dt_p3 / 6));
+  const LaneMat3 E = poly(skew_w_est, skew_w_est_p2, 1, -dt, dt_p2 / 2);
+  const LaneMat3 F = poly(skew_w_est, skew_w_est_p2, -dt, dt_p2 / 2, -dt_p3 / 6);
+
+  std::array<Lanes, kCovSize * kCovSize> F_d;
+  for (int r = 0; r < kCovSize; r++)
+  {
+    F_d[r * kCovSize + r] = one;
+  }
+  for (int r = 0; r < 3; r++)
+  {
+    F_d[r * kCovSize + r + 3] = Lanes::Constant(num, dt);
+    for (int c = 0; c < 3; c++)
+    {
+      const int k = 3 * r + c;
+      F_d[r * kCovSize + 6 + c] = A[k];
+      F_d[r * kCovSize + 9 + c] = B[k];
+      F_d[r * kCovSize + 12 + c] = -R[k] * (dt_p2 / 2);
+      F_d[(r + 3) * kCovSize + 6 + c] = C[k];
+      F_d[(r + 3) * kCovSize + 9 + c] = -A[k];
+      F_d[(r + 3) * kCovSize + 12 + c] = -R[k] * dt;
+      F_d[(r + 6) * kCovSize + 6 + c] = E[k];
+      F_d[(r + 6) * kCovSize + 9 + c] = F[k];
+    }
+  }
+
+  // Covariance propagation P = F_d * P * F_d^T, only structurally non zero elements of F_d are used
+  std::array<Lanes, kCovSize * kCovSize> FP;
+  for (int r = 0; r < kCovSize; r++)
+  {
+    for (int c = 0; c < kCovSize; c++)
+    {
+      Lanes sum(zero);
+      for (int n = 0; n < pattern.num_[r]; n++)
+      {
+        const int k = pattern.cols_[r][n];
+        sum += F_d[r * kCovSize + k] * load(cov_, k * kCovSize + c);
+      }
+      FP[r * kCovSize + c] = sum;
+    }
+  }
+
+  for (int r = 0; r < kCovSize; r++)
+  {
+    for (int c = r; c < kCovSize; c++)
+    {
+      Lanes sum(zero);
+      for (int n = 0; n < pattern.num_[c]; n++)
+      {
+        const int k = pattern.cols_[c][n];
+        sum += FP[r * kCovSize + k] * F_d[c * kCovSize + k];
+      }
+      store(&cov_, r * kCovSize + c, sum);
+      store(&cov_, c * kCovSize + r, sum);
+    }
+  }
+
+  for (int r = 0; r < kCovSize; r++)
+  {
+    for (int c = 0; c < kCovSize; c++)
+    {
+      store(&transition_, r * kCovSize + c, IsTransitionNonZero(r, c) ? F_d[r * kCovSize + c] : zero);
+    }
+  }
+
+  // Process noise, evaluated per filter
+  for (int l = 0; l < num; l++)
+  {
+    const int idx = start + l;
+    const Eigen::Quaterniond q_wi(q[0](l), q[1](l), q[2](l), q[3](l));
+    const Eigen::Vector3d b_a_l(b_a[0](l), b_a[1](l), b_a[2](l));
+    const Eigen::Vector3d b_w_l(b_w[0](l), b_w[1](l), b_w[2](l));
+
+    const CoreStateMatrix Q_d = CoreState::CalcQSmallAngleApprox(
+        dt, q_wi, a_m, noise_.col(idx).segment(kNa, 3).matrix(), b_a_l, noise_.col(idx).segment(kNba, 3).matrix(),
+        w_m, noise_.col(idx).segment(kNw, 3).matrix(), b_w_l, noise_.col(idx).segment(kNbw, 3).matrix());
+
+    const Eigen::Matrix<double, kCovSize, kCovSize, Eigen::RowMajor> Q_sym((Q_d + Q_d.transpose()) / 2);
+    cov_.col(idx) += Eigen::Map<const Eigen::Array<double, kCovSize * kCovSize, 1>>(Q_sym.data());
+  }
+
+  // State propagation, see CoreState::PropagateState
+  const double delta_t = std::abs(dt);
+
+  // With W = OmegaMat(w) the relations W * W = -|w|^2 * I and OmegaMat(a) * OmegaMat(b) - OmegaMat(b) * OmegaMat(a)
+  // = OmegaMat(2 * b x a) hold. The 4th order matrix exponential and the commutator term of the first order
+  // quaternion integration therefore reduce to q_new = c_0 * q + q * [0, u].
+  Lanes ew_old[3], ew_med[3];
+  for (int k = 0; k < 3; k++)
+  {
+    ew_old[k] = w_m_old[k] - b_w[k];
+    ew_med[k] = (ew_old[k] + w_est[k]) / 2;
+  }
+
+  const Lanes theta_p2 =
+      (ew_med[0] * ew_med[0] + ew_med[1] * ew_med[1] + ew_med[2] * ew_med[2]) * (delta_t * delta_t / 4);
+  const Lanes c_0 = one - theta_p2 / 2 + theta_p2 * theta_p2 / 24;
+  const Lanes c_1 = (one - theta_p2 / 6) * (delta_t / 2);
+  const double c_2 = delta_t * delta_t / 24;
+
+  Lanes u[3];
+  u[0] = c_1 * ew_med[0] + (ew_old[1] * w_est[2] - ew_old[2] * w_est[1]) * c_2;
+  u[1] = c_1 * ew_med[1] + (ew_old[2] * w_est[0] - ew_old[0] * w_est[2]) * c_2;
+  u[2] = c_1 * ew_med[2] + (ew_old[0] * w_est[1] - ew_old[1] * w_est[0]) * c_2;
+
+  Lanes q_new[4];
+  q_new[0] = c_0 * q[0] - (q[1] * u[0] + q[2] * u[1] + q[3] * u[2]);
+  q_new[1] = c_0 * q[1] + q[0] * u[0] + q[2] * u[2] - q[3] * u[1];
+  q_new[2] = c_0 * q[2] + q[0] * u[1] + q[3] * u[0] - q[1] * u[2];
+  q_new[3] = c_0 * q[3] + q[0] * u[2] + q[1] * u[1] - q[2] * u[0];
+
+  const Lanes q_norm = (q_new[0] * q_new[0] + q_new[1] * q_new[1] + q_new[2] * q_new[2] + q_new[3] * q_new[3]).sqrt();
+  for (auto& k : q_new)
+  {
+    k /= q_norm;
+  }
+
+  const LaneMat3 R_new = rotation(q_new);
+
+  Lanes ea_old[3];
+  for (int k = 0; k < 3; k++)
+  {
+    ea_old[k] = a_m_old[k] - b_a[k];
+  }
+
+  for (int r = 0; r < 3; r++)
+  {
+    const Lanes dv = (R_new[3 * r] * a_est[0] + R_new[3 * r + 1] * a_est[1] + R_new[3 * r + 2] * a_est[2] +
+                      R[3 * r] * ea_old[0] + R[3 * r + 1] * ea_old[1] + R[3 * r + 2] * ea_old[2]) /
+                     2;
+    const Lanes v_new = v[r] + (dv - g_(r)) * delta_t;
+
+    store(&state_, kPwi + r, p[r] + ((v_new + v[r]) / 2) * delta_t);
+    store(&state_, kVwi + r, v_new);
+    store(&state_, kWm + r, Lanes::Constant(num, w_m(r)));
+    store(&state_, kAm + r, Lanes::Constant(num, a_m(r)));
+  }
+
+  for (int k = 0; k < 4; k++)
+  {
+    store(&state_, kQwi + k, q_new[k]);
+  }
+}
+}  // namespace mars
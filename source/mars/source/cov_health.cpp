@@ -0,0 +1,141 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/cov_health.h>
+#include <Eigen/Cholesky>
+#include <Eigen/Eigenvalues>
+#include <iostream>
+
+namespace mars
+{
+bool CovHealthMonitor::Check(const CoreStateMatrix& cov, const char* description)
+{
+  if (level_ == CovCheckLevel::none)
+  {
+    return true;
+  }
+
+  num_checks_++;
+  bool result = CheckBasic(cov, description);
+
+  // Full checks for each covariance, after anomalies and sampled
+  const bool sampled = full_check_interval_ > 0 && num_checks_ % full_check_interval_ == 0;
+  if (level_ == CovCheckLevel::full || !result || sampled)
+  {
+    result = CheckFull(cov, description) && result;
+  }
+
+  if (!result)
+  {
+    num_anomalies_++;
+  }
+
+  return result;
+}
+
+int CovHealthMonitor::get_num_anomalies() const
+{
+  return num_anomalies_;
+}
+
+void CovHealthMonitor::ResetCounters()
+{
+  num_checks_ = 0;
+  num_full_checks_ = 0;
+  num_not_finite_ = 0;
+  num_non_positive_variance_ = 0;
+  num_not_positive_definite_ = 0;
+  num_not_symmetric_ = 0;
+  num_negative_eigenvalue_ = 0;
+  min_eigenvalue_ = 0;
+  num_anomalies_ = 0;
+}
+
+bool CovHealthMonitor::CheckBasic(const CoreStateMatrix& cov, const char* description)
+{
+  if (!cov.allFinite())
+  {
+    num_not_finite_++;
+    if (verbose_)
+    {
+      std::cout << "Warning: [" << description << "]: The covariance matrix has non-finite values" << std::endl;
+    }
+
+    // The remaining checks are not meaningful
+    return false;
+  }
+
+  bool result = true;
+
+  if ((cov.diagonal().array() <= 0).any())
+  {
+    num_non_positive_variance_++;
+    result = false;
+    if (verbose_)
+    {
+      std::cout << "Warning: [" << description << "]: The covariance matrix has non-positive variances (min "
+                << cov.diagonal().minCoeff() << ")" << std::endl;
+    }
+  }
+
+  // The factorization only reads the lower triangle
+  if (Eigen::LLT<CoreStateMatrix>(cov).info() != Eigen::Success)
+  {
+    num_not_positive_definite_++;
+    result = false;
+    if (verbose_)
+    {
+      std::cout << "Warning: [" << description << "]: The covariance matrix is not positive definite" << std::endl;
+    }
+  }
+
+  return result;
+}
+
+bool CovHealthMonitor::CheckFull(const CoreStateMatrix& cov, const char* description)
+{
+  num_full_checks_++;
+
+  if (!cov.allFinite())
+  {
+    return false;
+  }
+
+  bool result = true;
+
+  const double asymmetry = (cov - cov.transpose()).cwiseAbs().maxCoeff();
+  const double max_variance = cov.diagonal().cwiseAbs().maxCoeff();
+  if (asymmetry > symmetry_tolerance_ * max_variance)
+  {
+    num_not_symmetric_++;
+    result = false;
+    if (verbose_)
+    {
+      std::cout << "Warning: [" << description << "]: The covariance matrix is not symmetric (max difference "
+                << asymmetry << ")" << std::endl;
+    }
+  }
+
+  const CoreStateMatrix cov_sym = 0.5 * (cov + cov.transpose());
+  min_eigenvalue_ = Eigen::SelfAdjointEigenSolver<CoreStateMatrix>(cov_sym, Eigen::EigenvaluesOnly).eigenvalues()(0);
+  if (min_eigenvalue_ < 0)
+  {
+    num_negative_eigenvalue_++;
+    result = false;
+    if (verbose_)
+    {
+      std::cout << "Warning: [" << description << "]: The covariance matrix is not positive semidefinite min: "
+                << min_eigenvalue_ << std::endl;
+    }
+  }
+
+  return result;
+}
+}  // namespace mars
@@ -38,7 +38,7 @@ Eigen::MatrixXd Ekf::CalculateCorrection(Chi2* chi2)
 {
   Eigen::MatrixXd corr = CalculateStateCorrection();
 
-  if (chi2->do_test_)
+  if (chi2->do_test_ || chi2->calc_always_)
   {
     chi2->CalculateChi2(res_, S_);
   }
@@ -101,6 +101,7 @@ bool Chi2::CalculateChi2(const Eigen::MatrixXd& res, const Eigen::MatrixXd& S)
 
   last_res_ = res;
   last_X2_ = X2;
+  num_calculations_++;
   return passed_;
 }
 
@@ -113,4 +114,14 @@ void Chi2::PrintReport(const std::string& name)
     std::cout << "X2 = " << last_X2_ << ", ucv = " << ucv_ << std::endl;
   }
 }
+
+double Chi2::get_last_X2() const
+{
+  return last_X2_;
+}
+
+int Chi2::get_num_calculations() const
+{
+  return num_calculations_;
+}
 }  // namespace mars
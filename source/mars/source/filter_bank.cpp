@@ -0,0 +1,410 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/filter_bank.h>
+#include <mars/sensors/update_sensor_abs_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace mars
+{
+FilterBank::FilterBank(const CoreLogic& core_logic, const int& max_hypotheses, const int& num_threads)
+  : max_hypotheses_(std::max(1, max_hypotheses))
+{
+  FilterHypothesis root;
+  root.id_ = next_id_++;
+  root.core_logic_ = core_logic.Clone();
+  hypotheses_.push_back(std::move(root));
+
+  if (num_threads > 0)
+  {
+    num_threads_ = num_threads;
+  }
+  else
+  {
+    num_threads_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+
+  // The calling thread participates in the parallel processing
+  for (int k = 1; k < num_threads_; k++)
+  {
+    workers_.emplace_back(&FilterBank::WorkerLoop, this);
+  }
+}
+
+FilterBank::~FilterBank()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (auto& k : workers_)
+  {
+    k.join();
+  }
+}
+
+int FilterBank::Branch(const int& idx)
+{
+  if (idx < 0 || idx >= get_num_hypotheses())
+  {
+    std::cout << "Warning: FilterBank: Hypothesis index " << idx << " does not exist" << std::endl;
+    return -1;
+  }
+
+  const FilterHypothesis& source = hypotheses_[idx];
+
+  FilterHypothesis branch;
+  branch.id_ = next_id_++;
+  branch.parent_id_ = source.id_;
+  branch.core_logic_ = source.core_logic_.Clone();
+  branch.log_likelihood_ = source.log_likelihood_;
+  branch.num_scored_updates_ = source.num_scored_updates_;
+  branch.sensor_contexts_ = source.sensor_contexts_;
+
+  hypotheses_.push_back(std::move(branch));
+  return get_num_hypotheses() - 1;
+}
+
+int FilterBank::ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                                   const BufferDataType& data)
+{
+  // Propagation measurements in order only touch the hypothesis itself and can be processed in parallel. Updates and
+  // out of order measurements use the shared sensor instances and are processed sequentially.
+  bool parallel = true;
+  for (const auto& k : hypotheses_)
+  {
+    if (sensor != k.core_logic_.core_states_->propagation_sensor_)
+    {
+      parallel = false;
+      break;
+    }
+
+    BufferEntryType latest_entry;
+    if (k.core_logic_.buffer_.get_latest_entry(&latest_entry) && latest_entry.timestamp_ > timestamp)
+    {
+      parallel = false;
+      break;
+    }
+  }
+
+  int num_successful = 0;
+
+  if (parallel)
+  {
+    std::vector<char> results(hypotheses_.size(), 0);
+    RunParallel([&](const int& idx) {
+      results[idx] = hypotheses_[idx].core_logic_.ProcessMeasurement(sensor, timestamp, data);
+    });
+
+    num_successful = static_cast<int>(std::count(results.begin(), results.end(), 1));
+  }
+  else
+  {
+    for (int k = 0; k < get_num_hypotheses(); k++)
+    {
+      num_successful += ProcessMeasurement(k, sensor, timestamp, data);
+    }
+  }
+
+  return num_successful;
+}
+
+bool FilterBank::ProcessMeasurement(const int& idx, const std::shared_ptr<SensorAbsClass>& sensor,
+                                    const Time& timestamp, const BufferDataType& data)
+{
+  if (idx < 0 || idx >= get_num_hypotheses())
+  {
+    std::cout << "Warning: FilterBank: Hypothesis index " << idx << " does not exist" << std::endl;
+    return false;
+  }
+
+  FilterHypothesis& hypothesis = hypotheses_[idx];
+
+  // The first measurement of a sensor in this hypothesis starts from the initial state of the sensor instance. The
+  // propagation sensor holds no state of the hypothesis.
+  SensorAbsClass* sensor_ptr = sensor.get();
+  if (sensor != hypothesis.core_logic_.core_states_->propagation_sensor_ &&
+      hypothesis.sensor_contexts_.find(sensor_ptr) == hypothesis.sensor_contexts_.end())
+  {
+    auto initial_it = initial_sensor_contexts_.find(sensor_ptr);
+    if (initial_it == initial_sensor_contexts_.end())
+    {
+      initial_it = initial_sensor_contexts_.emplace(sensor_ptr, sensor->SaveState()).first;
+    }
+    hypothesis.sensor_contexts_.emplace(sensor_ptr, initial_it->second);
+  }
+
+  // The sensor instances are shared between the hypotheses. All sensors of the hypothesis are set to its state, an
+  // out of order measurement can re-process the updates of any sensor.
+  for (auto& k : hypothesis.sensor_contexts_)
+  {
+    k.first->RestoreState(k.second);
+  }
+
+  // The X2 value of the update is required for the scoring, independent of the X2 test
+  std::shared_ptr<UpdateSensorAbsClass> update_sensor = std::dynamic_pointer_cast<UpdateSensorAbsClass>(sensor);
+  if (update_sensor != nullptr)
+  {
+    update_sensor->chi2_.calc_always_ = true;
+  }
+  const int num_calculations_before = update_sensor != nullptr ? update_sensor->chi2_.get_num_calculations() : 0;
+
+  const bool result = hypothesis.core_logic_.ProcessMeasurement(sensor, timestamp, data);
+
+  ScoreUpdate(&hypothesis, sensor, num_calculations_before);
+
+  // A new state is stored, branches share the states of their source until then
+  for (auto& k : hypothesis.sensor_contexts_)
+  {
+    k.second = k.first->SaveState();
+  }
+
+  return result;
+}
+
+void FilterBank::ScoreUpdate(FilterHypothesis* hypothesis, const std::shared_ptr<SensorAbsClass>& sensor,
+                             const int& num_calculations_before)
+{
+  std::shared_ptr<UpdateSensorAbsClass> update_sensor = std::dynamic_pointer_cast<UpdateSensorAbsClass>(sensor);
+
+  if (update_sensor == nullptr || update_sensor->chi2_.get_num_calculations() == num_calculations_before)
+  {
+    // No update was performed
+    return;
+  }
+
+  // If the update caused a re-processing of the buffer, the X2 value of the last update is used
+  hypothesis->log_likelihood_ -= 0.5 * update_sensor->chi2_.get_last_X2();
+  hypothesis->num_scored_updates_++;
+}
+
+int FilterBank::Prune(const double& max_log_likelihood_diff)
+{
+  const int num_before = get_num_hypotheses();
+  const double threshold = hypotheses_[get_best_hypothesis()].log_likelihood_ - std::abs(max_log_likelihood_diff);
+
+  hypotheses_.erase(std::remove_if(hypotheses_.begin(), hypotheses_.end(),
+                                   [&](const FilterHypothesis& k) { return k.log_likelihood_ < threshold; }),
+                    hypotheses_.end());
+
+  if (get_num_hypotheses() > max_hypotheses_)
+  {
+    // Keep the most likely hypotheses, the order of the remaining hypotheses is preserved
+    std::vector<double> log_likelihoods;
+    for (const auto& k : hypotheses_)
+    {
+      log_likelihoods.push_back(k.log_likelihood_);
+    }
+    std::nth_element(log_likelihoods.begin(), log_likelihoods.begin() + (max_hypotheses_ - 1), log_likelihoods.end(),
+                     std::greater<double>());
+    const double min_log_likelihood = log_likelihoods[max_hypotheses_ - 1];
+
+    int num_kept = 0;
+    hypotheses_.erase(std::remove_if(hypotheses_.begin(), hypotheses_.end(),
+                                     [&](const FilterHypothesis& k) {
+                                       if (k.log_likelihood_ >= min_log_likelihood && num_kept < max_hypotheses_)
+                                       {
+                                         num_kept++;
+                                         return false;
+                                       }
+                                       return true;
+                                     }),
+                      hypotheses_.end());
+  }
+
+  return num_before - get_num_hypotheses();
+}
+
+int FilterBank::Merge(const double& max_position_diff, const double& max_attitude_diff)
+{
+  const int num_before = get_num_hypotheses();
+
+  // Latest core state of each hypothesis, hypotheses without a state are not merged
+  auto get_latest_core = [](const FilterHypothesis& hypothesis, CoreType* core) {
+    BufferEntryType latest_state;
+    if (!hypothesis.core_logic_.buffer_.get_latest_state(&latest_state) || latest_state.data_.core_ == nullptr)
+    {
+      return false;
+    }
+    *core = *static_cast<CoreType*>(latest_state.data_.core_.get());
+    return true;
+  };
+
+  for (int i = 0; i < get_num_hypotheses(); i++)
+  {
+    CoreType core_i;
+    if (!get_latest_core(hypotheses_[i], &core_i))
+    {
+      continue;
+    }
+
+    for (int j = get_num_hypotheses() - 1; j > i; j--)
+    {
+      CoreType core_j;
+      if (!get_latest_core(hypotheses_[j], &core_j))
+      {
+        continue;
+      }
+
+      const double position_diff = (core_i.state_.p_wi_ - core_j.state_.p_wi_).norm();
+      const double attitude_diff = core_i.state_.q_wi_.angularDistance(core_j.state_.q_wi_);
+
+      if (position_diff > max_position_diff || attitude_diff > max_attitude_diff)
+      {
+        continue;
+      }
+
+      // Sum of the likelihoods in log space
+      const double ll_i = hypotheses_[i].log_likelihood_;
+      const double ll_j = hypotheses_[j].log_likelihood_;
+      const double ll_max = std::max(ll_i, ll_j);
+      const double ll_sum = ll_max + std::log1p(std::exp(std::min(ll_i, ll_j) - ll_max));
+
+      if (ll_j > ll_i)
+      {
+        std::swap(hypotheses_[i], hypotheses_[j]);
+        core_i = core_j;
+      }
+
+      hypotheses_[i].log_likelihood_ = ll_sum;
+      RemoveHypothesis(j);
+    }
+  }
+
+  return num_before - get_num_hypotheses();
+}
+
+int FilterBank::get_best_hypothesis() const
+{
+  int best_idx = 0;
+  for (int k = 1; k < get_num_hypotheses(); k++)
+  {
+    if (hypotheses_[k].log_likelihood_ > hypotheses_[best_idx].log_likelihood_)
+    {
+      best_idx = k;
+    }
+  }
+  return best_idx;
+}
+
+std::vector<double> FilterBank::get_weights() const
+{
+  const double ll_max = hypotheses_[get_best_hypothesis()].log_likelihood_;
+
+  std::vector<double> weights;
+  double sum = 0;
+  for (const auto& k : hypotheses_)
+  {
+    weights.push_back(std::exp(k.log_likelihood_ - ll_max));
+    sum += weights.back();
+  }
+
+  for (auto& k : weights)
+  {
+    k /= sum;
+  }
+
+  return weights;
+}
+
+int FilterBank::get_num_hypotheses() const
+{
+  return static_cast<int>(hypotheses_.size());
+}
+
+int FilterBank::get_num_threads() const
+{
+  return num_threads_;
+}
+
+const FilterHypothesis& FilterBank::get_hypothesis(const int& idx) const
+{
+  return hypotheses_.at(idx);
+}
+
+void FilterBank::RemoveHypothesis(const int& idx)
+{
+  // The bank always holds at least one hypothesis
+  if (get_num_hypotheses() > 1)
+  {
+    hypotheses_.erase(hypotheses_.begin() + idx);
+  }
+}
+
+void FilterBank::RunParallel(const std::function<void(const int&)>& function)
+{
+  const int num_jobs = get_num_hypotheses();
+
+  if (workers_.empty() || num_jobs < 2)
+  {
+    for (int k = 0; k < num_jobs; k++)
+    {
+      function(k);
+    }
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = &function;
+  job_size_ = num_jobs;
+  job_next_idx_ = 0;
+  job_num_pending_ = num_jobs;
+  job_generation_++;
+  work_cv_.notify_all();
+
+  ProcessJob(&lock);
+
+  done_cv_.wait(lock, [&]() { return job_num_pending_ == 0; });
+  job_ = nullptr;
+}
+
+void FilterBank::ProcessJob(std::unique_lock<std::mutex>* lock)
+{
+  while (job_ != nullptr && job_next_idx_ < job_size_)
+  {
+    const std::function<void(const int&)>* job = job_;
+    const int idx = job_next_idx_++;
+
+    lock->unlock();
+    (*job)(idx);
+    lock->lock();
+
+    if (--job_num_pending_ == 0)
+    {
+      done_cv_.notify_all();
+    }
+  }
+}
+
+void FilterBank::WorkerLoop()
+{
+  int generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true)
+  {
+    work_cv_.wait(lock, [&]() { return shutdown_ || job_generation_ != generation; });
+
+    if (shutdown_)
+    {
+      return;
+    }
+
+    generation = job_generation_;
+    ProcessJob(&lock);
+  }
+}
+}  // namespace mars
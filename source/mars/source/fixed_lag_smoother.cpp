@@ -0,0 +1,144 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/fixed_lag_smoother.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Cholesky>
+
+namespace mars
+{
+namespace
+{
+const CoreType& CoreData(const std::shared_ptr<void>& core_data)
+{
+  return *static_cast<CoreType*>(core_data.get());
+}
+}  // namespace
+
+void FixedLagSmoother::AddStep(const BufferEntryType& prior_entry, const BufferEntryType& posterior_entry)
+{
+  Step step;
+  step.timestamp_ = posterior_entry.timestamp_;
+  step.sensor_ = posterior_entry.sensor_;
+  step.prior_ = prior_entry.data_.core_;
+  step.posterior_ = posterior_entry.data_.core_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Updates without intermediate propagation use the previous state as prior
+  step.identity_transition_ = step.prior_ == last_posterior_;
+  last_posterior_ = step.posterior_;
+  pending_.push_back(step);
+}
+
+void FixedLagSmoother::Reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.clear();
+  reset_pending_ = true;
+  last_posterior_ = nullptr;
+}
+
+int FixedLagSmoother::Process(std::vector<BufferEntryType>* smoothed_entries)
+{
+  smoothed_entries->clear();
+
+  std::deque<Step> steps;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    steps.swap(pending_);
+
+    if (reset_pending_)
+    {
+      window_.clear();
+      reset_pending_ = false;
+    }
+  }
+
+  for (auto& step : steps)
+  {
+    if (!window_.empty())
+    {
+      // RTS gain C = P F^T P_pred^-1, the gain of a step without propagation is the identity
+      Step& previous = window_.back();
+      const CoreStateMatrix& P = CoreData(previous.posterior_).cov_;
+
+      if (step.identity_transition_)
+      {
+        previous.gain_.setIdentity();
+      }
+      else
+      {
+        const CoreType& prior = CoreData(step.prior_);
+        previous.gain_ = prior.cov_.llt().solve(prior.state_transition_ * P).transpose();
+      }
+    }
+
+    window_.push_back(step);
+  }
+
+  if (window_.empty())
+  {
+    return 0;
+  }
+
+  // Steps that are at least lag_ older than the latest step are output
+  const Time output_end = window_.back().timestamp_ - Time(lag_);
+  size_t num_output = 0;
+  while (num_output + 1 < window_.size() && window_[num_output].timestamp_ <= output_end)
+  {
+    num_output++;
+  }
+
+  if (num_output == 0)
+  {
+    return 0;
+  }
+
+  // Backward pass from the latest step, the latest filtered state is also the smoothed one
+  smoothed_entries->resize(num_output);
+  CoreType smoothed = CoreData(window_.back().posterior_);
+
+  for (int k = static_cast<int>(window_.size()) - 2; k >= 0; k--)
+  {
+    const Step& step = window_[k];
+    const CoreType& filtered = CoreData(step.posterior_);
+    const CoreType& predicted = window_[k + 1].identity_transition_ ? filtered : CoreData(window_[k + 1].prior_);
+
+    // The smoothed state of the next step is taken relative to its filtered state, combining the rotations of the
+    // smoothing correction and of the filter update in one difference is less accurate
+    const CoreType& filtered_next = CoreData(window_[k + 1].posterior_);
+    const CoreStateVector difference = CoreStateType::CalcCorrection(smoothed.state_, filtered_next.state_) +
+                                       CoreStateType::CalcCorrection(filtered_next.state_, predicted.state_);
+    const CoreStateVector correction = step.gain_ * difference;
+    smoothed.state_ = CoreStateType::ApplyCorrection(filtered.state_, correction);
+
+    const CoreStateMatrix cov = filtered.cov_ + step.gain_ * (smoothed.cov_ - predicted.cov_) * step.gain_.transpose();
+    smoothed.cov_ = 0.5 * (cov + cov.transpose());
+    smoothed.state_transition_ = filtered.state_transition_;
+
+    if (k < static_cast<int>(num_output))
+    {
+      BufferDataType data;
+      data.set_core_data(std::make_shared<CoreType>(smoothed));
+      (*smoothed_entries)[k] = BufferEntryType(step.timestamp_, data, step.sensor_, BufferMetadataType::core_state);
+    }
+  }
+
+  window_.erase(window_.begin(), window_.begin() + num_output);
+
+  return static_cast<int>(num_output);
+}
+
+int FixedLagSmoother::get_window_size() const
+{
+  return static_cast<int>(window_.size());
+}
+}  // namespace mars
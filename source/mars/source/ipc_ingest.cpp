@@ -0,0 +1,533 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/ipc_ingest.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace mars
+{
+namespace
+{
+template <typename T>
+bool ReadValue(const char* data, const size_t& size, size_t* offset, T* value)
+{
+  if (*offset + sizeof(T) > size)
+  {
+    return false;
+  }
+
+  std::memcpy(value, data + *offset, sizeof(T));
+  *offset += sizeof(T);
+  return true;
+}
+
+bool SetNonBlocking(const int& fd)
+{
+  const int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool SetSocketAddress(const std::string& socket_path, sockaddr_un* address)
+{
+  std::memset(address, 0, sizeof(sockaddr_un));
+  address->sun_family = AF_UNIX;
+
+  if (socket_path.empty() || socket_path.size() >= sizeof(address->sun_path))
+  {
+    return false;
+  }
+
+  std::memcpy(address->sun_path, socket_path.c_str(), socket_path.size());
+  return true;
+}
+}  // namespace
+
+constexpr uint32_t IngestDecoder::kMaxNameSize;
+constexpr uint32_t IngestDecoder::kMaxNumValues;
+constexpr uint32_t IngestDecoder::kMaxNumSensors;
+
+int IngestEncoder::AddSensor(const std::string& name, const JournalPayloadType& payload_type)
+{
+  const int id = static_cast<int>(payload_types_.size());
+  payload_types_.push_back(payload_type);
+
+  Write(JournalRecordType::sensor);
+  Write(static_cast<int32_t>(id));
+  Write(payload_type);
+  Write(static_cast<uint32_t>(name.size()));
+  Write(name.data(), name.size());
+
+  return id;
+}
+
+bool IngestEncoder::AddMeasurement(const int& sensor_id, const Time& timestamp, const std::shared_ptr<void>& payload)
+{
+  if (sensor_id < 0 || sensor_id >= static_cast<int>(payload_types_.size()))
+  {
+    return false;
+  }
+
+  values_.clear();
+  if (!JournalWriter::EncodePayload(payload_types_[sensor_id], payload, &values_))
+  {
+    return false;
+  }
+
+  Write(JournalRecordType::measurement);
+  Write(static_cast<int32_t>(sensor_id));
+  Write(timestamp.get_seconds());
+  Write(static_cast<uint32_t>(values_.size()));
+  Write(values_.data(), values_.size() * sizeof(double));
+
+  return true;
+}
+
+void IngestEncoder::AddInitialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init)
+{
+  const double values[7] = { p_wi_init.x(), p_wi_init.y(), p_wi_init.z(), q_wi_init.w(),
+                             q_wi_init.x(), q_wi_init.y(), q_wi_init.z() };
+
+  Write(JournalRecordType::initialize);
+  Write(values, sizeof(values));
+}
+
+const std::vector<char>& IngestEncoder::get_data() const
+{
+  return data_;
+}
+
+void IngestEncoder::Clear()
+{
+  data_.clear();
+}
+
+void IngestEncoder::Write(const void* data, const size_t& size)
+{
+  const char* bytes = static_cast<const char*>(data);
+  data_.insert(data_.end(), bytes, bytes + size);
+}
+
+IngestDecodeResult IngestDecoder::Decode(const char* data, const size_t& size, size_t* offset, JournalRecord* record)
+{
+  // The offset is only advanced once the complete record was read
+  size_t position = *offset;
+
+  JournalRecordType type;
+  if (!ReadValue(data, size, &position, &type))
+  {
+    return IngestDecodeResult::incomplete;
+  }
+
+  *record = JournalRecord();
+  record->type_ = type;
+
+  switch (type)
+  {
+    case JournalRecordType::sensor:
+    {
+      int32_t id;
+      uint32_t name_size;
+      if (!ReadValue(data, size, &position, &id) || !ReadValue(data, size, &position, &record->payload_type_) ||
+          !ReadValue(data, size, &position, &name_size))
+      {
+        return IngestDecodeResult::incomplete;
+      }
+
+      // The server allocates a slot for each id up to the largest one of the stream
+      if (id < 0 || static_cast<uint32_t>(id) >= kMaxNumSensors || name_size > kMaxNameSize)
+      {
+        return IngestDecodeResult::error;
+      }
+
+      if (position + name_size > size)
+      {
+        return IngestDecodeResult::incomplete;
+      }
+
+      record->sensor_id_ = id;
+      record->sensor_name_.assign(data + position, name_size);
+      position += name_size;
+
+      payload_types_[id] = record->payload_type_;
+      break;
+    }
+    case JournalRecordType::measurement:
+    {
+      int32_t id;
+      double timestamp;
+      uint32_t num_values;
+      if (!ReadValue(data, size, &position, &id) || !ReadValue(data, size, &position, &timestamp) ||
+          !ReadValue(data, size, &position, &num_values))
+      {
+        return IngestDecodeResult::incomplete;
+      }
+
+      if (num_values > kMaxNumValues)
+      {
+        return IngestDecodeResult::error;
+      }
+
+      const size_t values_size = num_values * sizeof(double);
+      if (position + values_size > size)
+      {
+        return IngestDecodeResult::incomplete;
+      }
+
+      record->sensor_id_ = id;
+      record->timestamp_ = Time(timestamp);
+
+      auto it = payload_types_.find(id);
+      if (it != payload_types_.end())
+      {
+        values_.resize(num_values);
+        std::memcpy(values_.data(), data + position, values_size);
+        record->payload_type_ = it->second;
+        record->payload_ = JournalReader::DecodePayload(it->second, values_);
+      }
+      position += values_size;
+      break;
+    }
+    case JournalRecordType::initialize:
+    {
+      double values[7];
+      if (!ReadValue(data, size, &position, &values))
+      {
+        return IngestDecodeResult::incomplete;
+      }
+
+      record->p_wi_ = Eigen::Vector3d(values[0], values[1], values[2]);
+      record->q_wi_ = Eigen::Quaterniond(values[3], values[4], values[5], values[6]);
+      break;
+    }
+    default:
+      return IngestDecodeResult::error;
+  }
+
+  *offset = position;
+  return IngestDecodeResult::record;
+}
+
+size_t IngestDecoder::get_max_record_size()
+{
+  const size_t sensor_size = sizeof(JournalRecordType) + 3 * sizeof(int32_t) + kMaxNameSize;
+  const size_t measurement_size =
+      sizeof(JournalRecordType) + sizeof(int32_t) + sizeof(double) + sizeof(uint32_t) + kMaxNumValues * sizeof(double);
+  return std::max(sensor_size, measurement_size);
+}
+
+IngestServer::IngestServer(std::shared_ptr<CoreLogic> core_logic, std::string socket_path, const size_t& read_size)
+  : core_logic_(std::move(core_logic)), socket_path_(std::move(socket_path)), read_size_(std::max<size_t>(read_size, 1))
+{
+  sockaddr_un address;
+  if (!SetSocketAddress(socket_path_, &address))
+  {
+    std::cout << "Warning: IngestServer: Invalid socket path " << socket_path_ << std::endl;
+    return;
+  }
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0)
+  {
+    std::cout << "Warning: IngestServer: Could not create the socket" << std::endl;
+    return;
+  }
+
+  unlink(socket_path_.c_str());
+
+  if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listen_fd_, SOMAXCONN) != 0 || !SetNonBlocking(listen_fd_))
+  {
+    std::cout << "Warning: IngestServer: Could not listen on " << socket_path_ << ": " << std::strerror(errno)
+              << std::endl;
+    close(listen_fd_);
+    listen_fd_ = -1;
+  }
+}
+
+IngestServer::~IngestServer()
+{
+  for (auto& k : clients_)
+  {
+    CloseClient(k.get());
+  }
+
+  if (listen_fd_ >= 0)
+  {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+  }
+}
+
+bool IngestServer::is_open() const
+{
+  return listen_fd_ >= 0;
+}
+
+void IngestServer::AddSensor(const std::shared_ptr<SensorAbsClass>& sensor, const JournalPayloadType& payload_type)
+{
+  sensors_by_name_[sensor->name_] = { sensor, payload_type };
+}
+
+int IngestServer::Poll(const int& timeout_ms)
+{
+  if (listen_fd_ < 0)
+  {
+    return -1;
+  }
+
+  std::vector<pollfd> poll_fds;
+  poll_fds.reserve(clients_.size() + 1);
+  poll_fds.push_back({ listen_fd_, POLLIN, 0 });
+  for (const auto& k : clients_)
+  {
+    poll_fds.push_back({ k->fd_, POLLIN, 0 });
+  }
+
+  if (poll(poll_fds.data(), poll_fds.size(), timeout_ms) < 0)
+  {
+    return errno == EINTR ? 0 : -1;
+  }
+
+  int num_processed = 0;
+
+  for (size_t k = 1; k < poll_fds.size(); k++)
+  {
+    if (poll_fds[k].revents != 0)
+    {
+      ReadClient(clients_[k - 1].get(), &num_processed);
+    }
+  }
+
+  clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                [](const std::unique_ptr<Client>& client) { return client->fd_ < 0; }),
+                 clients_.end());
+
+  if (poll_fds[0].revents & POLLIN)
+  {
+    int fd;
+    while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0)
+    {
+      if (!SetNonBlocking(fd))
+      {
+        close(fd);
+        continue;
+      }
+
+      // Partial records stay in the buffer, a read always fits read_size_ bytes
+      std::unique_ptr<Client> client(new Client());
+      client->fd_ = fd;
+      client->buffer_.resize(read_size_ + IngestDecoder::get_max_record_size());
+      clients_.push_back(std::move(client));
+      num_connections_++;
+    }
+  }
+
+  return num_processed;
+}
+
+int IngestServer::get_num_clients() const
+{
+  return static_cast<int>(clients_.size());
+}
+
+bool IngestServer::ReadClient(Client* client, int* num_processed)
+{
+  const ssize_t num_read = recv(client->fd_, client->buffer_.data() + client->size_, read_size_, 0);
+
+  if (num_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+  {
+    return true;
+  }
+
+  if (num_read <= 0)
+  {
+    CloseClient(client);
+    return false;
+  }
+
+  num_bytes_ += static_cast<uint64_t>(num_read);
+  client->size_ += static_cast<size_t>(num_read);
+
+  JournalRecord record;
+  size_t offset = 0;
+  IngestDecodeResult result;
+
+  while ((result = client->decoder_.Decode(client->buffer_.data(), client->size_, &offset, &record)) ==
+         IngestDecodeResult::record)
+  {
+    if (!ProcessRecord(client, record, num_processed))
+    {
+      result = IngestDecodeResult::error;
+      break;
+    }
+  }
+
+  if (result == IngestDecodeResult::error)
+  {
+    std::cout << "Warning: IngestServer: Invalid record, the connection is closed" << std::endl;
+    num_stream_errors_++;
+    CloseClient(client);
+    return false;
+  }
+
+  client->size_ -= offset;
+  if (offset > 0 && client->size_ > 0)
+  {
+    std::memmove(client->buffer_.data(), client->buffer_.data() + offset, client->size_);
+  }
+
+  return true;
+}
+
+bool IngestServer::ProcessRecord(Client* client, const JournalRecord& record, int* num_processed)
+{
+  switch (record.type_)
+  {
+    case JournalRecordType::sensor:
+    {
+      auto it = sensors_by_name_.find(record.sensor_name_);
+      if (it == sensors_by_name_.end())
+      {
+        std::cout << "Warning: IngestServer: Sensor " << record.sensor_name_
+                  << " is not known, its measurements are dropped" << std::endl;
+      }
+      else if (record.payload_type_ != it->second.payload_type_)
+      {
+        // The sensor class casts the payload to its measurement type
+        std::cout << "Warning: IngestServer: Sensor " << record.sensor_name_ << " is registered with payload type "
+                  << static_cast<int>(record.payload_type_) << " instead of "
+                  << static_cast<int>(it->second.payload_type_) << std::endl;
+        return false;
+      }
+
+      client->sensors_.resize(std::max<size_t>(client->sensors_.size(), record.sensor_id_ + 1));
+      client->sensors_[record.sensor_id_] = it != sensors_by_name_.end() ? it->second.sensor_ : nullptr;
+      break;
+    }
+    case JournalRecordType::measurement:
+    {
+      if (record.sensor_id_ < 0 || record.sensor_id_ >= static_cast<int>(client->sensors_.size()) ||
+          client->sensors_[record.sensor_id_] == nullptr || record.payload_ == nullptr)
+      {
+        num_dropped_++;
+        break;
+      }
+
+      BufferDataType data;
+      data.set_sensor_data(record.payload_);
+      core_logic_->ProcessMeasurement(client->sensors_[record.sensor_id_], record.timestamp_, data);
+      num_measurements_++;
+      (*num_processed)++;
+      break;
+    }
+    case JournalRecordType::initialize:
+    {
+      core_logic_->Initialize(record.p_wi_, record.q_wi_);
+      num_initializations_++;
+      break;
+    }
+    default:
+      break;
+  }
+
+  return true;
+}
+
+void IngestServer::CloseClient(Client* client)
+{
+  if (client->fd_ >= 0)
+  {
+    close(client->fd_);
+    client->fd_ = -1;
+  }
+}
+
+IngestClient::~IngestClient()
+{
+  Close();
+}
+
+bool IngestClient::Connect(const std::string& socket_path)
+{
+  Close();
+
+  sockaddr_un address;
+  if (!SetSocketAddress(socket_path, &address))
+  {
+    return false;
+  }
+
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0)
+  {
+    return false;
+  }
+
+  if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool IngestClient::Send(const char* data, const size_t& size)
+{
+  size_t num_sent = 0;
+  while (fd_ >= 0 && num_sent < size)
+  {
+    // No SIGPIPE if the server closed the connection
+    const ssize_t result = send(fd_, data + num_sent, size - num_sent, MSG_NOSIGNAL);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      Close();
+      return false;
+    }
+
+    num_sent += static_cast<size_t>(result);
+  }
+
+  return fd_ >= 0;
+}
+
+bool IngestClient::Send(const IngestEncoder& encoder)
+{
+  return Send(encoder.get_data().data(), encoder.get_data().size());
+}
+
+void IngestClient::Close()
+{
+  if (fd_ >= 0)
+  {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool IngestClient::is_connected() const
+{
+  return fd_ >= 0;
+}
+}  // namespace mars
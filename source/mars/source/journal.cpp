@@ -0,0 +1,539 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/journal.h>
+#include <mars/sensors/attitude/attitude_measurement_type.h>
+#include <mars/sensors/bodyvel/bodyvel_measurement_type.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_measurement_type.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/mag/mag_measurement_type.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/pressure/pressure_measurement_type.h>
+#include <mars/sensors/vision/vision_measurement_type.h>
+#include <cstring>
+#include <iostream>
+
+namespace mars
+{
+namespace
+{
+const char kJournalMagic[8] = "MARSJNL";
+
+void AppendVector(const Eigen::Ref<const Eigen::VectorXd>& vector, std::vector<double>* values)
+{
+  values->insert(values->end(), vector.data(), vector.data() + vector.size());
+}
+
+void AppendQuaternion(const Eigen::Quaterniond& q, std::vector<double>* values)
+{
+  values->insert(values->end(), { q.w(), q.x(), q.y(), q.z() });
+}
+
+// Dynamic measurement noise of the BaseMeas: has_meas_noise, rows, cols, column major values
+void AppendMeasNoise(const BaseMeas& meas, std::vector<double>* values)
+{
+  values->insert(values->end(), { static_cast<double>(meas.has_meas_noise),
+                                  static_cast<double>(meas.meas_noise_.rows()),
+                                  static_cast<double>(meas.meas_noise_.cols()) });
+  values->insert(values->end(), meas.meas_noise_.data(), meas.meas_noise_.data() + meas.meas_noise_.size());
+}
+
+Eigen::Vector3d ReadVector3(const std::vector<double>& values, size_t* idx)
+{
+  const Eigen::Vector3d result(values[*idx], values[*idx + 1], values[*idx + 2]);
+  *idx += 3;
+  return result;
+}
+
+Eigen::Quaterniond ReadQuaternion(const std::vector<double>& values, size_t* idx)
+{
+  const Eigen::Quaterniond result(values[*idx], values[*idx + 1], values[*idx + 2], values[*idx + 3]);
+  *idx += 4;
+  return result;
+}
+
+bool ReadMeasNoise(const std::vector<double>& values, size_t idx, BaseMeas* meas)
+{
+  if (values.size() < idx + 3)
+  {
+    return false;
+  }
+
+  const auto rows = static_cast<Eigen::Index>(values[idx + 1]);
+  const auto cols = static_cast<Eigen::Index>(values[idx + 2]);
+
+  if (rows < 0 || cols < 0 || values.size() != idx + 3 + static_cast<size_t>(rows * cols))
+  {
+    return false;
+  }
+
+  meas->has_meas_noise = values[idx] != 0;
+  meas->meas_noise_ = Eigen::Map<const Eigen::MatrixXd>(values.data() + idx + 3, rows, cols);
+  return true;
+}
+
+// Number of values of each payload type without the measurement noise
+size_t PayloadSize(const JournalPayloadType& payload_type)
+{
+  switch (payload_type)
+  {
+    case JournalPayloadType::imu:
+      return 6;
+    case JournalPayloadType::pose:
+    case JournalPayloadType::vision:
+      return 7;
+    case JournalPayloadType::position:
+    case JournalPayloadType::gps:
+    case JournalPayloadType::mag:
+    case JournalPayloadType::pressure:
+    case JournalPayloadType::bodyvel:
+      return 3;
+    case JournalPayloadType::gps_w_vel:
+      return 6;
+    case JournalPayloadType::attitude:
+      return 4;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+constexpr uint32_t JournalWriter::kVersion;
+
+JournalWriter::JournalWriter(const std::string& file_path, const size_t& buffer_size)
+  : file_(file_path, std::ios::binary | std::ios::trunc), buffer_size_(buffer_size)
+{
+  if (!file_.is_open())
+  {
+    std::cout << "Warning: Journal: Could not open " << file_path << std::endl;
+    return;
+  }
+
+  buffer_.reserve(buffer_size_);
+  Write(kJournalMagic, sizeof(kJournalMagic));
+  Write(kVersion);
+}
+
+JournalWriter::~JournalWriter()
+{
+  Flush();
+}
+
+bool JournalWriter::IsOpen() const
+{
+  return file_.is_open();
+}
+
+int JournalWriter::RegisterSensor(const std::shared_ptr<SensorAbsClass>& sensor, const JournalPayloadType& payload_type)
+{
+  auto it = sensors_.find(sensor.get());
+  if (it != sensors_.end())
+  {
+    return it->second.id_;
+  }
+
+  const int id = static_cast<int>(sensors_.size());
+  sensors_[sensor.get()] = { id, payload_type };
+
+  const std::string name = sensor != nullptr ? sensor->name_ : "";
+  Write(JournalRecordType::sensor);
+  Write(static_cast<int32_t>(id));
+  Write(payload_type);
+  Write(static_cast<uint32_t>(name.size()));
+  Write(name.data(), name.size());
+
+  return id;
+}
+
+void JournalWriter::RecordMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                                      const BufferDataType& data)
+{
+  auto it = sensors_.find(sensor.get());
+  if (it == sensors_.end())
+  {
+    std::cout << "Warning: Journal: Sensor " << (sensor != nullptr ? sensor->name_ : "")
+              << " is not registered, measurements are recorded without payload" << std::endl;
+    RegisterSensor(sensor, JournalPayloadType::unknown);
+    it = sensors_.find(sensor.get());
+  }
+
+  values_.clear();
+  EncodePayload(it->second.payload_type_, data.sensor_, &values_);
+
+  Write(JournalRecordType::measurement);
+  Write(static_cast<int32_t>(it->second.id_));
+  Write(timestamp.get_seconds());
+  Write(static_cast<uint32_t>(values_.size()));
+  Write(values_.data(), values_.size() * sizeof(double));
+}
+
+void JournalWriter::RecordMeasurements(const std::vector<BufferEntryType>& measurements, const bool& stacked_update,
+                                       const double& stacked_update_epsilon)
+{
+  Write(JournalRecordType::measurements);
+  Write(static_cast<uint32_t>(measurements.size()));
+  Write(static_cast<uint8_t>(stacked_update));
+  Write(stacked_update_epsilon);
+
+  for (const auto& k : measurements)
+  {
+    RecordMeasurement(k.sensor_, k.timestamp_, k.data_);
+  }
+}
+
+void JournalWriter::RecordInitialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init)
+{
+  const double values[7] = { p_wi_init.x(), p_wi_init.y(), p_wi_init.z(), q_wi_init.w(),
+                             q_wi_init.x(), q_wi_init.y(), q_wi_init.z() };
+
+  Write(JournalRecordType::initialize);
+  Write(values, sizeof(values));
+}
+
+void JournalWriter::Flush()
+{
+  if (file_.is_open() && !buffer_.empty())
+  {
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    file_.flush();
+  }
+  buffer_.clear();
+}
+
+void JournalWriter::Write(const void* data, const size_t& size)
+{
+  if (!file_.is_open())
+  {
+    return;
+  }
+
+  if (buffer_.size() + size > buffer_size_)
+  {
+    Flush();
+  }
+
+  const char* bytes = static_cast<const char*>(data);
+  buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+bool JournalWriter::EncodePayload(const JournalPayloadType& payload_type, const std::shared_ptr<void>& payload,
+                                  std::vector<double>* values)
+{
+  if (payload == nullptr)
+  {
+    return false;
+  }
+
+  const BaseMeas* base_meas = nullptr;
+
+  switch (payload_type)
+  {
+    case JournalPayloadType::imu:
+    {
+      const auto* meas = static_cast<const IMUMeasurementType*>(payload.get());
+      AppendVector(meas->linear_acceleration_, values);
+      AppendVector(meas->angular_velocity_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::pose:
+    {
+      const auto* meas = static_cast<const PoseMeasurementType*>(payload.get());
+      AppendVector(meas->position_, values);
+      AppendQuaternion(meas->orientation_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::position:
+    {
+      const auto* meas = static_cast<const PositionMeasurementType*>(payload.get());
+      AppendVector(meas->position_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::vision:
+    {
+      const auto* meas = static_cast<const VisionMeasurementType*>(payload.get());
+      AppendVector(meas->position_, values);
+      AppendQuaternion(meas->orientation_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::gps:
+    {
+      const auto* meas = static_cast<const GpsMeasurementType*>(payload.get());
+      values->insert(values->end(),
+                     { meas->coordinates_.latitude_, meas->coordinates_.longitude_, meas->coordinates_.altitude_ });
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::gps_w_vel:
+    {
+      const auto* meas = static_cast<const GpsVelMeasurementType*>(payload.get());
+      values->insert(values->end(),
+                     { meas->coordinates_.latitude_, meas->coordinates_.longitude_, meas->coordinates_.altitude_ });
+      AppendVector(meas->velocity_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::mag:
+    {
+      const auto* meas = static_cast<const MagMeasurementType*>(payload.get());
+      AppendVector(meas->mag_vector_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::pressure:
+    {
+      const auto* meas = static_cast<const PressureMeasurementType*>(payload.get());
+      values->insert(values->end(), { meas->pressure_.data_, meas->pressure_.temperature_K_,
+                                      static_cast<double>(static_cast<int>(meas->pressure_.type_)) });
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::bodyvel:
+    {
+      const auto* meas = static_cast<const BodyvelMeasurementType*>(payload.get());
+      AppendVector(meas->velocity_, values);
+      base_meas = meas;
+      break;
+    }
+    case JournalPayloadType::attitude:
+    {
+      const auto* meas = static_cast<const AttitudeMeasurementType*>(payload.get());
+      AppendQuaternion(meas->attitude_.quaternion_, values);
+      base_meas = meas;
+      break;
+    }
+    default:
+      return false;
+  }
+
+  AppendMeasNoise(*base_meas, values);
+  return true;
+}
+
+JournalReader::JournalReader(const std::string& file_path) : file_(file_path, std::ios::binary)
+{
+  if (!file_.is_open())
+  {
+    std::cout << "Warning: Journal: Could not open " << file_path << std::endl;
+    return;
+  }
+
+  char magic[sizeof(kJournalMagic)];
+  uint32_t version;
+  if (!Read(magic, sizeof(magic)) || std::memcmp(magic, kJournalMagic, sizeof(magic)) != 0 || !Read(&version) ||
+      version < 1 || version > JournalWriter::kVersion)
+  {
+    std::cout << "Warning: Journal: " << file_path << " is not a journal of version 1 to " << JournalWriter::kVersion
+              << std::endl;
+    return;
+  }
+
+  is_open_ = true;
+}
+
+bool JournalReader::IsOpen() const
+{
+  return is_open_;
+}
+
+bool JournalReader::ReadNext(JournalRecord* record)
+{
+  if (!is_open_)
+  {
+    return false;
+  }
+
+  JournalRecordType type;
+  if (!Read(&type))
+  {
+    return false;
+  }
+
+  *record = JournalRecord();
+  record->type_ = type;
+
+  // A record that was started but could not be read completely is truncated or corrupted
+  is_corrupted_ = !ReadRecord(record);
+  return !is_corrupted_;
+}
+
+bool JournalReader::IsCorrupted() const
+{
+  return is_corrupted_;
+}
+
+bool JournalReader::ReadRecord(JournalRecord* record)
+{
+  switch (record->type_)
+  {
+    case JournalRecordType::sensor:
+    {
+      int32_t id;
+      uint32_t name_size;
+      if (!Read(&id) || !Read(&record->payload_type_) || !Read(&name_size))
+      {
+        return false;
+      }
+
+      record->sensor_id_ = id;
+      record->sensor_name_.resize(name_size);
+      if (name_size > 0 && !Read(&record->sensor_name_[0], name_size))
+      {
+        return false;
+      }
+
+      payload_types_[id] = record->payload_type_;
+      return true;
+    }
+    case JournalRecordType::measurement:
+    {
+      int32_t id;
+      double timestamp;
+      uint32_t num_values;
+      if (!Read(&id) || !Read(&timestamp) || !Read(&num_values))
+      {
+        return false;
+      }
+
+      values_.resize(num_values);
+      if (num_values > 0 && !Read(values_.data(), num_values * sizeof(double)))
+      {
+        return false;
+      }
+
+      record->sensor_id_ = id;
+      record->timestamp_ = Time(timestamp);
+
+      auto it = payload_types_.find(id);
+      if (it != payload_types_.end())
+      {
+        record->payload_type_ = it->second;
+        record->payload_ = DecodePayload(it->second, values_);
+      }
+      return true;
+    }
+    case JournalRecordType::initialize:
+    {
+      double values[7];
+      if (!Read(values, sizeof(values)))
+      {
+        return false;
+      }
+
+      record->p_wi_ = Eigen::Vector3d(values[0], values[1], values[2]);
+      record->q_wi_ = Eigen::Quaterniond(values[3], values[4], values[5], values[6]);
+      return true;
+    }
+    case JournalRecordType::measurements:
+    {
+      uint32_t num_measurements;
+      uint8_t stacked_update;
+      if (!Read(&num_measurements) || !Read(&stacked_update) || !Read(&record->stacked_update_epsilon_))
+      {
+        return false;
+      }
+
+      record->num_measurements_ = static_cast<int>(num_measurements);
+      record->stacked_update_ = stacked_update != 0;
+      return true;
+    }
+    default:
+      std::cout << "Warning: Journal: Unknown record type " << static_cast<int>(record->type_) << std::endl;
+      is_open_ = false;
+      return false;
+  }
+}
+
+std::shared_ptr<void> JournalReader::DecodePayload(const JournalPayloadType& payload_type,
+                                                   const std::vector<double>& values)
+{
+  const size_t payload_size = PayloadSize(payload_type);
+  if (payload_size == 0 || values.size() < payload_size)
+  {
+    return nullptr;
+  }
+
+  size_t idx = 0;
+
+  switch (payload_type)
+  {
+    case JournalPayloadType::imu:
+    {
+      const Eigen::Vector3d linear_acceleration = ReadVector3(values, &idx);
+      const Eigen::Vector3d angular_velocity = ReadVector3(values, &idx);
+      auto meas = std::make_shared<IMUMeasurementType>(linear_acceleration, angular_velocity);
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::pose:
+    {
+      const Eigen::Vector3d position = ReadVector3(values, &idx);
+      auto meas = std::make_shared<PoseMeasurementType>(position, ReadQuaternion(values, &idx));
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::position:
+    {
+      auto meas = std::make_shared<PositionMeasurementType>(ReadVector3(values, &idx));
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::vision:
+    {
+      const Eigen::Vector3d position = ReadVector3(values, &idx);
+      auto meas = std::make_shared<VisionMeasurementType>(position, ReadQuaternion(values, &idx));
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::gps:
+    {
+      auto meas = std::make_shared<GpsMeasurementType>(values[0], values[1], values[2]);
+      return ReadMeasNoise(values, 3, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::gps_w_vel:
+    {
+      auto meas =
+          std::make_shared<GpsVelMeasurementType>(values[0], values[1], values[2], values[3], values[4], values[5]);
+      return ReadMeasNoise(values, 6, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::mag:
+    {
+      auto meas = std::make_shared<MagMeasurementType>(ReadVector3(values, &idx));
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::pressure:
+    {
+      auto meas = std::make_shared<PressureMeasurementType>(values[0], values[1],
+                                                            static_cast<Pressure::Type>(static_cast<int>(values[2])));
+      return ReadMeasNoise(values, 3, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::bodyvel:
+    {
+      auto meas = std::make_shared<BodyvelMeasurementType>(ReadVector3(values, &idx));
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    case JournalPayloadType::attitude:
+    {
+      auto meas = std::make_shared<AttitudeMeasurementType>();
+      meas->attitude_.quaternion_ = ReadQuaternion(values, &idx);
+      return ReadMeasNoise(values, idx, meas.get()) ? meas : nullptr;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+bool JournalReader::Read(void* data, const size_t& size)
+{
+  file_.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+  return static_cast<size_t>(file_.gcount()) == size;
+}
+}  // namespace mars
@@ -0,0 +1,294 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/pipelined_core_logic.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace mars
+{
+PipelinedCoreLogic::PipelinedCoreLogic(std::shared_ptr<CoreLogic> core_logic, StateCallback state_callback)
+  : core_logic_(std::move(core_logic)), state_callback_(std::move(state_callback))
+{
+  core_states_ = core_logic_->core_states_;
+  worker_ = std::thread(&PipelinedCoreLogic::WorkerLoop, this);
+}
+
+PipelinedCoreLogic::~PipelinedCoreLogic()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_one();
+  worker_.join();
+}
+
+bool PipelinedCoreLogic::ProcessMeasurement(const std::shared_ptr<SensorAbsClass>& sensor, const Time& timestamp,
+                                            const BufferDataType& data)
+{
+  Task task;
+  task.sensor_ = sensor;
+  task.timestamp_ = timestamp;
+  task.data_ = data;
+  PushTask(task);
+
+  if (sensor != core_states_->propagation_sensor_)
+  {
+    return false;
+  }
+
+  // Out of order propagation measurements only reach the CoreLogic
+  if (has_state_ && timestamp < state_time_)
+  {
+    return false;
+  }
+
+  history_.push_back({ timestamp, data.sensor_ });
+  if (history_.size() > max_history_size_)
+  {
+    has_dropped_ = true;
+    dropped_time_ = history_.front().timestamp_;
+    history_.pop_front();
+
+    if (merging_)
+    {
+      if (merge_idx_ == 0)
+      {
+        // The next measurement of the merge was dropped
+        std::cout << "Warning: PipelinedCoreLogic: Discarded the anchor at " << merge_time_
+                  << ", propagation measurements after the anchor were dropped" << std::endl;
+        merging_ = false;
+        num_discarded_anchors_++;
+      }
+      else
+      {
+        merge_idx_--;
+      }
+    }
+  }
+
+  // A new anchor replaces a running merge only if it does not increase the remaining propagations, such that each
+  // merge completes
+  bool has_anchor = false;
+  Time anchor_time;
+  CoreStateType anchor_state;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (anchor_version_ != merged_version_ && (!merging_ || anchor_time_ >= merge_time_))
+    {
+      has_anchor = true;
+      merged_version_ = anchor_version_;
+      anchor_time = anchor_time_;
+      anchor_state = anchor_state_;
+    }
+  }
+
+  if (has_anchor)
+  {
+    StartMerge(anchor_time, anchor_state);
+  }
+
+  // A complete merge replaces the output state with the anchor propagated up to this measurement
+  const bool merged = merging_ && ContinueMerge();
+
+  if (!merged)
+  {
+    if (!has_state_)
+    {
+      return false;
+    }
+
+    const IMUMeasurementType& measurement = *static_cast<IMUMeasurementType*>(data.sensor_.get());
+    state_ = core_states_->PropagateState(state_, R_wi_, measurement, (timestamp - state_time_).abs().get_seconds(),
+                                          &R_wi_);
+    state_time_ = timestamp;
+  }
+
+  Publish();
+  return true;
+}
+
+void PipelinedCoreLogic::Initialize(const Eigen::Vector3d& p_wi_init, const Eigen::Quaterniond& q_wi_init)
+{
+  Task task;
+  task.initialize_ = true;
+  task.p_wi_ = p_wi_init;
+  task.q_wi_ = q_wi_init;
+  PushTask(task);
+}
+
+void PipelinedCoreLogic::WaitUntilIdle()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+}
+
+bool PipelinedCoreLogic::get_latest_state(Time* timestamp, CoreStateType* state) const
+{
+  std::lock_guard<std::mutex> lock(output_mutex_);
+  if (!has_output_)
+  {
+    return false;
+  }
+
+  *timestamp = output_time_;
+  *state = output_state_;
+  return true;
+}
+
+int PipelinedCoreLogic::get_num_merges() const
+{
+  return num_merges_;
+}
+
+int PipelinedCoreLogic::get_num_discarded_anchors() const
+{
+  return num_discarded_anchors_;
+}
+
+int PipelinedCoreLogic::get_max_queue_size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_queue_size_;
+}
+
+void PipelinedCoreLogic::PushTask(const Task& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(task);
+    max_queue_size_ = std::max(max_queue_size_, static_cast<int>(queue_.size()));
+  }
+  work_cv_.notify_one();
+}
+
+void PipelinedCoreLogic::WorkerLoop()
+{
+  std::deque<Task, Eigen::aligned_allocator<Task>> batch;
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true)
+  {
+    work_cv_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
+
+    if (queue_.empty())
+    {
+      // Shutdown with all measurements processed
+      return;
+    }
+
+    batch.swap(queue_);
+    busy_ = true;
+    lock.unlock();
+
+    for (const auto& k : batch)
+    {
+      if (k.initialize_)
+      {
+        core_logic_->Initialize(k.p_wi_, k.q_wi_);
+      }
+      else
+      {
+        core_logic_->ProcessMeasurement(k.sensor_, k.timestamp_, k.data_);
+      }
+    }
+    batch.clear();
+
+    BufferEntryType latest_state;
+    const bool has_anchor = core_logic_->core_is_initialized_ && core_logic_->buffer_.get_latest_state(&latest_state);
+
+    lock.lock();
+    if (has_anchor)
+    {
+      anchor_time_ = latest_state.timestamp_;
+      anchor_state_ = static_cast<CoreType*>(latest_state.data_.core_.get())->state_;
+      anchor_version_++;
+    }
+
+    busy_ = false;
+    if (queue_.empty())
+    {
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+void PipelinedCoreLogic::StartMerge(const Time& anchor_time, const CoreStateType& anchor_state)
+{
+  // Measurements up to the anchor are contained in the anchor
+  while (!history_.empty() && history_.front().timestamp_ <= anchor_time)
+  {
+    history_.pop_front();
+  }
+
+  // Propagating the anchor across dropped measurements would integrate one large time step
+  if (has_dropped_ && dropped_time_ > anchor_time)
+  {
+    std::cout << "Warning: PipelinedCoreLogic: Discarded the anchor at " << anchor_time
+              << ", propagation measurements after the anchor were dropped" << std::endl;
+    merging_ = false;
+    num_discarded_anchors_++;
+    return;
+  }
+
+  merging_ = true;
+  merge_idx_ = 0;
+  merge_time_ = anchor_time;
+  merge_state_ = anchor_state;
+  merge_R_wi_ = anchor_state.q_wi_.toRotationMatrix();
+}
+
+bool PipelinedCoreLogic::ContinueMerge()
+{
+  const size_t end_idx = std::min(history_.size(), merge_idx_ + static_cast<size_t>(std::max(max_merge_steps_, 2)));
+  for (; merge_idx_ < end_idx; merge_idx_++)
+  {
+    const PropagationSample& sample = history_[merge_idx_];
+    const IMUMeasurementType& measurement = *static_cast<IMUMeasurementType*>(sample.measurement_.get());
+    merge_state_ = core_states_->PropagateState(merge_state_, merge_R_wi_, measurement,
+                                                (sample.timestamp_ - merge_time_).abs().get_seconds(), &merge_R_wi_);
+    merge_time_ = sample.timestamp_;
+  }
+
+  if (merge_idx_ < history_.size())
+  {
+    return false;
+  }
+
+  // The merge reached the latest measurement, the history is kept for the next anchor
+  state_ = merge_state_;
+  R_wi_ = merge_R_wi_;
+  state_time_ = merge_time_;
+  merging_ = false;
+
+  has_state_ = true;
+  num_merges_++;
+  return true;
+}
+
+void PipelinedCoreLogic::Publish()
+{
+  {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    has_output_ = true;
+    output_time_ = state_time_;
+    output_state_ = state_;
+  }
+
+  if (state_callback_)
+  {
+    state_callback_(state_time_, state_);
+  }
+}
+}  // namespace mars
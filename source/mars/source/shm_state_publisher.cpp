@@ -0,0 +1,170 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/shm_state_publisher.h>
+#include <mars/type_definitions/core_type.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace mars
+{
+ShmStatePublisher::ShmStatePublisher(std::string name, const int& num_slots) : name_(std::move(name))
+{
+  const uint32_t slots = static_cast<uint32_t>(std::max(num_slots, 1));
+  const size_t memory_size = ShmStateHeader::get_memory_size(slots);
+
+  // Readers of a previous publisher keep their mapping of the removed memory
+  shm_unlink(name_.c_str());
+
+  const int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    std::cout << "Warning: ShmStatePublisher: Could not create the shared memory " << name_ << std::endl;
+    return;
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(memory_size)) != 0)
+  {
+    std::cout << "Warning: ShmStatePublisher: Could not resize the shared memory " << name_ << std::endl;
+    close(fd);
+    shm_unlink(name_.c_str());
+    return;
+  }
+
+  void* memory = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+  {
+    std::cout << "Warning: ShmStatePublisher: Could not map the shared memory " << name_ << std::endl;
+    shm_unlink(name_.c_str());
+    return;
+  }
+
+  // The memory of ftruncate is zero-initialized, all slots are empty
+  memory_size_ = memory_size;
+  header_ = static_cast<ShmStateHeader*>(memory);
+  header_->version_number_ = ShmStateHeader::version_;
+  header_->num_slots_ = slots;
+  header_->slot_size_ = sizeof(ShmStateSlot);
+  header_->latest_sequence_.store(0, std::memory_order_relaxed);
+  header_->magic_number_.store(ShmStateHeader::magic_, std::memory_order_release);
+}
+
+ShmStatePublisher::~ShmStatePublisher()
+{
+  if (header_ != nullptr)
+  {
+    munmap(header_, memory_size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+bool ShmStatePublisher::is_open() const
+{
+  return header_ != nullptr;
+}
+
+bool ShmStatePublisher::AddSensor(const std::shared_ptr<SensorAbsClass>& sensor)
+{
+  if (static_cast<int>(sensors_.size()) >= ShmStateSample::max_sensors_)
+  {
+    std::cout << "Warning: ShmStatePublisher: Max. number of sensors reached, " << sensor->name_
+              << " is not published" << std::endl;
+    return false;
+  }
+
+  sensors_.push_back(sensor);
+  return true;
+}
+
+bool ShmStatePublisher::Publish(const Buffer& buffer)
+{
+  BufferEntryType latest_state;
+  if (header_ == nullptr || !buffer.get_latest_state(&latest_state))
+  {
+    return false;
+  }
+
+  const uint64_t sequence = sequence_ + 1;
+  ShmStateSlot& slot = header_->get_slots()[(sequence - 1) % header_->num_slots_];
+
+  // Odd lock while the slot is written, readers discard their copy
+  slot.lock_.store(2 * sequence - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ShmStateSample& sample = slot.sample_;
+  sample.sequence_ = sequence;
+
+  const CoreType& core_data = *static_cast<CoreType*>(latest_state.data_.core_.get());
+  const CoreStateType& state = core_data.state_;
+  ShmCoreState& core = sample.core_;
+  core.timestamp_ = latest_state.timestamp_.get_seconds();
+  Eigen::Map<Eigen::Vector3d>(core.p_wi_) = state.p_wi_;
+  Eigen::Map<Eigen::Vector3d>(core.v_wi_) = state.v_wi_;
+  core.q_wi_[0] = state.q_wi_.w();
+  Eigen::Map<Eigen::Vector3d>(core.q_wi_ + 1) = state.q_wi_.vec();
+  Eigen::Map<Eigen::Vector3d>(core.b_w_) = state.b_w_;
+  Eigen::Map<Eigen::Vector3d>(core.b_a_) = state.b_a_;
+  Eigen::Map<CoreStateMatrix>(core.cov_) = core_data.cov_;
+
+  sample.num_sensors_ = static_cast<int32_t>(sensors_.size());
+  for (size_t k = 0; k < sensors_.size(); k++)
+  {
+    FillSensorState(buffer, sensors_[k], &sample.sensors_[k]);
+  }
+
+  slot.lock_.store(2 * sequence, std::memory_order_release);
+  header_->latest_sequence_.store(sequence, std::memory_order_release);
+  sequence_ = sequence;
+
+  return true;
+}
+
+uint64_t ShmStatePublisher::get_num_published() const
+{
+  return sequence_;
+}
+
+void ShmStatePublisher::FillSensorState(const Buffer& buffer, const std::shared_ptr<SensorAbsClass>& sensor,
+                                        ShmSensorState* sensor_state) const
+{
+  const size_t name_length = std::min<size_t>(sensor->name_.size(), ShmSensorState::max_name_length_ - 1);
+  std::copy_n(sensor->name_.c_str(), name_length, sensor_state->name_);
+  sensor_state->name_[name_length] = '\0';
+
+  BufferEntryType sensor_entry;
+  if (!buffer.get_latest_sensor_handle_state(sensor, &sensor_entry))
+  {
+    sensor_state->timestamp_ = 0;
+    sensor_state->valid_ = 0;
+    sensor_state->state_size_ = 0;
+    sensor_state->cov_size_ = 0;
+    return;
+  }
+
+  sensor_state->timestamp_ = sensor_entry.timestamp_.get_seconds();
+  sensor_state->valid_ = 1;
+
+  const Eigen::VectorXd state = sensor->get_state_vector(sensor_entry.data_.sensor_);
+  sensor_state->state_size_ = state.size() <= ShmSensorState::max_state_size_ ? static_cast<int32_t>(state.size()) : 0;
+  Eigen::Map<Eigen::VectorXd>(sensor_state->state_, sensor_state->state_size_) = state.head(sensor_state->state_size_);
+
+  // The core block of the sensor covariance is not used
+  const Eigen::MatrixXd cov = sensor->get_covariance(sensor_entry.data_.sensor_);
+  const int cov_size = static_cast<int>(cov.rows()) - CoreStateType::size_error_;
+  sensor_state->cov_size_ = cov_size > 0 && cov_size <= ShmSensorState::max_cov_size_ ? cov_size : 0;
+  Eigen::Map<Eigen::MatrixXd>(sensor_state->cov_, sensor_state->cov_size_, sensor_state->cov_size_) =
+      cov.bottomRightCorner(sensor_state->cov_size_, sensor_state->cov_size_);
+}
+}  // namespace mars
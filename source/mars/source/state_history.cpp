@@ -0,0 +1,229 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/state_history.h>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace mars
+{
+StateHistory::StateHistory(std::shared_ptr<const SweepDataset> dataset, const SweepRunSetup& setup)
+  : dataset_(dataset), setup_(setup)
+{
+}
+
+bool StateHistory::Run()
+{
+  checkpoints_.clear();
+  replay_valid_ = false;
+
+  if (dataset_ == nullptr || setup_.core_logic_ == nullptr)
+  {
+    std::cout << "Warning: StateHistory: No dataset or CoreLogic" << std::endl;
+    return false;
+  }
+
+  const std::vector<SweepMeasurement>& measurements = dataset_->get_measurements();
+  arrival_order_ = setup_.get_arrival_order(*dataset_);
+  arrival_time_.clear();
+  for (const auto& k : arrival_order_)
+  {
+    const SweepMeasurement& measurement = measurements[k];
+    arrival_time_.push_back(measurement.timestamp_.get_seconds() + setup_.get_sensor_delay(measurement.sensor_idx_));
+  }
+
+  // Earliest timestamp of the measurements from each arrival index on, delayed measurements can precede the
+  // measurements that already arrived
+  std::vector<Time> earliest_pending(arrival_order_.size() + 1, Time(std::numeric_limits<double>::infinity()));
+  for (size_t k = arrival_order_.size(); k > 0; k--)
+  {
+    earliest_pending[k - 1] = std::min(earliest_pending[k], measurements[arrival_order_[k - 1]].timestamp_);
+  }
+
+  // The first checkpoint is the filter before any measurement was processed
+  AddCheckpoint(0, -std::numeric_limits<double>::infinity(), earliest_pending[0]);
+
+  CoreLogic& core_logic = *setup_.core_logic_;
+
+  for (size_t k = 0; k < arrival_order_.size(); k++)
+  {
+    ProcessMeasurement(&core_logic, arrival_order_[k]);
+
+    // Checkpoints are taken once all measurements of an arrival time were processed
+    const bool last_of_arrival_time = k + 1 == arrival_order_.size() || arrival_time_[k + 1] > arrival_time_[k];
+    if (core_logic.core_is_initialized_ && last_of_arrival_time &&
+        (arrival_time_[k] - checkpoints_.back().timestamp_).get_seconds() >= checkpoint_interval_)
+    {
+      AddCheckpoint(k + 1, arrival_time_[k], earliest_pending[k + 1]);
+    }
+  }
+
+  return core_logic.core_is_initialized_;
+}
+
+bool StateHistory::get_state(const Time& timestamp, BufferEntryType* state_entry)
+{
+  if (checkpoints_.empty())
+  {
+    std::cout << "Warning: StateHistory: Run was not performed" << std::endl;
+    return false;
+  }
+
+  // Latest checkpoint at or before the requested time, the first checkpoint precedes all times
+  const auto checkpoint =
+      std::upper_bound(checkpoints_.begin() + 1, checkpoints_.end(), timestamp,
+                       [](const Time& t, const Checkpoint& c) { return t < c.timestamp_; }) -
+      1;
+
+  // Continue the previous replay unless the checkpoint is closer to the requested time
+  if (!replay_valid_ || timestamp < replay_time_ || replay_idx_ < checkpoint->arrival_idx_)
+  {
+    replay_ = checkpoint->core_logic_.Clone();
+    replay_idx_ = checkpoint->arrival_idx_;
+
+    for (size_t k = 0; k < setup_.sensors_.size(); k++)
+    {
+      if (setup_.sensors_[k] != nullptr)
+      {
+        setup_.sensors_[k]->RestoreState(checkpoint->sensor_states_[k]);
+      }
+    }
+  }
+
+  for (; replay_idx_ < arrival_order_.size() && arrival_time_[replay_idx_] <= timestamp; replay_idx_++)
+  {
+    ProcessMeasurement(&replay_, arrival_order_[replay_idx_]);
+    num_replayed_++;
+  }
+
+  replay_time_ = timestamp;
+  replay_valid_ = true;
+
+  if (!replay_.core_is_initialized_)
+  {
+    return false;
+  }
+
+  return replay_.buffer_.get_latest_state(state_entry);
+}
+
+int StateHistory::get_states(const std::vector<Time>& timestamps, std::vector<BufferEntryType>* state_entries)
+{
+  std::vector<size_t> order(timestamps.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&timestamps](const size_t& a, const size_t& b) { return timestamps[a] < timestamps[b]; });
+
+  state_entries->assign(timestamps.size(), BufferEntryType());
+
+  // Start a new replay, otherwise the first time could continue a replay that is further away than a checkpoint
+  replay_valid_ = false;
+
+  int num_valid = 0;
+  for (const auto& k : order)
+  {
+    num_valid += get_state(timestamps[k], &(*state_entries)[k]) ? 1 : 0;
+  }
+
+  return num_valid;
+}
+
+int StateHistory::get_num_checkpoints() const
+{
+  return static_cast<int>(checkpoints_.size());
+}
+
+int StateHistory::get_num_replayed() const
+{
+  return num_replayed_;
+}
+
+void StateHistory::ProcessMeasurement(CoreLogic* core_logic, const size_t& measurement_idx) const
+{
+  const SweepMeasurement& measurement = dataset_->get_measurements()[measurement_idx];
+
+  if (measurement.sensor_idx_ >= static_cast<int>(setup_.sensors_.size()) ||
+      setup_.sensors_[measurement.sensor_idx_] == nullptr)
+  {
+    return;
+  }
+
+  const std::shared_ptr<SensorAbsClass>& sensor = setup_.sensors_[measurement.sensor_idx_];
+
+  BufferDataType data;
+  data.set_sensor_data(measurement.data_);
+  core_logic->ProcessMeasurement(sensor, measurement.timestamp_, data);
+
+  if (sensor != core_logic->core_states_->propagation_sensor_ || core_logic->core_is_initialized_)
+  {
+    return;
+  }
+
+  Eigen::Vector3d p_wi_init(setup_.p_wi_init_);
+  Eigen::Quaterniond q_wi_init(setup_.q_wi_init_);
+
+  CoreStateType ground_truth;
+  if (setup_.init_from_ground_truth_ && dataset_->get_ground_truth(measurement.timestamp_, &ground_truth))
+  {
+    p_wi_init = ground_truth.p_wi_;
+    q_wi_init = ground_truth.q_wi_;
+  }
+
+  core_logic->Initialize(p_wi_init, q_wi_init);
+}
+
+void StateHistory::AddCheckpoint(const size_t& arrival_idx, const Time& timestamp, const Time& earliest_pending)
+{
+  checkpoints_.push_back({ arrival_idx, timestamp, setup_.core_logic_->Clone(), {} });
+  Checkpoint& checkpoint = checkpoints_.back();
+
+  CoreLogic& core_logic = checkpoint.core_logic_;
+  const Buffer& buffer = core_logic.buffer_;
+
+  // Entries from the earliest pending timestamp on are reworked by a delayed measurement. Without delays, this is
+  // the end of the buffer.
+  int rework_idx = buffer.get_length();
+  BufferEntryType entry;
+  while (rework_idx > 0 && buffer.get_entry_at_idx(rework_idx - 1, &entry) && entry.timestamp_ >= earliest_pending)
+  {
+    rework_idx--;
+  }
+
+  int trim_idx = rework_idx;
+
+  for (const auto& sensor : setup_.sensors_)
+  {
+    checkpoint.sensor_states_.push_back(sensor != nullptr ? sensor->SaveState() : nullptr);
+
+    if (sensor == nullptr)
+    {
+      continue;
+    }
+
+    // Pending measurements only refer to the latest state of each sensor before the reworked entries and the core
+    // states after it
+    for (int k = rework_idx - 1; k >= 0; k--)
+    {
+      if (buffer.get_entry_at_idx(k, &entry) && entry.sensor_.get() == sensor.get() && entry.IsState())
+      {
+        trim_idx = std::min(trim_idx, k);
+        break;
+      }
+    }
+  }
+
+  if (core_logic.core_is_initialized_)
+  {
+    core_logic.buffer_.DeleteEntriesBeforeIdx(trim_idx);
+    core_logic.buffer_prior_core_init_.ResetBufferData();
+  }
+}
+}  // namespace mars
@@ -0,0 +1,297 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <mars/sweep_runner.h>
+#include <mars/type_definitions/core_type.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <thread>
+
+namespace mars
+{
+int SweepDataset::AddSensorMeasurements(const std::vector<BufferEntryType>& entries)
+{
+  const int sensor_idx = num_sensors_++;
+
+  measurements_.reserve(measurements_.size() + entries.size());
+  for (const auto& entry : entries)
+  {
+    SweepMeasurement measurement;
+    measurement.timestamp_ = entry.timestamp_;
+    measurement.sensor_idx_ = sensor_idx;
+    measurement.data_ = entry.data_.sensor_;
+    measurements_.push_back(measurement);
+  }
+
+  // Stable sort keeps the order of sensors that were added first for equal timestamps
+  std::stable_sort(measurements_.begin(), measurements_.end(),
+                   [](const SweepMeasurement& a, const SweepMeasurement& b) { return a.timestamp_ < b.timestamp_; });
+
+  return sensor_idx;
+}
+
+void SweepDataset::AddGroundTruth(const std::vector<BufferEntryType>& sim_data)
+{
+  std::vector<std::pair<Time, std::shared_ptr<CoreStateType>>> ground_truth;
+  ground_truth.reserve(ground_truth_time_.size() + sim_data.size());
+
+  for (size_t k = 0; k < ground_truth_time_.size(); k++)
+  {
+    ground_truth.emplace_back(ground_truth_time_[k], ground_truth_state_[k]);
+  }
+
+  for (const auto& entry : sim_data)
+  {
+    if (entry.data_.core_ == nullptr)
+    {
+      continue;
+    }
+    ground_truth.emplace_back(entry.timestamp_, std::static_pointer_cast<CoreStateType>(entry.data_.core_));
+  }
+
+  std::stable_sort(ground_truth.begin(), ground_truth.end(),
+                   [](const std::pair<Time, std::shared_ptr<CoreStateType>>& a,
+                      const std::pair<Time, std::shared_ptr<CoreStateType>>& b) { return a.first < b.first; });
+
+  ground_truth_time_.clear();
+  ground_truth_state_.clear();
+  for (const auto& k : ground_truth)
+  {
+    ground_truth_time_.push_back(k.first);
+    ground_truth_state_.push_back(k.second);
+  }
+}
+
+bool SweepDataset::get_ground_truth(const Time& timestamp, CoreStateType* state, const double& max_dt) const
+{
+  if (ground_truth_time_.empty())
+  {
+    return false;
+  }
+
+  auto it = std::lower_bound(ground_truth_time_.begin(), ground_truth_time_.end(), timestamp);
+  size_t idx = static_cast<size_t>(std::distance(ground_truth_time_.begin(), it));
+
+  if (idx == ground_truth_time_.size())
+  {
+    idx = idx - 1;
+  }
+  else if (idx > 0 &&
+           (timestamp - ground_truth_time_[idx - 1]).abs() < (ground_truth_time_[idx] - timestamp).abs())
+  {
+    idx = idx - 1;
+  }
+
+  if ((ground_truth_time_[idx] - timestamp).abs().get_seconds() > max_dt)
+  {
+    return false;
+  }
+
+  *state = *ground_truth_state_[idx];
+  return true;
+}
+
+bool SweepDataset::has_ground_truth() const
+{
+  return !ground_truth_time_.empty();
+}
+
+const std::vector<SweepMeasurement>& SweepDataset::get_measurements() const
+{
+  return measurements_;
+}
+
+int SweepDataset::get_num_sensors() const
+{
+  return num_sensors_;
+}
+
+double SweepRunSetup::get_sensor_delay(const int& sensor_idx) const
+{
+  return sensor_idx >= 0 && sensor_idx < static_cast<int>(sensor_delays_.size()) ? sensor_delays_[sensor_idx] : 0.0;
+}
+
+std::vector<size_t> SweepRunSetup::get_arrival_order(const SweepDataset& dataset) const
+{
+  const std::vector<SweepMeasurement>& measurements = dataset.get_measurements();
+  std::vector<size_t> order(measurements.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  if (std::any_of(sensor_delays_.begin(), sensor_delays_.end(), [](double d) { return d != 0.0; }))
+  {
+    std::stable_sort(order.begin(), order.end(), [&](const size_t& a, const size_t& b) {
+      return measurements[a].timestamp_.get_seconds() + get_sensor_delay(measurements[a].sensor_idx_) <
+             measurements[b].timestamp_.get_seconds() + get_sensor_delay(measurements[b].sensor_idx_);
+    });
+  }
+
+  return order;
+}
+
+SweepRunner::SweepRunner(std::shared_ptr<const SweepDataset> dataset, const int& num_threads)
+  : dataset_(std::move(dataset))
+{
+  if (num_threads > 0)
+  {
+    num_threads_ = num_threads;
+  }
+  else
+  {
+    num_threads_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+}
+
+std::vector<SweepRunResult> SweepRunner::Run(const int& num_runs, const SetupFunction& setup) const
+{
+  std::vector<SweepRunResult> results(static_cast<size_t>(std::max(num_runs, 0)));
+  std::atomic<int> next_run{ 0 };
+
+  auto worker = [&]() {
+    int run_id;
+    while ((run_id = next_run.fetch_add(1)) < num_runs)
+    {
+      results[run_id] = RunSingle(*dataset_, run_id, setup(run_id));
+    }
+  };
+
+  const int num_workers = std::min(num_threads_, num_runs);
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers);
+
+  for (int k = 0; k < num_workers; k++)
+  {
+    workers.emplace_back(worker);
+  }
+
+  for (auto& k : workers)
+  {
+    k.join();
+  }
+
+  return results;
+}
+
+SweepRunResult SweepRunner::RunSingle(const SweepDataset& dataset, const int& run_id, const SweepRunSetup& setup)
+{
+  SweepRunResult result;
+  result.run_id_ = run_id;
+
+  if (setup.core_logic_ == nullptr)
+  {
+    std::cout << "Warning: SweepRunner: Run " << run_id << " has no CoreLogic" << std::endl;
+    return result;
+  }
+
+  const auto t_start = std::chrono::steady_clock::now();
+
+  CoreLogic& core_logic = *setup.core_logic_;
+  const std::vector<SweepMeasurement>& measurements = dataset.get_measurements();
+
+  const std::vector<size_t> order = setup.get_arrival_order(dataset);
+
+  double p_se = 0;
+  double v_se = 0;
+  double q_se = 0;
+  CoreStateType ground_truth;
+
+  for (const auto& k : order)
+  {
+    const SweepMeasurement& measurement = measurements[k];
+
+    if (measurement.sensor_idx_ >= static_cast<int>(setup.sensors_.size()) ||
+        setup.sensors_[measurement.sensor_idx_] == nullptr)
+    {
+      continue;
+    }
+
+    const std::shared_ptr<SensorAbsClass>& sensor = setup.sensors_[measurement.sensor_idx_];
+
+    BufferDataType data;
+    data.set_sensor_data(measurement.data_);
+    core_logic.ProcessMeasurement(sensor, measurement.timestamp_, data);
+    result.num_measurements_++;
+
+    // Errors are evaluated at the rate of the propagation sensor
+    if (sensor != core_logic.core_states_->propagation_sensor_)
+    {
+      continue;
+    }
+
+    if (!core_logic.core_is_initialized_)
+    {
+      Eigen::Vector3d p_wi_init(setup.p_wi_init_);
+      Eigen::Quaterniond q_wi_init(setup.q_wi_init_);
+
+      if (setup.init_from_ground_truth_ && dataset.get_ground_truth(measurement.timestamp_, &ground_truth))
+      {
+        p_wi_init = ground_truth.p_wi_;
+        q_wi_init = ground_truth.q_wi_;
+      }
+
+      core_logic.Initialize(p_wi_init, q_wi_init);
+      continue;
+    }
+
+    BufferEntryType latest_state;
+    if (!core_logic.buffer_.get_latest_state(&latest_state) ||
+        !dataset.get_ground_truth(latest_state.timestamp_, &ground_truth))
+    {
+      continue;
+    }
+
+    const CoreStateType& estimate = static_cast<CoreType*>(latest_state.data_.core_.get())->state_;
+
+    const double p_error = (estimate.p_wi_ - ground_truth.p_wi_).norm();
+    const double v_error = (estimate.v_wi_ - ground_truth.v_wi_).norm();
+    const double q_error =
+        Eigen::AngleAxisd(estimate.q_wi_.normalized().conjugate() * ground_truth.q_wi_.normalized()).angle() *
+        (180.0 / M_PI);
+
+    p_se += p_error * p_error;
+    v_se += v_error * v_error;
+    q_se += q_error * q_error;
+    result.p_final_error_ = p_error;
+    result.num_evaluations_++;
+  }
+
+  if (result.num_evaluations_ > 0)
+  {
+    result.valid_ = true;
+    result.p_rmse_ = std::sqrt(p_se / result.num_evaluations_);
+    result.v_rmse_ = std::sqrt(v_se / result.num_evaluations_);
+    result.q_rmse_deg_ = std::sqrt(q_se / result.num_evaluations_);
+  }
+
+  result.runtime_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+
+  return result;
+}
+
+void SweepRunner::PrintResults(const std::vector<SweepRunResult>& results)
+{
+  std::cout << "run\tvalid\tp_rmse[m]\tv_rmse[m/s]\tq_rmse[deg]\tp_final[m]\tt_run[s]" << std::endl;
+  std::cout << std::setprecision(5);
+
+  for (const auto& k : results)
+  {
+    std::cout << k.run_id_ << "\t" << k.valid_ << "\t" << k.p_rmse_ << "\t\t" << k.v_rmse_ << "\t\t" << k.q_rmse_deg_
+              << "\t\t" << k.p_final_error_ << "\t\t" << k.runtime_ << std::endl;
+  }
+}
+
+int SweepRunner::get_num_threads() const
+{
+  return num_threads_;
+}
+}  // namespace mars
@@ -0,0 +1,133 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#ifndef SLOW_POSITION_SENSOR_H
+#define SLOW_POSITION_SENSOR_H
+
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+///
+/// \brief The SlowPositionSensorClass class simulates an expensive sensor update
+///
+/// Each update takes at least delay_ms_. If the sensor is held, each update blocks until it is released by the test,
+/// this allows the tests to check the behavior of a busy worker thread without relying on wall-clock durations.
+///
+class SlowPositionSensorClass : public mars::PositionSensorClass
+{
+public:
+  SlowPositionSensorClass(const std::string& name, std::shared_ptr<mars::CoreState> core_states, int delay_ms)
+    : PositionSensorClass(name, core_states), delay_ms_(delay_ms)
+  {
+  }
+
+  bool CalcUpdate(const mars::Time& timestamp, std::shared_ptr<void> measurement,
+                  const mars::CoreStateType& prior_core_state, std::shared_ptr<void> latest_sensor_data,
+                  const Eigen::MatrixXd& prior_cov, mars::BufferDataType* new_state_data)
+  {
+    {
+      std::unique_lock<std::mutex> lock(gate_mutex_);
+      const int update_idx = num_updates_++;
+      gate_cv_.notify_all();
+      gate_cv_.wait(lock, [this, update_idx]() { return !hold_ || update_idx < num_released_; });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+    return PositionSensorClass::CalcUpdate(timestamp, measurement, prior_core_state, latest_sensor_data, prior_cov,
+                                           new_state_data);
+  }
+
+  /// Blocks all following updates until they are released
+  void Hold()
+  {
+    std::lock_guard<std::mutex> lock(gate_mutex_);
+    hold_ = true;
+    num_released_ = num_updates_;
+  }
+
+  /// Releases the next held update
+  void ReleaseUpdate()
+  {
+    std::lock_guard<std::mutex> lock(gate_mutex_);
+    num_released_++;
+    gate_cv_.notify_all();
+  }
+
+  /// Releases all held and following updates
+  void Release()
+  {
+    std::lock_guard<std::mutex> lock(gate_mutex_);
+    hold_ = false;
+    gate_cv_.notify_all();
+  }
+
+  /// Waits until the given number of updates was started
+  void WaitForUpdates(int num_updates)
+  {
+    std::unique_lock<std::mutex> lock(gate_mutex_);
+    gate_cv_.wait(lock, [this, num_updates]() { return num_updates_ >= num_updates; });
+  }
+
+  int get_num_updates()
+  {
+    std::lock_guard<std::mutex> lock(gate_mutex_);
+    return num_updates_;
+  }
+
+  int delay_ms_;
+
+private:
+  std::mutex gate_mutex_;
+  std::condition_variable gate_cv_;
+  bool hold_{ false };
+  int num_updates_{ 0 };
+  int num_released_{ 0 };
+};
+
+struct FilterSetup
+{
+  std::shared_ptr<mars::CoreLogic> core_logic_;
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_;
+  std::shared_ptr<SlowPositionSensorClass> position_sensor_;
+};
+
+///
+/// \brief CreateFilter Creates a CoreLogic with an IMU and a position sensor
+/// \param update_delay_ms Min. duration of each position update
+///
+inline FilterSetup CreateFilter(int update_delay_ms = 0)
+{
+  FilterSetup setup;
+  setup.imu_sensor_ = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(setup.imu_sensor_);
+
+  setup.position_sensor_ = std::make_shared<SlowPositionSensorClass>("Position", core_states_sptr, update_delay_ms);
+  setup.position_sensor_->const_ref_to_nav_ = true;
+  setup.position_sensor_->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+  setup.position_sensor_->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+  return setup;
+}
+
+#endif  // SLOW_POSITION_SENSOR_H
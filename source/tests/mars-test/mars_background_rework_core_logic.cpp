@@ -0,0 +1,240 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/background_rework_core_logic.h>
+#include <mars/batch_smoother.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../include_local/slow_position_sensor.h"
+
+class mars_background_rework_core_logic_test : public testing::Test
+{
+public:
+  using ProcessFunction =
+      std::function<void(const std::shared_ptr<mars::SensorAbsClass>&, const double&, const mars::BufferDataType&)>;
+
+  static mars::BufferDataType ImuData(const double& t)
+  {
+    mars::BufferDataType imu_data;
+    imu_data.set_sensor_data(std::make_shared<mars::IMUMeasurementType>(
+        Eigen::Vector3d(0.1 * std::sin(t), 0, 9.81), Eigen::Vector3d(0, 0, 0.2 * std::cos(t))));
+    return imu_data;
+  }
+
+  static mars::BufferDataType PositionData(const double& t)
+  {
+    mars::BufferDataType position_data;
+    position_data.set_sensor_data(std::make_shared<mars::PositionMeasurementType>(Eigen::Vector3d(0.1 * t, 0, 5)));
+    return position_data;
+  }
+
+  // IMU at 200 Hz and position at 20 Hz for 3 s, one in four position measurements arrives 0.3 s late and another one
+  // in four 0.02 s late
+  static void RunSequence(const FilterSetup& setup, const ProcessFunction& process)
+  {
+    struct LateMeasurement
+    {
+      int arrival_;
+      double timestamp_;
+    };
+    std::vector<LateMeasurement> late_measurements;
+
+    for (int k = 0; k < 600; k++)
+    {
+      const double t = k * 0.005;
+      process(setup.imu_sensor_, t, ImuData(t));
+
+      for (const auto& m : late_measurements)
+      {
+        if (m.arrival_ == k)
+        {
+          process(setup.position_sensor_, m.timestamp_, PositionData(m.timestamp_));
+        }
+      }
+
+      if (k % 10 == 5)
+      {
+        if (k % 40 == 25)
+        {
+          late_measurements.push_back({ k + 60, t });
+        }
+        else if (k % 40 == 35)
+        {
+          late_measurements.push_back({ k + 4, t });
+        }
+        else
+        {
+          process(setup.position_sensor_, t, PositionData(t));
+        }
+      }
+    }
+  }
+
+  static void ExpectEqualFilters(const mars::CoreLogic& core_logic, const mars::CoreLogic& reference)
+  {
+    ASSERT_EQ(core_logic.buffer_.get_length(), reference.buffer_.get_length());
+
+    for (int k = 0; k < reference.buffer_.get_length(); k++)
+    {
+      mars::BufferEntryType entry, reference_entry;
+      core_logic.buffer_.get_entry_at_idx(k, &entry);
+      reference.buffer_.get_entry_at_idx(k, &reference_entry);
+      ASSERT_EQ(entry.timestamp_, reference_entry.timestamp_);
+      ASSERT_EQ(entry.metadata_, reference_entry.metadata_);
+    }
+
+    mars::BufferEntryType latest_state, reference_state;
+    ASSERT_TRUE(core_logic.buffer_.get_latest_state(&latest_state));
+    ASSERT_TRUE(reference.buffer_.get_latest_state(&reference_state));
+    const mars::CoreType& core = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+    const mars::CoreType& reference_core = *static_cast<mars::CoreType*>(reference_state.data_.core_.get());
+
+    EXPECT_EQ(core.state_.p_wi_, reference_core.state_.p_wi_);
+    EXPECT_EQ(core.state_.v_wi_, reference_core.state_.v_wi_);
+    EXPECT_EQ(core.state_.q_wi_.coeffs(), reference_core.state_.q_wi_.coeffs());
+    EXPECT_EQ(core.state_.b_w_, reference_core.state_.b_w_);
+    EXPECT_EQ(core.state_.b_a_, reference_core.state_.b_a_);
+    EXPECT_EQ(core.cov_, reference_core.cov_);
+  }
+};
+
+TEST_F(mars_background_rework_core_logic_test, MATCHES_SEQUENTIAL_PROCESSING)
+{
+  FilterSetup reference = CreateFilter();
+  std::shared_ptr<mars::BatchSmoother> reference_smoother = std::make_shared<mars::BatchSmoother>();
+  reference.core_logic_->smoother_ = reference_smoother;
+  RunSequence(reference, [&reference](const std::shared_ptr<mars::SensorAbsClass>& sensor, const double& t,
+                                      const mars::BufferDataType& data) {
+    reference.core_logic_->ProcessMeasurement(sensor, t, data);
+    if (t == 0)
+    {
+      reference.core_logic_->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+    }
+  });
+
+  FilterSetup setup = CreateFilter();
+  std::shared_ptr<mars::BatchSmoother> smoother = std::make_shared<mars::BatchSmoother>();
+  setup.core_logic_->smoother_ = smoother;
+  mars::BackgroundReworkCoreLogic background_rework(setup.core_logic_);
+  RunSequence(setup, [&background_rework](const std::shared_ptr<mars::SensorAbsClass>& sensor, const double& t,
+                                          const mars::BufferDataType& data) {
+    background_rework.ProcessMeasurement(sensor, t, data);
+    if (t == 0)
+    {
+      background_rework.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+    }
+  });
+  background_rework.WaitForRework();
+
+  // Late measurements that arrive during a rework are passed to the active rework
+  EXPECT_GT(background_rework.get_num_background_reworks(), 0);
+  EXPECT_LE(background_rework.get_num_background_reworks(), 14);
+  EXPECT_FALSE(background_rework.is_rework_active());
+
+  ExpectEqualFilters(*setup.core_logic_, *reference.core_logic_);
+
+  // The smoother received the reworked steps of the clone instead of the live propagation
+  ASSERT_EQ(setup.core_logic_->smoother_, smoother);
+  ASSERT_EQ(smoother->get_num_nodes(), reference_smoother->get_num_nodes());
+
+  std::vector<mars::BufferEntryType> smoothed, reference_smoothed;
+  smoother->Smooth(&smoothed, 1);
+  reference_smoother->Smooth(&reference_smoothed, 1);
+  ASSERT_EQ(smoothed.size(), reference_smoothed.size());
+
+  for (size_t k = 0; k < reference_smoothed.size(); k++)
+  {
+    const mars::CoreType& core = *static_cast<mars::CoreType*>(smoothed[k].data_.core_.get());
+    const mars::CoreType& reference_core = *static_cast<mars::CoreType*>(reference_smoothed[k].data_.core_.get());
+    ASSERT_EQ(smoothed[k].timestamp_, reference_smoothed[k].timestamp_);
+    ASSERT_EQ(core.state_.p_wi_, reference_core.state_.p_wi_);
+    ASSERT_EQ(core.state_.q_wi_.coeffs(), reference_core.state_.q_wi_.coeffs());
+    ASSERT_EQ(core.cov_, reference_core.cov_);
+  }
+}
+
+TEST_F(mars_background_rework_core_logic_test, OUTPUT_CONTINUES_DURING_REWORK)
+{
+  FilterSetup setup = CreateFilter();
+  mars::BackgroundReworkCoreLogic background_rework(setup.core_logic_);
+
+  FilterSetup reference = CreateFilter();
+  auto process_imu = [&](const double& t) {
+    background_rework.ProcessMeasurement(setup.imu_sensor_, t, ImuData(t));
+    reference.core_logic_->ProcessMeasurement(reference.imu_sensor_, t, ImuData(t));
+  };
+  auto process_position = [&](const double& t) {
+    background_rework.ProcessMeasurement(setup.position_sensor_, t, PositionData(t));
+    reference.core_logic_->ProcessMeasurement(reference.position_sensor_, t, PositionData(t));
+  };
+
+  process_imu(0);
+  background_rework.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+  reference.core_logic_->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+
+  for (int k = 1; k <= 400; k++)
+  {
+    const double t = k * 0.005;
+    process_imu(t);
+
+    if (k % 10 == 5)
+    {
+      process_position(t);
+    }
+  }
+
+  // Late measurement, the rework is performed in the background and blocks in its first update until the sensor is
+  // released
+  setup.position_sensor_->Hold();
+  const int num_updates = setup.position_sensor_->get_num_updates();
+  process_position(1.5);
+  setup.position_sensor_->WaitForUpdates(num_updates + 1);
+
+  // The worker copied the buffer entries of the clone, the live filter is not delayed by a copy
+  EXPECT_FALSE(setup.core_logic_->buffer_.IsShared());
+  EXPECT_TRUE(background_rework.is_rework_active());
+  EXPECT_EQ(background_rework.get_num_background_reworks(), 1);
+
+  // The live filter propagates the IMU measurements while the rework is active
+  for (int k = 401; k <= 420; k++)
+  {
+    const double t = k * 0.005;
+    process_imu(t);
+
+    mars::BufferEntryType latest_state;
+    ASSERT_TRUE(setup.core_logic_->buffer_.get_latest_state(&latest_state));
+    EXPECT_EQ(latest_state.timestamp_, mars::Time(t));
+  }
+  EXPECT_EQ(setup.position_sensor_->get_num_updates(), num_updates + 1);
+  EXPECT_TRUE(background_rework.is_rework_active());
+  EXPECT_EQ(background_rework.get_num_deferred_measurements(), 0);
+
+  // Updates are deferred to the rework
+  process_position(2.1);
+  EXPECT_EQ(background_rework.get_num_deferred_measurements(), 1);
+  EXPECT_EQ(setup.position_sensor_->get_num_updates(), num_updates + 1);
+
+  setup.position_sensor_->Release();
+  background_rework.WaitForRework();
+  EXPECT_FALSE(background_rework.is_rework_active());
+
+  ExpectEqualFilters(*setup.core_logic_, *reference.core_logic_);
+}
@@ -0,0 +1,289 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/batch_smoother.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/data_utils/write_csv.h>
+#include <mars/fixed_lag_smoother.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class mars_batch_smoother_test : public testing::Test
+{
+public:
+  // IMU at 200 Hz and a noisy position sensor at 10 Hz over 10 s
+  void SetUp() override
+  {
+    mars::SyntheticTrajectoryOptions options;
+    options.duration_ = 10;
+    options.seed_ = 7;
+    generator_ = std::make_shared<mars::SyntheticDataGenerator>(options);
+
+    mars::SyntheticSensorOptions imu_options;
+    imu_options.type_ = mars::SyntheticSensorType::imu;
+    imu_options.rate_ = 200;
+    generator_->AddSensor(imu_options);
+
+    mars::SyntheticSensorOptions position_options;
+    position_options.type_ = mars::SyntheticSensorType::position;
+    position_options.rate_ = 10;
+    position_options.noise_std_ = 0.05;
+    generator_->AddSensor(position_options);
+  }
+
+  // Runs the filter on the arrival stream of the generator with the given smoother, position measurements before
+  // first_update_time are dropped
+  void RunFilter(const std::shared_ptr<mars::SmootherInterface>& smoother, const double& first_update_time = 0) const
+  {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->const_ref_to_nav_ = true;
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 1e-6;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, position_sensor_sptr };
+
+    mars::CoreLogic core_logic(core_states_sptr);
+    core_logic.smoother_ = smoother;
+
+    for (const auto& k : generator_->get_arrival_stream())
+    {
+      if (k.sensor_idx_ != 0 && k.timestamp_.get_seconds() < first_update_time)
+      {
+        continue;
+      }
+
+      mars::BufferDataType data;
+      data.set_sensor_data(k.data_);
+      core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+      if (!core_logic.core_is_initialized_)
+      {
+        const mars::CoreStateType gt = generator_->get_ground_truth(k.timestamp_.get_seconds());
+        core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+      }
+    }
+  }
+
+  static const mars::CoreType& CoreData(const mars::BufferEntryType& entry)
+  {
+    return *static_cast<mars::CoreType*>(entry.data_.core_.get());
+  }
+
+  static void ExpectNearStates(const mars::BufferEntryType& a, const mars::BufferEntryType& b, const double& tol)
+  {
+    ASSERT_EQ(a.timestamp_, b.timestamp_);
+
+    const mars::CoreType& core_a = CoreData(a);
+    const mars::CoreType& core_b = CoreData(b);
+    const mars::CoreStateVector difference = mars::CoreStateType::CalcCorrection(core_a.state_, core_b.state_);
+    EXPECT_LT(difference.norm(), tol) << "t = " << a.timestamp_;
+    EXPECT_LT((core_a.cov_ - core_b.cov_).norm(), tol * core_b.cov_.norm()) << "t = " << a.timestamp_;
+  }
+
+  std::shared_ptr<mars::SyntheticDataGenerator> generator_;
+};
+
+TEST_F(mars_batch_smoother_test, MATCHES_FIXED_LAG_SMOOTHER)
+{
+  // A single Process call after the recording smooths all steps with the latest step
+  std::shared_ptr<mars::FixedLagSmoother> fixed_lag_smoother = std::make_shared<mars::FixedLagSmoother>();
+  fixed_lag_smoother->lag_ = 0;
+  RunFilter(fixed_lag_smoother);
+
+  std::vector<mars::BufferEntryType> reference;
+  fixed_lag_smoother->Process(&reference);
+  ASSERT_GT(reference.size(), 9.5 * 200);
+
+  std::shared_ptr<mars::BatchSmoother> batch_smoother = std::make_shared<mars::BatchSmoother>();
+  RunFilter(batch_smoother);
+  ASSERT_EQ(batch_smoother->get_num_nodes(), static_cast<int>(reference.size()) + 1);
+
+  // The batch smoother also outputs the latest step, the fixed-lag smoother keeps it in its window
+  std::vector<mars::BufferEntryType> single_thread;
+  ASSERT_EQ(batch_smoother->Smooth(&single_thread, 1), batch_smoother->get_num_nodes());
+
+  std::vector<mars::BufferEntryType> multi_thread;
+  ASSERT_EQ(batch_smoother->Smooth(&multi_thread, 4), batch_smoother->get_num_nodes());
+
+  // The composed maps are the step-wise RTS recursion of the fixed-lag smoother
+  for (size_t k = 0; k < reference.size(); k++)
+  {
+    ExpectNearStates(single_thread[k], reference[k], 1e-9);
+    ExpectNearStates(multi_thread[k], single_thread[k], 1e-9);
+  }
+}
+
+TEST_F(mars_batch_smoother_test, OUTPUT_INTERVAL)
+{
+  std::shared_ptr<mars::BatchSmoother> all_steps = std::make_shared<mars::BatchSmoother>();
+  RunFilter(all_steps);
+  std::vector<mars::BufferEntryType> reference;
+  all_steps->Smooth(&reference, 2);
+
+  std::shared_ptr<mars::BatchSmoother> decimated = std::make_shared<mars::BatchSmoother>();
+  decimated->output_interval_ = 0.1;
+  RunFilter(decimated);
+  // A node every 0.1 s or 0.105 s depending on the rounding of the IMU timestamps
+  EXPECT_GE(decimated->get_num_nodes(), 10 / 0.105);
+  EXPECT_LE(decimated->get_num_nodes(), 10 / 0.1 + 1);
+
+  std::vector<mars::BufferEntryType> entries;
+  decimated->Smooth(&entries, 3);
+
+  // The nodes are filter steps, merging the steps between them does not change their smoothed states
+  size_t reference_idx = 0;
+  for (const auto& entry : entries)
+  {
+    while (reference_idx < reference.size() && reference[reference_idx].timestamp_ < entry.timestamp_)
+    {
+      reference_idx++;
+    }
+    ASSERT_LT(reference_idx, reference.size());
+    ExpectNearStates(entry, reference[reference_idx], 1e-9);
+  }
+}
+
+TEST_F(mars_batch_smoother_test, OUT_OF_ORDER_MEASUREMENTS)
+{
+  // A delay of 0.0225 s lets the position measurements arrive after the following IMU measurements, each one reworks
+  // the buffer. The first position measurement initializes the sensor in both runs.
+  auto set_generator = [this](const double& delay) {
+    mars::SyntheticTrajectoryOptions options;
+    options.duration_ = 10;
+    options.seed_ = 7;
+    generator_ = std::make_shared<mars::SyntheticDataGenerator>(options);
+
+    mars::SyntheticSensorOptions imu_options;
+    imu_options.type_ = mars::SyntheticSensorType::imu;
+    imu_options.rate_ = 200;
+    generator_->AddSensor(imu_options);
+
+    mars::SyntheticSensorOptions position_options;
+    position_options.type_ = mars::SyntheticSensorType::position;
+    position_options.rate_ = 10;
+    position_options.noise_std_ = 0.05;
+    position_options.delay_ = delay;
+    generator_->AddSensor(position_options);
+  };
+
+  for (const double& output_interval : { 0.0, 0.05 })
+  {
+    set_generator(0);
+    std::shared_ptr<mars::BatchSmoother> in_order = std::make_shared<mars::BatchSmoother>();
+    in_order->output_interval_ = output_interval;
+    RunFilter(in_order, 0.05);
+    std::vector<mars::BufferEntryType> reference;
+    in_order->Smooth(&reference);
+
+    set_generator(0.0225);
+    std::shared_ptr<mars::BatchSmoother> out_of_order = std::make_shared<mars::BatchSmoother>();
+    out_of_order->output_interval_ = output_interval;
+    RunFilter(out_of_order, 0.05);
+    std::vector<mars::BufferEntryType> entries;
+    out_of_order->Smooth(&entries);
+
+    // The reworked steps replace the steps of the states after the out of order measurement
+    ASSERT_EQ(entries.size(), reference.size());
+    for (size_t k = 0; k < reference.size(); k++)
+    {
+      ExpectNearStates(entries[k], reference[k], 1e-9);
+    }
+  }
+}
+
+TEST_F(mars_batch_smoother_test, WRITE_CSV)
+{
+  std::shared_ptr<mars::BatchSmoother> smoother = std::make_shared<mars::BatchSmoother>();
+  RunFilter(smoother);
+
+  std::vector<mars::BufferEntryType> entries;
+  smoother->Smooth(&entries);
+
+  const std::string file_path("mars_batch_smoother_test.csv");
+  ASSERT_TRUE(mars::BatchSmoother::WriteCsvFile(file_path, entries, true, 3));
+
+  std::ifstream file(file_path);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(file, line);)
+  {
+    lines.push_back(line);
+  }
+  std::remove(file_path.c_str());
+
+  // Header and one line per entry in time order, 23 state and 120 covariance columns
+  ASSERT_EQ(lines.size(), entries.size() + 1);
+  for (size_t k = 0; k < lines.size(); k++)
+  {
+    EXPECT_EQ(std::count(lines[k].begin(), lines[k].end(), ','), 22 + 120);
+  }
+  EXPECT_EQ(lines[1], CoreData(entries.front()).state_.to_csv_string(entries.front().timestamp_.get_seconds()) +
+                          mars::WriteCsv::cov_mat_to_csv(CoreData(entries.front()).cov_));
+  EXPECT_EQ(lines.back(), CoreData(entries.back()).state_.to_csv_string(entries.back().timestamp_.get_seconds()) +
+                              mars::WriteCsv::cov_mat_to_csv(CoreData(entries.back()).cov_));
+
+  EXPECT_FALSE(mars::BatchSmoother::WriteCsvFile("/nonexistent/smoothed.csv", entries));
+}
+
+TEST_F(mars_batch_smoother_test, WRITE_BINARY)
+{
+  std::shared_ptr<mars::BatchSmoother> smoother = std::make_shared<mars::BatchSmoother>();
+  smoother->output_interval_ = 0.5;
+  RunFilter(smoother);
+
+  std::vector<mars::BufferEntryType> entries;
+  smoother->Smooth(&entries);
+
+  const std::string file_path("mars_batch_smoother_test.bin");
+  ASSERT_TRUE(mars::BatchSmoother::WriteBinaryFile(file_path, entries));
+
+  std::ifstream file(file_path, std::ios::binary);
+  std::vector<double> values(entries.size() * 143 + 1);
+  file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(double));
+  ASSERT_EQ(file.gcount(), static_cast<std::streamsize>(entries.size() * 143 * sizeof(double)));
+  std::remove(file_path.c_str());
+
+  // The records hold the columns of the csv file
+  for (size_t k = 0; k < entries.size(); k++)
+  {
+    const mars::CoreType& core = CoreData(entries[k]);
+    const double* record = values.data() + k * 143;
+
+    EXPECT_EQ(record[0], entries[k].timestamp_.get_seconds());
+    EXPECT_EQ(Eigen::Map<const Eigen::Vector3d>(record + 7), core.state_.p_wi_);
+    EXPECT_EQ(record[13], core.state_.q_wi_.w());
+    EXPECT_EQ(Eigen::Map<const Eigen::Vector3d>(record + 14), core.state_.q_wi_.vec());
+    EXPECT_EQ(Eigen::Map<const Eigen::Vector3d>(record + 20), core.state_.b_a_);
+
+    // Upper triangle row by row
+    EXPECT_EQ(record[23], core.cov_(0, 0));
+    EXPECT_EQ(record[24], core.cov_(0, 1));
+    EXPECT_EQ(record[23 + 15], core.cov_(1, 1));
+    EXPECT_EQ(record[142], core.cov_(14, 14));
+  }
+}
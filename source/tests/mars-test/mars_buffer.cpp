@@ -21,6 +21,9 @@
 #include <mars/type_definitions/buffer_entry_type.h>
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <random>
+#include <vector>
 
 class mars_buffer_test : public testing::Test
 {
@@ -986,3 +989,200 @@ TEST_F(mars_buffer_test, INSERT_DATA_AT_IDX)
 {
   // TODO
 }
+
+///
+/// \brief Test that buffer copies share the entries until one of the copies is modified
+///
+TEST_F(mars_buffer_test, COPY_ON_WRITE)
+{
+  mars::Buffer buffer(10);
+
+  for (int k = 0; k < 5; k++)
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(std::make_shared<int>(k));
+    buffer.AddEntrySorted(mars::BufferEntryType(k, data, nullptr, mars::BufferMetadataType::measurement));
+  }
+  ASSERT_FALSE(buffer.IsShared());
+
+  mars::Buffer buffer_copy(buffer);
+  ASSERT_TRUE(buffer.IsShared());
+  ASSERT_TRUE(buffer_copy.IsShared());
+
+  // Getter do not detach the copy
+  mars::BufferEntryType entry;
+  buffer_copy.get_latest_entry(&entry);
+  ASSERT_TRUE(buffer_copy.IsShared());
+
+  // Modification of the copy does not affect the original
+  mars::BufferDataType data;
+  data.set_sensor_data(std::make_shared<int>(5));
+  buffer_copy.AddEntrySorted(mars::BufferEntryType(2.5, data, nullptr, mars::BufferMetadataType::measurement));
+
+  ASSERT_FALSE(buffer.IsShared());
+  ASSERT_FALSE(buffer_copy.IsShared());
+  ASSERT_EQ(buffer.get_length(), 5);
+  ASSERT_EQ(buffer_copy.get_length(), 6);
+
+  // Payloads remain shared between the copies
+  mars::BufferEntryType entry_original;
+  mars::BufferEntryType entry_copy;
+  buffer.get_entry_at_idx(4, &entry_original);
+  buffer_copy.get_entry_at_idx(5, &entry_copy);
+  ASSERT_EQ(entry_original.data_.sensor_.get(), entry_copy.data_.sensor_.get());
+
+  // Reset of a shared buffer does not affect the copy
+  mars::Buffer buffer_reset(buffer);
+  buffer_reset.ResetBufferData();
+  ASSERT_TRUE(buffer_reset.IsEmpty());
+  ASSERT_EQ(buffer.get_length(), 5);
+}
+
+///
+/// \brief Test that diverging buffer copies only copy the modified chunks
+///
+TEST_F(mars_buffer_test, COPY_SHARES_UNMODIFIED_ENTRIES)
+{
+  mars::Buffer buffer(1000);
+
+  for (int k = 0; k < 300; k++)
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(std::make_shared<int>(k));
+    buffer.AddEntrySorted(mars::BufferEntryType(k, data, nullptr, mars::BufferMetadataType::measurement));
+  }
+
+  // Both copies are modified at the end, in the middle and at the front
+  mars::Buffer buffer_copy(buffer);
+  mars::BufferDataType data;
+  data.set_sensor_data(std::make_shared<int>(300));
+  buffer_copy.AddEntrySorted(mars::BufferEntryType(300, data, nullptr, mars::BufferMetadataType::measurement));
+  buffer_copy.AddEntrySorted(mars::BufferEntryType(150.5, data, nullptr, mars::BufferMetadataType::measurement));
+  buffer.DeleteEntriesBeforeIdx(10);
+
+  ASSERT_EQ(buffer.get_length(), 290);
+  ASSERT_EQ(buffer_copy.get_length(), 302);
+  ASSERT_TRUE(buffer.IsSorted());
+  ASSERT_TRUE(buffer_copy.IsSorted());
+
+  // Entries outside of the modified chunks are shared by both copies
+  std::vector<const mars::BufferEntryType*> entries;
+  std::vector<const mars::BufferEntryType*> entries_copy;
+  ASSERT_TRUE(buffer.get_sensor_handle_measurements(nullptr, &entries));
+  ASSERT_TRUE(buffer_copy.get_sensor_handle_measurements(nullptr, &entries_copy));
+
+  int num_shared_entries = 0;
+  for (const auto& k : entries)
+  {
+    num_shared_entries += std::count(entries_copy.begin(), entries_copy.end(), k) > 0 ? 1 : 0;
+  }
+  ASSERT_GT(num_shared_entries, 100);
+}
+
+///
+/// \brief Test random modifications of a buffer and its copies against a reference
+///
+TEST_F(mars_buffer_test, RANDOM_MODIFICATIONS_OF_COPIES)
+{
+  struct ReferenceEntry
+  {
+    double timestamp_;
+    int id_;
+    bool is_state_;
+  };
+
+  constexpr int max_buffer_size = 700;
+  std::vector<mars::Buffer> buffers(1, mars::Buffer(max_buffer_size));
+  std::vector<std::vector<ReferenceEntry>> references(1);
+  std::mt19937 generator(42);
+  int next_id = 0;
+
+  auto compare_to_reference = [&buffers, &references]() {
+    for (size_t k = 0; k < buffers.size(); k++)
+    {
+      ASSERT_EQ(buffers[k].get_length(), static_cast<int>(references[k].size()));
+
+      for (int entry_idx = 0; entry_idx < buffers[k].get_length(); entry_idx++)
+      {
+        mars::BufferEntryType entry;
+        ASSERT_TRUE(buffers[k].get_entry_at_idx(entry_idx, &entry));
+        ASSERT_EQ(*static_cast<int*>(entry.data_.sensor_.get()), references[k][entry_idx].id_);
+      }
+    }
+  };
+
+  for (int step = 0; step < 20000; step++)
+  {
+    if (step % 100 == 0)
+    {
+      ASSERT_NO_FATAL_FAILURE(compare_to_reference());
+    }
+
+    // Copies are created from random buffers
+    if (step % 4000 == 3999)
+    {
+      const size_t source = generator() % buffers.size();
+      buffers.push_back(buffers[source]);
+      references.push_back(references[source]);
+    }
+
+    const size_t idx = generator() % buffers.size();
+    mars::Buffer& buffer = buffers[idx];
+    std::vector<ReferenceEntry>& reference = references[idx];
+    const unsigned int operation = generator() % 1000;
+
+    if (operation < 950)
+    {
+      // In order entries and out of order entries at random positions
+      const double latest = reference.empty() ? 0 : reference.back().timestamp_;
+      const double timestamp = (operation < 500 || reference.empty()) ?
+                                   latest + 0.25 :
+                                   reference[generator() % reference.size()].timestamp_ - 0.125;
+      const bool is_state = generator() % 2 == 0;
+
+      mars::BufferDataType data;
+      data.set_sensor_data(std::make_shared<int>(next_id));
+      buffer.AddEntrySorted(mars::BufferEntryType(
+          timestamp, data, nullptr,
+          is_state ? mars::BufferMetadataType::core_state : mars::BufferMetadataType::measurement));
+
+      auto position = std::upper_bound(
+          reference.begin(), reference.end(), timestamp,
+          [](const double& value, const ReferenceEntry& entry) { return value < entry.timestamp_; });
+      reference.insert(position, ReferenceEntry{ timestamp, next_id, is_state });
+      next_id++;
+
+      if (static_cast<int>(reference.size()) > max_buffer_size)
+      {
+        reference.erase(reference.begin());
+      }
+    }
+    else if (operation < 990 && !reference.empty())
+    {
+      // States after a random index or close to the latest entry are deleted as by a rework
+      const int num_entries = static_cast<int>(reference.size());
+      const int start_idx = operation < 955 ? static_cast<int>(generator() % num_entries) :
+                                             num_entries - 1 - static_cast<int>(generator() % 50);
+      if (start_idx >= 0)
+      {
+        buffer.DeleteStatesStartingAtIdx(start_idx);
+        reference.erase(std::remove_if(reference.begin() + start_idx, reference.end(),
+                                       [](const ReferenceEntry& entry) { return entry.is_state_; }),
+                        reference.end());
+      }
+    }
+    else if (!reference.empty())
+    {
+      // Oldest entries
+      const int delete_idx = 1 + static_cast<int>(generator() % 100);
+      if (delete_idx <= static_cast<int>(reference.size()))
+      {
+        buffer.DeleteEntriesBeforeIdx(delete_idx);
+        reference.erase(reference.begin(), reference.begin() + delete_idx);
+      }
+    }
+  }
+
+  ASSERT_GT(buffers.size(), 4u);
+  ASSERT_NO_FATAL_FAILURE(compare_to_reference());
+}
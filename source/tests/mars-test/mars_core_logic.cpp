@@ -12,14 +12,30 @@
 #include <mars/buffer.h>
 #include <mars/core_logic.h>
 #include <mars/core_state.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/sensors/bodyvel/bodyvel_measurement_type.h>
+#include <mars/sensors/bodyvel/bodyvel_sensor_class.h>
+#include <mars/sensors/gps/gps_conversion.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/gps/gps_sensor_class.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_measurement_type.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_sensor_class.h>
 #include <mars/sensors/imu/imu_measurement_type.h>
 #include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/mag/mag_measurement_type.h>
+#include <mars/sensors/mag/mag_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
 #include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/position/position_sensor_class.h>
 #include <mars/sensors/sensor_abs_class.h>
+#include <mars/sensors/vision/vision_measurement_type.h>
+#include <mars/sensors/vision/vision_sensor_class.h>
 #include <mars/type_definitions/buffer_data_type.h>
 #include <mars/type_definitions/core_type.h>
 #include <Eigen/Dense>
 #include <memory>
+#include <vector>
 
 class mars_core_logic_test : public testing::Test
 {
@@ -201,3 +217,612 @@ TEST_F(mars_core_logic_test, PROPAGATE_SENSOR_CROSS_COV)
 
   ASSERT_TRUE(sensor_cross_cov_after.isApprox(state_transition * sensor_cross_cov_before, 1e-16));
 }
+
+TEST_F(mars_core_logic_test, CLONE)
+{
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  mars::CoreLogic core_logic(core_states_sptr);
+
+  mars::BufferDataType data;
+  data.set_sensor_data(
+      std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero()));
+
+  for (int k = 0; k < 20; k++)
+  {
+    core_logic.ProcessMeasurement(imu_sensor_sptr, k * 0.005, data);
+  }
+  core_logic.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+
+  for (int k = 20; k < 40; k++)
+  {
+    core_logic.ProcessMeasurement(imu_sensor_sptr, k * 0.005, data);
+  }
+
+  const int buffer_length = core_logic.buffer_.get_length();
+
+  // The clone shares the buffer entries until one of the instances is modified
+  mars::CoreLogic core_logic_clone = core_logic.Clone();
+  ASSERT_TRUE(core_logic.buffer_.IsShared());
+  ASSERT_EQ(core_logic_clone.buffer_.get_length(), buffer_length);
+  ASSERT_TRUE(core_logic_clone.core_is_initialized_);
+
+  // The clone diverges with a different input
+  mars::BufferDataType data_clone;
+  data_clone.set_sensor_data(
+      std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(1, 0, 9.81), Eigen::Vector3d::Zero()));
+
+  for (int k = 40; k < 60; k++)
+  {
+    core_logic_clone.ProcessMeasurement(imu_sensor_sptr, k * 0.005, data_clone);
+  }
+
+  ASSERT_FALSE(core_logic.buffer_.IsShared());
+  ASSERT_EQ(core_logic.buffer_.get_length(), buffer_length);
+  ASSERT_GT(core_logic_clone.buffer_.get_length(), buffer_length);
+
+  // Processing the same input on the original leads to a different state
+  for (int k = 40; k < 60; k++)
+  {
+    core_logic.ProcessMeasurement(imu_sensor_sptr, k * 0.005, data);
+  }
+
+  mars::BufferEntryType latest_state;
+  mars::BufferEntryType latest_state_clone;
+  core_logic.buffer_.get_latest_state(&latest_state);
+  core_logic_clone.buffer_.get_latest_state(&latest_state_clone);
+
+  const mars::CoreType core = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  const mars::CoreType core_clone = *static_cast<mars::CoreType*>(latest_state_clone.data_.core_.get());
+
+  ASSERT_TRUE(core.state_.p_wi_.isApprox(Eigen::Vector3d(0, 0, 5), 1e-9));
+  ASSERT_GT(core_clone.state_.p_wi_.x(), 0);
+}
+
+TEST_F(mars_core_logic_test, STACKED_UPDATE)
+{
+  // Filter with an IMU, a pose and a position sensor with simultaneous measurements at 20 Hz. The platform rotates
+  // around the z axis, the position measurements are perturbed.
+  auto run_filter = [](const bool& stacked, const bool& duplicate_position) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> pose_cal_std;
+    pose_cal_std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = pose_cal_std.cwiseProduct(pose_cal_std).asDiagonal();
+    pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->const_ref_to_nav_ = true;
+    position_sensor_sptr->R_ = Eigen::Vector3d(0.05, 0.05, 0.05).cwiseProduct(Eigen::Vector3d(0.05, 0.05, 0.05));
+
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.state_.p_ip_ = Eigen::Vector3d(0.1, 0, 0);
+    const Eigen::Vector3d position_cal_std(0.1, 0.1, 0.1);
+    position_init_cal.sensor_cov_ = position_cal_std.cwiseProduct(position_cal_std).asDiagonal();
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    core_logic->stacked_update_ = stacked;
+    core_logic->stacked_update_epsilon_ = 1e-3;
+
+    for (int k = 0; k < 400; k++)
+    {
+      const double t = k * 0.005;
+
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(std::make_shared<mars::IMUMeasurementType>(
+          Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d(0, 0, 0.2)));
+      core_logic->ProcessMeasurement(imu_sensor_sptr, t, imu_data);
+
+      if (k == 0)
+      {
+        core_logic->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        const Eigen::Quaterniond q_meas(Eigen::AngleAxisd(0.2 * t, Eigen::Vector3d::UnitZ()));
+        const Eigen::Vector3d p_meas(0.02 * std::sin(5 * t), 0, 5);
+
+        std::vector<mars::BufferEntryType> measurements;
+        mars::BufferDataType pose_data;
+        pose_data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(p_meas, q_meas));
+        measurements.push_back(
+            mars::BufferEntryType(t, pose_data, pose_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        mars::BufferDataType position_data;
+        position_data.set_sensor_data(
+            std::make_shared<mars::PositionMeasurementType>(p_meas + q_meas * Eigen::Vector3d(0.1, 0, 0)));
+        const mars::BufferEntryType position_entry(t + 5e-4, position_data, position_sensor_sptr,
+                                                   mars::BufferMetadataType::measurement);
+        measurements.push_back(position_entry);
+
+        if (duplicate_position)
+        {
+          const mars::BufferEntryType position_entry(t + 5e-4, position_data, position_sensor_sptr,
+                                                   mars::BufferMetadataType::measurement);
+        measurements.push_back(position_entry);
+        }
+
+        core_logic->ProcessMeasurements(measurements);
+      }
+    }
+
+    return core_logic;
+  };
+
+  std::shared_ptr<mars::CoreLogic> sequential = run_filter(false, false);
+  std::shared_ptr<mars::CoreLogic> stacked = run_filter(true, false);
+  std::shared_ptr<mars::CoreLogic> duplicate = run_filter(true, true);
+
+  // The first measurement of each sensor initializes the sensor, all following pairs are stacked
+  ASSERT_EQ(sequential->num_stacked_updates_, 0);
+  ASSERT_EQ(stacked->num_stacked_updates_, 39);
+
+  // Measurements of the same sensor are not stacked, the pose and the first position measurement are
+  ASSERT_EQ(duplicate->num_stacked_updates_, 39);
+
+  // The stacked update results in one state entry per sensor with a shared core state
+  int num_shared_core_states = 0;
+  for (int k = 1; k < stacked->buffer_.get_length(); k++)
+  {
+    mars::BufferEntryType prior_entry;
+    mars::BufferEntryType entry;
+    stacked->buffer_.get_entry_at_idx(k - 1, &prior_entry);
+    stacked->buffer_.get_entry_at_idx(k, &entry);
+
+    if (entry.metadata_ == mars::BufferMetadataType::sensor_state &&
+        prior_entry.metadata_ == mars::BufferMetadataType::sensor_state)
+    {
+      ASSERT_EQ(prior_entry.timestamp_, entry.timestamp_);
+      ASSERT_NE(prior_entry.sensor_, entry.sensor_);
+      ASSERT_EQ(prior_entry.data_.core_, entry.data_.core_);
+      num_shared_core_states++;
+    }
+  }
+  ASSERT_GT(num_shared_core_states, 0);
+
+  // The stacked estimate follows the trajectory
+  mars::BufferEntryType latest_state;
+  ASSERT_TRUE(stacked->buffer_.get_latest_state(&latest_state));
+  const mars::CoreType core_stacked = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  const double t_latest = latest_state.timestamp_.get_seconds();
+  const Eigen::Quaterniond q_true(Eigen::AngleAxisd(0.2 * t_latest, Eigen::Vector3d::UnitZ()));
+
+  ASSERT_LT((core_stacked.state_.p_wi_ - Eigen::Vector3d(0, 0, 5)).norm(), 0.03);
+  ASSERT_LT(core_stacked.state_.v_wi_.norm(), 0.05);
+  ASSERT_LT(core_stacked.state_.q_wi_.angularDistance(q_true), 0.02);
+}
+
+TEST_F(mars_core_logic_test, STACKED_UPDATE_FALLBACK)
+{
+  // Body velocity sensor that claims stacked update support without providing a measurement model
+  class StackedBodyvelSensorClass : public mars::BodyvelSensorClass
+  {
+  public:
+    using BodyvelSensorClass::BodyvelSensorClass;
+
+    bool SupportsStackedUpdate() const
+    {
+      return true;
+    }
+  };
+
+  auto run_filter = [](const bool& stacked, int* num_failed) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    std::shared_ptr<StackedBodyvelSensorClass> bodyvel_sensor_sptr =
+        std::make_shared<StackedBodyvelSensorClass>("Bodyvel", core_states_sptr);
+    bodyvel_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.1 * 0.1);
+    mars::BodyvelSensorData bodyvel_init_cal;
+    bodyvel_init_cal.sensor_cov_ = Eigen::Matrix<double, 6, 6>::Identity() * 0.01;
+    bodyvel_sensor_sptr->set_initial_calib(std::make_shared<mars::BodyvelSensorData>(bodyvel_init_cal));
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    core_logic->stacked_update_ = stacked;
+    core_logic->stacked_update_epsilon_ = 1e-3;
+
+    for (int k = 0; k < 200; k++)
+    {
+      const double t = k * 0.005;
+
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(
+          std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero()));
+      core_logic->ProcessMeasurement(imu_sensor_sptr, t, imu_data);
+
+      if (k == 0)
+      {
+        core_logic->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        std::vector<mars::BufferEntryType> measurements;
+        mars::BufferDataType position_data;
+        position_data.set_sensor_data(std::make_shared<mars::PositionMeasurementType>(Eigen::Vector3d(0, 0, 5)));
+        measurements.push_back(
+            mars::BufferEntryType(t, position_data, position_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        mars::BufferDataType bodyvel_data;
+        bodyvel_data.set_sensor_data(std::make_shared<mars::BodyvelMeasurementType>(Eigen::Vector3d::Zero()));
+        measurements.push_back(mars::BufferEntryType(t + 5e-4, bodyvel_data, bodyvel_sensor_sptr,
+                                                     mars::BufferMetadataType::measurement));
+
+        *num_failed += !core_logic->ProcessMeasurements(measurements);
+      }
+    }
+
+    return core_logic;
+  };
+
+  int num_failed_sequential = 0;
+  int num_failed_stacked = 0;
+  std::shared_ptr<mars::CoreLogic> sequential = run_filter(false, &num_failed_sequential);
+  std::shared_ptr<mars::CoreLogic> stacked = run_filter(true, &num_failed_stacked);
+
+  // The failed stacked updates fall back to sequential updates with the same result
+  ASSERT_EQ(stacked->num_stacked_updates_, 0);
+  ASSERT_EQ(num_failed_stacked, num_failed_sequential);
+  ASSERT_EQ(stacked->buffer_.get_length(), sequential->buffer_.get_length());
+
+  for (int k = 0; k < sequential->buffer_.get_length(); k++)
+  {
+    mars::BufferEntryType entry, sequential_entry;
+    stacked->buffer_.get_entry_at_idx(k, &entry);
+    sequential->buffer_.get_entry_at_idx(k, &sequential_entry);
+    ASSERT_EQ(entry.timestamp_, sequential_entry.timestamp_);
+    ASSERT_EQ(entry.metadata_, sequential_entry.metadata_);
+    ASSERT_EQ(entry.sensor_ == nullptr, sequential_entry.sensor_ == nullptr);
+    if (entry.sensor_ != nullptr)
+    {
+      ASSERT_EQ(entry.sensor_->name_, sequential_entry.sensor_->name_);
+    }
+  }
+
+  mars::BufferEntryType latest_state, sequential_state;
+  ASSERT_TRUE(stacked->buffer_.get_latest_state(&latest_state));
+  ASSERT_TRUE(sequential->buffer_.get_latest_state(&sequential_state));
+  const mars::CoreType& core = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  const mars::CoreType& sequential_core = *static_cast<mars::CoreType*>(sequential_state.data_.core_.get());
+  ASSERT_EQ(core.state_.p_wi_, sequential_core.state_.p_wi_);
+  ASSERT_EQ(core.cov_, sequential_core.cov_);
+}
+
+TEST_F(mars_core_logic_test, STACKED_UPDATE_SENSOR_MODELS)
+{
+  // Filter with an IMU, a GPS, a GPS with velocity, a magnetometer and a vision sensor with simultaneous measurements
+  // at 20 Hz of a static platform
+  const mars::GpsCoordinates reference(46.614798, 14.2628073, 450);
+  const mars::GpsCoordinates gps_meas = mars::GpsConversion(reference).get_wgs84(Eigen::Vector3d(0, 0, 5));
+  const Eigen::Vector3d mag_meas(0.2, 0, -0.4);
+
+  auto run_filter = [&reference, &gps_meas, &mag_meas](const bool& stacked) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::GpsSensorClass> gps_sensor_sptr =
+        std::make_shared<mars::GpsSensorClass>("GPS", core_states_sptr);
+    gps_sensor_sptr->const_ref_to_nav_ = true;
+    gps_sensor_sptr->set_gps_reference_coordinates(reference);
+    gps_sensor_sptr->R_ = Eigen::Vector3d(0.1, 0.1, 0.1).cwiseProduct(Eigen::Vector3d(0.1, 0.1, 0.1));
+
+    std::shared_ptr<mars::GpsVelSensorClass> gps_vel_sensor_sptr =
+        std::make_shared<mars::GpsVelSensorClass>("GPS Vel", core_states_sptr);
+    gps_vel_sensor_sptr->const_ref_to_nav_ = true;
+    gps_vel_sensor_sptr->set_gps_reference_coordinates(reference);
+    Eigen::Matrix<double, 6, 1> gps_vel_meas_std;
+    gps_vel_meas_std << 0.1, 0.1, 0.1, 0.05, 0.05, 0.05;
+    gps_vel_sensor_sptr->R_ = gps_vel_meas_std.cwiseProduct(gps_vel_meas_std);
+
+    std::shared_ptr<mars::MagSensorClass> mag_sensor_sptr =
+        std::make_shared<mars::MagSensorClass>("Mag", core_states_sptr);
+    mag_sensor_sptr->const_ref_to_nav_ = true;
+    mag_sensor_sptr->R_ = Eigen::Vector3d(0.01, 0.01, 0.01).cwiseProduct(Eigen::Vector3d(0.01, 0.01, 0.01));
+
+    std::shared_ptr<mars::VisionSensorClass> vision_sensor_sptr =
+        std::make_shared<mars::VisionSensorClass>("Vision", core_states_sptr);
+    vision_sensor_sptr->const_ref_to_nav_ = true;
+    Eigen::Matrix<double, 6, 1> vision_meas_std;
+    vision_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    vision_sensor_sptr->R_ = vision_meas_std.cwiseProduct(vision_meas_std);
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    core_logic->stacked_update_ = stacked;
+    core_logic->stacked_update_epsilon_ = 1e-3;
+
+    for (int k = 0; k < 400; k++)
+    {
+      const double t = k * 0.005;
+
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(
+          std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero()));
+      core_logic->ProcessMeasurement(imu_sensor_sptr, t, imu_data);
+
+      if (k == 0)
+      {
+        core_logic->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        std::vector<mars::BufferEntryType> measurements;
+
+        mars::BufferDataType gps_data;
+        gps_data.set_sensor_data(std::make_shared<mars::GpsMeasurementType>(gps_meas.latitude_, gps_meas.longitude_,
+                                                                            gps_meas.altitude_));
+        measurements.push_back(
+            mars::BufferEntryType(t, gps_data, gps_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        mars::BufferDataType gps_vel_data;
+        gps_vel_data.set_sensor_data(std::make_shared<mars::GpsVelMeasurementType>(
+            gps_meas.latitude_, gps_meas.longitude_, gps_meas.altitude_, 0, 0, 0));
+        measurements.push_back(
+            mars::BufferEntryType(t + 2e-4, gps_vel_data, gps_vel_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        mars::BufferDataType mag_data;
+        mag_data.set_sensor_data(std::make_shared<mars::MagMeasurementType>(mag_meas));
+        measurements.push_back(
+            mars::BufferEntryType(t + 4e-4, mag_data, mag_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        mars::BufferDataType vision_data;
+        vision_data.set_sensor_data(
+            std::make_shared<mars::VisionMeasurementType>(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity()));
+        measurements.push_back(
+            mars::BufferEntryType(t + 6e-4, vision_data, vision_sensor_sptr, mars::BufferMetadataType::measurement));
+
+        core_logic->ProcessMeasurements(measurements);
+      }
+    }
+
+    return core_logic;
+  };
+
+  std::shared_ptr<mars::CoreLogic> sequential = run_filter(false);
+  std::shared_ptr<mars::CoreLogic> stacked = run_filter(true);
+
+  // The first measurement of each sensor initializes the sensor, all following groups are stacked
+  ASSERT_EQ(sequential->num_stacked_updates_, 0);
+  ASSERT_EQ(stacked->num_stacked_updates_, 39);
+
+  // The stacked update results in one state entry per sensor with a shared core state
+  int num_shared_core_states = 0;
+  for (int k = 1; k < stacked->buffer_.get_length(); k++)
+  {
+    mars::BufferEntryType prior_entry;
+    mars::BufferEntryType entry;
+    stacked->buffer_.get_entry_at_idx(k - 1, &prior_entry);
+    stacked->buffer_.get_entry_at_idx(k, &entry);
+
+    if (entry.metadata_ == mars::BufferMetadataType::sensor_state &&
+        prior_entry.metadata_ == mars::BufferMetadataType::sensor_state)
+    {
+      ASSERT_NE(prior_entry.sensor_, entry.sensor_);
+      ASSERT_EQ(prior_entry.data_.core_, entry.data_.core_);
+      num_shared_core_states++;
+    }
+  }
+  ASSERT_GT(num_shared_core_states, 0);
+
+  // The stacked estimate stays at the static pose and all sensors of the group contribute to the position estimate
+  mars::BufferEntryType latest_state, sequential_state;
+  ASSERT_TRUE(stacked->buffer_.get_latest_state(&latest_state));
+  ASSERT_TRUE(sequential->buffer_.get_latest_state(&sequential_state));
+  const mars::CoreType& core = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  const mars::CoreType& sequential_core = *static_cast<mars::CoreType*>(sequential_state.data_.core_.get());
+
+  ASSERT_LT((core.state_.p_wi_ - Eigen::Vector3d(0, 0, 5)).norm(), 0.01);
+  ASSERT_LT(core.state_.v_wi_.norm(), 0.01);
+  ASSERT_LT(core.state_.q_wi_.angularDistance(Eigen::Quaterniond::Identity()), 0.01);
+  ASSERT_TRUE(core.cov_.allFinite());
+  ASSERT_LT(core.cov_.block(0, 0, 3, 3).trace(), sequential_core.cov_.block(0, 0, 3, 3).trace());
+}
+
+TEST_F(mars_core_logic_test, INTERMEDIATE_PROPAGATION)
+{
+  // Filter with an IMU and a pose sensor, pose measurements are delayed by 'offset' with respect to an IMU sample.
+  // Optionally an outlier with the same timestamp is rejected by the chi2 test before each pose measurement once the
+  // filter has converged.
+  auto run_filter = [](const double& threshold, const double& offset, const bool& outlier) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+    pose_sensor_sptr->chi2_.ActivateTest(outlier);
+    pose_sensor_sptr->chi2_.set_chi_value(0.05);
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> pose_cal_std;
+    pose_cal_std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = pose_cal_std.cwiseProduct(pose_cal_std).asDiagonal();
+    pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    core_logic->interm_prop_threshold_ = threshold;
+
+    for (int k = 0; k < 400; k++)
+    {
+      const double t = k * 0.005;
+
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(
+          std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d(0, 0, 0.2)));
+      core_logic->ProcessMeasurement(imu_sensor_sptr, t, imu_data);
+
+      if (k == 0)
+      {
+        core_logic->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        const double t_meas = t + offset;
+        const Eigen::Quaterniond q_meas(Eigen::AngleAxisd(0.2 * t_meas, Eigen::Vector3d::UnitZ()));
+
+        if (outlier && k > 100)
+        {
+          mars::BufferDataType outlier_data;
+          outlier_data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(3, 0, 5), q_meas));
+          core_logic->ProcessMeasurement(pose_sensor_sptr, t_meas, outlier_data);
+        }
+
+        mars::BufferDataType pose_data;
+        pose_data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(0, 0, 5), q_meas));
+        core_logic->ProcessMeasurement(pose_sensor_sptr, t_meas, pose_data);
+      }
+    }
+
+    return core_logic;
+  };
+
+  auto latest_core = [](const mars::CoreLogic& core_logic) {
+    mars::BufferEntryType entry;
+    core_logic.buffer_.get_latest_state(&entry);
+    return *static_cast<mars::CoreType*>(entry.data_.core_.get());
+  };
+
+  // Updates at the time of the latest state do not need a propagation, the first measurement initializes the sensor
+  std::shared_ptr<mars::CoreLogic> synchronous = run_filter(0, 0, false);
+  ASSERT_EQ(synchronous->num_skipped_interm_prop_, 39);
+  ASSERT_EQ(synchronous->num_reused_interm_prop_, 0);
+
+  std::shared_ptr<mars::CoreLogic> delayed = run_filter(0, 0.002, false);
+  ASSERT_EQ(delayed->num_skipped_interm_prop_, 0);
+
+  std::shared_ptr<mars::CoreLogic> delayed_skipped = run_filter(0.003, 0.002, false);
+  ASSERT_EQ(delayed_skipped->num_skipped_interm_prop_, 39);
+
+  // Skipping introduces a time offset of up to the threshold, the measured rotation is applied 2 ms early
+  const mars::CoreType core_delayed = latest_core(*delayed);
+  const mars::CoreType core_delayed_skipped = latest_core(*delayed_skipped);
+  ASSERT_LT((core_delayed.state_.p_wi_ - core_delayed_skipped.state_.p_wi_).norm(), 1e-3);
+  ASSERT_LT(core_delayed.state_.q_wi_.angularDistance(core_delayed_skipped.state_.q_wi_), 5e-3);
+
+  // The propagation of a rejected update is reused by the following update
+  std::shared_ptr<mars::CoreLogic> rejected = run_filter(0, 0.002, true);
+  ASSERT_EQ(rejected->num_skipped_interm_prop_, 0);
+  ASSERT_EQ(rejected->num_reused_interm_prop_, 30);
+
+  const mars::CoreType core_rejected = latest_core(*rejected);
+  ASSERT_TRUE(core_delayed.state_.p_wi_.isApprox(core_rejected.state_.p_wi_, 1e-9));
+}
+
+TEST_F(mars_core_logic_test, INCREMENTAL_CROSS_COV)
+{
+  // Pose and position measurements with delays and jitter, the position measurements arrive out of order
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 5;
+  options.seed_ = 3;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions pose_options;
+  pose_options.rate_ = 20;
+  pose_options.noise_std_ = 0.01;
+  pose_options.noise_std_secondary_ = 0.01;
+  generator.AddSensor(pose_options);
+
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 10;
+  position_options.noise_std_ = 0.02;
+  position_options.delay_ = 0.03;
+  position_options.delay_jitter_ = 0.02;
+  generator.AddSensor(position_options);
+
+  auto run_filter = [&generator](const bool& incremental) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+    pose_sensor_sptr->incremental_cross_cov_ = incremental;
+    pose_sensor_sptr->R_ = Eigen::Matrix<double, 6, 1>::Constant(0.01 * 0.01);
+
+    mars::PoseSensorData pose_init_cal;
+    pose_init_cal.sensor_cov_ = Eigen::Matrix<double, 6, 6>::Identity() * 0.01;
+    pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->const_ref_to_nav_ = true;
+    position_sensor_sptr->incremental_cross_cov_ = incremental;
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.02 * 0.02);
+
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, pose_sensor_sptr,
+                                                                         position_sensor_sptr };
+
+    for (const auto& k : generator.get_arrival_stream())
+    {
+      mars::BufferDataType data;
+      data.set_sensor_data(k.data_);
+      core_logic->ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+      if (!core_logic->core_is_initialized_ && k.sensor_idx_ == 0)
+      {
+        const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+        core_logic->Initialize(gt.p_wi_, gt.q_wi_);
+      }
+    }
+
+    return core_logic;
+  };
+
+  std::shared_ptr<mars::CoreLogic> lazy = run_filter(false);
+  std::shared_ptr<mars::CoreLogic> incremental = run_filter(true);
+
+  // Both schemes result in the same estimate up to the order of the floating point operations
+  mars::BufferEntryType latest_lazy;
+  mars::BufferEntryType latest_incremental;
+  ASSERT_TRUE(lazy->buffer_.get_latest_state(&latest_lazy));
+  ASSERT_TRUE(incremental->buffer_.get_latest_state(&latest_incremental));
+
+  const mars::CoreType core_lazy = *static_cast<mars::CoreType*>(latest_lazy.data_.core_.get());
+  const mars::CoreType core_incremental = *static_cast<mars::CoreType*>(latest_incremental.data_.core_.get());
+
+  ASSERT_TRUE(core_lazy.state_.p_wi_.isApprox(core_incremental.state_.p_wi_, 1e-6));
+  ASSERT_TRUE(core_lazy.state_.v_wi_.isApprox(core_incremental.state_.v_wi_, 1e-6));
+  ASSERT_TRUE(core_lazy.state_.q_wi_.coeffs().isApprox(core_incremental.state_.q_wi_.coeffs(), 1e-6));
+  ASSERT_TRUE(core_lazy.cov_.isApprox(core_incremental.cov_, 1e-6));
+}
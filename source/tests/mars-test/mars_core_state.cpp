@@ -10,10 +10,12 @@
 
 #include <gmock/gmock.h>
 #include <mars/core_state.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
 #include <mars/sensors/imu/imu_sensor_class.h>
 #include <mars/type_definitions/core_state_type.h>
 #include <mars/type_definitions/core_type.h>
 #include <Eigen/Dense>
+#include <cstdlib>
 
 class mars_core_state_test : public testing::Test
 {
@@ -187,3 +189,57 @@ TEST_F(mars_core_state_test, Q_TEST)
 
   EXPECT_TRUE(test_return.isApprox(expected_result));
 }
+
+TEST_F(mars_core_state_test, CLOSED_FORM_QUAT_INTEGRATION)
+{
+  mars::CoreState core_state_matexp;
+  mars::CoreState core_state_closed_form;
+  core_state_closed_form.closed_form_quat_integration_ = true;
+
+  // Random IMU measurements at 200 Hz, each step starts from the same prior state
+  std::srand(7);
+  mars::CoreStateType state;
+  state.q_wi_ = Eigen::Quaterniond(Eigen::Vector4d::Random()).normalized();
+  state.b_w_ = Eigen::Vector3d::Random() * 0.01;
+  state.b_a_ = Eigen::Vector3d::Random() * 0.1;
+
+  for (int k = 0; k < 1000; k++)
+  {
+    const mars::IMUMeasurementType imu(Eigen::Vector3d(0, 0, 9.81) + Eigen::Vector3d::Random(),
+                                       Eigen::Vector3d::Random() * 2);
+
+    const mars::CoreStateType state_matexp = core_state_matexp.PropagateState(state, imu, 0.005);
+    const mars::CoreStateType state_closed_form = core_state_closed_form.PropagateState(state, imu, 0.005);
+
+    ASSERT_LT(state_matexp.q_wi_.angularDistance(state_closed_form.q_wi_), 1e-12);
+    ASSERT_TRUE(state_matexp.v_wi_.isApprox(state_closed_form.v_wi_, 1e-12));
+    ASSERT_TRUE(state_matexp.p_wi_.isApprox(state_closed_form.p_wi_, 1e-12));
+
+    state = state_closed_form;
+  }
+
+  // Constant turn rate, the exact solution is the rotation vector exponential. The truncation of the matrix exponential
+  // becomes visible for large rotations per step.
+  const Eigen::Vector3d w(3, -2, 1);
+  const double dt = 0.1;
+  const Eigen::Quaterniond q_prior(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitX()));
+  const Eigen::Quaterniond q_exact = q_prior * Eigen::Quaterniond(Eigen::AngleAxisd(w.norm() * dt, w.normalized()));
+
+  mars::CoreStateType prior_state;
+  prior_state.q_wi_ = q_prior;
+  prior_state.w_m_ = w;
+  const mars::IMUMeasurementType imu(Eigen::Vector3d(0, 0, 9.81), w);
+
+  const double error_matexp = core_state_matexp.PropagateState(prior_state, imu, dt).q_wi_.angularDistance(q_exact);
+  const double error_closed_form =
+      core_state_closed_form.PropagateState(prior_state, imu, dt).q_wi_.angularDistance(q_exact);
+
+  ASSERT_LT(error_closed_form, 1e-12);
+  ASSERT_GT(error_matexp, 1e-9);
+
+  // Small angle branch
+  const Eigen::Vector3d w_small(1e-6, 0, 0);
+  const Eigen::Quaterniond q_small = mars::CoreState::IntegrateQuaternionClosedForm(q_prior, w_small, w_small, dt);
+  ASSERT_LT(q_small.angularDistance(q_prior * Eigen::Quaterniond(Eigen::AngleAxisd(1e-7, Eigen::Vector3d::UnitX()))),
+            1e-15);
+}
@@ -0,0 +1,116 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_state.h>
+#include <mars/core_state_bank.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <vector>
+
+class mars_core_state_bank_test : public testing::Test
+{
+public:
+  // Generates a distinct state, covariance and noise setting for each filter
+  static void GenerateFilter(const int& idx, mars::CoreType* core, mars::CoreState* core_states)
+  {
+    const double s = 1 + 0.1 * idx;
+
+    core->state_.p_wi_ = Eigen::Vector3d(1, -2, 3) * s;
+    core->state_.v_wi_ = Eigen::Vector3d(0.5, 0.1, -0.2) * s;
+    core->state_.q_wi_ = Eigen::Quaterniond(Eigen::AngleAxisd(0.3 * s, Eigen::Vector3d(1, 2, 3).normalized()));
+    core->state_.b_w_ = Eigen::Vector3d(0.01, -0.02, 0.005) * s;
+    core->state_.b_a_ = Eigen::Vector3d(-0.05, 0.02, 0.1) * s;
+    core->state_.w_m_ = Eigen::Vector3d(0.1, 0.2, -0.3);
+    core->state_.a_m_ = Eigen::Vector3d(0.2, -0.1, 9.7);
+
+    Eigen::Matrix<double, 15, 15> A(Eigen::Matrix<double, 15, 15>::Random());
+    core->cov_ = A * A.transpose() * 0.01 * s + mars::CoreStateMatrix::Identity() * 0.1;
+
+    core_states->set_noise_std(Eigen::Vector3d::Constant(0.013 * s), Eigen::Vector3d::Constant(0.0013 * s),
+                               Eigen::Vector3d::Constant(0.083 * s), Eigen::Vector3d::Constant(0.0083 * s));
+  }
+};
+
+TEST_F(mars_core_state_bank_test, CTOR)
+{
+  mars::CoreStateBank bank(3);
+  ASSERT_EQ(bank.get_num_filters(), 3);
+
+  mars::CoreType core = bank.get_core(2);
+  ASSERT_TRUE(core.state_.q_wi_.coeffs().isApprox(Eigen::Quaterniond::Identity().coeffs()));
+  ASSERT_TRUE(core.state_transition_.isIdentity());
+  ASSERT_TRUE(core.cov_.isZero());
+}
+
+TEST_F(mars_core_state_bank_test, SET_GET_CORE)
+{
+  mars::CoreStateBank bank(2);
+  mars::CoreState core_states;
+  mars::CoreType core;
+  GenerateFilter(1, &core, &core_states);
+
+  bank.set_core(1, core);
+  mars::CoreType result = bank.get_core(1);
+
+  ASSERT_EQ(result.state_.p_wi_, core.state_.p_wi_);
+  ASSERT_EQ(result.state_.v_wi_, core.state_.v_wi_);
+  ASSERT_EQ(result.state_.q_wi_.coeffs(), core.state_.q_wi_.coeffs());
+  ASSERT_EQ(result.state_.b_w_, core.state_.b_w_);
+  ASSERT_EQ(result.state_.b_a_, core.state_.b_a_);
+  ASSERT_EQ(result.cov_, core.cov_);
+}
+
+TEST_F(mars_core_state_bank_test, PROPAGATION_MATCHES_CORE_STATE)
+{
+  // More filters than one lane block to cover the remainder block
+  const int num_filters = mars::CoreStateBank::kLaneBlock + 3;
+  const double dt = 0.005;
+
+  mars::CoreStateBank bank(num_filters);
+  std::vector<mars::CoreType, Eigen::aligned_allocator<mars::CoreType>> cores(num_filters);
+  std::vector<mars::CoreState, Eigen::aligned_allocator<mars::CoreState>> core_states(num_filters);
+
+  for (int k = 0; k < num_filters; k++)
+  {
+    GenerateFilter(k, &cores[k], &core_states[k]);
+    bank.set_core(k, cores[k]);
+    bank.set_noise_std(k, core_states[k].n_w_, core_states[k].n_bw_, core_states[k].n_a_, core_states[k].n_ba_);
+  }
+
+  for (int step = 0; step < 200; step++)
+  {
+    const double t = step * dt;
+    mars::IMUMeasurementType imu(Eigen::Vector3d(0.3 * std::sin(t), 0.1, 9.81 + 0.2 * std::cos(3 * t)),
+                                 Eigen::Vector3d(0.5 * std::cos(t), -0.4, 1.2 * std::sin(2 * t)));
+
+    bank.Propagate(imu, dt);
+
+    for (int k = 0; k < num_filters; k++)
+    {
+      mars::CoreType propagated = core_states[k].PredictProcessCovariance(cores[k], imu, dt);
+      propagated.state_ = core_states[k].PropagateState(cores[k].state_, imu, dt);
+      cores[k] = propagated;
+    }
+  }
+
+  for (int k = 0; k < num_filters; k++)
+  {
+    const mars::CoreType result = bank.get_core(k);
+
+    EXPECT_TRUE(result.state_.p_wi_.isApprox(cores[k].state_.p_wi_, 1e-12));
+    EXPECT_TRUE(result.state_.v_wi_.isApprox(cores[k].state_.v_wi_, 1e-12));
+    EXPECT_TRUE(result.state_.q_wi_.coeffs().isApprox(cores[k].state_.q_wi_.coeffs(), 1e-12));
+    EXPECT_TRUE(result.state_.w_m_.isApprox(cores[k].state_.w_m_));
+    EXPECT_TRUE(result.cov_.isApprox(cores[k].cov_, 1e-10));
+    EXPECT_TRUE(result.state_transition_.isApprox(cores[k].state_transition_, 1e-12));
+  }
+}
@@ -0,0 +1,165 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/cov_health.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <Eigen/Dense>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
+
+class mars_cov_health_test : public testing::Test
+{
+public:
+  // Well conditioned covariance with different scales
+  static mars::CoreStateMatrix ValidCov()
+  {
+    std::srand(1);
+    const mars::CoreStateMatrix A = mars::CoreStateMatrix::Random();
+    mars::CoreStateVector scale;
+    scale << 0.1, 0.1, 0.1, 0.5, 0.5, 0.5, 0.05, 0.05, 0.05, 1e-3, 1e-3, 1e-3, 1e-2, 1e-2, 1e-2;
+    return scale.asDiagonal() * (A * A.transpose() + mars::CoreStateMatrix::Identity()) * scale.asDiagonal();
+  }
+};
+
+TEST_F(mars_cov_health_test, VALID_COVARIANCE)
+{
+  mars::CovHealthMonitor monitor;
+  const mars::CoreStateMatrix cov = ValidCov();
+
+  for (int k = 0; k < 250; k++)
+  {
+    EXPECT_TRUE(monitor.Check(cov, "Valid"));
+  }
+
+  // Every 100th check is a full check
+  EXPECT_EQ(monitor.num_checks_, 250);
+  EXPECT_EQ(monitor.num_full_checks_, 2);
+  EXPECT_EQ(monitor.get_num_anomalies(), 0);
+  EXPECT_GT(monitor.min_eigenvalue_, 0);
+
+  monitor.ResetCounters();
+  EXPECT_EQ(monitor.num_checks_, 0);
+  EXPECT_EQ(monitor.num_full_checks_, 0);
+}
+
+TEST_F(mars_cov_health_test, ANOMALIES)
+{
+  mars::CovHealthMonitor monitor;
+  monitor.verbose_ = false;
+  monitor.full_check_interval_ = 0;
+
+  // Non-finite values
+  mars::CoreStateMatrix not_finite = ValidCov();
+  not_finite(3, 5) = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_FALSE(monitor.Check(not_finite, "Not finite"));
+  EXPECT_EQ(monitor.num_not_finite_, 1);
+
+  // Negative variance
+  mars::CoreStateMatrix negative_variance = ValidCov();
+  negative_variance(7, 7) = -1e-6;
+  EXPECT_FALSE(monitor.Check(negative_variance, "Negative variance"));
+  EXPECT_EQ(monitor.num_non_positive_variance_, 1);
+  EXPECT_EQ(monitor.num_not_positive_definite_, 1);
+
+  // Positive variances, but correlations larger than one, the anomaly triggers a full check
+  mars::CoreStateMatrix indefinite = ValidCov();
+  indefinite(0, 1) = indefinite(1, 0) = 2 * std::sqrt(indefinite(0, 0) * indefinite(1, 1));
+  EXPECT_FALSE(monitor.Check(indefinite, "Indefinite"));
+  EXPECT_EQ(monitor.num_non_positive_variance_, 1);
+  EXPECT_EQ(monitor.num_not_positive_definite_, 2);
+  EXPECT_EQ(monitor.num_negative_eigenvalue_, 2);
+  EXPECT_LT(monitor.min_eigenvalue_, 0);
+
+  EXPECT_EQ(monitor.num_checks_, 3);
+  EXPECT_EQ(monitor.num_full_checks_, 3);
+  EXPECT_EQ(monitor.get_num_anomalies(), 3);
+
+  // The asymmetry is only detected by the full check
+  mars::CoreStateMatrix not_symmetric = ValidCov();
+  not_symmetric(2, 9) += 1e-4;
+  EXPECT_TRUE(monitor.Check(not_symmetric, "Not symmetric"));
+
+  monitor.level_ = mars::CovCheckLevel::full;
+  EXPECT_FALSE(monitor.Check(not_symmetric, "Not symmetric"));
+  EXPECT_EQ(monitor.num_not_symmetric_, 1);
+  EXPECT_EQ(monitor.num_full_checks_, 4);
+
+  // No checks
+  monitor.level_ = mars::CovCheckLevel::none;
+  EXPECT_TRUE(monitor.Check(not_finite, "Not finite"));
+  EXPECT_EQ(monitor.num_checks_, 5);
+}
+
+TEST_F(mars_cov_health_test, CORE_LOGIC_UPDATES)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 20;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 20;
+  position_options.noise_std_ = 0.05;
+  generator.AddSensor(position_options);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+      std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+  position_sensor_sptr->const_ref_to_nav_ = true;
+  position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 1e-6;
+  position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, position_sensor_sptr };
+
+  mars::CoreLogic core_logic(core_states_sptr);
+  core_logic.cov_health_.full_check_interval_ = 50;
+
+  int num_updates = 0;
+  for (const auto& k : generator.get_arrival_stream())
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+    core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+    if (!core_logic.core_is_initialized_)
+    {
+      const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+      core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+    }
+    else if (k.sensor_idx_ == 1 && position_sensor_sptr->is_initialized_)
+    {
+      num_updates++;
+    }
+  }
+
+  // The prior covariance of each update is checked, the first measurement initializes the sensor
+  EXPECT_EQ(core_logic.cov_health_.num_checks_, num_updates - 1);
+  EXPECT_EQ(core_logic.cov_health_.num_full_checks_, core_logic.cov_health_.num_checks_ / 50);
+  EXPECT_EQ(core_logic.cov_health_.get_num_anomalies(), 0);
+}
@@ -0,0 +1,276 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/filter_bank.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/gps/gps_sensor_class.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/pressure/pressure_measurement_type.h>
+#include <mars/sensors/pressure/pressure_sensor_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <memory>
+
+class mars_filter_bank_test : public testing::Test
+{
+public:
+  // Initialized filter with an IMU and a pose sensor, stationary at p_wi = [0, 0, 5]
+  void SetUp() override
+  {
+    imu_sensor_sptr_ = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr_);
+
+    pose_sensor_sptr_ = std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr_->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    pose_sensor_sptr_->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> std;
+    std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+    pose_sensor_sptr_->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    core_logic_ = mars::CoreLogic(core_states_sptr);
+    core_logic_.ProcessMeasurement(imu_sensor_sptr_, 0, ImuData());
+    core_logic_.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+  }
+
+  static mars::BufferDataType ImuData()
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(
+        std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero()));
+    return data;
+  }
+
+  static mars::BufferDataType PoseData(const Eigen::Vector3d& position)
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(position, Eigen::Quaterniond::Identity()));
+    return data;
+  }
+
+  static Eigen::Vector3d LatestPosition(const mars::CoreLogic& core_logic)
+  {
+    mars::BufferEntryType latest_state;
+    core_logic.buffer_.get_latest_state(&latest_state);
+    return static_cast<mars::CoreType*>(latest_state.data_.core_.get())->state_.p_wi_;
+  }
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr_;
+  std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr_;
+  mars::CoreLogic core_logic_;
+};
+
+TEST_F(mars_filter_bank_test, BRANCH)
+{
+  mars::FilterBank bank(core_logic_, 4, 2);
+  ASSERT_EQ(bank.get_num_hypotheses(), 1);
+  ASSERT_EQ(bank.get_num_threads(), 2);
+
+  ASSERT_EQ(bank.Branch(0), 1);
+  ASSERT_EQ(bank.Branch(5), -1);
+  ASSERT_EQ(bank.get_num_hypotheses(), 2);
+  ASSERT_EQ(bank.get_hypothesis(1).parent_id_, bank.get_hypothesis(0).id_);
+
+  // Branches share the buffer entries until they diverge
+  ASSERT_TRUE(bank.get_hypothesis(1).core_logic_.buffer_.IsShared());
+
+  const std::vector<double> weights = bank.get_weights();
+  ASSERT_DOUBLE_EQ(weights[0], 0.5);
+  ASSERT_DOUBLE_EQ(weights[1], 0.5);
+}
+
+TEST_F(mars_filter_bank_test, PARALLEL_PROPAGATION)
+{
+  mars::FilterBank bank(core_logic_, 8, 3);
+  for (int k = 0; k < 4; k++)
+  {
+    bank.Branch(0);
+  }
+
+  mars::CoreLogic reference = core_logic_.Clone();
+
+  for (int k = 1; k < 100; k++)
+  {
+    const mars::BufferDataType data = ImuData();
+    ASSERT_EQ(bank.ProcessMeasurement(imu_sensor_sptr_, k * 0.005, data), 5);
+    reference.ProcessMeasurement(imu_sensor_sptr_, k * 0.005, data);
+  }
+
+  for (int k = 0; k < bank.get_num_hypotheses(); k++)
+  {
+    ASSERT_EQ(bank.get_hypothesis(k).core_logic_.buffer_.get_length(), reference.buffer_.get_length());
+    ASSERT_EQ(LatestPosition(bank.get_hypothesis(k).core_logic_), LatestPosition(reference));
+  }
+}
+
+TEST_F(mars_filter_bank_test, SCORE_AND_PRUNE)
+{
+  mars::FilterBank bank(core_logic_, 8, 2);
+  const int branch_idx = bank.Branch(0);
+  ASSERT_FALSE(pose_sensor_sptr_->chi2_.calc_always_);
+
+  // The branch receives pose measurements with an alternating offset
+  for (int k = 1; k < 200; k++)
+  {
+    bank.ProcessMeasurement(imu_sensor_sptr_, k * 0.005, ImuData());
+
+    if (k % 10 == 0)
+    {
+      bank.ProcessMeasurement(0, pose_sensor_sptr_, k * 0.005, PoseData(Eigen::Vector3d(0, 0, 5)));
+      const double offset = (k / 10) % 2 ? 0.5 : -0.5;
+      bank.ProcessMeasurement(branch_idx, pose_sensor_sptr_, k * 0.005, PoseData(Eigen::Vector3d(offset, 0, 5)));
+    }
+  }
+
+  // The first pose measurement initializes the sensor and is not scored
+  ASSERT_TRUE(pose_sensor_sptr_->chi2_.calc_always_);
+  ASSERT_EQ(bank.get_hypothesis(0).num_scored_updates_, 18);
+  ASSERT_EQ(bank.get_hypothesis(branch_idx).num_scored_updates_, 18);
+  ASSERT_EQ(bank.get_best_hypothesis(), 0);
+  ASSERT_GT(bank.get_hypothesis(0).log_likelihood_, bank.get_hypothesis(branch_idx).log_likelihood_);
+
+  // A large threshold keeps both hypotheses
+  ASSERT_EQ(bank.Prune(1e12), 0);
+  ASSERT_EQ(bank.Prune(10), 1);
+  ASSERT_EQ(bank.get_num_hypotheses(), 1);
+  ASSERT_EQ(bank.get_hypothesis(0).id_, 0);
+}
+
+TEST_F(mars_filter_bank_test, PRUNE_MAX_HYPOTHESES)
+{
+  mars::FilterBank bank(core_logic_, 2, 1);
+  bank.Branch(0);
+  bank.Branch(0);
+
+  // The first hypothesis is penalized, the first pose measurement initializes the sensor
+  for (int k = 1; k < 3; k++)
+  {
+    bank.ProcessMeasurement(imu_sensor_sptr_, k * 0.005, ImuData());
+    bank.ProcessMeasurement(0, pose_sensor_sptr_, k * 0.005, PoseData(Eigen::Vector3d(1, 0, 5)));
+  }
+
+  ASSERT_EQ(bank.Prune(1e12), 1);
+  ASSERT_EQ(bank.get_num_hypotheses(), 2);
+  ASSERT_EQ(bank.get_hypothesis(0).id_, 1);
+  ASSERT_EQ(bank.get_hypothesis(1).id_, 2);
+}
+
+TEST_F(mars_filter_bank_test, SENSOR_STATE_PER_HYPOTHESIS)
+{
+  std::shared_ptr<mars::GpsSensorClass> gps_sensor_sptr =
+      std::make_shared<mars::GpsSensorClass>("GPS", core_logic_.core_states_);
+  gps_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.1 * 0.1);
+
+  mars::FilterBank bank(core_logic_, 4, 1);
+  const int branch_idx = bank.Branch(0);
+
+  // Each hypothesis initializes the GPS sensor with its own reference
+  bank.ProcessMeasurement(imu_sensor_sptr_, 0.005, ImuData());
+  mars::BufferDataType gps_data_0, gps_data_1;
+  gps_data_0.set_sensor_data(std::make_shared<mars::GpsMeasurementType>(47, 14, 500));
+  gps_data_1.set_sensor_data(std::make_shared<mars::GpsMeasurementType>(48, 15, 600));
+  ASSERT_TRUE(bank.ProcessMeasurement(0, gps_sensor_sptr, 0.005, gps_data_0));
+  ASSERT_TRUE(bank.ProcessMeasurement(branch_idx, gps_sensor_sptr, 0.005, gps_data_1));
+
+  gps_sensor_sptr->RestoreState(bank.get_hypothesis(0).sensor_contexts_.at(gps_sensor_sptr.get()));
+  EXPECT_TRUE(gps_sensor_sptr->is_initialized_);
+  EXPECT_EQ(gps_sensor_sptr->gps_conversion_.get_gps_reference().latitude_, 47);
+  gps_sensor_sptr->RestoreState(bank.get_hypothesis(branch_idx).sensor_contexts_.at(gps_sensor_sptr.get()));
+  EXPECT_TRUE(gps_sensor_sptr->is_initialized_);
+  EXPECT_EQ(gps_sensor_sptr->gps_conversion_.get_gps_reference().latitude_, 48);
+
+  // A hypothesis without pose measurements holds no pose sensor state, the sensor is initialized for the hypothesis
+  // on its first pose measurement
+  ASSERT_TRUE(bank.ProcessMeasurement(0, pose_sensor_sptr_, 0.005, PoseData(Eigen::Vector3d(0, 0, 5))));
+  pose_sensor_sptr_->RestoreState(bank.get_hypothesis(0).sensor_contexts_.at(pose_sensor_sptr_.get()));
+  EXPECT_TRUE(pose_sensor_sptr_->is_initialized_);
+  EXPECT_EQ(bank.get_hypothesis(branch_idx).sensor_contexts_.count(pose_sensor_sptr_.get()), 0u);
+
+  bank.ProcessMeasurement(imu_sensor_sptr_, 0.01, ImuData());
+  ASSERT_TRUE(bank.ProcessMeasurement(branch_idx, pose_sensor_sptr_, 0.01, PoseData(Eigen::Vector3d(0, 0, 5))));
+  EXPECT_EQ(bank.get_hypothesis(branch_idx).num_scored_updates_, 0);
+  ASSERT_TRUE(bank.ProcessMeasurement(0, pose_sensor_sptr_, 0.01, PoseData(Eigen::Vector3d(0, 0, 5))));
+  EXPECT_EQ(bank.get_hypothesis(0).num_scored_updates_, 1);
+
+  // Branches inherit the sensor states of their source
+  const int second_branch_idx = bank.Branch(0);
+  gps_sensor_sptr->RestoreState(bank.get_hypothesis(second_branch_idx).sensor_contexts_.at(gps_sensor_sptr.get()));
+  EXPECT_EQ(gps_sensor_sptr->gps_conversion_.get_gps_reference().latitude_, 47);
+}
+
+TEST_F(mars_filter_bank_test, PRESSURE_REFERENCE_PER_HYPOTHESIS)
+{
+  std::shared_ptr<mars::PressureSensorClass> pressure_sensor_sptr =
+      std::make_shared<mars::PressureSensorClass>("Pressure", core_logic_.core_states_);
+  pressure_sensor_sptr->R_ = Eigen::Matrix<double, 1, 1>(0.1 * 0.1);
+  mars::PressureSensorData pressure_init_cal;
+  pressure_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+  pressure_sensor_sptr->set_initial_calib(std::make_shared<mars::PressureSensorData>(pressure_init_cal));
+
+  mars::FilterBank bank(core_logic_, 4, 1);
+  const int branch_idx = bank.Branch(0);
+
+  // Each hypothesis initializes the pressure sensor with its own reference
+  bank.ProcessMeasurement(imu_sensor_sptr_, 0.005, ImuData());
+  mars::BufferDataType pressure_data_0, pressure_data_1;
+  pressure_data_0.set_sensor_data(std::make_shared<mars::PressureMeasurementType>(101325, 293.15));
+  pressure_data_1.set_sensor_data(std::make_shared<mars::PressureMeasurementType>(95000, 293.15));
+  ASSERT_TRUE(bank.ProcessMeasurement(0, pressure_sensor_sptr, 0.005, pressure_data_0));
+  ASSERT_TRUE(bank.ProcessMeasurement(branch_idx, pressure_sensor_sptr, 0.005, pressure_data_1));
+
+  // The same measurement results in a different height for each hypothesis
+  const mars::Pressure pressure(95000, 293.15, mars::Pressure::Type::GAS);
+  pressure_sensor_sptr->RestoreState(bank.get_hypothesis(0).sensor_contexts_.at(pressure_sensor_sptr.get()));
+  EXPECT_TRUE(pressure_sensor_sptr->pressure_reference_is_set_);
+  EXPECT_GT(pressure_sensor_sptr->pressure_conversion_.get_height(pressure)(0), 100);
+  pressure_sensor_sptr->RestoreState(bank.get_hypothesis(branch_idx).sensor_contexts_.at(pressure_sensor_sptr.get()));
+  EXPECT_TRUE(pressure_sensor_sptr->pressure_reference_is_set_);
+  EXPECT_NEAR(pressure_sensor_sptr->pressure_conversion_.get_height(pressure)(0), 0, 1e-9);
+}
+
+TEST_F(mars_filter_bank_test, MERGE)
+{
+  mars::FilterBank bank(core_logic_, 8, 2);
+  bank.Branch(0);
+  const int diverged_idx = bank.Branch(0);
+
+  for (int k = 1; k < 100; k++)
+  {
+    bank.ProcessMeasurement(imu_sensor_sptr_, k * 0.005, ImuData());
+
+    if (k % 10 == 0)
+    {
+      for (int h = 0; h < bank.get_num_hypotheses(); h++)
+      {
+        const Eigen::Vector3d position = h == diverged_idx ? Eigen::Vector3d(2, 0, 5) : Eigen::Vector3d(0, 0, 5);
+        bank.ProcessMeasurement(h, pose_sensor_sptr_, k * 0.005, PoseData(position));
+      }
+    }
+  }
+
+  const double ll_0 = bank.get_hypothesis(0).log_likelihood_;
+
+  // The identical hypotheses are merged, the diverged hypothesis remains
+  ASSERT_EQ(bank.Merge(0.1, 0.1), 1);
+  ASSERT_EQ(bank.get_num_hypotheses(), 2);
+  EXPECT_NEAR(bank.get_hypothesis(0).log_likelihood_, ll_0 + std::log(2), 1e-9);
+}
@@ -0,0 +1,199 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/fixed_lag_smoother.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class mars_fixed_lag_smoother_test : public testing::Test
+{
+public:
+  // Runs the filter on the arrival stream of the generator, the first sensor is the IMU and all others are position
+  // sensors. Returns the latest filtered state after each measurement by timestamp.
+  static std::map<double, mars::BufferEntryType> RunFilter(const mars::SyntheticDataGenerator& generator,
+                                                          const std::shared_ptr<mars::FixedLagSmoother>& smoother,
+                                                          std::vector<mars::BufferEntryType>* smoothed_entries)
+  {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr };
+    for (int k = 1; k < generator.get_num_sensors(); k++)
+    {
+      std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+          std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+      position_sensor_sptr->const_ref_to_nav_ = true;
+      position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+
+      mars::PositionSensorData position_init_cal;
+      position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 1e-6;
+      position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+      sensors.push_back(position_sensor_sptr);
+    }
+
+    mars::CoreLogic core_logic(core_states_sptr);
+    core_logic.smoother_ = smoother;
+
+    // The smoother runs on a second thread while the filter processes the measurements
+    std::atomic<bool> done{ false };
+    std::thread smoother_thread([&smoother, &done, smoothed_entries]() {
+      std::vector<mars::BufferEntryType> entries;
+      while (!done)
+      {
+        smoother->Process(&entries);
+        smoothed_entries->insert(smoothed_entries->end(), entries.begin(), entries.end());
+      }
+    });
+
+    std::map<double, mars::BufferEntryType> filtered_states;
+    for (const auto& k : generator.get_arrival_stream())
+    {
+      mars::BufferDataType data;
+      data.set_sensor_data(k.data_);
+      core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+      if (!core_logic.core_is_initialized_)
+      {
+        const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+        core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+      }
+
+      mars::BufferEntryType latest_state;
+      core_logic.buffer_.get_latest_state(&latest_state);
+      filtered_states[latest_state.timestamp_.get_seconds()] = latest_state;
+    }
+
+    done = true;
+    smoother_thread.join();
+
+    std::vector<mars::BufferEntryType> entries;
+    smoother->Process(&entries);
+    smoothed_entries->insert(smoothed_entries->end(), entries.begin(), entries.end());
+
+    return filtered_states;
+  }
+
+  static const mars::CoreType& CoreData(const mars::BufferEntryType& entry)
+  {
+    return *static_cast<mars::CoreType*>(entry.data_.core_.get());
+  }
+};
+
+TEST_F(mars_fixed_lag_smoother_test, PROPAGATION_ONLY)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 3;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  std::shared_ptr<mars::FixedLagSmoother> smoother = std::make_shared<mars::FixedLagSmoother>();
+  smoother->lag_ = 0.5;
+
+  std::vector<mars::BufferEntryType> smoothed_entries;
+  const std::map<double, mars::BufferEntryType> filtered_states = RunFilter(generator, smoother, &smoothed_entries);
+
+  // All states except the lag window are output in time order
+  ASSERT_EQ(smoothed_entries.size() + smoother->get_window_size(), filtered_states.size());
+  EXPECT_NEAR(smoother->get_window_size(), 0.5 * 200, 2);
+
+  // Without updates the smoothed states are the filtered states
+  for (size_t k = 0; k < smoothed_entries.size(); k++)
+  {
+    const mars::CoreType& smoothed = CoreData(smoothed_entries[k]);
+    const mars::CoreType& filtered = CoreData(filtered_states.at(smoothed_entries[k].timestamp_.get_seconds()));
+
+    if (k > 0)
+    {
+      EXPECT_GT(smoothed_entries[k].timestamp_, smoothed_entries[k - 1].timestamp_);
+    }
+
+    EXPECT_LT((smoothed.state_.p_wi_ - filtered.state_.p_wi_).norm(), 1e-9);
+    EXPECT_LT((smoothed.state_.v_wi_ - filtered.state_.v_wi_).norm(), 1e-9);
+    EXPECT_TRUE(smoothed.state_.q_wi_.isApprox(filtered.state_.q_wi_, 1e-9));
+    EXPECT_TRUE(smoothed.cov_.isApprox(filtered.cov_, 1e-9));
+  }
+}
+
+TEST_F(mars_fixed_lag_smoother_test, SMOOTHING_WITH_UPDATES)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 20;
+  options.seed_ = 5;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 10;
+  position_options.noise_std_ = 0.05;
+  generator.AddSensor(position_options);
+
+  std::shared_ptr<mars::FixedLagSmoother> smoother = std::make_shared<mars::FixedLagSmoother>();
+  smoother->lag_ = 1.0;
+
+  std::vector<mars::BufferEntryType> smoothed_entries;
+  const std::map<double, mars::BufferEntryType> filtered_states = RunFilter(generator, smoother, &smoothed_entries);
+  ASSERT_GT(smoothed_entries.size(), 18 * 200);
+
+  // Smoothing reduces the error and the uncertainty of the filtered states after the convergence
+  double p_se_filtered = 0;
+  double p_se_smoothed = 0;
+  int num_evaluated = 0;
+
+  for (const auto& entry : smoothed_entries)
+  {
+    const double t = entry.timestamp_.get_seconds();
+    if (t < 5)
+    {
+      continue;
+    }
+
+    const mars::CoreType& smoothed = CoreData(entry);
+    const mars::CoreType& filtered = CoreData(filtered_states.at(t));
+    const mars::CoreStateType gt = generator.get_ground_truth(t);
+
+    p_se_filtered += (filtered.state_.p_wi_ - gt.p_wi_).squaredNorm();
+    p_se_smoothed += (smoothed.state_.p_wi_ - gt.p_wi_).squaredNorm();
+    num_evaluated++;
+
+    const double p_var_smoothed = smoothed.cov_.block(0, 0, 3, 3).trace();
+    const double p_var_filtered = filtered.cov_.block(0, 0, 3, 3).trace();
+    EXPECT_LE(p_var_smoothed, p_var_filtered * (1 + 1e-9));
+  }
+
+  ASSERT_GT(num_evaluated, 0);
+  EXPECT_LT(p_se_smoothed, 0.8 * p_se_filtered);
+
+  // A reset discards the window
+  smoother->Reset();
+  std::vector<mars::BufferEntryType> entries;
+  EXPECT_EQ(smoother->Process(&entries), 0);
+  EXPECT_EQ(smoother->get_window_size(), 0);
+}
@@ -9,8 +9,14 @@
 // You can contact the author at <christian.brommer@ieee.org>
 
 #include <gmock/gmock.h>
+#include <mars/core_state.h>
 #include <mars/sensors/gps/gps_conversion.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/gps/gps_sensor_class.h>
 #include <Eigen/Dense>
+#include <cstdlib>
+#include <memory>
+#include <vector>
 
 class mars_gps_test : public testing::Test
 {
@@ -38,3 +44,99 @@ TEST_F(mars_gps_test, CTOR_GPS)
 
   std::cout << coordinates_3 << std::endl;
 }
+
+TEST_F(mars_gps_test, ENU_TO_WGS84)
+{
+  mars::GpsCoordinates reference(46.614798, 14.2628073, 18);
+  mars::GpsConversion gps_conversion(reference);
+
+  const Eigen::Matrix<double, 3, 1> enu(3312.079520417935, 1072.193122997238, -1.948681026472);
+  const mars::GpsCoordinates coordinates = gps_conversion.get_wgs84(enu);
+
+  EXPECT_NEAR(coordinates.latitude_, 46.624435, 1e-9);
+  EXPECT_NEAR(coordinates.longitude_, 14.306053, 1e-9);
+  EXPECT_NEAR(coordinates.altitude_, 17, 1e-5);
+
+  // Round trip
+  const Eigen::Matrix<double, 3, 1> enu_local(-12.5, 40.2, 7.3);
+  EXPECT_TRUE(enu_local.isApprox(gps_conversion.get_enu(gps_conversion.get_wgs84(enu_local)), 1e-9));
+}
+
+TEST_F(mars_gps_test, BATCH_ENU)
+{
+  const mars::GpsCoordinates reference(46.614798, 14.2628073, 450);
+  mars::GpsConversion gps_conversion(reference);
+
+  auto max_error = [&gps_conversion](const Eigen::ArrayXd& latitude, const Eigen::ArrayXd& longitude,
+                                     const Eigen::ArrayXd& altitude) {
+    Eigen::Matrix3Xd enu;
+    gps_conversion.get_enu_batch(latitude, longitude, altitude, &enu);
+
+    double error = 0;
+    for (Eigen::Index k = 0; k < latitude.size(); k++)
+    {
+      const mars::GpsCoordinates coordinates(latitude(k), longitude(k), altitude(k));
+      error = std::max(error, (enu.col(k) - gps_conversion.get_enu(coordinates)).norm());
+    }
+    return error;
+  };
+
+  // Coordinates on the whole earth, all quadrants of the range reduction
+  std::srand(3);
+  const int num = 10000;
+  const Eigen::ArrayXd latitude_global = 90 * Eigen::ArrayXd::Random(num);
+  const Eigen::ArrayXd longitude_global = 180 * Eigen::ArrayXd::Random(num);
+  const Eigen::ArrayXd altitude_global = 1000 * Eigen::ArrayXd::Random(num);
+  EXPECT_LT(max_error(latitude_global, longitude_global, altitude_global), 1e-6);
+
+  // Local coordinates within +-20 km use the expansion around the reference
+  const Eigen::ArrayXd latitude_local = reference.latitude_ + 0.18 * Eigen::ArrayXd::Random(num);
+  const Eigen::ArrayXd longitude_local = reference.longitude_ + 0.18 * Eigen::ArrayXd::Random(num);
+  EXPECT_LT(max_error(latitude_local, longitude_local, altitude_global), 1e-8);
+
+  Eigen::Matrix3Xd enu_empty;
+  gps_conversion.get_enu_batch(Eigen::ArrayXd(), Eigen::ArrayXd(), Eigen::ArrayXd(), &enu_empty);
+  EXPECT_EQ(enu_empty.cols(), 0);
+
+  // The sensor converts batches once the reference is set and uses the result in CalcUpdate
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  mars::GpsSensorClass gps_sensor("GPS", core_states_sptr);
+
+  std::vector<std::shared_ptr<void>> measurements;
+  for (int k = 0; k < 10; k++)
+  {
+    measurements.push_back(
+        std::make_shared<mars::GpsMeasurementType>(latitude_local(k), longitude_local(k), altitude_global(k)));
+  }
+
+  gps_sensor.PreprocessMeasurements(measurements);
+  EXPECT_TRUE(gps_sensor.batch_enu_.empty());
+
+  gps_sensor.set_gps_reference_coordinates(reference);
+  gps_sensor.PreprocessMeasurements(measurements);
+  ASSERT_EQ(gps_sensor.batch_enu_.size(), measurements.size());
+  for (const auto& k : measurements)
+  {
+    const mars::GpsMeasurementType* meas = static_cast<mars::GpsMeasurementType*>(k.get());
+    EXPECT_LT((gps_sensor.batch_enu_.at(k) - gps_conversion.get_enu(meas->coordinates_)).norm(), 1e-8);
+  }
+
+  // A new batch replaces the previous one
+  gps_sensor.PreprocessMeasurements({ measurements[0] });
+  EXPECT_EQ(gps_sensor.batch_enu_.size(), 1u);
+  EXPECT_EQ(gps_sensor.get_enu(measurements[0]), gps_sensor.batch_enu_.at(measurements[0]));
+
+  // The batch is not used once the reference changed
+  const mars::GpsCoordinates other_reference(46.6, 14.3, 400);
+  mars::GpsConversion other_conversion(other_reference);
+  const std::shared_ptr<void> state_other_reference = [&other_reference, &core_states_sptr]() {
+    mars::GpsSensorClass sensor("GPS other reference", core_states_sptr);
+    sensor.set_gps_reference_coordinates(other_reference);
+    return sensor.SaveState();
+  }();
+
+  gps_sensor.RestoreState(state_other_reference);
+  const mars::GpsMeasurementType* meas = static_cast<mars::GpsMeasurementType*>(measurements[0].get());
+  EXPECT_EQ(gps_sensor.get_enu(measurements[0]), other_conversion.get_enu(meas->coordinates_));
+  EXPECT_GT((gps_sensor.get_enu(measurements[0]) - gps_sensor.batch_enu_.at(measurements[0])).norm(), 100);
+}
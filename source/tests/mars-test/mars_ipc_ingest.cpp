@@ -0,0 +1,307 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/ipc_ingest.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class mars_ipc_ingest_test : public testing::Test
+{
+public:
+  struct FilterSetup
+  {
+    std::shared_ptr<mars::CoreLogic> core_logic_;
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_;
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_;
+  };
+
+  static std::string SocketPath()
+  {
+    return "mars_ipc_ingest_test_" + std::to_string(getpid()) + ".sock";
+  }
+
+  static FilterSetup CreateFilter()
+  {
+    FilterSetup setup;
+    setup.imu_sensor_ = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(setup.imu_sensor_);
+
+    setup.pose_sensor_ = std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    setup.pose_sensor_->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    setup.pose_sensor_->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> std;
+    std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+    setup.pose_sensor_->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    return setup;
+  }
+
+  // Sine trajectory with an IMU at 200 Hz and pose measurements at 20 Hz, the filter is initialized after the first
+  // IMU measurement. The setup receives the measurements directly, the encoder receives the same sequence of calls.
+  static void RunFilter(const FilterSetup& setup, mars::IngestEncoder* encoder)
+  {
+    const int imu_id = encoder->AddSensor("IMU", mars::JournalPayloadType::imu);
+    const int pose_id = encoder->AddSensor("Pose", mars::JournalPayloadType::pose);
+
+    for (int k = 0; k < 400; k++)
+    {
+      const double t = k * 0.005;
+
+      auto imu_meas = std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0.1 * std::sin(t), 0, 9.81),
+                                                                 Eigen::Vector3d(0, 0, 0.2 * std::cos(t)));
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(imu_meas);
+      setup.core_logic_->ProcessMeasurement(setup.imu_sensor_, t, imu_data);
+      encoder->AddMeasurement(imu_id, t, imu_meas);
+
+      if (k == 0)
+      {
+        setup.core_logic_->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+        encoder->AddInitialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        const Eigen::Quaterniond q_meas(Eigen::AngleAxisd(0.001 * k, Eigen::Vector3d::UnitZ()));
+        auto pose_meas = std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(0.01 * k, 0, 5), q_meas);
+        mars::BufferDataType pose_data;
+        pose_data.set_sensor_data(pose_meas);
+        setup.core_logic_->ProcessMeasurement(setup.pose_sensor_, t, pose_data);
+        encoder->AddMeasurement(pose_id, t, pose_meas);
+      }
+    }
+  }
+
+  static mars::CoreType LatestCore(const mars::CoreLogic& core_logic)
+  {
+    mars::BufferEntryType latest_state;
+    core_logic.buffer_.get_latest_state(&latest_state);
+    return *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  }
+};
+
+TEST_F(mars_ipc_ingest_test, ENCODE_DECODE)
+{
+  mars::IngestEncoder encoder;
+  const int imu_id = encoder.AddSensor("IMU", mars::JournalPayloadType::imu);
+  const mars::IMUMeasurementType imu(Eigen::Vector3d(1, 2, 3), Eigen::Vector3d(4, 5, 6));
+  ASSERT_TRUE(encoder.AddMeasurement(imu_id, 1.5, std::make_shared<mars::IMUMeasurementType>(imu)));
+  encoder.AddInitialize(Eigen::Vector3d(1, 2, 3), Eigen::Quaterniond(0, 1, 0, 0));
+
+  // Unknown sensor id
+  ASSERT_FALSE(encoder.AddMeasurement(3, 2, std::make_shared<mars::IMUMeasurementType>(imu)));
+
+  // The data is received byte by byte, records are decoded once they are complete
+  const std::vector<char>& data = encoder.get_data();
+  mars::IngestDecoder decoder;
+  std::vector<mars::JournalRecord> records;
+  mars::JournalRecord record;
+  size_t offset = 0;
+
+  for (size_t size = 0; size <= data.size(); size++)
+  {
+    const mars::IngestDecodeResult result = decoder.Decode(data.data(), size, &offset, &record);
+    ASSERT_NE(result, mars::IngestDecodeResult::error);
+    if (result == mars::IngestDecodeResult::record)
+    {
+      records.push_back(record);
+      EXPECT_EQ(offset, size);
+    }
+  }
+
+  ASSERT_EQ(offset, data.size());
+  ASSERT_EQ(records.size(), 3);
+
+  EXPECT_EQ(records[0].type_, mars::JournalRecordType::sensor);
+  EXPECT_EQ(records[0].sensor_name_, "IMU");
+  EXPECT_EQ(records[0].payload_type_, mars::JournalPayloadType::imu);
+
+  EXPECT_EQ(records[1].type_, mars::JournalRecordType::measurement);
+  EXPECT_EQ(records[1].sensor_id_, imu_id);
+  EXPECT_EQ(records[1].timestamp_, mars::Time(1.5));
+  ASSERT_NE(records[1].payload_, nullptr);
+  EXPECT_EQ(*static_cast<mars::IMUMeasurementType*>(records[1].payload_.get()), imu);
+
+  EXPECT_EQ(records[2].type_, mars::JournalRecordType::initialize);
+  EXPECT_EQ(records[2].p_wi_, Eigen::Vector3d(1, 2, 3));
+  EXPECT_EQ(records[2].q_wi_.coeffs(), Eigen::Quaterniond(0, 1, 0, 0).coeffs());
+
+  // Invalid record type and oversized payloads
+  const char invalid_type[] = { 7, 0, 0, 0 };
+  offset = 0;
+  EXPECT_EQ(decoder.Decode(invalid_type, sizeof(invalid_type), &offset, &record), mars::IngestDecodeResult::error);
+
+  std::vector<char> oversized = { static_cast<char>(mars::JournalRecordType::measurement), 0, 0, 0, 0 };
+  oversized.resize(oversized.size() + sizeof(double));
+  const uint32_t num_values = mars::IngestDecoder::kMaxNumValues + 1;
+  const char* num_values_bytes = reinterpret_cast<const char*>(&num_values);
+  oversized.insert(oversized.end(), num_values_bytes, num_values_bytes + sizeof(num_values));
+  offset = 0;
+  EXPECT_EQ(decoder.Decode(oversized.data(), oversized.size(), &offset, &record), mars::IngestDecodeResult::error);
+  EXPECT_EQ(offset, 0);
+
+  // Sensor id above the cap
+  std::vector<char> large_id = { static_cast<char>(mars::JournalRecordType::sensor) };
+  const int32_t sensor_id = 0x7fffffff;
+  const char* sensor_id_bytes = reinterpret_cast<const char*>(&sensor_id);
+  large_id.insert(large_id.end(), sensor_id_bytes, sensor_id_bytes + sizeof(sensor_id));
+  const mars::JournalPayloadType payload_type = mars::JournalPayloadType::imu;
+  const char* payload_type_bytes = reinterpret_cast<const char*>(&payload_type);
+  large_id.insert(large_id.end(), payload_type_bytes, payload_type_bytes + sizeof(payload_type));
+  large_id.resize(large_id.size() + sizeof(uint32_t));
+  offset = 0;
+  EXPECT_EQ(decoder.Decode(large_id.data(), large_id.size(), &offset, &record), mars::IngestDecodeResult::error);
+  EXPECT_EQ(offset, 0);
+}
+
+TEST_F(mars_ipc_ingest_test, SERVER_MATCHES_DIRECT_PROCESSING)
+{
+  mars::IngestEncoder encoder;
+  FilterSetup direct = CreateFilter();
+  RunFilter(direct, &encoder);
+
+  // Measurements of a sensor that is not part of the server are dropped
+  const int unknown_id = encoder.AddSensor("Unknown", mars::JournalPayloadType::imu);
+  encoder.AddMeasurement(unknown_id, 5, std::make_shared<mars::IMUMeasurementType>());
+
+  FilterSetup ingested = CreateFilter();
+  const std::string socket_path = SocketPath();
+
+  // Small reads split records between reads
+  mars::IngestServer server(ingested.core_logic_, socket_path, 1000);
+  ASSERT_TRUE(server.is_open());
+  server.AddSensor(ingested.imu_sensor_, mars::JournalPayloadType::imu);
+  server.AddSensor(ingested.pose_sensor_, mars::JournalPayloadType::pose);
+
+  // The client sends the records in chunks from a second thread
+  bool sent = false;
+  std::thread client_thread([&encoder, &socket_path, &sent]() {
+    mars::IngestClient client;
+    if (!client.Connect(socket_path))
+    {
+      return;
+    }
+
+    const std::vector<char>& data = encoder.get_data();
+    const size_t chunk_size = 4096;
+    sent = true;
+    for (size_t k = 0; k < data.size(); k += chunk_size)
+    {
+      sent &= client.Send(data.data() + k, std::min(chunk_size, data.size() - k));
+    }
+  });
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while ((server.num_connections_ == 0 || server.get_num_clients() > 0) && std::chrono::steady_clock::now() < deadline)
+  {
+    ASSERT_GE(server.Poll(100), 0);
+  }
+  client_thread.join();
+
+  ASSERT_TRUE(sent);
+  EXPECT_EQ(server.num_connections_, 1);
+  EXPECT_EQ(server.get_num_clients(), 0);
+  EXPECT_EQ(server.num_measurements_, 440);
+  EXPECT_EQ(server.num_initializations_, 1);
+  EXPECT_EQ(server.num_dropped_, 1);
+  EXPECT_EQ(server.num_stream_errors_, 0);
+  EXPECT_EQ(server.num_bytes_, encoder.get_data().size());
+
+  // The wire format holds the raw doubles, both filters are identical
+  const mars::CoreType core_direct = LatestCore(*direct.core_logic_);
+  const mars::CoreType core_ingested = LatestCore(*ingested.core_logic_);
+  EXPECT_EQ(core_direct.state_.p_wi_, core_ingested.state_.p_wi_);
+  EXPECT_EQ(core_direct.state_.v_wi_, core_ingested.state_.v_wi_);
+  EXPECT_EQ(core_direct.state_.q_wi_.coeffs(), core_ingested.state_.q_wi_.coeffs());
+  EXPECT_EQ(core_direct.cov_, core_ingested.cov_);
+}
+
+TEST_F(mars_ipc_ingest_test, INVALID_STREAM)
+{
+  FilterSetup setup = CreateFilter();
+  const std::string socket_path = SocketPath();
+  mars::IngestServer server(setup.core_logic_, socket_path);
+  ASSERT_TRUE(server.is_open());
+
+  mars::IngestClient client;
+  ASSERT_TRUE(client.Connect(socket_path));
+  const char invalid[] = { 42, 1, 2, 3 };
+  ASSERT_TRUE(client.Send(invalid, sizeof(invalid)));
+
+  // Accept, then read the invalid record
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (server.num_stream_errors_ == 0 && std::chrono::steady_clock::now() < deadline)
+  {
+    server.Poll(100);
+  }
+
+  EXPECT_EQ(server.num_connections_, 1);
+  EXPECT_EQ(server.num_stream_errors_, 1);
+  EXPECT_EQ(server.get_num_clients(), 0);
+
+  // Invalid socket path
+  mars::IngestServer invalid_server(setup.core_logic_, std::string(200, 'a'));
+  EXPECT_FALSE(invalid_server.is_open());
+  EXPECT_EQ(invalid_server.Poll(0), -1);
+}
+
+TEST_F(mars_ipc_ingest_test, PAYLOAD_TYPE_MISMATCH)
+{
+  FilterSetup setup = CreateFilter();
+  const std::string socket_path = SocketPath();
+  mars::IngestServer server(setup.core_logic_, socket_path);
+  ASSERT_TRUE(server.is_open());
+  server.AddSensor(setup.imu_sensor_, mars::JournalPayloadType::imu);
+  server.AddSensor(setup.pose_sensor_, mars::JournalPayloadType::pose);
+
+  // The pose sensor is registered with position payloads, which are smaller than the pose measurement type
+  mars::IngestEncoder encoder;
+  const int pose_id = encoder.AddSensor("Pose", mars::JournalPayloadType::position);
+  encoder.AddMeasurement(pose_id, 1, std::make_shared<mars::PositionMeasurementType>(Eigen::Vector3d(1, 2, 3)));
+
+  mars::IngestClient client;
+  ASSERT_TRUE(client.Connect(socket_path));
+  ASSERT_TRUE(client.Send(encoder));
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (server.num_stream_errors_ == 0 && std::chrono::steady_clock::now() < deadline)
+  {
+    server.Poll(100);
+  }
+
+  EXPECT_EQ(server.num_connections_, 1);
+  EXPECT_EQ(server.num_stream_errors_, 1);
+  EXPECT_EQ(server.num_measurements_, 0);
+  EXPECT_EQ(server.get_num_clients(), 0);
+}
@@ -0,0 +1,432 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/journal.h>
+#include <mars/sensors/gps_w_vel/gps_w_vel_measurement_type.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/sensors/pressure/pressure_measurement_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+class mars_journal_test : public testing::Test
+{
+public:
+  const std::string journal_path_{ "mars_journal_test.bin" };
+
+  void TearDown() override
+  {
+    std::remove(journal_path_.c_str());
+  }
+
+  // Filter with an IMU and a pose sensor. The filter is driven by a sine trajectory with pose measurements at 20 Hz
+  static std::shared_ptr<mars::CoreLogic> RunFilter(const std::shared_ptr<mars::JournalWriter>& journal)
+  {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    SetupPoseSensor(pose_sensor_sptr.get());
+
+    std::shared_ptr<mars::CoreLogic> core_logic = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    core_logic->journal_ = journal;
+
+    if (journal != nullptr)
+    {
+      journal->RegisterSensor(imu_sensor_sptr, mars::JournalPayloadType::imu);
+      journal->RegisterSensor(pose_sensor_sptr, mars::JournalPayloadType::pose);
+    }
+
+    for (int k = 0; k < 400; k++)
+    {
+      const double t = k * 0.005;
+
+      mars::BufferDataType imu_data;
+      imu_data.set_sensor_data(std::make_shared<mars::IMUMeasurementType>(
+          Eigen::Vector3d(0.1 * std::sin(t), 0, 9.81), Eigen::Vector3d(0, 0, 0.2 * std::cos(t))));
+      core_logic->ProcessMeasurement(imu_sensor_sptr, t, imu_data);
+
+      if (k == 0)
+      {
+        core_logic->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+      }
+
+      if (k % 10 == 5)
+      {
+        const Eigen::Quaterniond q_meas(Eigen::AngleAxisd(0.001 * k, Eigen::Vector3d::UnitZ()));
+        mars::BufferDataType pose_data;
+        pose_data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(0.01 * k, 0, 5), q_meas));
+        core_logic->ProcessMeasurement(pose_sensor_sptr, t, pose_data);
+      }
+    }
+
+    return core_logic;
+  }
+
+  static void SetupPoseSensor(mars::PoseSensorClass* pose_sensor)
+  {
+    pose_sensor->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    pose_sensor->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> std;
+    std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+    pose_sensor->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+  }
+
+  struct StackedFilter
+  {
+    std::shared_ptr<mars::CoreLogic> core_logic_;
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_;
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_;
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_;
+  };
+
+  // Filter with an IMU, a pose and a position sensor, the stacked update is disabled
+  static StackedFilter CreateStackedFilter()
+  {
+    StackedFilter filter;
+    filter.imu_sensor_ = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(filter.imu_sensor_);
+
+    filter.pose_sensor_ = std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    SetupPoseSensor(filter.pose_sensor_.get());
+
+    filter.position_sensor_ = std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    filter.position_sensor_->const_ref_to_nav_ = true;
+    filter.position_sensor_->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 0.01;
+    filter.position_sensor_->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    filter.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    return filter;
+  }
+
+  static mars::CoreType LatestCore(const mars::CoreLogic& core_logic)
+  {
+    mars::BufferEntryType latest_state;
+    core_logic.buffer_.get_latest_state(&latest_state);
+    return *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+  }
+};
+
+TEST_F(mars_journal_test, PAYLOAD_ENCODING)
+{
+  std::vector<double> values;
+
+  mars::IMUMeasurementType imu(Eigen::Vector3d(1, 2, 3), Eigen::Vector3d(4, 5, 6));
+  imu.has_meas_noise = true;
+  imu.meas_noise_ = Eigen::MatrixXd::Identity(2, 3) * 0.5;
+  ASSERT_TRUE(mars::JournalWriter::EncodePayload(mars::JournalPayloadType::imu,
+                                                 std::make_shared<mars::IMUMeasurementType>(imu), &values));
+  std::shared_ptr<void> imu_decoded = mars::JournalReader::DecodePayload(mars::JournalPayloadType::imu, values);
+  ASSERT_NE(imu_decoded, nullptr);
+  ASSERT_EQ(*static_cast<mars::IMUMeasurementType*>(imu_decoded.get()), imu);
+  ASSERT_TRUE(static_cast<mars::IMUMeasurementType*>(imu_decoded.get())->has_meas_noise);
+  ASSERT_EQ(static_cast<mars::IMUMeasurementType*>(imu_decoded.get())->meas_noise_, imu.meas_noise_);
+
+  values.clear();
+  mars::GpsVelMeasurementType gps(46.6, 14.2, 500.1, 1, 2, 3);
+  ASSERT_TRUE(mars::JournalWriter::EncodePayload(mars::JournalPayloadType::gps_w_vel,
+                                                 std::make_shared<mars::GpsVelMeasurementType>(gps), &values));
+  auto gps_decoded = std::static_pointer_cast<mars::GpsVelMeasurementType>(
+      mars::JournalReader::DecodePayload(mars::JournalPayloadType::gps_w_vel, values));
+  ASSERT_EQ(gps_decoded->coordinates_.latitude_, gps.coordinates_.latitude_);
+  ASSERT_EQ(gps_decoded->coordinates_.altitude_, gps.coordinates_.altitude_);
+  ASSERT_EQ(gps_decoded->velocity_, gps.velocity_);
+
+  values.clear();
+  mars::PressureMeasurementType pressure(101325.0, 293.15);
+  ASSERT_TRUE(mars::JournalWriter::EncodePayload(mars::JournalPayloadType::pressure,
+                                                 std::make_shared<mars::PressureMeasurementType>(pressure), &values));
+  auto pressure_decoded = std::static_pointer_cast<mars::PressureMeasurementType>(
+      mars::JournalReader::DecodePayload(mars::JournalPayloadType::pressure, values));
+  ASSERT_EQ(pressure_decoded->pressure_.data_, pressure.pressure_.data_);
+  ASSERT_EQ(pressure_decoded->pressure_.temperature_K_, pressure.pressure_.temperature_K_);
+  ASSERT_TRUE(pressure_decoded->pressure_.type_ == pressure.pressure_.type_);
+
+  // Invalid input
+  values.resize(2);
+  ASSERT_EQ(mars::JournalReader::DecodePayload(mars::JournalPayloadType::imu, values), nullptr);
+  ASSERT_FALSE(mars::JournalWriter::EncodePayload(mars::JournalPayloadType::unknown,
+                                                  std::make_shared<mars::IMUMeasurementType>(imu), &values));
+}
+
+TEST_F(mars_journal_test, INVALID_FILE)
+{
+  mars::JournalReader missing_reader("mars_journal_test_missing.bin");
+  ASSERT_FALSE(missing_reader.IsOpen());
+
+  {
+    std::ofstream file(journal_path_);
+    file << "no journal";
+  }
+
+  mars::JournalReader reader(journal_path_);
+  ASSERT_FALSE(reader.IsOpen());
+
+  mars::JournalRecord record;
+  ASSERT_FALSE(reader.ReadNext(&record));
+}
+
+TEST_F(mars_journal_test, RECORD_AND_REPLAY)
+{
+  // Small write buffer to test multiple flushes
+  std::shared_ptr<mars::JournalWriter> journal = std::make_shared<mars::JournalWriter>(journal_path_, 256);
+  ASSERT_TRUE(journal->IsOpen());
+
+  std::shared_ptr<mars::CoreLogic> recorded = RunFilter(journal);
+  journal->Flush();
+
+  // Replay with a new filter setup
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+      std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+  SetupPoseSensor(pose_sensor_sptr.get());
+
+  mars::CoreLogic replayed(core_states_sptr);
+  std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors;
+
+  mars::JournalReader reader(journal_path_);
+  ASSERT_TRUE(reader.IsOpen());
+
+  mars::JournalRecord record;
+  int num_measurements = 0;
+  int num_initializations = 0;
+
+  while (reader.ReadNext(&record))
+  {
+    switch (record.type_)
+    {
+      case mars::JournalRecordType::sensor:
+        ASSERT_EQ(record.sensor_id_, static_cast<int>(sensors.size()));
+        if (record.sensor_name_ == "IMU")
+        {
+          sensors.push_back(imu_sensor_sptr);
+        }
+        else
+        {
+          sensors.push_back(pose_sensor_sptr);
+        }
+        break;
+      case mars::JournalRecordType::measurement:
+      {
+        ASSERT_NE(record.payload_, nullptr);
+        mars::BufferDataType data;
+        data.set_sensor_data(record.payload_);
+        replayed.ProcessMeasurement(sensors.at(record.sensor_id_), record.timestamp_, data);
+        num_measurements++;
+        break;
+      }
+      case mars::JournalRecordType::initialize:
+        replayed.Initialize(record.p_wi_, record.q_wi_);
+        num_initializations++;
+        break;
+      default:
+        break;
+    }
+  }
+
+  ASSERT_EQ(sensors.size(), 2);
+  ASSERT_EQ(num_measurements, 440);
+  ASSERT_EQ(num_initializations, 1);
+
+  // The replay is bit-exact
+  const mars::CoreType core_recorded = LatestCore(*recorded);
+  const mars::CoreType core_replayed = LatestCore(replayed);
+  ASSERT_EQ(core_recorded.state_.p_wi_, core_replayed.state_.p_wi_);
+  ASSERT_EQ(core_recorded.state_.v_wi_, core_replayed.state_.v_wi_);
+  ASSERT_EQ(core_recorded.state_.q_wi_.coeffs(), core_replayed.state_.q_wi_.coeffs());
+  ASSERT_EQ(core_recorded.cov_, core_replayed.cov_);
+}
+
+TEST_F(mars_journal_test, TRUNCATED_FILE)
+{
+  {
+    std::shared_ptr<mars::JournalWriter> journal = std::make_shared<mars::JournalWriter>(journal_path_);
+    RunFilter(journal);
+  }
+
+  mars::JournalRecord record;
+  int num_records = 0;
+  {
+    mars::JournalReader reader(journal_path_);
+    while (reader.ReadNext(&record))
+    {
+      num_records++;
+    }
+    ASSERT_FALSE(reader.IsCorrupted());
+  }
+
+  // Cut the last record in half
+  std::ifstream in_file(journal_path_, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(in_file)), std::istreambuf_iterator<char>());
+  in_file.close();
+  {
+    std::ofstream out_file(journal_path_, std::ios::binary | std::ios::trunc);
+    out_file.write(content.data(), static_cast<std::streamsize>(content.size() - 20));
+  }
+
+  mars::JournalReader reader(journal_path_);
+  int num_truncated_records = 0;
+  while (reader.ReadNext(&record))
+  {
+    num_truncated_records++;
+  }
+  ASSERT_TRUE(reader.IsCorrupted());
+  ASSERT_EQ(num_truncated_records, num_records - 1);
+}
+
+TEST_F(mars_journal_test, CLONE_HAS_NO_JOURNAL)
+{
+  mars::CoreLogic core_logic;
+  core_logic.journal_ = std::make_shared<mars::JournalWriter>(journal_path_);
+
+  mars::CoreLogic clone = core_logic.Clone();
+  ASSERT_EQ(clone.journal_, nullptr);
+}
+
+TEST_F(mars_journal_test, STACKED_RECORD_AND_REPLAY)
+{
+  std::shared_ptr<mars::JournalWriter> journal = std::make_shared<mars::JournalWriter>(journal_path_);
+  ASSERT_TRUE(journal->IsOpen());
+
+  StackedFilter recorded = CreateStackedFilter();
+  recorded.core_logic_->stacked_update_ = true;
+  recorded.core_logic_->journal_ = journal;
+  journal->RegisterSensor(recorded.imu_sensor_, mars::JournalPayloadType::imu);
+  journal->RegisterSensor(recorded.pose_sensor_, mars::JournalPayloadType::pose);
+  journal->RegisterSensor(recorded.position_sensor_, mars::JournalPayloadType::position);
+
+  // Pose and position measurements at the same time are passed to ProcessMeasurements
+  for (int k = 0; k < 400; k++)
+  {
+    const double t = k * 0.005;
+
+    mars::BufferDataType imu_data;
+    imu_data.set_sensor_data(std::make_shared<mars::IMUMeasurementType>(
+        Eigen::Vector3d(0.1 * std::sin(t), 0, 9.81), Eigen::Vector3d(0, 0, 0.2 * std::cos(t))));
+    recorded.core_logic_->ProcessMeasurement(recorded.imu_sensor_, t, imu_data);
+
+    if (k == 0)
+    {
+      recorded.core_logic_->Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+    }
+
+    if (k % 10 == 5)
+    {
+      const Eigen::Quaterniond q_meas(Eigen::AngleAxisd(0.001 * k, Eigen::Vector3d::UnitZ()));
+      mars::BufferDataType pose_data;
+      pose_data.set_sensor_data(std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(0.01 * k, 0, 5), q_meas));
+      mars::BufferDataType position_data;
+      position_data.set_sensor_data(std::make_shared<mars::PositionMeasurementType>(Eigen::Vector3d(0.01 * k, 0, 5)));
+
+      recorded.core_logic_->ProcessMeasurements(
+          { mars::BufferEntryType(t, pose_data, recorded.pose_sensor_, mars::BufferMetadataType::measurement),
+            mars::BufferEntryType(t, position_data, recorded.position_sensor_,
+                                  mars::BufferMetadataType::measurement) });
+    }
+  }
+  journal->Flush();
+
+  // Replays the journal with a new filter, the measurements of a ProcessMeasurements call are either replayed with one
+  // call or individually
+  auto replay = [this](const bool& replay_calls, int* num_calls) {
+    StackedFilter replayed = CreateStackedFilter();
+    const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { replayed.imu_sensor_, replayed.pose_sensor_,
+                                                                         replayed.position_sensor_ };
+
+    mars::JournalReader reader(journal_path_);
+    EXPECT_TRUE(reader.IsOpen());
+
+    mars::JournalRecord record;
+    std::vector<mars::BufferEntryType> call_measurements;
+    int num_pending_call_records = 0;
+    *num_calls = 0;
+
+    while (reader.ReadNext(&record))
+    {
+      if (record.type_ == mars::JournalRecordType::measurements && replay_calls)
+      {
+        replayed.core_logic_->stacked_update_ = record.stacked_update_;
+        replayed.core_logic_->stacked_update_epsilon_ = record.stacked_update_epsilon_;
+        call_measurements.clear();
+        num_pending_call_records = record.num_measurements_;
+      }
+      else if (record.type_ == mars::JournalRecordType::measurement)
+      {
+        mars::BufferDataType data;
+        data.set_sensor_data(record.payload_);
+
+        if (num_pending_call_records > 0)
+        {
+          call_measurements.emplace_back(record.timestamp_, data, sensors.at(record.sensor_id_),
+                                         mars::BufferMetadataType::measurement);
+          if (--num_pending_call_records == 0)
+          {
+            replayed.core_logic_->ProcessMeasurements(call_measurements);
+            (*num_calls)++;
+          }
+        }
+        else
+        {
+          replayed.core_logic_->ProcessMeasurement(sensors.at(record.sensor_id_), record.timestamp_, data);
+        }
+      }
+      else if (record.type_ == mars::JournalRecordType::initialize)
+      {
+        replayed.core_logic_->Initialize(record.p_wi_, record.q_wi_);
+      }
+    }
+
+    EXPECT_FALSE(reader.IsCorrupted());
+    return LatestCore(*replayed.core_logic_);
+  };
+
+  int num_calls = 0;
+  const mars::CoreType core_recorded = LatestCore(*recorded.core_logic_);
+  const mars::CoreType core_replayed = replay(true, &num_calls);
+  ASSERT_EQ(num_calls, 40);
+
+  // The replay of the calls is bit-exact
+  ASSERT_EQ(core_recorded.state_.p_wi_, core_replayed.state_.p_wi_);
+  ASSERT_EQ(core_recorded.state_.v_wi_, core_replayed.state_.v_wi_);
+  ASSERT_EQ(core_recorded.state_.q_wi_.coeffs(), core_replayed.state_.q_wi_.coeffs());
+  ASSERT_EQ(core_recorded.cov_, core_replayed.cov_);
+
+  // Sequential updates of the same measurements differ from the stacked updates
+  const mars::CoreType core_sequential = replay(false, &num_calls);
+  ASSERT_EQ(num_calls, 0);
+  ASSERT_NE(core_recorded.cov_, core_sequential.cov_);
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/sensors/mag/mag_utils.h>
+#include <Eigen/Dense>
+#include <cstdlib>
+
+class mars_mag_utils_test : public testing::Test
+{
+public:
+};
+
+TEST_F(mars_mag_utils_test, MAG_INIT)
+{
+  // IMU rotated about the vertical axis, gravity along z and a magnetic field with inclination
+  const Eigen::Matrix3d R_wi(Eigen::AngleAxisd(0.7, Eigen::Vector3d::UnitZ()));
+  const Eigen::Vector3d mag_w(0.2, 0.0, -0.45);
+  const Eigen::Vector3d acc_w(0, 0, 9.81);
+
+  mars::MagnetometerInit mag_init;
+  std::srand(5);
+  Eigen::Vector3d mag_sum(Eigen::Vector3d::Zero());
+  Eigen::Vector3d acc_sum(Eigen::Vector3d::Zero());
+
+  for (int k = 0; k < 1000; k++)
+  {
+    const Eigen::Vector3d mag_i = R_wi.transpose() * mag_w + 0.01 * Eigen::Vector3d::Random();
+    const Eigen::Vector3d acc_i = R_wi.transpose() * acc_w + 0.1 * Eigen::Vector3d::Random();
+    mag_init.AddElement(mag_i, acc_i);
+    mag_sum += mag_i;
+    acc_sum += acc_i;
+  }
+
+  ASSERT_EQ(mag_init.get_size(), 1000);
+  const mars::MagnetometerInit::MagImuData mean = mag_init.get_vec_mean();
+  ASSERT_TRUE(mean.mag_vec_.isApprox(mag_sum / 1000, 1e-12));
+  ASSERT_TRUE(mean.imu_vec_.isApprox(acc_sum / 1000, 1e-12));
+
+  // The rotation aligns the IMU gravity vector with the world z axis
+  const Eigen::Matrix3d R = mag_init.get_rot();
+  ASSERT_NEAR((R * mean.imu_vec_.normalized() - Eigen::Vector3d::UnitZ()).norm(), 0, 1e-12);
+
+  // The relative rotation of two initializations is independent of the world frame convention
+  mars::MagnetometerInit mag_init_rotated;
+  const Eigen::Matrix3d R_rot(Eigen::AngleAxisd(-0.3, Eigen::Vector3d::UnitZ()));
+  mag_init_rotated.AddElement(R_rot.transpose() * mean.mag_vec_, R_rot.transpose() * mean.imu_vec_);
+  ASSERT_TRUE((R.transpose() * mag_init_rotated.get_rot()).isApprox(R_rot, 1e-9));
+
+  mag_init.set_done();
+  ASSERT_TRUE(mag_init.IsDone());
+  mag_init.Reset();
+  ASSERT_FALSE(mag_init.IsDone());
+  ASSERT_EQ(mag_init.get_size(), 0);
+}
@@ -0,0 +1,155 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/data_utils/measurement_archive.h>
+#include <mars/data_utils/read_archive_data.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <Eigen/Dense>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+class mars_measurement_archive_test : public testing::Test
+{
+public:
+  const std::string archive_path_{ "mars_measurement_archive_test.bin" };
+
+  void TearDown() override
+  {
+    std::remove(archive_path_.c_str());
+  }
+
+  static Eigen::Vector3d Signal(const double& t)
+  {
+    return Eigen::Vector3d(std::sin(t), std::cos(2 * t), t);
+  }
+
+  // IMU at 100 Hz and pose at 10 Hz with measurement noise over 100 s
+  void WriteArchive(const uint32_t& chunk_size)
+  {
+    mars::MeasurementArchiveWriter writer(archive_path_, chunk_size);
+    ASSERT_TRUE(writer.IsOpen());
+
+    const int imu_id = writer.AddStream("IMU", mars::JournalPayloadType::imu);
+    const int pose_id = writer.AddStream("Pose", mars::JournalPayloadType::pose);
+    EXPECT_EQ(writer.AddStream("Pose", mars::JournalPayloadType::pose), -1);
+
+    for (int k = 0; k < 10000; k++)
+    {
+      const double t = k * 0.01;
+      EXPECT_TRUE(writer.Append(imu_id, t, std::make_shared<mars::IMUMeasurementType>(Signal(t), Signal(t + 1))));
+
+      if (k % 10 == 0)
+      {
+        std::shared_ptr<mars::PoseMeasurementType> pose =
+            std::make_shared<mars::PoseMeasurementType>(Signal(t), Eigen::Quaterniond::Identity());
+        pose->has_meas_noise = true;
+        pose->meas_noise_ = Eigen::MatrixXd::Identity(6, 6) * t;
+        EXPECT_TRUE(writer.Append(pose_id, t, pose));
+      }
+    }
+
+    // Streams must be time sorted
+    EXPECT_FALSE(writer.Append(imu_id, 50, std::make_shared<mars::IMUMeasurementType>()));
+  }
+};
+
+TEST_F(mars_measurement_archive_test, READ_WINDOW)
+{
+  WriteArchive(64);
+
+  mars::MeasurementArchiveReader reader(archive_path_);
+  ASSERT_TRUE(reader.IsOpen());
+  EXPECT_EQ(reader.get_stream_names(), std::vector<std::string>({ "IMU", "Pose" }));
+
+  mars::JournalPayloadType payload_type;
+  uint64_t num_records;
+  mars::Time t_first, t_last;
+  ASSERT_TRUE(reader.get_stream_info("IMU", &payload_type, &num_records, &t_first, &t_last));
+  EXPECT_EQ(payload_type, mars::JournalPayloadType::imu);
+  EXPECT_EQ(num_records, 10000);
+  EXPECT_EQ(t_first, mars::Time(0));
+  EXPECT_EQ(t_last, mars::Time(9999 * 0.01));
+
+  // Window within the stream
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::vector<mars::BufferEntryType> data;
+  ASSERT_TRUE(reader.Read("IMU", 30.005, 40.005, imu_sensor, &data, 1000));
+  ASSERT_EQ(data.size(), 1000);
+
+  for (size_t k = 0; k < data.size(); k++)
+  {
+    const double t = (3001 + static_cast<int>(k)) * 0.01;
+    EXPECT_EQ(data[k].timestamp_, mars::Time(t + 1000));
+    EXPECT_EQ(data[k].sensor_, imu_sensor);
+
+    const mars::IMUMeasurementType* meas = static_cast<mars::IMUMeasurementType*>(data[k].data_.sensor_.get());
+    EXPECT_EQ(meas->linear_acceleration_, Signal(t));
+    EXPECT_EQ(meas->angular_velocity_, Signal(t + 1));
+  }
+
+  // Windows outside of the stream are empty
+  ASSERT_TRUE(reader.Read("IMU", 200, 300, imu_sensor, &data));
+  EXPECT_TRUE(data.empty());
+  EXPECT_FALSE(reader.Read("Vision", 0, 100, imu_sensor, &data));
+
+  // Single record window, the borders are included. Dynamic measurement noise is preserved
+  ASSERT_TRUE(reader.Read("Pose", 5000 * 0.01, 5000 * 0.01, imu_sensor, &data));
+  ASSERT_EQ(data.size(), 1);
+  const mars::PoseMeasurementType* pose = static_cast<mars::PoseMeasurementType*>(data[0].data_.sensor_.get());
+  EXPECT_EQ(pose->position_, Signal(5000 * 0.01));
+  EXPECT_TRUE(pose->has_meas_noise);
+  EXPECT_EQ(pose->meas_noise_, Eigen::MatrixXd(Eigen::MatrixXd::Identity(6, 6) * (5000 * 0.01)));
+}
+
+TEST_F(mars_measurement_archive_test, READ_ARCHIVE_DATA)
+{
+  WriteArchive(1000);
+
+  // The loader reads the full stream by default
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::vector<mars::BufferEntryType> data;
+  mars::ReadArchiveData(&data, imu_sensor, archive_path_, "Pose");
+  ASSERT_EQ(data.size(), 1000);
+  EXPECT_EQ(data.front().timestamp_, mars::Time(0));
+  EXPECT_EQ(data.back().timestamp_, mars::Time(9990 * 0.01));
+
+  // Loaded entries can be archived again
+  const std::string copy_path = archive_path_ + ".copy";
+  {
+    mars::MeasurementArchiveWriter writer(copy_path);
+    EXPECT_TRUE(writer.Append(writer.AddStream("Pose", mars::JournalPayloadType::pose), data));
+  }
+
+  std::vector<mars::BufferEntryType> copy;
+  mars::ReadArchiveData(&copy, imu_sensor, copy_path, "Pose", 0, 9.995, 20.005);
+  std::remove(copy_path.c_str());
+  ASSERT_EQ(copy.size(), 101);
+  EXPECT_EQ(copy.front().timestamp_, mars::Time(1000 * 0.01));
+}
+
+TEST_F(mars_measurement_archive_test, INVALID_ARCHIVE)
+{
+  {
+    std::ofstream file(archive_path_, std::ios::binary);
+    file << "MARSJNL this is not an archive";
+  }
+
+  mars::MeasurementArchiveReader reader(archive_path_);
+  EXPECT_FALSE(reader.IsOpen());
+  EXPECT_TRUE(reader.get_stream_names().empty());
+
+  mars::MeasurementArchiveReader missing("mars_measurement_archive_missing.bin");
+  EXPECT_FALSE(missing.IsOpen());
+}
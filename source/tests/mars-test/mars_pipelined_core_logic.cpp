@@ -0,0 +1,252 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/pipelined_core_logic.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_measurement_type.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <cmath>
+#include <memory>
+#include "../include_local/slow_position_sensor.h"
+
+class mars_pipelined_core_logic_test : public testing::Test
+{
+public:
+  static bool ProcessImu(const FilterSetup& setup, mars::PipelinedCoreLogic* pipeline, const double& t)
+  {
+    auto imu_meas = std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0.1 * std::sin(t), 0, 9.81),
+                                                               Eigen::Vector3d(0, 0, 0.2 * std::cos(t)));
+    mars::BufferDataType imu_data;
+    imu_data.set_sensor_data(imu_meas);
+    return pipeline->ProcessMeasurement(setup.imu_sensor_, t, imu_data);
+  }
+
+  static void ProcessPosition(const FilterSetup& setup, mars::PipelinedCoreLogic* pipeline, const double& t)
+  {
+    auto position_meas = std::make_shared<mars::PositionMeasurementType>(Eigen::Vector3d(0.1 * t, 0, 5));
+    mars::BufferDataType position_data;
+    position_data.set_sensor_data(position_meas);
+    pipeline->ProcessMeasurement(setup.position_sensor_, t, position_data);
+  }
+
+  // The output state after a propagation of the idle pipeline is the latest state of the CoreLogic
+  static void ExpectMatchesCoreLogic(const FilterSetup& setup, mars::PipelinedCoreLogic* pipeline, const double& t)
+  {
+    pipeline->WaitUntilIdle();
+    ASSERT_TRUE(ProcessImu(setup, pipeline, t));
+    pipeline->WaitUntilIdle();
+
+    mars::Time output_time;
+    mars::CoreStateType output_state;
+    ASSERT_TRUE(pipeline->get_latest_state(&output_time, &output_state));
+
+    mars::BufferEntryType latest_state;
+    ASSERT_TRUE(setup.core_logic_->buffer_.get_latest_state(&latest_state));
+    const mars::CoreStateType& core_state = static_cast<mars::CoreType*>(latest_state.data_.core_.get())->state_;
+
+    EXPECT_EQ(output_time, latest_state.timestamp_);
+    EXPECT_EQ(output_state.p_wi_, core_state.p_wi_);
+    EXPECT_EQ(output_state.v_wi_, core_state.v_wi_);
+    EXPECT_EQ(output_state.q_wi_.coeffs(), core_state.q_wi_.coeffs());
+    EXPECT_EQ(output_state.b_w_, core_state.b_w_);
+    EXPECT_EQ(output_state.b_a_, core_state.b_a_);
+  }
+};
+
+TEST_F(mars_pipelined_core_logic_test, NO_OUTPUT_BEFORE_INITIALIZATION)
+{
+  FilterSetup setup = CreateFilter();
+  int num_callbacks = 0;
+  mars::PipelinedCoreLogic pipeline(setup.core_logic_, [&num_callbacks](const mars::Time&, const mars::CoreStateType&) {
+    num_callbacks++;
+  });
+
+  for (int k = 0; k < 10; k++)
+  {
+    EXPECT_FALSE(ProcessImu(setup, &pipeline, k * 0.005));
+  }
+  pipeline.WaitUntilIdle();
+  EXPECT_FALSE(ProcessImu(setup, &pipeline, 0.05));
+
+  mars::Time output_time;
+  mars::CoreStateType output_state;
+  EXPECT_FALSE(pipeline.get_latest_state(&output_time, &output_state));
+  EXPECT_EQ(num_callbacks, 0);
+  EXPECT_EQ(pipeline.get_num_merges(), 0);
+}
+
+TEST_F(mars_pipelined_core_logic_test, MATCHES_CORE_LOGIC)
+{
+  FilterSetup setup = CreateFilter();
+  int num_callbacks = 0;
+  mars::Time last_callback_time;
+  mars::PipelinedCoreLogic pipeline(setup.core_logic_, [&](const mars::Time& timestamp, const mars::CoreStateType&) {
+    num_callbacks++;
+    last_callback_time = timestamp;
+  });
+
+  // IMU at 200 Hz, position at 20 Hz
+  ProcessImu(setup, &pipeline, 0);
+  pipeline.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+
+  for (int k = 1; k < 400; k++)
+  {
+    const double t = k * 0.005;
+    ProcessImu(setup, &pipeline, t);
+
+    if (k % 10 == 5)
+    {
+      ProcessPosition(setup, &pipeline, t);
+    }
+  }
+
+  ExpectMatchesCoreLogic(setup, &pipeline, 2.0);
+  EXPECT_GT(num_callbacks, 0);
+  EXPECT_GT(pipeline.get_num_merges(), 0);
+  EXPECT_EQ(last_callback_time, mars::Time(2.0));
+}
+
+TEST_F(mars_pipelined_core_logic_test, SLOW_UPDATES_DO_NOT_DELAY_OUTPUT)
+{
+  FilterSetup setup = CreateFilter();
+  mars::PipelinedCoreLogic pipeline(setup.core_logic_);
+
+  ProcessImu(setup, &pipeline, 0);
+  pipeline.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+  ProcessImu(setup, &pipeline, 0.005);
+  ProcessPosition(setup, &pipeline, 0.005);
+  pipeline.WaitUntilIdle();
+
+  // The worker blocks in the next update until the sensor is released
+  setup.position_sensor_->Hold();
+  const int num_updates = setup.position_sensor_->get_num_updates();
+  ProcessImu(setup, &pipeline, 0.01);
+  ProcessPosition(setup, &pipeline, 0.01);
+  setup.position_sensor_->WaitForUpdates(num_updates + 1);
+
+  for (int k = 3; k <= 202; k++)
+  {
+    const double t = k * 0.005;
+    ASSERT_TRUE(ProcessImu(setup, &pipeline, t));
+
+    // The output follows the IMU while the worker is still busy with the update
+    mars::Time output_time;
+    mars::CoreStateType output_state;
+    ASSERT_TRUE(pipeline.get_latest_state(&output_time, &output_state));
+    EXPECT_EQ(output_time, mars::Time(t));
+
+    if (k % 20 == 10)
+    {
+      ProcessPosition(setup, &pipeline, t);
+    }
+  }
+
+  // No further update was started and all measurements since the held update are pending
+  EXPECT_EQ(setup.position_sensor_->get_num_updates(), num_updates + 1);
+  EXPECT_EQ(pipeline.get_max_queue_size(), 210);
+
+  setup.position_sensor_->Release();
+  ExpectMatchesCoreLogic(setup, &pipeline, 1.015);
+  EXPECT_EQ(setup.position_sensor_->get_num_updates(), num_updates + 11);
+}
+
+TEST_F(mars_pipelined_core_logic_test, MERGE_IS_BOUNDED_PER_CALL)
+{
+  FilterSetup setup = CreateFilter();
+  mars::PipelinedCoreLogic pipeline(setup.core_logic_);
+  pipeline.max_merge_steps_ = 4;
+
+  ProcessImu(setup, &pipeline, 0);
+  pipeline.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+  ProcessPosition(setup, &pipeline, 0);
+  pipeline.WaitUntilIdle();
+
+  // The worker publishes the anchor of the first update and blocks in the second update
+  setup.position_sensor_->Hold();
+  const int num_updates = setup.position_sensor_->get_num_updates();
+  ProcessPosition(setup, &pipeline, 0.005);
+  setup.position_sensor_->WaitForUpdates(num_updates + 1);
+
+  for (int k = 1; k <= 20; k++)
+  {
+    ProcessImu(setup, &pipeline, 0.005 + k * 0.005);
+  }
+  ProcessPosition(setup, &pipeline, 0.105);
+
+  setup.position_sensor_->ReleaseUpdate();
+  setup.position_sensor_->WaitForUpdates(num_updates + 2);
+
+  // Each call adds one measurement and propagates the anchor by four, the anchor is 20 measurements behind
+  const int num_merges = pipeline.get_num_merges();
+  for (int k = 21; k <= 27; k++)
+  {
+    const double t = 0.005 + k * 0.005;
+    ASSERT_TRUE(ProcessImu(setup, &pipeline, t));
+
+    mars::Time output_time;
+    mars::CoreStateType output_state;
+    ASSERT_TRUE(pipeline.get_latest_state(&output_time, &output_state));
+    EXPECT_EQ(output_time, mars::Time(t));
+    EXPECT_EQ(pipeline.get_num_merges(), k < 27 ? num_merges : num_merges + 1);
+  }
+
+  setup.position_sensor_->ReleaseUpdate();
+  ExpectMatchesCoreLogic(setup, &pipeline, 0.2);
+  EXPECT_EQ(pipeline.get_num_discarded_anchors(), 0);
+}
+
+TEST_F(mars_pipelined_core_logic_test, TRUNCATED_HISTORY_DISCARDS_ANCHOR)
+{
+  FilterSetup setup = CreateFilter();
+  mars::PipelinedCoreLogic pipeline(setup.core_logic_);
+  pipeline.max_history_size_ = 10;
+
+  ProcessImu(setup, &pipeline, 0);
+  pipeline.Initialize(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity());
+  ProcessPosition(setup, &pipeline, 0);
+  pipeline.WaitUntilIdle();
+
+  setup.position_sensor_->Hold();
+  const int num_updates = setup.position_sensor_->get_num_updates();
+  ProcessPosition(setup, &pipeline, 0.005);
+  setup.position_sensor_->WaitForUpdates(num_updates + 1);
+
+  // The first ten measurements after the anchor are dropped from the history
+  for (int k = 1; k <= 20; k++)
+  {
+    ProcessImu(setup, &pipeline, 0.005 + k * 0.005);
+  }
+  ProcessPosition(setup, &pipeline, 0.105);
+
+  setup.position_sensor_->ReleaseUpdate();
+  setup.position_sensor_->WaitForUpdates(num_updates + 2);
+
+  // The anchor is discarded instead of being propagated across the dropped measurements
+  const int num_merges = pipeline.get_num_merges();
+  ASSERT_TRUE(ProcessImu(setup, &pipeline, 0.11));
+  EXPECT_EQ(pipeline.get_num_discarded_anchors(), 1);
+  EXPECT_EQ(pipeline.get_num_merges(), num_merges);
+
+  mars::Time output_time;
+  mars::CoreStateType output_state;
+  ASSERT_TRUE(pipeline.get_latest_state(&output_time, &output_state));
+  EXPECT_EQ(output_time, mars::Time(0.11));
+
+  // Anchors after the dropped measurements are merged
+  setup.position_sensor_->ReleaseUpdate();
+  ExpectMatchesCoreLogic(setup, &pipeline, 0.115);
+  EXPECT_EQ(pipeline.get_num_discarded_anchors(), 1);
+}
@@ -16,6 +16,7 @@
 #include <mars/type_definitions/buffer_data_type.h>
 #include <mars/type_definitions/buffer_entry_type.h>
 #include <Eigen/Dense>
+#include <vector>
 
 class mars_pose_sensor_test : public testing::Test
 {
@@ -56,9 +57,94 @@ TEST_F(mars_pose_sensor_test, POSE_SENSOR_INIT)
   std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>(core_states);
   mars::PoseSensorClass pose_sensor("Pose", core_states_sptr);
 
-  EXPECT_DEATH(pose_sensor.Initialize(1, std::make_shared<mars::PoseMeasurementType>(measurement),
-                                      std::make_shared<mars::CoreType>()),
-               "");
+  mars::CoreType core_data;
+  core_data.cov_.setIdentity();
+
+  // Without a given calibration, the sensor is calibrated from the measurement
+  mars::BufferDataType init_data = pose_sensor.Initialize(
+      1, std::make_shared<mars::PoseMeasurementType>(measurement), std::make_shared<mars::CoreType>(core_data));
+
+  EXPECT_TRUE(pose_sensor.is_initialized_);
+  EXPECT_TRUE(pose_sensor.get_state(init_data.sensor_).p_ip_.isApprox(position));
+}
+
+TEST_F(mars_pose_sensor_test, POSE_AUTO_CALIBRATION)
+{
+  mars::CoreState core_states;
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>(core_states);
+  mars::PoseSensorClass pose_sensor("Pose", core_states_sptr);
+
+  mars::CoreType core_data;
+  core_data.state_.p_wi_ = Eigen::Vector3d(1, -2, 0.5);
+  core_data.state_.q_wi_ = Eigen::Quaterniond(Eigen::AngleAxisd(0.7, Eigen::Vector3d(1, 2, 3).normalized()));
+  core_data.cov_.setIdentity();
+
+  const Eigen::Vector3d p_ip(0.1, 0.2, -0.3);
+  const Eigen::Quaterniond q_ip(Eigen::AngleAxisd(0.3, Eigen::Vector3d(0, 1, 1).normalized()));
+
+  const auto measure = [&](const mars::CoreStateType& core) {
+    return mars::PoseMeasurementType(core.p_wi_ + core.q_wi_.toRotationMatrix() * p_ip, core.q_wi_ * q_ip);
+  };
+
+  // The closed form recovers the calibration
+  mars::PoseSensorData sensor_data;
+  EXPECT_TRUE(pose_sensor.CalcAutoCalibration(0, measure(core_data.state_), core_data, &sensor_data));
+  EXPECT_TRUE(sensor_data.state_.p_ip_.isApprox(p_ip, 1e-12));
+  EXPECT_TRUE(sensor_data.state_.q_ip_.isApprox(q_ip, 1e-12));
+
+  // With an identity core covariance and no measurement noise, the cross-covariance holds the core jacobian
+  const Eigen::MatrixXd J_core = sensor_data.core_sensor_cross_cov_.transpose();
+  EXPECT_TRUE(sensor_data.sensor_cov_.isApprox(J_core * J_core.transpose(), 1e-12));
+
+  const double eps = 1e-6;
+  const mars::PoseMeasurementType measurement = measure(core_data.state_);
+  for (int k = 0; k < mars::CoreStateType::size_error_; k++)
+  {
+    mars::CoreType perturbed = core_data;
+    Eigen::Matrix<double, mars::CoreStateType::size_error_, 1> delta;
+    delta.setZero();
+    delta(k) = eps;
+    perturbed.state_.p_wi_ += delta.segment<3>(0);
+    perturbed.state_.q_wi_ = perturbed.state_.q_wi_ * mars::Utils::QuatFromSmallAngle(delta.segment<3>(6));
+
+    mars::PoseSensorData perturbed_data;
+    pose_sensor.CalcAutoCalibration(0, measurement, perturbed, &perturbed_data);
+
+    Eigen::Matrix<double, 6, 1> difference;
+    difference << perturbed_data.state_.p_ip_ - sensor_data.state_.p_ip_,
+        2 * (sensor_data.state_.q_ip_.conjugate() * perturbed_data.state_.q_ip_).vec();
+    EXPECT_TRUE((difference / eps - J_core.col(k)).cwiseAbs().maxCoeff() < 1e-5) << "Core error state " << k;
+  }
+}
+
+TEST_F(mars_pose_sensor_test, POSE_AUTO_CALIBRATION_REFINE)
+{
+  mars::CoreState core_states;
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>(core_states);
+  mars::PoseSensorClass pose_sensor("Pose", core_states_sptr);
+  pose_sensor.auto_calib_.refine_duration_ = 1.0;
+
+  mars::CoreType core_data;
+  core_data.cov_.setIdentity();
+
+  // Measurement offsets that average to a known calibration
+  const std::vector<double> offsets = { 0.1, 0.3, 0.2 };
+  mars::BufferDataType init_data;
+  for (size_t k = 0; k < offsets.size(); k++)
+  {
+    EXPECT_FALSE(pose_sensor.is_initialized_);
+
+    const Eigen::Vector3d position(offsets[k], 0, 0);
+    const Eigen::Quaterniond orientation(Eigen::AngleAxisd(offsets[k], Eigen::Vector3d::UnitZ()));
+    init_data = pose_sensor.Initialize(0.5 * static_cast<double>(k),
+                                       std::make_shared<mars::PoseMeasurementType>(position, orientation),
+                                       std::make_shared<mars::CoreType>(core_data));
+  }
+
+  EXPECT_TRUE(pose_sensor.is_initialized_);
+  const mars::PoseSensorStateType state = pose_sensor.get_state(init_data.sensor_);
+  EXPECT_TRUE(state.p_ip_.isApprox(Eigen::Vector3d(0.2, 0, 0), 1e-12));
+  EXPECT_NEAR(Eigen::AngleAxisd(state.q_ip_).angle(), 0.2, 1e-4);
 }
 
 TEST_F(mars_pose_sensor_test, POSE_UPDATE)
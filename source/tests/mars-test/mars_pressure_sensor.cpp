@@ -14,6 +14,7 @@
 #include <mars/sensors/pressure/pressure_conversion.h>
 #include <mars/sensors/pressure/pressure_measurement_type.h>
 #include <mars/sensors/pressure/pressure_sensor_class.h>
+#include <mars/sensors/pressure/pressure_utils.h>
 #include <mars/type_definitions/base_states.h>
 #include <mars/type_definitions/buffer_data_type.h>
 #include <mars/type_definitions/buffer_entry_type.h>
@@ -101,3 +102,92 @@ TEST_F(mars_pressure_sensor_test, PRESSURE_UPDATE)
   //      position_sensor.CalcUpdate(timestamp, std::make_shared<mars::PositionMeasurementType>(measurement),
   //                                 prior_core_state, prior_sensor_buffer_data.sensor_, prior_cov);
 }
+
+TEST_F(mars_pressure_sensor_test, PRESSURE_INIT)
+{
+  // 100 Hz measurements with a linear pressure ramp, the mean of the window is the ramp value at its center
+  mars::PressureInit pressure_init(1.0);
+  mars::Pressure mean;
+
+  for (int k = 0; k < 300; k++)
+  {
+    const mars::Time t(10 + 0.01 * k);
+    const mars::Pressure meas(101325 + k, 293.15, mars::Pressure::Type::GAS);
+    mean = pressure_init.get_press_mean(meas, t);
+
+    if (k < 100)
+    {
+      ASSERT_FALSE(pressure_init.IsDone());
+      ASSERT_EQ(mean.data_, meas.data_);
+    }
+    else
+    {
+      ASSERT_TRUE(pressure_init.IsDone());
+
+      // The window covers the init duration and at most one bin of 1/16 s in addition
+      ASSERT_LE(mean.data_, 101325 + k - 50 + 1e-6);
+      ASSERT_GE(mean.data_, 101325 + k - 50 - 100.0 / 16 / 2 - 1);
+      ASSERT_NEAR(mean.temperature_K_, 293.15, 1e-9);
+    }
+  }
+
+  // Measurements older than the window are ignored
+  pressure_init.AddMeasurement(mars::Pressure(0, 0, mars::Pressure::Type::GAS), mars::Time(10.0));
+  const mars::Pressure meas_late(101625, 293.15, mars::Pressure::Type::GAS);
+  ASSERT_NEAR(pressure_init.get_press_mean(meas_late, mars::Time(13.0)).temperature_K_, 293.15, 1e-9);
+
+  // A reset restarts the window
+  pressure_init.Reset();
+  ASSERT_FALSE(pressure_init.IsDone());
+  const mars::Pressure meas(100000, 290, mars::Pressure::Type::GAS);
+  pressure_init.get_press_mean(meas, mars::Time(20.0));
+  ASSERT_FALSE(pressure_init.IsDone());
+  ASSERT_EQ(pressure_init.get_press_mean(meas, mars::Time(21.0)).data_, 100000);
+  ASSERT_TRUE(pressure_init.IsDone());
+}
+
+TEST_F(mars_pressure_sensor_test, FAST_HEIGHT)
+{
+  const mars::Pressure reference(101325, 293.15, mars::Pressure::Type::GAS);
+  mars::PressureConversion exact(reference);
+  mars::PressureConversion fast(reference);
+
+  // Operating range of +-20 % of the reference pressure and temperatures of 250 K to 350 K
+  const int num = 20001;
+  const Eigen::ArrayXd pressure = Eigen::ArrayXd::LinSpaced(num, 0.8 * reference.data_, 1.2 * reference.data_);
+  const Eigen::ArrayXd temperature = Eigen::ArrayXd::LinSpaced(num, 250, 350);
+
+  for (const double& max_error : { 1e-2, 1e-4, 1e-6 })
+  {
+    ASSERT_GT(fast.set_fast_height(max_error, 0.2), 0);
+
+    Eigen::ArrayXd height_fast;
+    fast.get_height_batch(pressure, temperature, mars::Pressure::Type::GAS, &height_fast);
+
+    double error = 0;
+    for (int k = 0; k < num; k++)
+    {
+      const mars::Pressure p(pressure(k), temperature(k), mars::Pressure::Type::GAS);
+      const double h_exact = exact.get_height(p)(0);
+      error = std::max(error, std::abs(height_fast(k) - h_exact));
+      ASSERT_EQ(height_fast(k), fast.get_height(p)(0));
+    }
+    EXPECT_LE(error, max_error);
+  }
+
+  // Pressures outside of the operating range use the exact formula
+  const mars::Pressure p_low(50000, 300, mars::Pressure::Type::GAS);
+  ASSERT_EQ(fast.get_height(p_low)(0), exact.get_height(p_low)(0));
+
+  // Disabled approximation
+  ASSERT_EQ(fast.set_fast_height(0), 0);
+  const mars::Pressure p(100000, 300, mars::Pressure::Type::GAS);
+  ASSERT_EQ(fast.get_height(p)(0), exact.get_height(p)(0));
+
+  // Other types
+  Eigen::ArrayXd height;
+  fast.get_height_batch(pressure, temperature, mars::Pressure::Type::HEIGHT, &height);
+  ASSERT_TRUE((height == pressure).all());
+  fast.get_height_batch(pressure, temperature, mars::Pressure::Type::LIQUID, &height);
+  ASSERT_EQ(height(0), exact.get_height(mars::Pressure(pressure(0), 0, mars::Pressure::Type::LIQUID))(0));
+}
@@ -0,0 +1,342 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/position/position_sensor_class.h>
+#include <mars/shm_state.h>
+#include <mars/shm_state_publisher.h>
+#include <mars/type_definitions/core_type.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+class mars_shm_state_test : public testing::Test
+{
+public:
+  static std::string ShmName()
+  {
+    return "/mars_shm_state_test_" + std::to_string(getpid());
+  }
+
+  // Core state entry whose values all derive from the value
+  static mars::BufferEntryType CoreEntry(const double& value)
+  {
+    mars::CoreType core_data;
+    core_data.state_.p_wi_ = Eigen::Vector3d::Constant(value);
+    core_data.state_.v_wi_ = Eigen::Vector3d::Constant(-value);
+    core_data.cov_ = mars::CoreStateMatrix::Constant(value);
+
+    mars::BufferDataType data;
+    data.set_core_data(std::make_shared<mars::CoreType>(core_data));
+    return mars::BufferEntryType(mars::Time(value), data, nullptr, mars::BufferMetadataType::core_state);
+  }
+
+  // A sample is consistent if all values were written by the same Publish call
+  static bool IsConsistent(const mars::ShmStateSample& sample)
+  {
+    const double value = static_cast<double>(sample.sequence_);
+    if (sample.core_.timestamp_ != value || sample.core_.v_wi_[2] != -value)
+    {
+      return false;
+    }
+
+    for (const double& k : sample.core_.cov_)
+    {
+      if (k != value)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+TEST_F(mars_shm_state_test, READER_OPEN)
+{
+  mars::ShmStateReader reader;
+  EXPECT_FALSE(reader.Open(ShmName()));
+
+  mars::ShmStateSample sample;
+  {
+    mars::ShmStatePublisher publisher(ShmName(), 4);
+    ASSERT_TRUE(publisher.is_open());
+
+    ASSERT_TRUE(reader.Open(ShmName()));
+    EXPECT_EQ(reader.get_latest_sequence(), 0);
+    EXPECT_FALSE(reader.ReadLatest(&sample));
+
+    // Publishing requires a state
+    mars::Buffer buffer(10);
+    EXPECT_FALSE(publisher.Publish(buffer));
+
+    for (int k = 1; k <= 6; k++)
+    {
+      buffer.AddEntrySorted(CoreEntry(k));
+      EXPECT_TRUE(publisher.Publish(buffer));
+    }
+
+    EXPECT_EQ(publisher.get_num_published(), 6);
+    EXPECT_EQ(reader.get_latest_sequence(), 6);
+    ASSERT_TRUE(reader.ReadLatest(&sample));
+    EXPECT_EQ(sample.sequence_, 6);
+    EXPECT_TRUE(IsConsistent(sample));
+
+    // The ring holds the latest four samples
+    EXPECT_FALSE(reader.Read(2, &sample));
+    ASSERT_TRUE(reader.Read(3, &sample));
+    EXPECT_EQ(sample.sequence_, 3);
+    EXPECT_TRUE(IsConsistent(sample));
+    EXPECT_FALSE(reader.Read(7, &sample));
+  }
+
+  // The removed memory stays mapped, new readers can not open it
+  EXPECT_TRUE(reader.ReadLatest(&sample));
+  mars::ShmStateReader late_reader;
+  EXPECT_FALSE(late_reader.Open(ShmName()));
+}
+
+TEST_F(mars_shm_state_test, CORE_LOGIC_PUBLISHER)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 5;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 20;
+  position_options.noise_std_ = 0.05;
+  generator.AddSensor(position_options);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+  std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+      std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+  position_sensor_sptr->const_ref_to_nav_ = true;
+  position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+
+  mars::PositionSensorData position_init_cal;
+  position_init_cal.state_.p_ip_ = Eigen::Vector3d(0.1, 0.2, 0.3);
+  position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 1e-6;
+  position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+  const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, position_sensor_sptr };
+
+  mars::CoreLogic core_logic(core_states_sptr);
+  core_logic.state_publisher_ = std::make_shared<mars::ShmStatePublisher>(ShmName());
+  core_logic.state_publisher_period_ = 0;
+  ASSERT_TRUE(core_logic.state_publisher_->is_open());
+  core_logic.state_publisher_->AddSensor(position_sensor_sptr);
+
+  mars::ShmStateReader reader;
+  ASSERT_TRUE(reader.Open(ShmName()));
+
+  for (const auto& k : generator.get_arrival_stream())
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+    core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+    if (!core_logic.core_is_initialized_)
+    {
+      const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+      core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+    }
+  }
+
+  EXPECT_GT(core_logic.state_publisher_->get_num_published(), 0);
+  EXPECT_EQ(reader.get_latest_sequence(), core_logic.state_publisher_->get_num_published());
+
+  mars::ShmStateSample sample;
+  ASSERT_TRUE(reader.ReadLatest(&sample));
+
+  // Core state
+  mars::BufferEntryType latest_state;
+  ASSERT_TRUE(core_logic.buffer_.get_latest_state(&latest_state));
+  const mars::CoreType& core_data = *static_cast<mars::CoreType*>(latest_state.data_.core_.get());
+
+  EXPECT_DOUBLE_EQ(sample.core_.timestamp_, latest_state.timestamp_.get_seconds());
+  EXPECT_TRUE(Eigen::Map<const Eigen::Vector3d>(sample.core_.p_wi_).isApprox(core_data.state_.p_wi_));
+  EXPECT_EQ(sample.core_.q_wi_[0], core_data.state_.q_wi_.w());
+  EXPECT_TRUE(Eigen::Map<const Eigen::Vector3d>(sample.core_.q_wi_ + 1).isApprox(core_data.state_.q_wi_.vec()));
+  EXPECT_TRUE(Eigen::Map<const mars::CoreStateMatrix>(sample.core_.cov_).isApprox(core_data.cov_));
+
+  // Sensor state
+  mars::BufferEntryType sensor_entry;
+  ASSERT_TRUE(core_logic.buffer_.get_latest_sensor_handle_state(position_sensor_sptr, &sensor_entry));
+  const mars::PositionSensorData& sensor_data =
+      *static_cast<mars::PositionSensorData*>(sensor_entry.data_.sensor_.get());
+
+  ASSERT_EQ(sample.num_sensors_, 1);
+  const mars::ShmSensorState& sensor_state = sample.sensors_[0];
+  EXPECT_STREQ(sensor_state.name_, "Position");
+  EXPECT_EQ(sensor_state.valid_, 1);
+  EXPECT_DOUBLE_EQ(sensor_state.timestamp_, sensor_entry.timestamp_.get_seconds());
+  ASSERT_EQ(sensor_state.state_size_, 3);
+  EXPECT_TRUE(Eigen::Map<const Eigen::Vector3d>(sensor_state.state_).isApprox(sensor_data.state_.p_ip_));
+  ASSERT_EQ(sensor_state.cov_size_, 3);
+  EXPECT_TRUE(Eigen::Map<const Eigen::Matrix3d>(sensor_state.cov_).isApprox(sensor_data.sensor_cov_));
+}
+
+TEST_F(mars_shm_state_test, PUBLISH_PERIOD)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 5;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions position_options;
+  position_options.type_ = mars::SyntheticSensorType::position;
+  position_options.rate_ = 20;
+  generator.AddSensor(position_options);
+
+  // Returns the number of published samples, the number of processed updates and propagation steps
+  auto run = [&generator](const double& period, int* num_updates, int* num_propagations) {
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PositionSensorClass> position_sensor_sptr =
+        std::make_shared<mars::PositionSensorClass>("Position", core_states_sptr);
+    position_sensor_sptr->R_ = Eigen::Vector3d::Constant(0.05 * 0.05);
+    mars::PositionSensorData position_init_cal;
+    position_init_cal.sensor_cov_ = Eigen::Matrix3d::Identity() * 1e-6;
+    position_sensor_sptr->set_initial_calib(std::make_shared<mars::PositionSensorData>(position_init_cal));
+
+    const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, position_sensor_sptr };
+
+    mars::CoreLogic core_logic(core_states_sptr);
+    core_logic.state_publisher_ = std::make_shared<mars::ShmStatePublisher>(ShmName());
+    core_logic.state_publisher_period_ = period;
+
+    *num_updates = 0;
+    *num_propagations = 0;
+
+    for (const auto& k : generator.get_arrival_stream())
+    {
+      const bool initialized = core_logic.core_is_initialized_;
+
+      mars::BufferDataType data;
+      data.set_sensor_data(k.data_);
+      core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+      if (!initialized)
+      {
+        const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+        core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+        continue;
+      }
+
+      (k.sensor_idx_ == 0 ? *num_propagations : *num_updates)++;
+    }
+
+    return static_cast<int>(core_logic.state_publisher_->get_num_published());
+  };
+
+  int num_updates;
+  int num_propagations;
+
+  // Updates only by default
+  EXPECT_EQ(run(-1, &num_updates, &num_propagations), num_updates);
+  EXPECT_GT(num_updates, 90);
+
+  // Every propagation step
+  EXPECT_EQ(run(0, &num_updates, &num_propagations), num_updates + num_propagations);
+
+  // Propagation steps at 10 Hz
+  const int num_published = run(0.1, &num_updates, &num_propagations);
+  EXPECT_GE(num_published, num_updates + 49);
+  EXPECT_LE(num_published, num_updates + 51);
+}
+
+TEST_F(mars_shm_state_test, MULTIPLE_READER_PROCESSES)
+{
+  const int num_readers = 4;
+  const int num_samples = 20000;
+
+  // The name derives from the pid of the parent process
+  const std::string name = ShmName();
+  mars::ShmStatePublisher publisher(name, 8);
+  ASSERT_TRUE(publisher.is_open());
+
+  std::vector<pid_t> readers;
+  for (int k = 0; k < num_readers; k++)
+  {
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+
+    if (pid == 0)
+    {
+      // Reader process, reads until the last sample was published or the timeout passed
+      mars::ShmStateReader reader;
+      if (!reader.Open(name))
+      {
+        _exit(2);
+      }
+
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+      mars::ShmStateSample sample;
+      uint64_t last_sequence = 0;
+
+      while (last_sequence < num_samples && std::chrono::steady_clock::now() < deadline)
+      {
+        if (!reader.ReadLatest(&sample))
+        {
+          continue;
+        }
+
+        if (!IsConsistent(sample) || sample.sequence_ < last_sequence)
+        {
+          _exit(1);
+        }
+
+        last_sequence = sample.sequence_;
+      }
+
+      _exit(last_sequence == num_samples ? 0 : 3);
+    }
+
+    readers.push_back(pid);
+  }
+
+  mars::Buffer buffer(10);
+  for (int k = 1; k <= num_samples; k++)
+  {
+    buffer.AddEntrySorted(CoreEntry(k));
+    publisher.Publish(buffer);
+  }
+
+  for (const auto& pid : readers)
+  {
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+  }
+}
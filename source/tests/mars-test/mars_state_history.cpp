@@ -0,0 +1,271 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/state_history.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class mars_state_history_test : public testing::Test
+{
+public:
+  // IMU at 200 Hz and a noisy pose sensor at 20 Hz over 20 s
+  void SetUp() override
+  {
+    mars::SyntheticTrajectoryOptions options;
+    options.duration_ = 20;
+    options.seed_ = 3;
+    mars::SyntheticDataGenerator generator(options);
+
+    mars::SyntheticSensorOptions imu_options;
+    imu_options.type_ = mars::SyntheticSensorType::imu;
+    imu_options.rate_ = 200;
+    imu_options.noise_std_ = 0.01;
+    imu_options.noise_std_secondary_ = 0.001;
+
+    mars::SyntheticSensorOptions pose_options;
+    pose_options.type_ = mars::SyntheticSensorType::pose;
+    pose_options.rate_ = 20;
+    pose_options.noise_std_ = 0.02;
+    pose_options.noise_std_secondary_ = 0.01;
+
+    std::shared_ptr<mars::SweepDataset> dataset = std::make_shared<mars::SweepDataset>();
+    dataset->AddSensorMeasurements(generator.get_sensor_measurements(generator.AddSensor(imu_options)));
+    dataset->AddSensorMeasurements(generator.get_sensor_measurements(generator.AddSensor(pose_options)));
+    dataset_ = dataset;
+
+    const mars::CoreStateType ground_truth = generator.get_ground_truth(0);
+    p_wi_init_ = ground_truth.p_wi_;
+    q_wi_init_ = ground_truth.q_wi_;
+  }
+
+  // Setup of a run, the pose calibration is refined over the given duration if no initial calibration is used
+  mars::SweepRunSetup GenerateSetup(const bool& initial_calib = true, const double& refine_duration = 0,
+                                    const std::vector<double>& sensor_delays = {}) const
+  {
+    mars::SweepRunSetup setup;
+
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.01, 0.01, 0.01;
+    pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    if (initial_calib)
+    {
+      mars::PoseSensorData pose_init_cal;
+      Eigen::Matrix<double, 6, 1> std;
+      std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+      pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+      pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+    }
+    pose_sensor_sptr->auto_calib_.refine_duration_ = refine_duration;
+
+    setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    setup.sensors_ = { imu_sensor_sptr, pose_sensor_sptr };
+    setup.sensor_delays_ = sensor_delays;
+    setup.init_from_ground_truth_ = false;
+    setup.p_wi_init_ = p_wi_init_;
+    setup.q_wi_init_ = q_wi_init_;
+
+    return setup;
+  }
+
+  // Arrival time and latest state after each measurement of a full run without checkpoints
+  std::vector<std::pair<mars::Time, mars::BufferEntryType>> RunReference(const mars::SweepRunSetup& setup) const
+  {
+    const std::vector<mars::SweepMeasurement>& measurements = dataset_->get_measurements();
+    mars::CoreLogic& core_logic = *setup.core_logic_;
+    std::vector<std::pair<mars::Time, mars::BufferEntryType>> states;
+
+    for (const auto& idx : setup.get_arrival_order(*dataset_))
+    {
+      const mars::SweepMeasurement& k = measurements[idx];
+      mars::BufferDataType data;
+      data.set_sensor_data(k.data_);
+      core_logic.ProcessMeasurement(setup.sensors_[k.sensor_idx_], k.timestamp_, data);
+
+      if (!core_logic.core_is_initialized_ && k.sensor_idx_ == 0)
+      {
+        core_logic.Initialize(p_wi_init_, q_wi_init_);
+      }
+
+      mars::BufferEntryType latest_state;
+      if (core_logic.core_is_initialized_)
+      {
+        core_logic.buffer_.get_latest_state(&latest_state);
+      }
+      states.emplace_back(k.timestamp_.get_seconds() + setup.get_sensor_delay(k.sensor_idx_), latest_state);
+    }
+
+    return states;
+  }
+
+  // Reference state at the given time, the state after the last measurement that arrived up to this time
+  static mars::BufferEntryType get_reference(const std::vector<std::pair<mars::Time, mars::BufferEntryType>>& reference,
+                                             const mars::Time& t)
+  {
+    mars::BufferEntryType state;
+    for (size_t k = 0; k < reference.size() && reference[k].first <= t; k++)
+    {
+      state = reference[k].second;
+    }
+    return state;
+  }
+
+  static void ExpectEqualStates(const mars::BufferEntryType& a, const mars::BufferEntryType& b)
+  {
+    ASSERT_NE(a.data_.core_, nullptr);
+    ASSERT_NE(b.data_.core_, nullptr);
+    EXPECT_EQ(a.timestamp_, b.timestamp_);
+
+    const mars::CoreType* core_a = static_cast<mars::CoreType*>(a.data_.core_.get());
+    const mars::CoreType* core_b = static_cast<mars::CoreType*>(b.data_.core_.get());
+    EXPECT_EQ(core_a->state_.p_wi_, core_b->state_.p_wi_);
+    EXPECT_EQ(core_a->state_.v_wi_, core_b->state_.v_wi_);
+    EXPECT_EQ(core_a->state_.q_wi_.coeffs(), core_b->state_.q_wi_.coeffs());
+    EXPECT_EQ(core_a->state_.b_w_, core_b->state_.b_w_);
+    EXPECT_EQ(core_a->state_.b_a_, core_b->state_.b_a_);
+    EXPECT_EQ(core_a->cov_, core_b->cov_);
+  }
+
+  std::shared_ptr<const mars::SweepDataset> dataset_;
+  Eigen::Vector3d p_wi_init_;
+  Eigen::Quaterniond q_wi_init_;
+};
+
+TEST_F(mars_state_history_test, QUERY_MATCHES_FULL_RUN)
+{
+  const std::vector<std::pair<mars::Time, mars::BufferEntryType>> reference = RunReference(GenerateSetup());
+
+  mars::StateHistory history(dataset_, GenerateSetup());
+  history.checkpoint_interval_ = 2;
+  ASSERT_TRUE(history.Run());
+
+  // Filter before the first measurement and one checkpoint every 2 s from 0 s to 20 s
+  ASSERT_EQ(history.get_num_checkpoints(), 12);
+
+  // Times in decreasing order restore a checkpoint for each query, times on measurements include the measurement
+  mars::BufferEntryType state;
+  for (const double& t : { 20.0, 19.99, 17.3, 12.0, 12.0 - 0.0025, 8.05, 4.0, 0.5, 0.003 })
+  {
+    ASSERT_TRUE(history.get_state(t, &state)) << "t = " << t;
+    ExpectEqualStates(state, get_reference(reference, t));
+  }
+
+  // A single query replays less than one checkpoint interval
+  mars::StateHistory single(dataset_, GenerateSetup());
+  single.checkpoint_interval_ = 2;
+  single.Run();
+  ASSERT_TRUE(single.get_state(15.99, &state));
+  EXPECT_LT(single.get_num_replayed(), 2 * (200 + 20));
+  ExpectEqualStates(state, get_reference(reference, 15.99));
+
+  // No state before the initialization
+  EXPECT_FALSE(history.get_state(-1, &state));
+}
+
+TEST_F(mars_state_history_test, BATCH_QUERY)
+{
+  const std::vector<std::pair<mars::Time, mars::BufferEntryType>> reference = RunReference(GenerateSetup());
+
+  mars::StateHistory history(dataset_, GenerateSetup());
+  ASSERT_FALSE(history.get_state(1, nullptr));
+  ASSERT_TRUE(history.Run());
+
+  std::vector<mars::Time> times;
+  for (int k = 0; k < 500; k++)
+  {
+    times.push_back(-0.5 + (k * 7919 % 500) * 0.042);
+  }
+
+  std::vector<mars::BufferEntryType> states;
+  const int num_valid = history.get_states(times, &states);
+  ASSERT_EQ(states.size(), times.size());
+
+  // Sorted queries replay each measurement at most once
+  EXPECT_LE(history.get_num_replayed(), static_cast<int>(dataset_->get_measurements().size()));
+
+  int num_expected_valid = 0;
+  for (size_t k = 0; k < times.size(); k++)
+  {
+    const mars::BufferEntryType expected = get_reference(reference, times[k]);
+    if (expected.data_.core_ == nullptr)
+    {
+      EXPECT_EQ(states[k].data_.core_, nullptr);
+      continue;
+    }
+
+    num_expected_valid++;
+    ExpectEqualStates(states[k], expected);
+  }
+
+  EXPECT_EQ(num_valid, num_expected_valid);
+}
+
+TEST_F(mars_state_history_test, SENSOR_STATE_IS_PART_OF_CHECKPOINT)
+{
+  // The pose calibration is refined over 1 s, checkpoints within the refinement window hold a partial refinement
+  const std::vector<std::pair<mars::Time, mars::BufferEntryType>> reference =
+      RunReference(GenerateSetup(false, 1.0));
+
+  mars::StateHistory history(dataset_, GenerateSetup(false, 1.0));
+  history.checkpoint_interval_ = 0.4;
+  ASSERT_TRUE(history.Run());
+
+  // The run completed the refinement, the queries restore the refinement of their checkpoint
+  mars::BufferEntryType state;
+  for (const double& t : { 0.9, 0.5, 1.3, 2.5, 1.05 })
+  {
+    ASSERT_TRUE(history.get_state(t, &state)) << "t = " << t;
+    ExpectEqualStates(state, get_reference(reference, t));
+  }
+}
+
+TEST_F(mars_state_history_test, SENSOR_DELAYS)
+{
+  // The pose measurements arrive 32.5 ms late and are processed out of order
+  const std::vector<double> delays = { 0, 0.0325 };
+  const std::vector<std::pair<mars::Time, mars::BufferEntryType>> reference =
+      RunReference(GenerateSetup(true, 0, delays));
+
+  mars::StateHistory history(dataset_, GenerateSetup(true, 0, delays));
+  history.checkpoint_interval_ = 0.075;
+  ASSERT_TRUE(history.Run());
+
+  // The checkpoint at 0.075 s precedes the arrival of the first pose measurement at 0.0825 s
+  mars::BufferEntryType state;
+  for (const double& t : { 19.99, 12.0325, 12.0, 8.04, 4.031, 0.5, 0.14 })
+  {
+    ASSERT_TRUE(history.get_state(t, &state)) << "t = " << t;
+    ExpectEqualStates(state, get_reference(reference, t));
+  }
+
+  // The delayed estimate differs from the estimate of the in order run
+  const std::vector<std::pair<mars::Time, mars::BufferEntryType>> in_order = RunReference(GenerateSetup());
+  ASSERT_TRUE(history.get_state(12.02, &state));
+  const mars::CoreType* core = static_cast<mars::CoreType*>(state.data_.core_.get());
+  const mars::CoreType* core_in_order = static_cast<mars::CoreType*>(get_reference(in_order, 12.02).data_.core_.get());
+  EXPECT_GT((core->state_.p_wi_ - core_in_order->state_.p_wi_).norm(), 0);
+}
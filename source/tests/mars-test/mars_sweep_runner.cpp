@@ -0,0 +1,178 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sweep_runner.h>
+#include <mars/type_definitions/buffer_entry_type.h>
+#include <Eigen/Dense>
+#include <memory>
+#include <vector>
+
+class mars_sweep_runner_test : public testing::Test
+{
+public:
+  // Stationary IMU at p_wi = [0, 0, 5] with ground truth, 200 Hz for one second
+  static void GenerateImuData(std::vector<mars::BufferEntryType>* data)
+  {
+    for (int k = 0; k < 200; k++)
+    {
+      mars::CoreStateType ground_truth;
+      ground_truth.p_wi_ = Eigen::Vector3d(0, 0, 5);
+
+      mars::BufferDataType entry_data;
+      entry_data.set_core_data(std::make_shared<mars::CoreStateType>(ground_truth));
+      entry_data.set_sensor_data(
+          std::make_shared<mars::IMUMeasurementType>(Eigen::Vector3d(0, 0, 9.81), Eigen::Vector3d::Zero()));
+
+      data->push_back(mars::BufferEntryType(k * 0.005, entry_data, nullptr, mars::BufferMetadataType::measurement));
+    }
+  }
+
+  // Pose measurements of the stationary trajectory at 20 Hz
+  static void GeneratePoseData(std::vector<mars::BufferEntryType>* data)
+  {
+    for (int k = 1; k < 20; k++)
+    {
+      mars::BufferDataType entry_data;
+      entry_data.set_sensor_data(
+          std::make_shared<mars::PoseMeasurementType>(Eigen::Vector3d(0, 0, 5), Eigen::Quaterniond::Identity()));
+
+      data->push_back(mars::BufferEntryType(k * 0.05, entry_data, nullptr, mars::BufferMetadataType::measurement));
+    }
+  }
+
+  static mars::SweepRunSetup GenerateSetup(const double& pose_delay)
+  {
+    mars::SweepRunSetup setup;
+
+    std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+    std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+    core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+
+    std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+        std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+    pose_sensor_sptr->const_ref_to_nav_ = true;
+
+    Eigen::Matrix<double, 6, 1> pose_meas_std;
+    pose_meas_std << 0.02, 0.02, 0.02, 0.035, 0.035, 0.035;
+    pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+    mars::PoseSensorData pose_init_cal;
+    Eigen::Matrix<double, 6, 1> std;
+    std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+    pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+    pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+    setup.core_logic_ = std::make_shared<mars::CoreLogic>(core_states_sptr);
+    setup.sensors_ = { imu_sensor_sptr, pose_sensor_sptr };
+    setup.sensor_delays_ = { 0.0, pose_delay };
+
+    return setup;
+  }
+};
+
+TEST_F(mars_sweep_runner_test, DATASET)
+{
+  std::vector<mars::BufferEntryType> imu_data;
+  std::vector<mars::BufferEntryType> pose_data;
+  GenerateImuData(&imu_data);
+  GeneratePoseData(&pose_data);
+
+  mars::SweepDataset dataset;
+  ASSERT_FALSE(dataset.has_ground_truth());
+
+  ASSERT_EQ(dataset.AddSensorMeasurements(imu_data), 0);
+  ASSERT_EQ(dataset.AddSensorMeasurements(pose_data), 1);
+  dataset.AddGroundTruth(imu_data);
+
+  ASSERT_EQ(dataset.get_num_sensors(), 2);
+  ASSERT_TRUE(dataset.has_ground_truth());
+  ASSERT_EQ(dataset.get_measurements().size(), imu_data.size() + pose_data.size());
+
+  // Measurements are sorted and the IMU entry comes first for equal timestamps
+  const std::vector<mars::SweepMeasurement>& measurements = dataset.get_measurements();
+  for (size_t k = 1; k < measurements.size(); k++)
+  {
+    ASSERT_TRUE(measurements[k - 1].timestamp_ <= measurements[k].timestamp_);
+    if (measurements[k - 1].timestamp_ == measurements[k].timestamp_)
+    {
+      ASSERT_LE(measurements[k - 1].sensor_idx_, measurements[k].sensor_idx_);
+    }
+  }
+
+  // Payloads are shared and not copied
+  ASSERT_EQ(measurements[0].data_.get(), imu_data[0].data_.sensor_.get());
+
+  mars::CoreStateType ground_truth;
+  ASSERT_TRUE(dataset.get_ground_truth(0.5, &ground_truth));
+  ASSERT_TRUE(ground_truth.p_wi_.isApprox(Eigen::Vector3d(0, 0, 5)));
+  ASSERT_FALSE(dataset.get_ground_truth(0.5025, &ground_truth));
+  ASSERT_TRUE(dataset.get_ground_truth(0.5025, &ground_truth, 0.003));
+}
+
+TEST_F(mars_sweep_runner_test, PARALLEL_RUNS)
+{
+  std::vector<mars::BufferEntryType> imu_data;
+  std::vector<mars::BufferEntryType> pose_data;
+  GenerateImuData(&imu_data);
+  GeneratePoseData(&pose_data);
+
+  std::shared_ptr<mars::SweepDataset> dataset = std::make_shared<mars::SweepDataset>();
+  dataset->AddSensorMeasurements(imu_data);
+  dataset->AddSensorMeasurements(pose_data);
+  dataset->AddGroundTruth(imu_data);
+
+  const int num_runs = 6;
+  mars::SweepRunner runner(dataset, 3);
+  ASSERT_EQ(runner.get_num_threads(), 3);
+
+  // Even runs are delayed, odd runs are not
+  std::vector<mars::SweepRunResult> results =
+      runner.Run(num_runs, [](const int& run_id) { return GenerateSetup((run_id % 2) * 0.02); });
+
+  ASSERT_EQ(static_cast<int>(results.size()), num_runs);
+
+  for (int k = 0; k < num_runs; k++)
+  {
+    EXPECT_EQ(results[k].run_id_, k);
+    EXPECT_TRUE(results[k].valid_);
+    EXPECT_EQ(results[k].num_measurements_, static_cast<int>(imu_data.size() + pose_data.size()));
+    EXPECT_LT(results[k].p_rmse_, 1e-3);
+    EXPECT_LT(results[k].q_rmse_deg_, 1e-3);
+  }
+
+  // The same setup on the shared dataset leads to the same result independent of the worker thread
+  for (int k = 2; k < num_runs; k++)
+  {
+    EXPECT_EQ(results[k].num_evaluations_, results[k % 2].num_evaluations_);
+    EXPECT_DOUBLE_EQ(results[k].p_rmse_, results[k % 2].p_rmse_);
+    EXPECT_DOUBLE_EQ(results[k].v_rmse_, results[k % 2].v_rmse_);
+  }
+
+  // Single threaded execution matches the parallel execution
+  mars::SweepRunResult single = mars::SweepRunner::RunSingle(*dataset, 0, GenerateSetup(0));
+  EXPECT_DOUBLE_EQ(single.p_rmse_, results[0].p_rmse_);
+}
+
+TEST_F(mars_sweep_runner_test, MISSING_CORE_LOGIC)
+{
+  mars::SweepDataset dataset;
+  mars::SweepRunSetup setup;
+
+  mars::SweepRunResult result = mars::SweepRunner::RunSingle(dataset, 3, setup);
+  ASSERT_EQ(result.run_id_, 3);
+  ASSERT_FALSE(result.valid_);
+}
@@ -0,0 +1,325 @@
+// Copyright (C) 2022 Christian Brommer, Control of Networked Systems, University of Klagenfurt, Austria.
+//
+// All rights reserved.
+//
+// This software is licensed under the terms of the BSD-2-Clause-License with
+// no commercial use allowed, the full terms of which are made available
+// in the LICENSE file. No license in patents is granted.
+//
+// You can contact the author at <christian.brommer@ieee.org>
+
+#include <gmock/gmock.h>
+#include <mars/core_logic.h>
+#include <mars/core_state.h>
+#include <mars/data_utils/read_pose_data.h>
+#include <mars/data_utils/read_sim_data.h>
+#include <mars/data_utils/synthetic_data.h>
+#include <mars/journal.h>
+#include <mars/sensors/gps/gps_measurement_type.h>
+#include <mars/sensors/imu/imu_measurement_type.h>
+#include <mars/sensors/imu/imu_sensor_class.h>
+#include <mars/sensors/pose/pose_measurement_type.h>
+#include <mars/sensors/pose/pose_sensor_class.h>
+#include <mars/sensors/pressure/pressure_conversion.h>
+#include <mars/sensors/pressure/pressure_measurement_type.h>
+#include <mars/type_definitions/core_type.h>
+#include <Eigen/Dense>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+class mars_synthetic_data_test : public testing::Test
+{
+public:
+  const std::string file_path_{ "mars_synthetic_data_test.tmp" };
+
+  void TearDown() override
+  {
+    std::remove(file_path_.c_str());
+  }
+};
+
+TEST_F(mars_synthetic_data_test, GROUND_TRUTH_DERIVATIVES)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.b_a_ = Eigen::Vector3d(0.1, -0.2, 0.05);
+  options.b_w_ = Eigen::Vector3d(0.01, 0.02, -0.01);
+  mars::SyntheticDataGenerator generator(options);
+
+  const double h = 1e-5;
+  const Eigen::Vector3d g(0, 0, 9.81);
+
+  for (double t = 0.5; t < 20; t += 1.3)
+  {
+    const mars::CoreStateType x = generator.get_ground_truth(t);
+    const mars::CoreStateType x_prev = generator.get_ground_truth(t - h);
+    const mars::CoreStateType x_next = generator.get_ground_truth(t + h);
+
+    // Velocity and acceleration
+    EXPECT_TRUE(((x_next.p_wi_ - x_prev.p_wi_) / (2 * h)).isApprox(x.v_wi_, 1e-6));
+    const Eigen::Vector3d a_w = x.q_wi_.toRotationMatrix() * (x.a_m_ - x.b_a_) - g;
+    EXPECT_TRUE(((x_next.v_wi_ - x_prev.v_wi_) / (2 * h)).isApprox(a_w, 1e-6));
+
+    // Angular velocity in the body frame, q_dot = 0.5 * q * [0, w]
+    const Eigen::Quaterniond dq = x_prev.q_wi_.conjugate() * x_next.q_wi_;
+    const Eigen::Vector3d w_numeric = 2 * dq.vec() / (2 * h);
+    EXPECT_TRUE(w_numeric.isApprox(x.w_m_ - x.b_w_, 1e-6));
+  }
+}
+
+TEST_F(mars_synthetic_data_test, SENSOR_OPTIONS)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 2;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 2000;
+  imu_options.timestamp_jitter_ = 1e-4;
+  const int imu_idx = generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions pose_options;
+  pose_options.rate_ = 100;
+  pose_options.dropout_ = 0.5;
+  pose_options.delay_ = 0.1;
+  pose_options.delay_jitter_ = 0.01;
+  pose_options.p_ix_ = Eigen::Vector3d(0.1, 0.2, -0.3);
+  pose_options.q_ix_ = Eigen::Quaterniond(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitX()));
+  const int pose_idx = generator.AddSensor(pose_options);
+
+  ASSERT_EQ(generator.get_num_sensors(), 2);
+
+  // IMU at 2 kHz with strictly increasing sample times
+  const std::vector<mars::BufferEntryType>& imu_data = generator.get_sensor_measurements(imu_idx);
+  ASSERT_EQ(imu_data.size(), 4001);
+  for (size_t k = 1; k < imu_data.size(); k++)
+  {
+    ASSERT_GT(imu_data[k].timestamp_, imu_data[k - 1].timestamp_);
+  }
+  ASSERT_NE(imu_data[0].data_.core_, nullptr);
+
+  // Dropout
+  const std::vector<mars::BufferEntryType>& pose_data = generator.get_sensor_measurements(pose_idx);
+  EXPECT_GT(pose_data.size(), 60);
+  EXPECT_LT(pose_data.size(), 140);
+
+  // Noise free pose measurements of the calibrated sensor
+  for (const auto& k : pose_data)
+  {
+    const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+    const auto& meas = *static_cast<mars::PoseMeasurementType*>(k.data_.sensor_.get());
+    EXPECT_TRUE(meas.position_.isApprox(gt.p_wi_ + gt.q_wi_.toRotationMatrix() * pose_options.p_ix_, 1e-12));
+    EXPECT_TRUE(meas.orientation_.isApprox(gt.q_wi_ * pose_options.q_ix_, 1e-12));
+  }
+
+  // The arrival stream is sorted by arrival and delays the pose measurements
+  const std::vector<mars::SyntheticMeasurement> stream = generator.get_arrival_stream();
+  ASSERT_EQ(stream.size(), imu_data.size() + pose_data.size());
+  for (size_t k = 1; k < stream.size(); k++)
+  {
+    ASSERT_LE(stream[k - 1].arrival_, stream[k].arrival_);
+    if (stream[k].sensor_idx_ == pose_idx)
+    {
+      ASSERT_GE((stream[k].arrival_ - stream[k].timestamp_).get_seconds(), 0.1 - 1e-12);
+    }
+  }
+}
+
+TEST_F(mars_synthetic_data_test, GPS_AND_PRESSURE)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 5;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions gps_options;
+  gps_options.type_ = mars::SyntheticSensorType::gps;
+  gps_options.rate_ = 5;
+  const int gps_idx = generator.AddSensor(gps_options);
+
+  mars::SyntheticSensorOptions pressure_options;
+  pressure_options.type_ = mars::SyntheticSensorType::pressure;
+  pressure_options.rate_ = 5;
+  const int pressure_idx = generator.AddSensor(pressure_options);
+
+  mars::GpsConversion gps_conversion(options.gps_reference_);
+  for (const auto& k : generator.get_sensor_measurements(gps_idx))
+  {
+    const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+    const auto& meas = *static_cast<mars::GpsMeasurementType*>(k.data_.sensor_.get());
+    EXPECT_TRUE(gps_conversion.get_enu(meas.coordinates_).isApprox(gt.p_wi_, 1e-6));
+  }
+
+  // The height relative to a sea level reference matches the ground truth
+  const mars::Pressure reference(101325, options.temperature_K_, mars::Pressure::Type::GAS);
+  mars::PressureConversion pressure_conversion(reference);
+  for (const auto& k : generator.get_sensor_measurements(pressure_idx))
+  {
+    const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+    const auto& meas = *static_cast<mars::PressureMeasurementType*>(k.data_.sensor_.get());
+    EXPECT_NEAR(pressure_conversion.get_height(meas.pressure_)(0), gt.p_wi_(2), 1e-6);
+  }
+}
+
+TEST_F(mars_synthetic_data_test, CSV_ROUND_TRIP)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 1;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 200;
+  imu_options.noise_std_ = 0.01;
+  imu_options.noise_std_secondary_ = 0.001;
+  const int imu_idx = generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions pose_options;
+  pose_options.noise_std_ = 0.01;
+  pose_options.noise_std_secondary_ = 0.01;
+  const int pose_idx = generator.AddSensor(pose_options);
+
+  ASSERT_TRUE(generator.WriteCsv(imu_idx, file_path_));
+  std::vector<mars::BufferEntryType> imu_data;
+  mars::ReadSimData(&imu_data, nullptr, file_path_);
+
+  ASSERT_EQ(imu_data.size(), generator.get_sensor_measurements(imu_idx).size());
+  for (size_t k = 0; k < imu_data.size(); k++)
+  {
+    const mars::BufferEntryType& expected = generator.get_sensor_measurements(imu_idx)[k];
+    ASSERT_EQ(imu_data[k].timestamp_, expected.timestamp_);
+    ASSERT_EQ(*static_cast<mars::IMUMeasurementType*>(imu_data[k].data_.sensor_.get()),
+              *static_cast<mars::IMUMeasurementType*>(expected.data_.sensor_.get()));
+    ASSERT_EQ(static_cast<mars::CoreStateType*>(imu_data[k].data_.core_.get())->p_wi_,
+              static_cast<mars::CoreStateType*>(expected.data_.core_.get())->p_wi_);
+  }
+
+  ASSERT_TRUE(generator.WriteCsv(pose_idx, file_path_));
+  std::vector<mars::BufferEntryType> pose_data;
+  mars::ReadPoseData(&pose_data, nullptr, file_path_);
+
+  ASSERT_EQ(pose_data.size(), generator.get_sensor_measurements(pose_idx).size());
+  for (size_t k = 0; k < pose_data.size(); k++)
+  {
+    const mars::BufferEntryType& expected = generator.get_sensor_measurements(pose_idx)[k];
+    const auto& meas = *static_cast<mars::PoseMeasurementType*>(pose_data[k].data_.sensor_.get());
+    const auto& meas_expected = *static_cast<mars::PoseMeasurementType*>(expected.data_.sensor_.get());
+    ASSERT_EQ(meas.position_, meas_expected.position_);
+    ASSERT_EQ(meas.orientation_.coeffs(), meas_expected.orientation_.coeffs());
+  }
+
+  ASSERT_FALSE(generator.WriteCsv(2, file_path_));
+}
+
+TEST_F(mars_synthetic_data_test, FEED_CORE_LOGIC)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 10;
+  options.seed_ = 42;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 400;
+  imu_options.noise_std_ = 0.013;
+  imu_options.noise_std_secondary_ = 0.0013;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions pose_options;
+  pose_options.rate_ = 20;
+  pose_options.noise_std_ = 0.01;
+  pose_options.noise_std_secondary_ = 0.01;
+  pose_options.delay_ = 0.05;
+  pose_options.delay_jitter_ = 0.01;
+  pose_options.dropout_ = 0.1;
+  generator.AddSensor(pose_options);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>();
+  core_states_sptr->set_propagation_sensor(imu_sensor_sptr);
+  core_states_sptr->set_noise_std(Eigen::Vector3d::Constant(0.0013), Eigen::Vector3d::Constant(0.0001),
+                                  Eigen::Vector3d::Constant(0.013), Eigen::Vector3d::Constant(0.001));
+
+  std::shared_ptr<mars::PoseSensorClass> pose_sensor_sptr =
+      std::make_shared<mars::PoseSensorClass>("Pose", core_states_sptr);
+  pose_sensor_sptr->const_ref_to_nav_ = true;
+  Eigen::Matrix<double, 6, 1> pose_meas_std;
+  pose_meas_std << 0.01, 0.01, 0.01, 0.01, 0.01, 0.01;
+  pose_sensor_sptr->R_ = pose_meas_std.cwiseProduct(pose_meas_std);
+
+  mars::PoseSensorData pose_init_cal;
+  Eigen::Matrix<double, 6, 1> std;
+  std << 0.1, 0.1, 0.1, 0.17, 0.17, 0.17;
+  pose_init_cal.sensor_cov_ = std.cwiseProduct(std).asDiagonal();
+  pose_sensor_sptr->set_initial_calib(std::make_shared<mars::PoseSensorData>(pose_init_cal));
+
+  mars::CoreLogic core_logic(core_states_sptr);
+  const std::vector<std::shared_ptr<mars::SensorAbsClass>> sensors = { imu_sensor_sptr, pose_sensor_sptr };
+
+  for (const auto& k : generator.get_arrival_stream())
+  {
+    mars::BufferDataType data;
+    data.set_sensor_data(k.data_);
+    core_logic.ProcessMeasurement(sensors[k.sensor_idx_], k.timestamp_, data);
+
+    if (!core_logic.core_is_initialized_ && k.sensor_idx_ == 0)
+    {
+      const mars::CoreStateType gt = generator.get_ground_truth(k.timestamp_.get_seconds());
+      core_logic.Initialize(gt.p_wi_, gt.q_wi_);
+    }
+  }
+
+  mars::BufferEntryType latest_state;
+  ASSERT_TRUE(core_logic.buffer_.get_latest_state(&latest_state));
+  const mars::CoreStateType& state = static_cast<mars::CoreType*>(latest_state.data_.core_.get())->state_;
+  const mars::CoreStateType gt = generator.get_ground_truth(latest_state.timestamp_.get_seconds());
+
+  EXPECT_LT((state.p_wi_ - gt.p_wi_).norm(), 0.1);
+  EXPECT_LT((state.v_wi_ - gt.v_wi_).norm(), 0.2);
+  EXPECT_LT(state.q_wi_.angularDistance(gt.q_wi_), 0.05);
+}
+
+TEST_F(mars_synthetic_data_test, WRITE_JOURNAL)
+{
+  mars::SyntheticTrajectoryOptions options;
+  options.duration_ = 1;
+  mars::SyntheticDataGenerator generator(options);
+
+  mars::SyntheticSensorOptions imu_options;
+  imu_options.type_ = mars::SyntheticSensorType::imu;
+  imu_options.rate_ = 100;
+  generator.AddSensor(imu_options);
+
+  mars::SyntheticSensorOptions gps_options;
+  gps_options.type_ = mars::SyntheticSensorType::gps_w_vel;
+  gps_options.rate_ = 10;
+  gps_options.delay_ = 0.2;
+  generator.AddSensor(gps_options);
+
+  std::shared_ptr<mars::ImuSensorClass> imu_sensor_sptr = std::make_shared<mars::ImuSensorClass>("IMU");
+  std::shared_ptr<mars::ImuSensorClass> gps_sensor_sptr = std::make_shared<mars::ImuSensorClass>("GPS");
+
+  ASSERT_FALSE(generator.WriteJournal(file_path_, { imu_sensor_sptr }));
+  ASSERT_TRUE(generator.WriteJournal(file_path_, { imu_sensor_sptr, gps_sensor_sptr }));
+
+  mars::JournalReader reader(file_path_);
+  ASSERT_TRUE(reader.IsOpen());
+
+  const std::vector<mars::SyntheticMeasurement> stream = generator.get_arrival_stream();
+  mars::JournalRecord record;
+  size_t num_measurements = 0;
+
+  while (reader.ReadNext(&record))
+  {
+    if (record.type_ == mars::JournalRecordType::measurement)
+    {
+      ASSERT_LT(num_measurements, stream.size());
+      ASSERT_EQ(record.timestamp_, stream[num_measurements].timestamp_);
+      ASSERT_EQ(record.sensor_id_, stream[num_measurements].sensor_idx_);
+      ASSERT_NE(record.payload_, nullptr);
+      num_measurements++;
+    }
+  }
+
+  ASSERT_EQ(num_measurements, stream.size());
+}
@@ -56,9 +56,61 @@ TEST_F(mars_vision_sensor_test, VISION_SENSOR_INIT)
   std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>(core_states);
   mars::VisionSensorClass vision_sensor("Vision", core_states_sptr);
 
-  EXPECT_DEATH(vision_sensor.Initialize(1, std::make_shared<mars::VisionMeasurementType>(measurement),
-                                        std::make_shared<mars::CoreType>()),
-               "");
+  mars::CoreType core_data;
+  core_data.cov_.setIdentity();
+
+  // Without a given calibration, the sensor is calibrated from the measurement
+  mars::BufferDataType init_data = vision_sensor.Initialize(
+      1, std::make_shared<mars::VisionMeasurementType>(measurement), std::make_shared<mars::CoreType>(core_data));
+
+  EXPECT_TRUE(vision_sensor.is_initialized_);
+  EXPECT_TRUE(vision_sensor.get_state(init_data.sensor_).p_vw_.isApprox(position));
+}
+
+TEST_F(mars_vision_sensor_test, VISION_AUTO_CALIBRATION)
+{
+  mars::CoreState core_states;
+  std::shared_ptr<mars::CoreState> core_states_sptr = std::make_shared<mars::CoreState>(core_states);
+  mars::VisionSensorClass vision_sensor("Vision", core_states_sptr);
+
+  mars::CoreType core_data;
+  core_data.state_.p_wi_ = Eigen::Vector3d(1, -2, 0.5);
+  core_data.state_.q_wi_ = Eigen::Quaterniond(Eigen::AngleAxisd(0.7, Eigen::Vector3d(1, 2, 3).normalized()));
+  core_data.cov_.setIdentity();
+
+  // Camera at the IMU with unit scale, as assumed by the auto calibration
+  const Eigen::Vector3d p_vw(0.4, -0.2, 1.5);
+  const Eigen::Quaterniond q_vw(Eigen::AngleAxisd(-0.4, Eigen::Vector3d(1, 0, 1).normalized()));
+  const mars::CoreStateType& core = core_data.state_;
+  const mars::VisionMeasurementType measurement(p_vw + q_vw.toRotationMatrix() * core.p_wi_, q_vw * core.q_wi_);
+
+  mars::VisionSensorData sensor_data;
+  EXPECT_TRUE(vision_sensor.CalcAutoCalibration(0, measurement, core_data, &sensor_data));
+  EXPECT_TRUE(sensor_data.state_.p_vw_.isApprox(p_vw, 1e-12));
+  EXPECT_TRUE(sensor_data.state_.q_vw_.isApprox(q_vw, 1e-12));
+
+  // With an identity core covariance, the cross-covariance holds the core jacobian
+  const Eigen::MatrixXd J_core = sensor_data.core_sensor_cross_cov_.transpose();
+
+  const double eps = 1e-6;
+  for (int k = 0; k < mars::CoreStateType::size_error_; k++)
+  {
+    mars::CoreType perturbed = core_data;
+    Eigen::Matrix<double, mars::CoreStateType::size_error_, 1> delta;
+    delta.setZero();
+    delta(k) = eps;
+    perturbed.state_.p_wi_ += delta.segment<3>(0);
+    perturbed.state_.q_wi_ = perturbed.state_.q_wi_ * mars::Utils::QuatFromSmallAngle(delta.segment<3>(6));
+
+    mars::VisionSensorData perturbed_data;
+    vision_sensor.CalcAutoCalibration(0, measurement, perturbed, &perturbed_data);
+
+    Eigen::Matrix<double, 13, 1> difference;
+    difference.setZero();
+    difference.segment<3>(0) = perturbed_data.state_.p_vw_ - sensor_data.state_.p_vw_;
+    difference.segment<3>(3) = 2 * (sensor_data.state_.q_vw_.conjugate() * perturbed_data.state_.q_vw_).vec();
+    EXPECT_TRUE((difference / eps - J_core.col(k)).cwiseAbs().maxCoeff() < 1e-5) << "Core error state " << k;
+  }
 }
 
 TEST_F(mars_vision_sensor_test, VISION_UPDATE)